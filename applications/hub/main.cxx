@@ -43,6 +43,10 @@
 #include "utils/constants.hxx"
 #include "utils/Hub.hxx"
 #include "utils/GcTcpHub.hxx"
+#include "utils/BinaryCanHub.hxx"
+#include "utils/CanCapture.hxx"
+#include "utils/ShardedCanHub.hxx"
+#include "utils/ShmCanHub.hxx"
 #include "utils/ClientConnection.hxx"
 #include "executor/Executor.hxx"
 #include "executor/Service.hxx"
@@ -54,9 +58,16 @@ CanHubFlow can_hub0(&g_service);
 OVERRIDE_CONST(gc_generate_newlines, 1);
 OVERRIDE_CONST(gridconnect_buffer_size, 1300);
 OVERRIDE_CONST(gridconnect_buffer_delay_usec, 2000);
+/// A TCP client that cannot keep up is disconnected after falling this many
+/// frames behind, instead of the hub buffering for it without bounds. The
+/// device (-d) and upstream (-u) links are not limited.
+OVERRIDE_CONST(hub_port_queue_max_frames, 2000);
 
 
 int port = 12021;
+int binary_port = -1;
+int num_shards = 1;
+bool upstream_binary = false;
 const char *device_path = nullptr;
 int upstream_port = 12021;
 const char *upstream_host = nullptr;
@@ -64,11 +75,23 @@ bool timestamped = false;
 bool export_mdns = false;
 const char* mdns_name = "openmrn_hub";
 bool printpackets = false;
+const char *capture_path = nullptr;
+int capture_mb = 0;
+const char *replay_path = nullptr;
+double replay_speed = 1;
+const char *shm_server_name = nullptr;
+const char *shm_client_name = nullptr;
+
+/// How many rotated capture files are kept with -C.
+static constexpr unsigned CAPTURE_FILES = 4;
 
 void usage(const char *e)
 {
-    fprintf(stderr, "Usage: %s [-p port] [-d device_path] [-u upstream_host] "
-                    "[-q upstream_port] [-m] [-n mdns_name] [-t] [-l]\n\n",
+    fprintf(stderr, "Usage: %s [-p port] [-b binary_port] [-d device_path] "
+                    "[-u upstream_host] [-q upstream_port] [-B] [-k shards] [-m] "
+                    "[-n mdns_name] [-t] [-l] [-c capture_file] [-C capture_mb] "
+                    "[-r replay_file] [-R speed] [-s shm_name] [-S shm_name]"
+                    "\n\n",
             e);
     fprintf(stderr, "GridConnect CAN HUB.\nListens to a specific TCP port, "
                     "reads CAN packets from the incoming connections using "
@@ -76,6 +99,9 @@ void usage(const char *e)
                     "packets to all other participants.\n\nArguments:\n");
     fprintf(stderr, "\t-p port     specifies the port number to listen on, "
                     "default is 12021.\n");
+    fprintf(stderr, "\t-b binary_port   also listens on this port for "
+                    "connections using the compact binary CAN protocol. Use "
+                    "for hub-to-hub links.\n");
     fprintf(stderr, "\t-d device   is a path to a physical device doing "
                     "serial-CAN or USB-CAN. If specified, opens device and "
                     "adds it to the hub.\n");
@@ -84,10 +110,37 @@ void usage(const char *e)
                     "hub.\n");
     fprintf(stderr,
             "\t-q upstream_port   is the port number for the upstream hub.\n");
+    fprintf(stderr,
+            "\t-B uses the binary CAN protocol for the upstream connection. "
+            "The upstream_port has to be the -b port of the upstream hub.\n");
+    fprintf(stderr,
+            "\t-k shards   distributes the GridConnect clients over this "
+            "many threads, each with its own part of the hub. Default is "
+            "1.\n");
     fprintf(stderr,
             "\t-t prints timestamps for each packet.\n");
     fprintf(stderr,
             "\t-l print all packets.\n");
+    fprintf(stderr,
+            "\t-c capture_file   writes all traffic to this file in the "
+            "binary capture format.\n");
+    fprintf(stderr,
+            "\t-C capture_mb   starts a new capture file after this many "
+            "megabytes, keeping %u old ones.\n", CAPTURE_FILES);
+    fprintf(stderr,
+            "\t-r replay_file   sends the traffic of a capture file to the "
+            "hub.\n");
+    fprintf(stderr,
+            "\t-R speed   replay speed multiplier. 1 is the original "
+            "timing (default), 0 is as fast as the hub takes it.\n");
+#if OPENMRN_HAVE_FUTEX
+    fprintf(stderr,
+            "\t-s shm_name   accepts processes on the same host through "
+            "this shared memory segment, e.g. /openmrn_hub.\n");
+    fprintf(stderr,
+            "\t-S shm_name   connects to the shared memory segment of "
+            "another hub on the same host.\n");
+#endif
 #ifdef HAVE_AVAHI_CLIENT
     fprintf(stderr,
             "\t-m exports the current service on mDNS.\n");
@@ -100,7 +153,7 @@ void usage(const char *e)
 void parse_args(int argc, char *argv[])
 {
     int opt;
-    while ((opt = getopt(argc, argv, "hp:d:u:q:tlmn:")) >= 0)
+    while ((opt = getopt(argc, argv, "hp:b:Bd:u:q:k:tlmn:c:C:r:R:s:S:")) >= 0)
     {
         switch (opt)
         {
@@ -113,12 +166,25 @@ void parse_args(int argc, char *argv[])
             case 'p':
                 port = atoi(optarg);
                 break;
+            case 'b':
+                binary_port = atoi(optarg);
+                break;
+            case 'B':
+                upstream_binary = true;
+                break;
             case 'u':
                 upstream_host = optarg;
                 break;
             case 'q':
                 upstream_port = atoi(optarg);
                 break;
+            case 'k':
+                num_shards = atoi(optarg);
+                if (num_shards < 1)
+                {
+                    usage(argv[0]);
+                }
+                break;
             case 't':
                 timestamped = true;
                 break;
@@ -132,6 +198,28 @@ void parse_args(int argc, char *argv[])
             case 'l':
                 printpackets = true;
                 break;
+            case 'c':
+                capture_path = optarg;
+                break;
+            case 'C':
+                capture_mb = atoi(optarg);
+                break;
+            case 'r':
+                replay_path = optarg;
+                break;
+            case 'R':
+                replay_speed = atof(optarg);
+                if (replay_speed < 0)
+                {
+                    usage(argv[0]);
+                }
+                break;
+            case 's':
+                shm_server_name = optarg;
+                break;
+            case 'S':
+                shm_client_name = optarg;
+                break;
             default:
                 fprintf(stderr, "Unknown option %c\n", opt);
                 usage(argv[0]);
@@ -153,8 +241,56 @@ int appl_main(int argc, char *argv[])
         packet_printer = new GcPacketPrinter(&can_hub0, timestamped);
     }
     fprintf(stderr,"packet_printer points to %p\n",packet_printer);
-    GcTcpHub hub(&can_hub0, port);
+    std::unique_ptr<CanCapturePort> capture;
+    if (capture_path)
+    {
+        capture.reset(new CanCapturePort(&can_hub0, capture_path,
+            (size_t)capture_mb << 20, capture_mb ? CAPTURE_FILES + 1 : 1));
+    }
+    std::unique_ptr<CanReplay> replay;
+    if (replay_path)
+    {
+        replay.reset(new CanReplay(&can_hub0, replay_path, replay_speed));
+        if (!replay->is_valid())
+        {
+            fprintf(stderr, "Cannot replay %s.\n", replay_path);
+            exit(1);
+        }
+    }
+    // The first shard is can_hub0; the upstream, the device and the binary
+    // port stay there.
+    ShardedCanHub shards(&can_hub0, num_shards);
+    GcTcpHub hub(&shards, port);
+    std::unique_ptr<BinaryCanTcpHub> binary_hub;
+    if (binary_port >= 0)
+    {
+        binary_hub.reset(new BinaryCanTcpHub(&can_hub0, binary_port));
+    }
     vector<std::unique_ptr<ConnectionClient>> connections;
+#if OPENMRN_HAVE_FUTEX
+    std::unique_ptr<ShmCanHub> shm_hub;
+    if (shm_server_name)
+    {
+        shm_hub.reset(new ShmCanHub(&can_hub0, shm_server_name));
+        if (!shm_hub->is_valid())
+        {
+            fprintf(stderr, "Cannot create shared memory %s.\n",
+                shm_server_name);
+            exit(1);
+        }
+    }
+    std::unique_ptr<ShmCanHubPort> shm_port;
+    if (shm_client_name)
+    {
+        shm_port.reset(new ShmCanHubPort(&can_hub0, shm_client_name));
+        if (!shm_port->is_valid())
+        {
+            fprintf(stderr, "Cannot connect to shared memory %s.\n",
+                shm_client_name);
+            exit(1);
+        }
+    }
+#endif
 
 #ifdef HAVE_AVAHI_CLIENT
     void mdns_client_start();
@@ -168,8 +304,9 @@ int appl_main(int argc, char *argv[])
     
     if (upstream_host)
     {
-        connections.emplace_back(new UpstreamConnectionClient(
-                                     "upstream", &can_hub0, upstream_host, upstream_port));
+        connections.emplace_back(
+            new UpstreamConnectionClient("upstream", &can_hub0, upstream_host,
+                upstream_port, upstream_binary));
     }
 
     if (device_path)
@@ -32,6 +32,11 @@
  * @date 5 Jun 2015
  */
 
+#include <sys/epoll.h>
+
+#include <atomic>
+#include <thread>
+
 #include "os/os.h"
 #include "nmranet_config.h"
 
@@ -41,6 +46,7 @@
 #include "freertos_drivers/common/DummyGPIO.hxx"
 #include "freertos_drivers/common/LoggingGPIO.hxx"
 #include "utils/ClientConnection.hxx"
+#include "utils/socket_listener.hxx"
 
 // Changes the default behavior by adding a newline after each gridconnect
 // packet. Makes it easier for debugging the raw device.
@@ -89,11 +95,15 @@ const char *device_path = nullptr;
 int upstream_port = 12021;
 const char *upstream_host = nullptr;
 int pkt_per_sec = 0;
+int num_clients = 0;
+int num_senders = 1;
+int run_seconds = 0;
 
 void usage(const char *e)
 {
     fprintf(stderr, "Usage: %s [-d device_path] [-u upstream_host] "
-                    "[-q upstream_port] -s speed\n\n",
+                    "[-q upstream_port] [-c clients [-w senders] [-T secs]] "
+                    "-s speed\n\n",
             e);
     fprintf(stderr, "\t-d device   is a path to a physical device doing "
                     "serial-CAN or USB-CAN. If specified, opens device and "
@@ -105,13 +115,25 @@ void usage(const char *e)
             "\t-q upstream_port   is the port number for the upstream hub.\n");
     fprintf(stderr,
             "\t-s speed   is the packets/sec to generate.\n");
+    fprintf(stderr,
+            "\t-c clients   instead of running a node, opens this many "
+            "GridConnect connections to the upstream hub, sends speed "
+            "packets/sec from the first few of them (0 = as fast as the hub "
+            "takes them) and measures how many packets arrive to all of "
+            "them.\n");
+    fprintf(stderr,
+            "\t-w senders   how many of the clients send packets. Default "
+            "is 1.\n");
+    fprintf(stderr,
+            "\t-T secs   exits after this many seconds and prints a "
+            "summary.\n");
     exit(1);
 }
 
 void parse_args(int argc, char *argv[])
 {
     int opt;
-    while ((opt = getopt(argc, argv, "hd:u:q:s:")) >= 0)
+    while ((opt = getopt(argc, argv, "hd:u:q:s:c:w:T:")) >= 0)
     {
         switch (opt)
         {
@@ -130,6 +152,15 @@ void parse_args(int argc, char *argv[])
             case 's':
                 pkt_per_sec = atoi(optarg);
                 break;
+            case 'c':
+                num_clients = atoi(optarg);
+                break;
+            case 'w':
+                num_senders = atoi(optarg);
+                break;
+            case 'T':
+                run_seconds = atoi(optarg);
+                break;
             default:
                 fprintf(stderr, "Unknown option %c\n", opt);
                 usage(argv[0]);
@@ -147,6 +178,136 @@ public:
     }
 } pkt_gen_timer;
 
+/// Number of packets written by the client load senders.
+std::atomic<uint64_t> g_client_sent {0};
+
+/// Writes packets to the sender connections of the client load test.
+/// @param fds the sender connections.
+void client_load_sender(std::vector<int> fds)
+{
+    long long start = os_get_time_monotonic();
+    uint64_t count = 0;
+    char buf[64];
+    while (true)
+    {
+        if (pkt_per_sec > 0)
+        {
+            long long due = (os_get_time_monotonic() - start) / 1000 *
+                pkt_per_sec / 1000000;
+            if ((long long)count >= due)
+            {
+                usleep(1000);
+                continue;
+            }
+        }
+        // Event reports with a sequence number.
+        int len = snprintf(buf, sizeof(buf), ":X195B4%03XN%016llX;\n",
+            (unsigned)(count % fds.size()) + 0x100,
+            (unsigned long long)count);
+        int fd = fds[count % fds.size()];
+        int ofs = 0;
+        while (ofs < len)
+        {
+            ssize_t ret = ::write(fd, buf + ofs, len - ofs);
+            if (ret <= 0)
+            {
+                fprintf(stderr, "client load: write error, stopping.\n");
+                return;
+            }
+            ofs += ret;
+        }
+        ++count;
+        g_client_sent.store(count, std::memory_order_relaxed);
+    }
+}
+
+/// Runs the client load test: opens num_clients connections to the upstream
+/// hub and counts the packets arriving on them. Never returns unless
+/// run_seconds is set.
+void run_client_load()
+{
+    if (!upstream_host)
+    {
+        upstream_host = "localhost";
+    }
+    int epfd = epoll_create1(0);
+    HASSERT(epfd >= 0);
+    std::vector<int> fds;
+    for (int i = 0; i < num_clients; ++i)
+    {
+        int fd = ConnectSocket(upstream_host, upstream_port);
+        if (fd < 0)
+        {
+            fprintf(stderr, "client load: could not connect client %d\n", i);
+            exit(1);
+        }
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        HASSERT(epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0);
+        fds.push_back(fd);
+    }
+    fprintf(stderr, "client load: %d clients connected.\n", num_clients);
+    // Lets the hub register all connections before the load starts.
+    sleep(1);
+    std::vector<int> senders(fds.begin(),
+        fds.begin() + std::min(std::max(num_senders, 1), num_clients));
+    std::thread(client_load_sender, senders).detach();
+
+    static char buf[65536];
+    struct epoll_event events[64];
+    uint64_t received = 0;
+    uint64_t last_received = 0;
+    uint64_t last_sent = 0;
+    int connected = num_clients;
+    long long start = os_get_time_monotonic();
+    long long last = start;
+    while (true)
+    {
+        int n = epoll_wait(epfd, events, 64, 100);
+        for (int i = 0; i < n; ++i)
+        {
+            ssize_t ret = ::read(events[i].data.fd, buf, sizeof(buf));
+            if (ret <= 0)
+            {
+                epoll_ctl(epfd, EPOLL_CTL_DEL, events[i].data.fd, nullptr);
+                --connected;
+                continue;
+            }
+            for (ssize_t j = 0; j < ret; ++j)
+            {
+                if (buf[j] == ';')
+                {
+                    ++received;
+                }
+            }
+        }
+        long long now = os_get_time_monotonic();
+        if (now - last < SEC_TO_NSEC(1))
+        {
+            continue;
+        }
+        double secs = (now - last) / 1e9;
+        uint64_t sent = g_client_sent.load(std::memory_order_relaxed);
+        printf("sent %8.0f pkt/s, received %10.0f pkt/s (%6.0f per "
+               "client), %d clients connected\n",
+            (sent - last_sent) / secs, (received - last_received) / secs,
+            (received - last_received) / secs / num_clients, connected);
+        fflush(stdout);
+        last = now;
+        last_sent = sent;
+        last_received = received;
+        if (run_seconds && now - start >= SEC_TO_NSEC(run_seconds))
+        {
+            secs = (now - start) / 1e9;
+            printf("total: sent %.0f pkt/s, received %.0f pkt/s, %d clients "
+                   "connected\n",
+                sent / secs, received / secs, connected);
+            exit(0);
+        }
+    }
+}
+
 /** Entry point to application.
  * @param argc number of command line arguments
  * @param argv array of command line arguments
@@ -155,6 +316,10 @@ public:
 int appl_main(int argc, char *argv[])
 {
     parse_args(argc, argv);
+    if (num_clients > 0)
+    {
+        run_client_load();
+    }
     vector<std::unique_ptr<ConnectionClient>> connections;
 
     if (upstream_host)
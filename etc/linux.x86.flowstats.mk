@@ -0,0 +1,12 @@
+# Host target with the flow statistics (OPENMRN_FEATURE_FLOW_STATS) turned
+# on. The feature changes the layout of ExecutorBase, so it needs its own
+# copy of the libraries. Only the libraries needed by the executor and
+# console tests are built (openlcb has the buffer pool constants).
+
+include $(OPENMRNPATH)/etc/linux.x86.mk
+
+CORELIBS := console utils executor os openlcb
+LINKCORELIBS = -lconsole -lopenlcb -lexecutor -lutils -lexecutor -los
+
+CFLAGSEXTRA += -DOPENMRN_FEATURE_FLOW_STATS=1
+CXXFLAGSEXTRA += -DOPENMRN_FEATURE_FLOW_STATS=1
@@ -78,6 +78,13 @@ DECLARE_CONST(executor_select_prescaler);
  */
 DECLARE_CONST(executor_max_sleep_msec);
 
+/** Whether executors should use epoll instead of ::pselect for waiting on
+ * file descriptors. Only available on Linux (see
+ * OPENMRN_FEATURE_EXECUTOR_EPOLL). The epoll implementation keeps the fds
+ * registered with the kernel, so the cost of a wakeup does not depend on how
+ * many fds are watched, and fds above FD_SETSIZE work. */
+DECLARE_CONST(executor_use_epoll);
+
 /** Number of packets to queue in the CANbus device driver for send. Each packet
  * takes 16 bytes of RAM. */
 DECLARE_CONST(can_tx_buffer_size);
@@ -116,6 +123,19 @@ DECLARE_CONST(gridconnect_buffer_delay_usec);
  * two threads per client (multi-threaded) execution model. */
 DECLARE_CONST(gridconnect_tcp_use_select);
 
+/** How many CAN frames a hub may hold for one client port before applying
+ * hub_port_queue_policy. 0 for no limit. Client ports are the connections
+ * accepted by GcTcpHub, BinaryCanTcpHub and ShmCanHub; device and upstream
+ * links are never limited by these constants. */
+DECLARE_CONST(hub_port_queue_max_frames);
+
+/** How many bytes a hub may hold for one client port. 0 for no limit. */
+DECLARE_CONST(hub_port_queue_max_bytes);
+
+/** What to do when a client port's queue is full; a HubQueuePolicy value:
+ * 0 = block, 1 = drop oldest, 2 = drop newest, 3 = disconnect. */
+DECLARE_CONST(hub_port_queue_policy);
+
 /** Number of entries in the remote alias cache */
 DECLARE_CONST(remote_alias_cache_size);
 
@@ -146,5 +166,19 @@ DECLARE_CONST(enable_all_memory_space);
  * standard. */
 DECLARE_CONST(node_init_identify);
 
+/** Maximum number of event handlers registered with the SYNCHRONOUS flag that
+ * the event service calls one after the other, before yielding the executor
+ * to other work. */
+DECLARE_CONST(event_sync_handler_batch);
+
+/** Maximum number of messages each local node sends in response to an
+ * Identify Events message during one event_identify_interval_msec
+ * period. Responding handlers after that wait for the next period. 0 means no
+ * limit, which is the default. */
+DECLARE_CONST(event_identify_max_messages);
+
+/** Length of the period for event_identify_max_messages in milliseconds. */
+DECLARE_CONST(event_identify_interval_msec);
+
 
 #endif /* _nmranet_config_h_ */
@@ -55,6 +55,26 @@
 #define OPENMRN_HAVE_POSIX_FD 1
 #endif
 
+#if (defined(__linux__) || defined(__MACH__)) && !defined(__EMSCRIPTEN__)
+/// Uses ::writev to send multiple buffers with one system call, for example
+/// in HubDeviceSelect.
+#define OPENMRN_HAVE_WRITEV 1
+/// Uses ::mmap to read files, for example in CanReplay.
+#define OPENMRN_HAVE_MMAP 1
+#endif
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+/// Has shm_open and futex, for example for ShmCanHub.
+#define OPENMRN_HAVE_FUTEX 1
+#endif
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+/// Uses the Linux io_uring interface, for example in HubDeviceUring.
+#define OPENMRN_HAVE_IO_URING 1
+#endif
+#endif
+
 /// @todo this should probably be a whitelist: __linux__ || __MACH__.
 #if !defined(__FreeRTOS__) && !defined(__WINNT__) && !defined(ESP32) &&        \
     !defined(ARDUINO) && !defined(ESP_NONOS)
@@ -117,6 +137,41 @@
 #endif
 #endif
 
+#if OPENMRN_FEATURE_THREAD_PTHREAD && OPENMRN_HAVE_PSELECT
+/// Compiles ExecutorPool, which runs the executables of a single executor on
+/// multiple worker threads.
+#define OPENMRN_FEATURE_EXECUTOR_POOL 1
+#endif
+
+#if !defined(__FreeRTOS__) && !defined(ESP32) && !defined(ARDUINO) &&         \
+    !defined(ESP_NONOS)
+/// Uses a hierarchical timer wheel in ActiveTimers instead of a sorted
+/// list. Costs a few kbytes of RAM per executor, so MCUs keep the list.
+#define OPENMRN_FEATURE_TIMER_WHEEL 1
+#endif
+
+#if defined(__linux__) && OPENMRN_HAVE_PSELECT && !defined(__EMSCRIPTEN__)
+/// Compiles the epoll based implementation of the Executor's select loop. See
+/// config_executor_use_epoll().
+#define OPENMRN_FEATURE_EXECUTOR_EPOLL 1
+#endif
+
+#if OPENMRN_FEATURE_THREAD_PTHREAD && !defined(ESP32) &&                      \
+    !defined(__EMSCRIPTEN__)
+/// Compiles per-thread caches of free buffers in DynamicPool, which reduce
+/// lock contention when multiple threads allocate from mainBufferPool.
+#define OPENMRN_FEATURE_POOL_THREAD_CACHE 1
+#endif
+
+#ifndef OPENMRN_FEATURE_FLOW_STATS
+/// Collects run time statistics of the StateFlows and Executors; see
+/// executor/FlowStats.hxx. Off by default, because it makes every StateFlow
+/// bigger and every state transition slower. Can be enabled on the compiler
+/// command line (Linux and macOS only), but has to be the same for all
+/// translation units. The linux.x86.flowstats target builds and tests it.
+#define OPENMRN_FEATURE_FLOW_STATS 0
+#endif
+
 #if defined(__linux__) || defined(__MACH__) || defined(__FreeRTOS__) ||        \
     defined(ESP32)
 /// Compiles support for BSD sockets API.
@@ -0,0 +1,306 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file AliasCacheBench.cxx
+ *
+ * Benchmarks for the alias cache.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "bench/Benchmark.hxx"
+
+#include <algorithm>
+
+#include "openlcb/AliasCache.hxx"
+#include "os/OS.hxx"
+#include "utils/Map.hxx"
+
+namespace
+{
+
+using openlcb::AliasCache;
+using openlcb::NodeAlias;
+using openlcb::NodeID;
+
+/// Node ID of the first cache entry.
+constexpr NodeID BASE_NODE = 0x050101011800ULL;
+
+/// The previous alias cache implementation, kept for comparison: two Maps
+/// and a least recently used list that every lookup reorders.
+class LruAliasCache
+{
+public:
+    LruAliasCache(NodeID seed, size_t entries)
+        : pool_(new Metadata[entries])
+        , aliasMap_(entries)
+        , idMap_(entries)
+    {
+        for (size_t i = 0; i < entries; ++i)
+        {
+            pool_[i].older = freeList_;
+            freeList_ = pool_ + i;
+        }
+    }
+
+    ~LruAliasCache()
+    {
+        delete[] pool_;
+    }
+
+    /// Adds a mapping, evicting the least recently used one if needed.
+    /// @param id node ID @param alias alias
+    void add(NodeID id, NodeAlias alias)
+    {
+        auto it = aliasMap_.find(alias);
+        if (it != aliasMap_.end())
+        {
+            unlink((*it).second);
+        }
+        Metadata *insert = freeList_;
+        if (insert)
+        {
+            freeList_ = insert->older;
+        }
+        else
+        {
+            insert = oldest_;
+            unlink(insert);
+            freeList_ = insert->older;
+        }
+        insert->timestamp = OSTime::get_monotonic();
+        insert->id = id;
+        insert->alias = alias;
+        aliasMap_[alias] = insert;
+        idMap_[id] = insert;
+        insert->newer = nullptr;
+        insert->older = newest_;
+        if (newest_)
+        {
+            newest_->newer = insert;
+        }
+        else
+        {
+            oldest_ = insert;
+        }
+        newest_ = insert;
+    }
+
+    /// @param id node ID to look up. @return its alias or 0.
+    NodeAlias lookup(NodeID id)
+    {
+        auto it = idMap_.find(id);
+        if (it == idMap_.end())
+        {
+            return 0;
+        }
+        touch((*it).second);
+        return (*it).second->alias;
+    }
+
+    /// @param alias alias to look up. @return its node ID or 0.
+    NodeID lookup(NodeAlias alias)
+    {
+        auto it = aliasMap_.find(alias);
+        if (it == aliasMap_.end())
+        {
+            return 0;
+        }
+        touch((*it).second);
+        return (*it).second->id;
+    }
+
+private:
+    /// One mapping.
+    struct Metadata
+    {
+        NodeID id;
+        NodeAlias alias;
+        long long timestamp;
+        Metadata *newer;
+        Metadata *older;
+    };
+
+    /// Removes an entry from the maps and the list, and puts it on the free
+    /// list. @param m the entry.
+    void unlink(Metadata *m)
+    {
+        aliasMap_.erase(m->alias);
+        idMap_.erase(m->id);
+        (m->newer ? m->newer->older : newest_) = m->older;
+        (m->older ? m->older->newer : oldest_) = m->newer;
+        m->older = freeList_;
+        freeList_ = m;
+    }
+
+    /// Marks an entry as the most recently used. @param m the entry.
+    void touch(Metadata *m)
+    {
+        m->timestamp = OSTime::get_monotonic();
+        if (m == newest_)
+        {
+            return;
+        }
+        (m->older ? m->older->newer : oldest_) = m->newer;
+        m->newer->older = m->older;
+        m->newer = nullptr;
+        m->older = newest_;
+        newest_->newer = m;
+        newest_ = m;
+    }
+
+    Metadata *pool_;
+    Metadata *freeList_ {nullptr};
+    Map<NodeAlias, Metadata *> aliasMap_;
+    Map<NodeID, Metadata *> idMap_;
+    Metadata *oldest_ {nullptr};
+    Metadata *newest_ {nullptr};
+};
+
+/// Common base for the alias cache benchmarks. The cache has arg entries and
+/// is filled up. @param C is the cache class.
+template <class C> class AliasCacheBase : public Benchmark
+{
+public:
+    AliasCacheBase(unsigned size)
+        : cache_(BASE_NODE, size)
+    {
+        for (unsigned i = 0; i < size; ++i)
+        {
+            cache_.add(node(i), alias(i));
+            order_.push_back(i);
+        }
+        // Looks up the entries in a scrambled but repeatable order.
+        uint32_t seed = 12345;
+        for (unsigned i = size; i > 1; --i)
+        {
+            seed = seed * 1103515245 + 12345;
+            std::swap(order_[i - 1], order_[(seed >> 8) % i]);
+        }
+    }
+
+protected:
+    /// @param i entry index. @return node ID of the entry.
+    static NodeID node(unsigned i)
+    {
+        return BASE_NODE + i * 3;
+    }
+
+    /// @param i entry index. @return alias of the entry.
+    static NodeAlias alias(unsigned i)
+    {
+        return 1 + (i % 4000);
+    }
+
+    /// Cache under test.
+    C cache_;
+    /// Entry indexes in lookup order.
+    std::vector<unsigned> order_;
+};
+
+/// Looks up aliases by node ID in a full cache.
+template <class C> class AliasCacheLookupId : public AliasCacheBase<C>
+{
+public:
+    using AliasCacheBase<C>::AliasCacheBase;
+
+    void run(unsigned n) override
+    {
+        unsigned sum = 0;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            sum += this->cache_.lookup(
+                this->node(this->order_[i % this->order_.size()]));
+        }
+        do_not_optimize(sum);
+    }
+};
+
+typedef AliasCacheLookupId<AliasCache> ClockLookupId;
+BENCHMARK(ClockLookupId, "AliasCache/LookupId", 10, 100, 1000);
+typedef AliasCacheLookupId<LruAliasCache> LruLookupId;
+BENCHMARK(LruLookupId, "LruAliasCache/LookupId", 10, 100, 1000);
+
+/// Looks up node IDs by alias in a full cache.
+template <class C> class AliasCacheLookupAlias : public AliasCacheBase<C>
+{
+public:
+    using AliasCacheBase<C>::AliasCacheBase;
+
+    void run(unsigned n) override
+    {
+        NodeID sum = 0;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            sum += this->cache_.lookup(
+                this->alias(this->order_[i % this->order_.size()]));
+        }
+        do_not_optimize(sum);
+    }
+};
+
+typedef AliasCacheLookupAlias<AliasCache> ClockLookupAlias;
+BENCHMARK(ClockLookupAlias, "AliasCache/LookupAlias", 10, 100, 1000);
+typedef AliasCacheLookupAlias<LruAliasCache> LruLookupAlias;
+BENCHMARK(LruLookupAlias, "LruAliasCache/LookupAlias", 10, 100, 1000);
+
+/// Adds new entries to a full cache, each of which evicts an entry.
+template <class C> class AliasCacheAdd : public AliasCacheBase<C>
+{
+public:
+    AliasCacheAdd(unsigned size)
+        : AliasCacheBase<C>(size)
+        , next_(size)
+    {
+    }
+
+    void run(unsigned n) override
+    {
+        // Entries are recycled after 2 * size additions, by which time they
+        // have been evicted.
+        unsigned period = 2 * this->order_.size();
+        for (unsigned i = 0; i < n; ++i)
+        {
+            this->cache_.add(this->node(next_), this->alias(next_));
+            if (++next_ >= period)
+            {
+                next_ = 0;
+            }
+        }
+    }
+
+private:
+    /// Index of the next entry to add.
+    unsigned next_;
+};
+
+typedef AliasCacheAdd<AliasCache> ClockAdd;
+BENCHMARK(ClockAdd, "AliasCache/Add", 10, 100, 1000);
+typedef AliasCacheAdd<LruAliasCache> LruAdd;
+BENCHMARK(LruAdd, "LruAliasCache/Add", 10, 100, 1000);
+
+} // namespace
@@ -0,0 +1,313 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file Benchmark.cxx
+ *
+ * Benchmark runner and JSON result writer.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "bench/Benchmark.hxx"
+
+#include <algorithm>
+#include <getopt.h>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "os/os.h"
+#include "utils/StringPrintf.hxx"
+
+Executor<1> g_bench_executor("bench_executor", 0, 2048);
+Service g_bench_service(&g_bench_executor);
+
+std::vector<BenchmarkInfo> *benchmark_registry()
+{
+    static std::vector<BenchmarkInfo> *registry =
+        new std::vector<BenchmarkInfo>;
+    return registry;
+}
+
+void wait_for_bench_executor()
+{
+    // Work done by the executor may schedule more work or timers, so we go
+    // around a few times.
+    for (int i = 0; i < 3; ++i)
+    {
+        ExecutorGuard guard(&g_bench_executor);
+        guard.wait_for_notification();
+    }
+}
+
+namespace
+{
+
+/// Command line options.
+struct Options
+{
+    /// Only benchmarks whose name contains this string are run.
+    const char *filter = "";
+    /// Where to write the JSON results. nullptr: nowhere, "-": stdout.
+    const char *jsonFile = nullptr;
+    /// Free-form label (e.g. the release name) stored in the results.
+    const char *label = "";
+    /// Minimum duration of one measured run.
+    long long minTimeNsec = MSEC_TO_NSEC(200);
+    /// How many times to repeat the measured run.
+    unsigned repetitions = 5;
+} options;
+
+/// BenchmarkResult of one benchmark with one argument.
+struct BenchmarkResult
+{
+    /// Full name, including the argument.
+    string name;
+    /// Benchmark argument, 0 if not parametrized.
+    unsigned arg;
+    /// Number of operations per measured run.
+    unsigned iterations;
+    /// Median of the per-operation times of the repetitions.
+    double nsPerOp;
+    /// Fastest repetition.
+    double nsPerOpMin;
+    /// Slowest repetition.
+    double nsPerOpMax;
+};
+
+/// Times one run of a benchmark. @param b the benchmark; @param n number of
+/// operations. @return elapsed nanoseconds.
+long long time_run(Benchmark *b, unsigned n)
+{
+    long long start = os_get_time_monotonic();
+    b->run(n);
+    return os_get_time_monotonic() - start;
+}
+
+/// Runs one benchmark with one argument.
+/// @param info the benchmark to run.
+/// @param arg the argument.
+/// @param name full name of the benchmark.
+/// @return the measurement result.
+BenchmarkResult run_benchmark(
+    const BenchmarkInfo &info, unsigned arg, string name)
+{
+    std::unique_ptr<Benchmark> b(info.factory(arg));
+    // Warmup, and estimate of the number of iterations.
+    unsigned n = 1;
+    while (true)
+    {
+        long long t = time_run(b.get(), n);
+        if (t >= options.minTimeNsec || n >= 1000000000u)
+        {
+            break;
+        }
+        double scale = options.minTimeNsec * 1.2 / std::max(t, 1LL);
+        scale = std::min(std::max(scale, 2.0), 100.0);
+        n = std::min(n * scale, 1e9);
+    }
+    std::vector<double> samples;
+    for (unsigned i = 0; i < options.repetitions; ++i)
+    {
+        samples.push_back(time_run(b.get(), n) * 1.0 / n);
+    }
+    std::sort(samples.begin(), samples.end());
+    BenchmarkResult r;
+    r.name = std::move(name);
+    r.arg = arg;
+    r.iterations = n;
+    r.nsPerOp = samples[samples.size() / 2];
+    r.nsPerOpMin = samples.front();
+    r.nsPerOpMax = samples.back();
+    return r;
+}
+
+/// Escapes a string for JSON output. @param s input. @return quoted string.
+string json_string(const string &s)
+{
+    string ret = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+        {
+            ret.push_back('\\');
+            ret.push_back(c);
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            ret += StringPrintf("\\u%04x", c);
+        }
+        else
+        {
+            ret.push_back(c);
+        }
+    }
+    ret.push_back('"');
+    return ret;
+}
+
+/// Writes the results in JSON format.
+/// @param f output file.
+/// @param results the benchmark results.
+void write_json(FILE *f, const std::vector<BenchmarkResult> &results)
+{
+    char date[32];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    char host[256];
+    if (gethostname(host, sizeof(host)) != 0)
+    {
+        host[0] = 0;
+    }
+    host[sizeof(host) - 1] = 0;
+    fprintf(f, "{\n  \"context\": {\n");
+    fprintf(f, "    \"date\": %s,\n", json_string(date).c_str());
+    fprintf(f, "    \"host\": %s,\n", json_string(host).c_str());
+    fprintf(f, "    \"num_cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(f, "    \"compiler\": %s,\n", json_string(__VERSION__).c_str());
+    fprintf(f, "    \"label\": %s,\n", json_string(options.label).c_str());
+    fprintf(f, "    \"min_time_ms\": %lld,\n", options.minTimeNsec / 1000000);
+    fprintf(f, "    \"repetitions\": %u\n", options.repetitions);
+    fprintf(f, "  },\n  \"benchmarks\": [");
+    for (unsigned i = 0; i < results.size(); ++i)
+    {
+        const BenchmarkResult &r = results[i];
+        fprintf(f, "%s\n    {\"name\": %s, \"arg\": %u, \"iterations\": %u, "
+                   "\"ns_per_op\": %.2f, \"ns_per_op_min\": %.2f, "
+                   "\"ns_per_op_max\": %.2f}",
+            i ? "," : "", json_string(r.name).c_str(), r.arg, r.iterations,
+            r.nsPerOp, r.nsPerOpMin, r.nsPerOpMax);
+    }
+    fprintf(f, "\n  ]\n}\n");
+}
+
+/// Prints the command line usage and exits. @param e name of the binary.
+void usage(const char *e)
+{
+    fprintf(stderr,
+        "Usage: %s [-f filter] [-o results.json] [-l label] [-t min_time_ms] "
+        "[-r repetitions] [-L]\n\n"
+        "Runs the OpenMRN microbenchmarks.\n\n"
+        "\t-f filter only runs benchmarks whose name contains filter.\n"
+        "\t-o file writes the results in JSON format to file ('-' for "
+        "stdout).\n"
+        "\t-l label is stored in the JSON results, e.g. the release name.\n"
+        "\t-t msec is the minimum duration of each measured run. Default "
+        "200.\n"
+        "\t-r count is how many times each measurement is repeated. Default "
+        "5.\n"
+        "\t-L lists the benchmarks and exits.\n",
+        e);
+    exit(1);
+}
+
+} // namespace
+
+int appl_main(int argc, char *argv[])
+{
+    bool list_only = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "hf:o:l:t:r:L")) >= 0)
+    {
+        switch (opt)
+        {
+            case 'f':
+                options.filter = optarg;
+                break;
+            case 'o':
+                options.jsonFile = optarg;
+                break;
+            case 'l':
+                options.label = optarg;
+                break;
+            case 't':
+                options.minTimeNsec = MSEC_TO_NSEC(atoi(optarg));
+                break;
+            case 'r':
+                options.repetitions = std::max(1, atoi(optarg));
+                break;
+            case 'L':
+                list_only = true;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    FILE *table = options.jsonFile && !strcmp(options.jsonFile, "-")
+        ? stderr
+        : stdout;
+    std::vector<BenchmarkResult> results;
+    for (const BenchmarkInfo &info : *benchmark_registry())
+    {
+        std::vector<unsigned> args = info.args;
+        if (args.empty())
+        {
+            args.push_back(0);
+        }
+        for (unsigned arg : args)
+        {
+            string name = info.name;
+            if (!info.args.empty())
+            {
+                name += StringPrintf("/%u", arg);
+            }
+            if (name.find(options.filter) == string::npos)
+            {
+                continue;
+            }
+            if (list_only)
+            {
+                fprintf(table, "%s\n", name.c_str());
+                continue;
+            }
+            results.push_back(run_benchmark(info, arg, name));
+            const BenchmarkResult &r = results.back();
+            fprintf(table, "%-40s %12.1f ns/op  (min %.1f max %.1f, %u iter)\n",
+                r.name.c_str(), r.nsPerOp, r.nsPerOpMin, r.nsPerOpMax,
+                r.iterations);
+            fflush(table);
+        }
+    }
+    if (options.jsonFile && !list_only)
+    {
+        FILE *f = strcmp(options.jsonFile, "-") ? fopen(options.jsonFile, "w")
+                                                : stdout;
+        if (!f)
+        {
+            perror(options.jsonFile);
+            return 1;
+        }
+        write_json(f, results);
+        if (f != stdout)
+        {
+            fclose(f);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,128 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file Benchmark.hxx
+ *
+ * Minimal microbenchmark harness for the host benchmark suite in
+ * targets/linux.x86/bench.
+ *
+ * A benchmark is a class derived from Benchmark. The constructor performs the
+ * setup, the destructor the teardown, and run(n) executes the measured
+ * operation n times. The harness picks n such that one run takes at least the
+ * minimum measurement time, then repeats the run a few times and reports the
+ * median, minimum and maximum time per operation.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#ifndef _BENCH_BENCHMARK_HXX_
+#define _BENCH_BENCHMARK_HXX_
+
+#include <string>
+#include <vector>
+
+#include "executor/Executor.hxx"
+#include "executor/Service.hxx"
+
+/// Base class of all benchmarks.
+class Benchmark
+{
+public:
+    virtual ~Benchmark()
+    {
+    }
+
+    /// Executes the measured operation.
+    /// @param n how many times the operation has to be performed.
+    virtual void run(unsigned n) = 0;
+};
+
+/// Describes one registered benchmark.
+struct BenchmarkInfo
+{
+    /// Creates the benchmark object.
+    typedef Benchmark *(*Factory)(unsigned arg);
+
+    /// Name of the benchmark, e.g. "GridConnect/Parse".
+    const char *name;
+    /// Creates the benchmark object for a given argument.
+    Factory factory;
+    /// The benchmark is run once for each of these arguments. The meaning of
+    /// the argument (e.g. number of handlers) is up to the benchmark.
+    std::vector<unsigned> args;
+};
+
+/// Global list of benchmarks. @return the list.
+std::vector<BenchmarkInfo> *benchmark_registry();
+
+/// Static helper object that adds a benchmark to the registry.
+template <class B> class BenchmarkRegistration
+{
+public:
+    /// @param name is the reported name of the benchmark.
+    /// @param args lists the arguments to run the benchmark with. Empty for
+    /// benchmarks that are not parametrized.
+    BenchmarkRegistration(const char *name, std::vector<unsigned> args = {})
+    {
+        benchmark_registry()->push_back({name, &create, std::move(args)});
+    }
+
+private:
+    /// Factory function. @param arg benchmark argument. @return new object.
+    static Benchmark *create(unsigned arg)
+    {
+        return new B(arg);
+    }
+};
+
+/// Registers a benchmark class. The class has to have a constructor taking an
+/// unsigned argument.
+///
+/// @param CLASS is the benchmark class.
+/// @param NAME is the reported name (string literal).
+/// @param ... are the arguments to run the benchmark with.
+#define BENCHMARK(CLASS, NAME, ...)                                            \
+    static BenchmarkRegistration<CLASS> bench_reg_##CLASS(                     \
+        NAME, std::vector<unsigned>({__VA_ARGS__}))
+
+/// Executor shared by the benchmarks that need the asynchronous stack. It runs
+/// on its own thread; the benchmark code runs on the main thread.
+extern Executor<1> g_bench_executor;
+/// Service on g_bench_executor.
+extern Service g_bench_service;
+
+/// Blocks the calling thread until g_bench_executor has no more work to do.
+void wait_for_bench_executor();
+
+/// Keeps the compiler from optimizing away a computed value.
+/// @param value is the value to keep.
+template <class T> inline void do_not_optimize(const T &value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+#endif // _BENCH_BENCHMARK_HXX_
@@ -0,0 +1,155 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file BinaryCanBench.cxx
+ *
+ * Benchmarks for the binary CAN hub protocol. Compare with the GridConnect
+ * benchmarks (GridConnect/Generate and GridConnect/StreamParseBulk) for the
+ * cost of the two encodings.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "bench/Benchmark.hxx"
+
+#include <algorithm>
+#include <string>
+
+#include "can_frame.h"
+#include "utils/BinaryCanHub.hxx"
+#include "utils/gc_format.h"
+
+namespace
+{
+
+/// Same traffic mix as the GridConnect benchmarks.
+const char *const PACKETS[] = {
+    "X195B4123N0102030405060708",
+    "X1A22A555N3031323334353637",
+    "X19170123N",
+    "X19488997N033A",
+    "X194C7123N0501010118000000",
+    "X1B22A555N30313233",
+    "S123N0102",
+    "X195B4456N05010101FFFF0000",
+};
+
+/// Number of entries in PACKETS. Must be a power of two.
+constexpr unsigned NUM_PACKETS = sizeof(PACKETS) / sizeof(PACKETS[0]);
+static_assert((NUM_PACKETS & (NUM_PACKETS - 1)) == 0, "not a power of two");
+
+/// Renders one can_frame to a binary record per operation. The argument is
+/// 1 for records with timestamp.
+class BinaryCanEncode : public Benchmark
+{
+public:
+    BinaryCanEncode(unsigned timestamp)
+        : timestamp_(timestamp)
+    {
+        for (unsigned i = 0; i < NUM_PACKETS; ++i)
+        {
+            gc_format_parse(PACKETS[i], &frames_[i]);
+        }
+    }
+
+    void run(unsigned n) override
+    {
+        uint8_t buf[BINARY_CAN_RECORD_SIZE_TS];
+        for (unsigned i = 0; i < n; ++i)
+        {
+            binary_can_encode(
+                &frames_[i & (NUM_PACKETS - 1)], buf, timestamp_, i);
+            do_not_optimize(buf);
+        }
+    }
+
+private:
+    /// Pre-parsed frames.
+    struct can_frame frames_[NUM_PACKETS];
+    /// Whether to render timestamps.
+    bool timestamp_;
+};
+
+BENCHMARK(BinaryCanEncode, "BinaryCan/Encode", 0, 1);
+
+/// Parses a stream of binary records the way the hub port reads from a
+/// socket. One operation is one frame. The argument is 1 for records with
+/// timestamp.
+class BinaryCanStreamParse : public Benchmark
+{
+public:
+    BinaryCanStreamParse(unsigned timestamp)
+    {
+        uint8_t buf[BINARY_CAN_RECORD_SIZE_TS];
+        for (unsigned i = 0; i < NUM_FRAMES; ++i)
+        {
+            struct can_frame f;
+            gc_format_parse(PACKETS[i & (NUM_PACKETS - 1)], &f);
+            size_t len = binary_can_encode(&f, buf, timestamp, i);
+            stream_.append((char *)buf, len);
+        }
+        binary_can_hello(buf, timestamp ? BINARY_CAN_FLAG_TIMESTAMP : 0);
+        size_t consumed;
+        struct can_frame f;
+        parser_.parse_bulk(buf, BINARY_CAN_HELLO_SIZE, &f, 1, &consumed);
+    }
+
+    void run(unsigned n) override
+    {
+        struct can_frame frames[16];
+        const uint8_t *data = (const uint8_t *)stream_.data();
+        unsigned ofs = 0;
+        for (unsigned i = 0; i < n;)
+        {
+            size_t consumed;
+            size_t count = parser_.parse_bulk(data + ofs,
+                std::min<size_t>(READ_SIZE, stream_.size() - ofs), frames,
+                std::min<size_t>(16, n - i), &consumed);
+            do_not_optimize(frames);
+            i += count;
+            ofs += consumed;
+            if (ofs >= stream_.size())
+            {
+                ofs = 0;
+            }
+        }
+    }
+
+private:
+    /// How many frames are in the stream buffer.
+    static constexpr unsigned NUM_FRAMES = 64 * NUM_PACKETS;
+    /// How many bytes are handed to the parser at a time.
+    static constexpr size_t READ_SIZE = 256;
+    /// The incoming bytes, without the hello.
+    string stream_;
+    /// Stream state.
+    BinaryCanStreamParser parser_;
+};
+
+BENCHMARK(BinaryCanStreamParse, "BinaryCan/StreamParse", 0, 1);
+
+} // namespace
@@ -0,0 +1,99 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file CanStack.hxx
+ *
+ * Helper for the benchmarks that need a complete OpenLCB stack on a CAN hub.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#ifndef _BENCH_CANSTACK_HXX_
+#define _BENCH_CANSTACK_HXX_
+
+#include "bench/Benchmark.hxx"
+#include "openlcb/DefaultNode.hxx"
+#include "openlcb/IfCan.hxx"
+#include "openlcb/NodeInitializeFlow.hxx"
+
+/// One virtual node with its own CAN interface, connected to a hub. The node
+/// gets a fixed alias, so there is no alias allocation traffic.
+class CanStack
+{
+public:
+    /// @param hub is the CAN hub to connect to.
+    /// @param node_id is the ID of the virtual node.
+    /// @param alias is the preassigned alias of the node.
+    CanStack(CanHubFlow *hub, openlcb::NodeID node_id, openlcb::NodeAlias alias)
+        : iface_(&g_bench_executor, hub, 10, 10, 2)
+    {
+        // Singleton that sends the node initialization messages.
+        static openlcb::InitializeFlow init_flow(&g_bench_service);
+        g_bench_executor.sync_run([this, node_id, alias]() {
+            iface_.local_aliases()->add(node_id, alias);
+        });
+        iface_.add_addressed_message_support();
+        node_.reset(new openlcb::DefaultNode(&iface_, node_id));
+        wait_for_bench_executor();
+    }
+
+    ~CanStack()
+    {
+        wait_for_bench_executor();
+        node_.reset();
+        wait_for_bench_executor();
+    }
+
+    /// Tells the interface about a node on the bus so that no alias lookups
+    /// are needed. @param node_id the remote node; @param alias its alias.
+    void add_remote(openlcb::NodeID node_id, openlcb::NodeAlias alias)
+    {
+        g_bench_executor.sync_run([this, node_id, alias]() {
+            iface_.remote_aliases()->add(node_id, alias);
+        });
+    }
+
+    /// @return the CAN interface.
+    openlcb::IfCan *iface()
+    {
+        return &iface_;
+    }
+
+    /// @return the virtual node.
+    openlcb::Node *node()
+    {
+        return node_.get();
+    }
+
+private:
+    /// Interface of the node.
+    openlcb::IfCan iface_;
+    /// The virtual node.
+    std::unique_ptr<openlcb::DefaultNode> node_;
+};
+
+#endif // _BENCH_CANSTACK_HXX_
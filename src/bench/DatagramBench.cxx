@@ -0,0 +1,207 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file DatagramBench.cxx
+ *
+ * Benchmark for datagram round trips between two in-process nodes.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "bench/Benchmark.hxx"
+
+#include "bench/CanStack.hxx"
+#include "openlcb/DatagramCan.hxx"
+#include "openlcb/DatagramHandlerDefault.hxx"
+
+namespace openlcb
+{
+/// Incoming datagrams are allocated from the main buffer pool.
+Pool *const g_incoming_datagram_allocator = mainBufferPool;
+}
+
+namespace
+{
+
+using openlcb::DatagramClient;
+using openlcb::NodeAlias;
+using openlcb::NodeID;
+
+/// Datagram handler that accepts every datagram.
+class AcceptingDatagramHandler : public openlcb::DefaultDatagramHandler
+{
+public:
+    /// @param srv is the datagram service to receive datagrams from.
+    AcceptingDatagramHandler(openlcb::DatagramService *srv)
+        : DefaultDatagramHandler(srv)
+    {
+    }
+
+    Action entry() override
+    {
+        return respond_ok(0);
+    }
+};
+
+/// Flow that sends datagrams one after the other. The next datagram is sent
+/// from the executor after the previous one is acknowledged, because the
+/// datagram client notifies done before it terminates.
+class DatagramPinger : public StateFlowBase
+{
+public:
+    /// @param client is the datagram client to use.
+    /// @param iface is the interface of the sending node.
+    /// @param src is the sending node.
+    /// @param dst is the receiving node.
+    /// @param payload is the datagram payload.
+    DatagramPinger(DatagramClient *client, openlcb::If *iface, NodeID src,
+        openlcb::NodeHandle dst, const string &payload)
+        : StateFlowBase(&g_bench_service)
+        , client_(client)
+        , iface_(iface)
+        , src_(src)
+        , dst_(dst)
+        , payload_(payload)
+    {
+    }
+
+    /// Sends datagrams and blocks until all are acknowledged.
+    /// @param n how many datagrams to send.
+    void run(unsigned n)
+    {
+        remaining_ = n;
+        start_flow(STATE(send));
+        done_.wait_for_notification();
+        // Lets the flow terminate.
+        wait_for_bench_executor();
+    }
+
+private:
+    Action send()
+    {
+        if (!remaining_)
+        {
+            done_.notify();
+            return exit();
+        }
+        --remaining_;
+        auto *b = iface_->dispatcher()->alloc();
+        b->data()->reset(openlcb::Defs::MTI_DATAGRAM, src_, dst_, payload_);
+        b->set_done(bn_.reset(this));
+        client_->write_datagram(b);
+        return wait_and_call(STATE(acked));
+    }
+
+    Action acked()
+    {
+        HASSERT(client_->result() == DatagramClient::OPERATION_SUCCESS);
+        return call_immediately(STATE(send));
+    }
+
+    /// Datagram client used for sending.
+    DatagramClient *client_;
+    /// Interface of the sending node.
+    openlcb::If *iface_;
+    /// Sending node.
+    NodeID src_;
+    /// Receiving node.
+    openlcb::NodeHandle dst_;
+    /// Datagram payload.
+    string payload_;
+    /// How many datagrams are still to be sent.
+    unsigned remaining_;
+    /// Done callback of the datagram buffers.
+    BarrierNotifiable bn_;
+    /// Notified when all datagrams were sent.
+    SyncNotifiable done_;
+};
+
+/// Sends datagrams from one node to another node on the same CAN hub and
+/// waits for the Datagram Received OK response. One operation is a complete
+/// round trip. The argument is the payload length in bytes; payloads longer
+/// than 8 bytes need multiple CAN frames.
+class DatagramRoundTrip : public Benchmark
+{
+public:
+    DatagramRoundTrip(unsigned payload_length)
+        : payload_(payload_length, 'x')
+    {
+        payload_[0] = 0x30;
+        client_.add_remote(SERVER_NODE, SERVER_ALIAS);
+        server_.add_remote(CLIENT_NODE, CLIENT_ALIAS);
+        serverDatagrams_.registry()->insert(nullptr, 0x30, &handler_);
+        datagramClient_ = clientDatagrams_.client_allocator()->next_blocking();
+        pinger_.reset(new DatagramPinger(datagramClient_, client_.iface(),
+            CLIENT_NODE, {SERVER_NODE, SERVER_ALIAS}, payload_));
+    }
+
+    ~DatagramRoundTrip()
+    {
+        pinger_.reset();
+        clientDatagrams_.client_allocator()->insert(datagramClient_);
+        serverDatagrams_.registry()->erase(nullptr, 0x30, &handler_);
+        wait_for_bench_executor();
+    }
+
+    void run(unsigned n) override
+    {
+        pinger_->run(n);
+    }
+
+private:
+    /// Node ID of the sending node.
+    static constexpr NodeID CLIENT_NODE = 0x050101011801ULL;
+    /// Alias of the sending node.
+    static constexpr NodeAlias CLIENT_ALIAS = 0x22A;
+    /// Node ID of the receiving node.
+    static constexpr NodeID SERVER_NODE = 0x050101011802ULL;
+    /// Alias of the receiving node.
+    static constexpr NodeAlias SERVER_ALIAS = 0x33B;
+
+    /// Datagram payload.
+    string payload_;
+    /// The CAN bus connecting the two nodes.
+    CanHubFlow hub_{&g_bench_service};
+    /// Sending node.
+    CanStack client_{&hub_, CLIENT_NODE, CLIENT_ALIAS};
+    /// Receiving node.
+    CanStack server_{&hub_, SERVER_NODE, SERVER_ALIAS};
+    /// Datagram support of the sending node.
+    openlcb::CanDatagramService clientDatagrams_{client_.iface(), 10, 2};
+    /// Datagram support of the receiving node.
+    openlcb::CanDatagramService serverDatagrams_{server_.iface(), 10, 2};
+    /// Accepts the datagrams on the receiving node.
+    AcceptingDatagramHandler handler_{&serverDatagrams_};
+    /// Datagram client used for sending.
+    DatagramClient *datagramClient_;
+    /// Sends the datagrams.
+    std::unique_ptr<DatagramPinger> pinger_;
+};
+
+BENCHMARK(DatagramRoundTrip, "Datagram/RoundTrip", 6, 64);
+
+} // namespace
@@ -0,0 +1,472 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file EventBench.cxx
+ *
+ * Benchmarks for the event handler registry and for the inbound event report
+ * path.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "bench/Benchmark.hxx"
+
+#include <atomic>
+
+#include "bench/CanStack.hxx"
+#include "openlcb/EventHandlerContainer.hxx"
+#include "openlcb/EventHandlerTemplates.hxx"
+#include "openlcb/EventService.hxx"
+
+namespace
+{
+
+using openlcb::EventId;
+using openlcb::EventRegistry;
+using openlcb::EventRegistryEntry;
+
+/// First event ID used by the benchmarks.
+constexpr EventId BASE_EVENT = 0x0501010118000000ULL;
+
+/// Event handler that counts the event reports.
+class CountingEventHandler : public openlcb::SimpleEventHandler
+{
+public:
+    void handle_event_report(const EventRegistryEntry &registry_entry,
+        EventReport *event, BarrierNotifiable *done) override
+    {
+        ++count_;
+        done->notify();
+    }
+
+    void handle_identify_global(const EventRegistryEntry &registry_entry,
+        EventReport *event, BarrierNotifiable *done) override
+    {
+        done->notify();
+    }
+
+    /// Number of event reports received.
+    std::atomic<unsigned> count_{0};
+};
+
+/// Looks up the handlers of one event in a registry that has a given number
+/// of single-event registrations, plus a few ranges. One operation is a
+/// complete iteration for one event report. @param R is the registry class.
+template <class R> class RegistryLookup : public Benchmark
+{
+public:
+    RegistryLookup(unsigned num_handlers)
+        : report_(openlcb::FOR_TESTING)
+        , iterator_(registry_.create_iterator())
+    {
+        for (unsigned i = 0; i < num_handlers; ++i)
+        {
+            events_.push_back(BASE_EVENT + i * 2);
+            registry_.register_handler(
+                EventRegistryEntry(&handler_, events_.back()), 0);
+        }
+        // Range registrations, as a typical producer/consumer node has.
+        for (unsigned i = 0; i < 4; ++i)
+        {
+            registry_.register_handler(
+                EventRegistryEntry(&handler_, BASE_EVENT + (i << 16)), 16);
+        }
+        report_.mask = 0;
+    }
+
+    void run(unsigned n) override
+    {
+        unsigned found = 0;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            report_.event = events_[i % events_.size()];
+            iterator_->init_iteration(&report_);
+            while (iterator_->next_entry())
+            {
+                ++found;
+            }
+        }
+        do_not_optimize(found);
+    }
+
+private:
+    /// Registry under test.
+    R registry_;
+    /// Handler used for all registrations.
+    CountingEventHandler handler_;
+    /// Registered events.
+    std::vector<EventId> events_;
+    /// Event report to look up.
+    openlcb::EventReport report_;
+    /// Iterator of registry_.
+    std::unique_ptr<openlcb::EventIterator> iterator_;
+};
+
+typedef RegistryLookup<openlcb::TreeEventHandlers> TreeLookup;
+BENCHMARK(TreeLookup, "TreeEventHandlers/Lookup", 1, 10, 100, 1000, 10000);
+typedef RegistryLookup<openlcb::FlatEventHandlers> FlatLookup;
+BENCHMARK(FlatLookup, "FlatEventHandlers/Lookup", 1, 10, 100, 1000, 10000);
+typedef RegistryLookup<openlcb::VectorEventHandlers> VectorLookup;
+BENCHMARK(VectorLookup, "VectorEventHandlers/Lookup", 1, 10, 100, 1000);
+
+/// Looks up an event that has a given number of matching registrations, like
+/// the inputs and outputs of an IO board that all react to the same event,
+/// among 1000 other registrations. One operation is a complete iteration for
+/// one event report. @param R is the registry class.
+template <class R> class RegistryMultiMatch : public Benchmark
+{
+public:
+    RegistryMultiMatch(unsigned num_matches)
+        : report_(openlcb::FOR_TESTING)
+        , iterator_(registry_.create_iterator())
+    {
+        for (unsigned i = 0; i < 1000; ++i)
+        {
+            registry_.register_handler(
+                EventRegistryEntry(&handler_, BASE_EVENT + 0x1000 + i), 0);
+        }
+        // The matches are spread over different range widths.
+        for (unsigned i = 0; i < num_matches; ++i)
+        {
+            unsigned mask = i % 4 ? 0 : 4 * (i % 5);
+            EventId event = BASE_EVENT & ~((1ULL << mask) - 1);
+            registry_.register_handler(
+                EventRegistryEntry(&handler_, event), mask);
+        }
+        report_.event = BASE_EVENT;
+        report_.mask = 0;
+    }
+
+    void run(unsigned n) override
+    {
+        unsigned found = 0;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            iterator_->init_iteration(&report_);
+            while (iterator_->next_entry())
+            {
+                ++found;
+            }
+        }
+        do_not_optimize(found);
+    }
+
+private:
+    /// Registry under test.
+    R registry_;
+    /// Handler used for all registrations.
+    CountingEventHandler handler_;
+    /// Event report to look up.
+    openlcb::EventReport report_;
+    /// Iterator of registry_.
+    std::unique_ptr<openlcb::EventIterator> iterator_;
+};
+
+typedef RegistryMultiMatch<openlcb::TreeEventHandlers> TreeMultiMatch;
+BENCHMARK(TreeMultiMatch, "TreeEventHandlers/MultiMatch", 0, 1, 8, 64);
+typedef RegistryMultiMatch<openlcb::FlatEventHandlers> FlatMultiMatch;
+BENCHMARK(FlatMultiMatch, "FlatEventHandlers/MultiMatch", 0, 1, 8, 64);
+typedef RegistryMultiMatch<openlcb::VectorEventHandlers> VectorMultiMatch;
+BENCHMARK(VectorMultiMatch, "VectorEventHandlers/MultiMatch", 0, 1, 8, 64);
+
+/// Measures the latency from a CAN frame entering the hub to the event
+/// handler being called, through the IfCan frame parser, the message
+/// dispatcher and the EventService. The argument is the number of events
+/// registered; only one of them is reported.
+class IfCanEventLatency : public Benchmark
+{
+public:
+    IfCanEventLatency(unsigned num_events)
+    {
+        stack_.add_remote(REMOTE_NODE, REMOTE_ALIAS);
+        for (unsigned i = 0; i < num_events; ++i)
+        {
+            EventRegistry::instance()->register_handler(
+                EventRegistryEntry(&handler_, BASE_EVENT + i * 2), 0);
+        }
+        wait_for_bench_executor();
+    }
+
+    ~IfCanEventLatency()
+    {
+        EventRegistry::instance()->unregister_handler(&handler_);
+        wait_for_bench_executor();
+    }
+
+    void run(unsigned n) override
+    {
+        for (unsigned i = 0; i < n; ++i)
+        {
+            unsigned expected = handler_.count_ + 1;
+            auto *b = hub_.alloc();
+            // Producer/Consumer Event Report from the remote node.
+            b->data()->can_id = 0x195B4000 | REMOTE_ALIAS;
+            SET_CAN_FRAME_EFF(*b->data());
+            b->data()->can_dlc = 8;
+            uint64_t event = htobe64(BASE_EVENT);
+            memcpy(b->data()->mutable_frame()->data, &event, 8);
+            hub_.send(b);
+            while (handler_.count_ < expected)
+            {
+                sched_yield();
+            }
+        }
+    }
+
+private:
+    /// Node ID of the simulated sender.
+    static constexpr openlcb::NodeID REMOTE_NODE = 0x050101011899ULL;
+    /// Alias of the simulated sender.
+    static constexpr openlcb::NodeAlias REMOTE_ALIAS = 0x555;
+
+    /// CAN bus.
+    CanHubFlow hub_{&g_bench_service};
+    /// Stack under test.
+    CanStack stack_{&hub_, 0x050101011801ULL, 0x22A};
+    /// Global event service.
+    openlcb::EventService eventService_{stack_.iface()};
+    /// Receives the events.
+    CountingEventHandler handler_;
+};
+
+BENCHMARK(IfCanEventLatency, "IfCan/EventReportLatency", 1, 1000);
+
+/// Event handler that counts all calls to it.
+class FanoutEventHandler : public openlcb::SimpleEventHandler
+{
+public:
+    void handle_event_report(const EventRegistryEntry &registry_entry,
+        EventReport *event, BarrierNotifiable *done) override
+    {
+        ++count_;
+        done->notify();
+    }
+
+    void handle_identify_global(const EventRegistryEntry &registry_entry,
+        EventReport *event, BarrierNotifiable *done) override
+    {
+        ++count_;
+        done->notify();
+    }
+
+    /// Number of calls received.
+    std::atomic<unsigned> count_{0};
+};
+
+/// Measures the latency of delivering one incoming message to a number of
+/// event handlers, from the CAN frame entering the hub to the last handler
+/// call. The argument is the number of matching registrations. @param FLAGS
+/// are the flags of the registrations. @param IDENTIFY is true to send a
+/// global Identify Events, false to send an event report.
+template <uint32_t FLAGS, bool IDENTIFY> class EventFanout : public Benchmark
+{
+public:
+    EventFanout(unsigned num_handlers)
+        : numHandlers_(num_handlers)
+    {
+        stack_.add_remote(REMOTE_NODE, REMOTE_ALIAS);
+        for (unsigned i = 0; i < num_handlers; ++i)
+        {
+            EventRegistry::instance()->register_handler(
+                EventRegistryEntry(&handler_, BASE_EVENT, i, FLAGS), 0);
+        }
+        wait_for_bench_executor();
+    }
+
+    ~EventFanout()
+    {
+        EventRegistry::instance()->unregister_handler(&handler_);
+        wait_for_bench_executor();
+    }
+
+    void run(unsigned n) override
+    {
+        for (unsigned i = 0; i < n; ++i)
+        {
+            unsigned expected = handler_.count_ + numHandlers_;
+            auto *b = hub_.alloc();
+            if (IDENTIFY)
+            {
+                // Identify Events (global).
+                b->data()->can_id = 0x19970000 | REMOTE_ALIAS;
+                b->data()->can_dlc = 0;
+            }
+            else
+            {
+                // Producer/Consumer Event Report.
+                b->data()->can_id = 0x195B4000 | REMOTE_ALIAS;
+                b->data()->can_dlc = 8;
+                uint64_t event = htobe64(BASE_EVENT);
+                memcpy(b->data()->mutable_frame()->data, &event, 8);
+            }
+            SET_CAN_FRAME_EFF(*b->data());
+            hub_.send(b);
+            while (handler_.count_ < expected)
+            {
+                sched_yield();
+            }
+        }
+    }
+
+private:
+    /// Node ID of the simulated sender.
+    static constexpr openlcb::NodeID REMOTE_NODE = 0x050101011899ULL;
+    /// Alias of the simulated sender.
+    static constexpr openlcb::NodeAlias REMOTE_ALIAS = 0x555;
+
+    /// How many registrations match.
+    unsigned numHandlers_;
+    /// CAN bus.
+    CanHubFlow hub_{&g_bench_service};
+    /// Stack under test.
+    CanStack stack_{&hub_, 0x050101011801ULL, 0x22A};
+    /// Global event service.
+    openlcb::EventService eventService_{stack_.iface()};
+    /// Receives the events.
+    FanoutEventHandler handler_;
+};
+
+typedef EventFanout<0, false> ReportFanout;
+BENCHMARK(ReportFanout, "EventService/ReportFanout", 1, 8, 64);
+typedef EventFanout<EventRegistryEntry::SYNCHRONOUS, false> ReportFanoutSync;
+BENCHMARK(ReportFanoutSync, "EventService/ReportFanoutSync", 1, 8, 64);
+typedef EventFanout<0, true> IdentifyFanout;
+BENCHMARK(IdentifyFanout, "EventService/IdentifyFanout", 1, 8, 64);
+typedef EventFanout<EventRegistryEntry::SYNCHRONOUS, true> IdentifyFanoutSync;
+BENCHMARK(IdentifyFanoutSync, "EventService/IdentifyFanoutSync", 1, 8, 64);
+
+/// Event handler that answers the identify global message with a Producer
+/// Identified message for the registered event.
+class IdentifyingEventHandler : public openlcb::SimpleEventHandler
+{
+public:
+    /// @param node is the node sending the messages.
+    IdentifyingEventHandler(openlcb::Node *node)
+        : node_(node)
+    {
+    }
+
+    void handle_identify_global(const EventRegistryEntry &registry_entry,
+        EventReport *event, BarrierNotifiable *done) override
+    {
+        event->event_write_helper<1>()->WriteAsync(node_,
+            openlcb::Defs::MTI_PRODUCER_IDENTIFIED_VALID,
+            openlcb::WriteHelper::global(),
+            openlcb::eventid_to_buffer(registry_entry.event), done);
+    }
+
+private:
+    /// Sending node.
+    openlcb::Node *node_;
+};
+
+/// Hub port that counts the frames it receives.
+class FrameCountingPort : public CanHubPortInterface
+{
+public:
+    void send(Buffer<CanHubData> *b, unsigned priority) override
+    {
+        ++count_;
+        b->unref();
+    }
+
+    /// Number of frames received.
+    std::atomic<unsigned> count_{0};
+};
+
+/// Measures the time it takes a node to answer a global Identify Events
+/// message, when it has 200 single-event producers. One operation is the
+/// complete response. The argument is the number of messages allowed per
+/// 10 msec identify pacing period; 0 turns the pacing off.
+class IdentifyResponse : public Benchmark
+{
+public:
+    IdentifyResponse(unsigned max_messages)
+    {
+        eventService_.set_identify_pacing(max_messages, 10);
+        stack_.add_remote(REMOTE_NODE, REMOTE_ALIAS);
+        for (unsigned i = 0; i < NUM_EVENTS; ++i)
+        {
+            EventRegistry::instance()->register_handler(
+                EventRegistryEntry(&handler_, BASE_EVENT + i), 0);
+        }
+        hub_.register_port(&port_);
+        wait_for_bench_executor();
+    }
+
+    ~IdentifyResponse()
+    {
+        EventRegistry::instance()->unregister_handler(&handler_);
+        hub_.unregister_port(&port_);
+        wait_for_bench_executor();
+    }
+
+    void run(unsigned n) override
+    {
+        for (unsigned i = 0; i < n; ++i)
+        {
+            unsigned expected = port_.count_ + NUM_EVENTS;
+            auto *b = hub_.alloc();
+            b->data()->can_id = 0x19970000 | REMOTE_ALIAS;
+            SET_CAN_FRAME_EFF(*b->data());
+            b->data()->can_dlc = 0;
+            hub_.send(b);
+            while (port_.count_ < expected)
+            {
+                usleep(100);
+            }
+            // The last period of the pacing has to expire as well.
+            while (eventService_.event_processing_pending())
+            {
+                usleep(100);
+            }
+        }
+    }
+
+private:
+    /// How many events the node produces.
+    static constexpr unsigned NUM_EVENTS = 200;
+    /// Node ID of the simulated sender.
+    static constexpr openlcb::NodeID REMOTE_NODE = 0x050101011899ULL;
+    /// Alias of the simulated sender.
+    static constexpr openlcb::NodeAlias REMOTE_ALIAS = 0x555;
+
+    /// CAN bus.
+    CanHubFlow hub_{&g_bench_service};
+    /// Stack under test.
+    CanStack stack_{&hub_, 0x050101011801ULL, 0x22A};
+    /// Global event service.
+    openlcb::EventService eventService_{stack_.iface()};
+    /// Answers the identify messages.
+    IdentifyingEventHandler handler_{stack_.node()};
+    /// Counts the frames the node sends.
+    FrameCountingPort port_;
+};
+
+BENCHMARK(IdentifyResponse, "EventService/IdentifyResponse", 0, 5, 9);
+
+} // namespace
@@ -0,0 +1,327 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file ExecutorBench.cxx
+ *
+ * Benchmarks for the executor select backends and the ExecutorPool.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "bench/Benchmark.hxx"
+
+#include <atomic>
+#include <memory>
+#include <sys/eventfd.h>
+
+#include "executor/ExecutorPool.hxx"
+#include "executor/StateFlow.hxx"
+#include "utils/Hub.hxx"
+#include "utils/gc_format.h"
+
+namespace
+{
+
+/// Flow that keeps reading 8-byte values from an eventfd and counts them.
+class EventFdReader : public StateFlowBase
+{
+public:
+    /// @param s is the service to run on. @param fd is the eventfd to read.
+    /// @param count is incremented for every value read.
+    EventFdReader(Service *s, int fd, std::atomic<unsigned> *count)
+        : StateFlowBase(s)
+        , fd_(fd)
+        , count_(count)
+    {
+        start_flow(STATE(read));
+    }
+
+    ~EventFdReader()
+    {
+        if (service()->executor()->is_selected(&helper_))
+        {
+            service()->executor()->unselect(&helper_);
+        }
+    }
+
+private:
+    Action read()
+    {
+        return read_single(&helper_, fd_, &value_, 8, STATE(read_done));
+    }
+
+    Action read_done()
+    {
+        ++*count_;
+        return call_immediately(STATE(read));
+    }
+
+    StateFlowSelectHelper helper_{this};
+    int fd_;
+    std::atomic<unsigned> *count_;
+    uint64_t value_;
+};
+
+/// Wakes up flows waiting on eventfds through the select loop of an
+/// executor. The argument is the number of watched fds. One operation is one
+/// event delivered to a flow.
+class SelectWakeup : public Benchmark
+{
+public:
+    /// @param use_epoll selects the backend. @param num_fds is how many fds
+    /// are watched. @param all_active is true to trigger all fds in every
+    /// round, false to trigger only the first one.
+    SelectWakeup(bool use_epoll, unsigned num_fds, bool all_active)
+        : executor_(NO_THREAD())
+        , service_(&executor_)
+        , allActive_(all_active)
+    {
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+        executor_.set_use_epoll(use_epoll);
+#else
+        HASSERT(!use_epoll);
+#endif
+        executor_.start_thread("bench_select", 0, 1024);
+        for (unsigned i = 0; i < num_fds; ++i)
+        {
+            int fd = eventfd(0, EFD_NONBLOCK);
+            HASSERT(fd >= 0);
+            fds_.push_back(fd);
+            readers_.emplace_back(new EventFdReader(&service_, fd, &count_));
+        }
+        wait_for_executor();
+    }
+
+    ~SelectWakeup()
+    {
+        wait_for_executor();
+        for (auto &r : readers_)
+        {
+            executor_.sync_run([&r]() { r.reset(); });
+        }
+        for (int fd : fds_)
+        {
+            ::close(fd);
+        }
+    }
+
+    void run(unsigned n) override
+    {
+        unsigned per_round = allActive_ ? fds_.size() : 1;
+        unsigned rounds = (n + per_round - 1) / per_round;
+        unsigned base = count_;
+        for (unsigned i = 0; i < rounds; ++i)
+        {
+            for (unsigned j = 0; j < per_round; ++j)
+            {
+                uint64_t one = 1;
+                ssize_t ret = ::write(fds_[j], &one, 8);
+                HASSERT(ret == 8);
+            }
+            while (count_ - base < (i + 1) * per_round)
+            {
+                sched_yield();
+            }
+        }
+    }
+
+private:
+    /// Blocks until the executor is idle.
+    void wait_for_executor()
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            ExecutorGuard guard(&executor_);
+            guard.wait_for_notification();
+        }
+    }
+
+    Executor<1> executor_;
+    Service service_;
+    /// True to trigger every fd in each round.
+    bool allActive_;
+    /// Number of events the readers have seen.
+    std::atomic<unsigned> count_{0};
+    /// The eventfds.
+    std::vector<int> fds_;
+    /// One reader per eventfd.
+    std::vector<std::unique_ptr<EventFdReader>> readers_;
+};
+
+/// pselect backend, one active fd.
+class PselectOneActive : public SelectWakeup
+{
+public:
+    PselectOneActive(unsigned num_fds)
+        : SelectWakeup(false, num_fds, false)
+    {
+    }
+};
+
+BENCHMARK(PselectOneActive, "Executor/Pselect/OneActive", 10, 100, 1000);
+
+/// pselect backend, all fds active.
+class PselectAllActive : public SelectWakeup
+{
+public:
+    PselectAllActive(unsigned num_fds)
+        : SelectWakeup(false, num_fds, true)
+    {
+    }
+};
+
+BENCHMARK(PselectAllActive, "Executor/Pselect/AllActive", 10, 100, 1000);
+
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+
+/// epoll backend, one active fd.
+class EpollOneActive : public SelectWakeup
+{
+public:
+    EpollOneActive(unsigned num_fds)
+        : SelectWakeup(true, num_fds, false)
+    {
+    }
+};
+
+BENCHMARK(EpollOneActive, "Executor/Epoll/OneActive", 10, 100, 1000);
+
+/// epoll backend, all fds active.
+class EpollAllActive : public SelectWakeup
+{
+public:
+    EpollAllActive(unsigned num_fds)
+        : SelectWakeup(true, num_fds, true)
+    {
+    }
+};
+
+BENCHMARK(EpollAllActive, "Executor/Epoll/AllActive", 10, 100, 1000);
+
+#endif // OPENMRN_FEATURE_EXECUTOR_EPOLL
+
+#if OPENMRN_FEATURE_EXECUTOR_POOL
+
+/// Hub port that renders each frame to GridConnect, like a TCP client port
+/// would, and counts the frames.
+class RenderingPort : public CanHubPort
+{
+public:
+    /// @param s is the service to run on. @param count is incremented for
+    /// every frame.
+    RenderingPort(Service *s, std::atomic<unsigned> *count)
+        : CanHubPort(s)
+        , count_(count)
+    {
+    }
+
+    Action entry() override
+    {
+        char buf[64];
+        gc_format_generate(message()->data(), buf, 0);
+        ++*count_;
+        return release_and_exit();
+    }
+
+private:
+    /// Frame counter.
+    std::atomic<unsigned> *count_;
+};
+
+/// Sends CAN frames into a hub running on an ExecutorPool with 32 ports, each
+/// on its own Service so that they may run in parallel. The argument is the
+/// number of workers. One operation is one incoming frame. On a machine with
+/// fewer cores than workers the numbers will not scale.
+class PoolHubFanout : public Benchmark
+{
+public:
+    PoolHubFanout(unsigned workers)
+        : pool_("bench_pool", 0, 1024, workers)
+    {
+        for (unsigned i = 0; i < NUM_PORTS; ++i)
+        {
+            services_.emplace_back(new Service(&pool_));
+            ports_.emplace_back(
+                new RenderingPort(services_.back().get(), &count_));
+            hub_.register_port(ports_.back().get());
+        }
+    }
+
+    ~PoolHubFanout()
+    {
+        for (auto &p : ports_)
+        {
+            hub_.unregister_port(p.get());
+        }
+        ExecutorGuard guard(&pool_);
+        guard.wait_for_notification();
+    }
+
+    void run(unsigned n) override
+    {
+        unsigned base = count_;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            // Keeps the number of queued buffers bounded.
+            while (i - (count_ - base) / NUM_PORTS > MAX_IN_FLIGHT)
+            {
+                sched_yield();
+            }
+            auto *b = hub_.alloc();
+            b->data()->can_id = 0x195b4000 | (i & 0xfff);
+            b->data()->can_dlc = 8;
+            memset(b->data()->mutable_frame()->data, i, 8);
+            hub_.send(b);
+        }
+        while (count_ - base < n * NUM_PORTS)
+        {
+            sched_yield();
+        }
+    }
+
+private:
+    /// Number of output ports.
+    static constexpr unsigned NUM_PORTS = 32;
+    /// How many frames may be in the hub at the same time.
+    static constexpr unsigned MAX_IN_FLIGHT = 256;
+
+    ExecutorPool<1> pool_;
+    Service service_{&pool_};
+    CanHubFlow hub_{&service_};
+    /// Number of frames delivered to the ports.
+    std::atomic<unsigned> count_{0};
+    /// One Service per port.
+    std::vector<std::unique_ptr<Service>> services_;
+    /// Output ports.
+    std::vector<std::unique_ptr<RenderingPort>> ports_;
+};
+
+BENCHMARK(PoolHubFanout, "ExecutorPool/HubFanout", 1, 2, 4, 8);
+
+#endif // OPENMRN_FEATURE_EXECUTOR_POOL
+
+} // namespace
@@ -0,0 +1,297 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file GridConnectBench.cxx
+ *
+ * Benchmarks for the GridConnect format parser and renderer.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "bench/Benchmark.hxx"
+
+#include <algorithm>
+#include <string>
+
+#include "can_frame.h"
+#include "utils/GcRenderCache.hxx"
+#include "utils/GcStreamParser.hxx"
+#include "utils/gc_format.h"
+
+namespace
+{
+
+/// A typical mix of OpenLCB traffic: event reports, datagram frames, short
+/// addressed messages and an occasional standard frame. The leading ':' and
+/// the trailing ';' are removed, as gc_format_parse expects.
+const char *const GC_PACKETS[] = {
+    "X195B4123N0102030405060708",
+    "X1A22A555N3031323334353637",
+    "X19170123N",
+    "X19488997N033A",
+    "X194C7123N0501010118000000",
+    "X1B22A555N30313233",
+    "S123N0102",
+    "X195B4456N05010101FFFF0000",
+};
+
+/// Number of entries in GC_PACKETS. Must be a power of two.
+constexpr unsigned NUM_PACKETS = sizeof(GC_PACKETS) / sizeof(GC_PACKETS[0]);
+static_assert((NUM_PACKETS & (NUM_PACKETS - 1)) == 0, "not a power of two");
+
+/// Parses one GridConnect packet to a can_frame per operation.
+class GcParse : public Benchmark
+{
+public:
+    GcParse(unsigned)
+    {
+    }
+
+    void run(unsigned n) override
+    {
+        struct can_frame frame;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            gc_format_parse(GC_PACKETS[i & (NUM_PACKETS - 1)], &frame);
+            do_not_optimize(frame);
+        }
+    }
+};
+
+BENCHMARK(GcParse, "GridConnect/Parse");
+
+/// Renders one can_frame to GridConnect per operation. The argument is the
+/// double_format flag of gc_format_generate.
+class GcGenerate : public Benchmark
+{
+public:
+    GcGenerate(unsigned double_format)
+        : doubleFormat_(double_format)
+    {
+        for (unsigned i = 0; i < NUM_PACKETS; ++i)
+        {
+            gc_format_parse(GC_PACKETS[i], &frames_[i]);
+        }
+    }
+
+    void run(unsigned n) override
+    {
+        char buf[64];
+        for (unsigned i = 0; i < n; ++i)
+        {
+            gc_format_generate(
+                &frames_[i & (NUM_PACKETS - 1)], buf, doubleFormat_);
+            do_not_optimize(buf);
+        }
+    }
+
+private:
+    /// Pre-parsed frames.
+    struct can_frame frames_[NUM_PACKETS];
+    /// Argument for gc_format_generate.
+    int doubleFormat_;
+};
+
+BENCHMARK(GcGenerate, "GridConnect/Generate", 0, 1);
+
+/// Base class for the stream benchmarks. Holds a buffer of GridConnect
+/// traffic as it would arrive from a socket.
+class GcStreamBase : public Benchmark
+{
+protected:
+    /// How many frames are in the stream buffer.
+    static constexpr unsigned NUM_FRAMES = 64 * NUM_PACKETS;
+
+    GcStreamBase()
+    {
+        for (unsigned i = 0; i < NUM_FRAMES; ++i)
+        {
+            stream_ += ':';
+            stream_ += GC_PACKETS[i & (NUM_PACKETS - 1)];
+            stream_ += ";\n";
+        }
+    }
+
+    /// The incoming characters.
+    string stream_;
+};
+
+/// Splits a stream into frames with GcStreamParser::consume_byte and parses
+/// every frame separately. One operation is one frame.
+class GcStreamParse : public GcStreamBase
+{
+public:
+    GcStreamParse(unsigned)
+    {
+    }
+
+    void run(unsigned n) override
+    {
+        struct can_frame frame;
+        unsigned ofs = 0;
+        for (unsigned i = 0; i < n;)
+        {
+            if (parser_.consume_byte(stream_[ofs]))
+            {
+                parser_.parse_frame_to_output(&frame);
+                do_not_optimize(frame);
+                ++i;
+            }
+            if (++ofs >= stream_.size())
+            {
+                ofs = 0;
+            }
+        }
+    }
+
+private:
+    /// Stream state.
+    GcStreamParser parser_;
+};
+
+BENCHMARK(GcStreamParse, "GridConnect/StreamParse");
+
+/// Splits a stream into frames with GcStreamParser::parse_bulk, the way
+/// GridConnectHub reads from a socket. One operation is one frame.
+class GcStreamParseBulk : public GcStreamBase
+{
+public:
+    GcStreamParseBulk(unsigned)
+    {
+    }
+
+    void run(unsigned n) override
+    {
+        struct can_frame frames[16];
+        unsigned ofs = 0;
+        for (unsigned i = 0; i < n;)
+        {
+            size_t consumed;
+            size_t count = parser_.parse_bulk(stream_.data() + ofs,
+                std::min<size_t>(READ_SIZE, stream_.size() - ofs), frames,
+                std::min<size_t>(16, n - i), &consumed);
+            do_not_optimize(frames);
+            i += count;
+            ofs += consumed;
+            if (ofs >= stream_.size())
+            {
+                ofs = 0;
+            }
+        }
+    }
+
+private:
+    /// How many characters are handed to the parser at a time.
+    static constexpr size_t READ_SIZE = 256;
+    /// Stream state.
+    GcStreamParser parser_;
+};
+
+BENCHMARK(GcStreamParseBulk, "GridConnect/StreamParseBulk");
+
+/// Renders a batch of can_frames with gc_format_generate_bulk. One operation
+/// is one frame. The argument is the double_format flag.
+class GcGenerateBulk : public Benchmark
+{
+public:
+    GcGenerateBulk(unsigned double_format)
+        : doubleFormat_(double_format)
+    {
+        for (unsigned i = 0; i < NUM_PACKETS; ++i)
+        {
+            gc_format_parse(GC_PACKETS[i], &frames_[i]);
+        }
+    }
+
+    void run(unsigned n) override
+    {
+        char buf[2 * NUM_PACKETS * GC_FORMAT_MAX_FRAME_LENGTH];
+        for (unsigned i = 0; i < n; i += NUM_PACKETS)
+        {
+            gc_format_generate_bulk(frames_, NUM_PACKETS, buf, doubleFormat_);
+            do_not_optimize(buf);
+        }
+    }
+
+private:
+    /// Pre-parsed frames.
+    struct can_frame frames_[NUM_PACKETS];
+    /// Argument for gc_format_generate_bulk.
+    int doubleFormat_;
+};
+
+BENCHMARK(GcGenerateBulk, "GridConnect/GenerateBulk", 0, 1);
+
+/// Renders every frame for a number of clients, the way the connections of a
+/// GcTcpHub do. One operation is one frame sent to one client. The argument
+/// is 0 to format separately for each client, 1 to go through a shared
+/// GcRenderCache.
+class GcFanout : public Benchmark
+{
+public:
+    GcFanout(unsigned use_cache)
+        : useCache_(use_cache)
+    {
+        for (unsigned i = 0; i < NUM_PACKETS; ++i)
+        {
+            gc_format_parse(GC_PACKETS[i], &frames_[i]);
+        }
+    }
+
+    void run(unsigned n) override
+    {
+        char buf[GC_FORMAT_MAX_FRAME_LENGTH];
+        for (unsigned i = 0; i < n; ++i)
+        {
+            const struct can_frame *f =
+                &frames_[(i / NUM_CLIENTS) & (NUM_PACKETS - 1)];
+            if (useCache_)
+            {
+                cache_.render(f, 0, buf);
+            }
+            else
+            {
+                gc_format_generate(f, buf, 0);
+            }
+            do_not_optimize(buf);
+        }
+    }
+
+private:
+    /// How many clients receive each frame.
+    static constexpr unsigned NUM_CLIENTS = 100;
+    /// Pre-parsed frames.
+    struct can_frame frames_[NUM_PACKETS];
+    /// Shared rendering cache.
+    GcRenderCache cache_;
+    /// Non-zero if cache_ should be used.
+    unsigned useCache_;
+};
+
+BENCHMARK(GcFanout, "GridConnect/Fanout", 0, 1);
+
+} // namespace
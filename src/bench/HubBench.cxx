@@ -0,0 +1,431 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file HubBench.cxx
+ *
+ * Benchmarks for the hub fan-out and for the message dispatcher.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "bench/Benchmark.hxx"
+
+#include <atomic>
+#include <memory>
+#include <sys/socket.h>
+#include <thread>
+
+#include "openlcb/If.hxx"
+#include "utils/GcTcpHub.hxx"
+#include "utils/GridConnectHub.hxx"
+#include "utils/Hub.hxx"
+#include "utils/HubDeviceSelect.hxx"
+#include "utils/HubDeviceUring.hxx"
+#include "utils/ShmCanHub.hxx"
+#include "utils/socket_listener.hxx"
+
+namespace
+{
+
+/// How many messages the benchmark thread may have queued before it waits
+/// for the executor to catch up. Keeps the memory use bounded.
+constexpr unsigned MAX_IN_FLIGHT = 256;
+
+/// Sends n items with at most MAX_IN_FLIGHT outstanding.
+/// @param n how many items to send.
+/// @param done counter that reaches the number of completed items.
+/// @param per_item how much done increments per item.
+/// @param send_one callback that sends item i.
+template <class F>
+void send_throttled(
+    unsigned n, std::atomic<unsigned> *done, unsigned per_item, F send_one)
+{
+    unsigned base = done->load();
+    for (unsigned i = 0; i < n; ++i)
+    {
+        while (i - (done->load() - base) / per_item > MAX_IN_FLIGHT)
+        {
+            sched_yield();
+        }
+        send_one(i);
+    }
+    while (done->load() - base < n * per_item)
+    {
+        sched_yield();
+    }
+}
+
+/// Hub port that counts the frames it receives and drops them.
+class CountingPort : public CanHubPort
+{
+public:
+    /// @param count is incremented for every frame.
+    CountingPort(std::atomic<unsigned> *count)
+        : CanHubPort(&g_bench_service)
+        , count_(count)
+    {
+    }
+
+    Action entry() override
+    {
+        ++*count_;
+        return release_and_exit();
+    }
+
+private:
+    /// Frame counter.
+    std::atomic<unsigned> *count_;
+};
+
+/// Sends CAN frames into a hub with a given number of ports. One operation is
+/// one incoming frame, which is delivered to every port.
+class HubFanout : public Benchmark
+{
+public:
+    HubFanout(unsigned num_ports)
+    {
+        for (unsigned i = 0; i < num_ports; ++i)
+        {
+            ports_.emplace_back(new CountingPort(&count_));
+            hub_.register_port(ports_.back().get());
+        }
+        wait_for_bench_executor();
+    }
+
+    ~HubFanout()
+    {
+        for (auto &p : ports_)
+        {
+            hub_.unregister_port(p.get());
+        }
+        wait_for_bench_executor();
+    }
+
+    void run(unsigned n) override
+    {
+        send_throttled(n, &count_, ports_.size(), [this](unsigned i) {
+            auto *b = hub_.alloc();
+            b->data()->can_id = 0x195b4000 | (i & 0xfff);
+            b->data()->can_dlc = 8;
+            memset(b->data()->mutable_frame()->data, i, 8);
+            hub_.send(b);
+        });
+    }
+
+private:
+    /// Number of frames delivered to the ports.
+    std::atomic<unsigned> count_{0};
+    /// Hub under test.
+    CanHubFlow hub_{&g_bench_service};
+    /// Output ports.
+    std::vector<std::unique_ptr<CountingPort>> ports_;
+};
+
+BENCHMARK(HubFanout, "Hub/Fanout", 1, 8, 32);
+
+#if OPENMRN_HAVE_IO_URING && defined(OPENMRN_FEATURE_EXECUTOR_SELECT)
+
+/// Forwards CAN frames from one socket to another through a hub with two
+/// device ports. The benchmark thread writes the frames into the first
+/// socket, and a second thread reads them from the other one. One operation
+/// is one frame. The argument is 0 for HubDeviceSelect ports, 1 for
+/// HubDeviceUring ports.
+class HubDeviceLink : public Benchmark
+{
+public:
+    HubDeviceLink(unsigned use_uring)
+    {
+        int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, in_);
+        HASSERT(ret == 0);
+        ret = socketpair(AF_UNIX, SOCK_STREAM, 0, out_);
+        HASSERT(ret == 0);
+        if (use_uring)
+        {
+            ring_.reset(new IoUring(&g_bench_executor));
+            HASSERT(ring_->is_valid());
+            uringIn_.reset(new HubDeviceUring<CanHubFlow>(
+                ring_.get(), &hub_, in_[1]));
+            uringOut_.reset(new HubDeviceUring<CanHubFlow>(
+                ring_.get(), &hub_, out_[1]));
+        }
+        else
+        {
+            selectIn_.reset(new HubDeviceSelect<CanHubFlow>(&hub_, in_[1]));
+            selectOut_.reset(new HubDeviceSelect<CanHubFlow>(&hub_, out_[1]));
+        }
+        for (unsigned i = 0; i < CHUNK; ++i)
+        {
+            frames_[i].can_id = 0x195b4000 | i;
+            SET_CAN_FRAME_EFF(frames_[i]);
+            frames_[i].can_dlc = 8;
+            memset(frames_[i].data, i, 8);
+        }
+        reader_ = std::thread([this]() { read_all(); });
+    }
+
+    ~HubDeviceLink()
+    {
+        // The ports close their end of the sockets, which stops reader_.
+        selectIn_.reset();
+        selectOut_.reset();
+        uringIn_.reset();
+        uringOut_.reset();
+        reader_.join();
+        wait_for_bench_executor();
+        ring_.reset();
+        ::close(in_[0]);
+        ::close(out_[0]);
+    }
+
+    void run(unsigned n) override
+    {
+        send_throttled(
+            (n + CHUNK - 1) / CHUNK, &count_, CHUNK, [this](unsigned) {
+                ssize_t ret = ::write(in_[0], frames_, sizeof(frames_));
+                HASSERT(ret == sizeof(frames_));
+            });
+    }
+
+private:
+    /// Number of frames written with one system call.
+    static constexpr unsigned CHUNK = 16;
+
+    /// Reads and counts the frames until the socket is closed.
+    void read_all()
+    {
+        struct can_frame buf[CHUNK * 4];
+        size_t partial = 0;
+        while (true)
+        {
+            ssize_t ret = ::read(out_[0], buf, sizeof(buf));
+            if (ret <= 0)
+            {
+                return;
+            }
+            partial += ret;
+            count_ += partial / sizeof(struct can_frame);
+            partial %= sizeof(struct can_frame);
+        }
+    }
+
+    /// Number of frames arrived at the output socket.
+    std::atomic<unsigned> count_ {0};
+    /// Hub under test.
+    CanHubFlow hub_ {&g_bench_service};
+    /// Input socket pair. [0] is written by the benchmark, [1] is a port.
+    int in_[2];
+    /// Output socket pair. [1] is a port, [0] is read by reader_.
+    int out_[2];
+    /// One chunk of frames to send.
+    struct can_frame frames_[CHUNK];
+    /// Ring of the io_uring ports.
+    std::unique_ptr<IoUring> ring_;
+    /// Ports of the select variant.
+    std::unique_ptr<HubDeviceSelect<CanHubFlow>> selectIn_, selectOut_;
+    /// Ports of the io_uring variant.
+    std::unique_ptr<HubDeviceUring<CanHubFlow>> uringIn_, uringOut_;
+    /// Runs read_all().
+    std::thread reader_;
+};
+
+BENCHMARK(HubDeviceLink, "Hub/DeviceLink", 0, 1);
+
+#endif // OPENMRN_HAVE_IO_URING
+
+#if OPENMRN_HAVE_FUTEX
+
+/// Sends CAN frames from a client hub to a server hub, like two processes on
+/// the same host would. One operation is one frame arriving at the server
+/// hub. The argument is 0 for GridConnect over loopback TCP (GcTcpHub), 1
+/// for the shared memory transport (ShmCanHub).
+class HubLocalLink : public Benchmark
+{
+public:
+    HubLocalLink(unsigned use_shm)
+    {
+        serverHub_->register_port(&counter_);
+        if (use_shm)
+        {
+            shm_.reset(new ShmCanHub(serverHub_.get(), "/openmrn_bench"));
+            HASSERT(shm_->is_valid());
+            shmPort_.reset(new ShmCanHubPort(clientHub_.get(), "/openmrn_bench"));
+            HASSERT(shmPort_->is_valid());
+            while (shm_->num_clients() < 1)
+            {
+                usleep(1000);
+            }
+        }
+        else
+        {
+            tcp_.reset(new GcTcpHub(serverHub_.get(), PORT));
+            while (!tcp_->is_started())
+            {
+                usleep(1000);
+            }
+            int fd = ConnectSocket("localhost", PORT);
+            HASSERT(fd >= 0);
+            create_gc_port_for_can_hub(clientHub_.get(), fd);
+            // Waits for the connection to appear on the server hub.
+            usleep(50000);
+        }
+    }
+
+    ~HubLocalLink()
+    {
+        shmPort_.reset();
+        shm_.reset();
+        serverHub_->unregister_port(&counter_);
+        wait_for_bench_executor();
+        if (tcp_)
+        {
+            // The GridConnect connection cannot be torn down from here; it
+            // stays with its hubs until the end of the process.
+            tcp_.release();
+            serverHub_.release();
+            clientHub_.release();
+        }
+    }
+
+    void run(unsigned n) override
+    {
+        send_throttled(n, &count_, 1, [this](unsigned i) {
+            auto *b = clientHub_->alloc();
+            b->data()->can_id = 0x195b4000 | (i & 0xfff);
+            SET_CAN_FRAME_EFF(*b->data()->mutable_frame());
+            b->data()->can_dlc = 8;
+            memset(b->data()->mutable_frame()->data, i, 8);
+            b->data()->skipMember_ = nullptr;
+            clientHub_->send(b);
+        });
+    }
+
+private:
+    /// TCP port of the GcTcpHub.
+    static constexpr int PORT = 12031;
+
+    /// Number of frames arrived at the server hub.
+    std::atomic<unsigned> count_ {0};
+    /// Counts the frames at the server hub.
+    CountingPort counter_ {&count_};
+    /// Hub of the "hub process".
+    std::unique_ptr<CanHubFlow> serverHub_ {
+        new CanHubFlow(&g_bench_service)};
+    /// Hub of the "client process".
+    std::unique_ptr<CanHubFlow> clientHub_ {
+        new CanHubFlow(&g_bench_service)};
+    /// Server of the TCP variant.
+    std::unique_ptr<GcTcpHub> tcp_;
+    /// Server of the shared memory variant.
+    std::unique_ptr<ShmCanHub> shm_;
+    /// Client of the shared memory variant.
+    std::unique_ptr<ShmCanHubPort> shmPort_;
+};
+
+BENCHMARK(HubLocalLink, "Hub/LocalLink", 0, 1);
+
+#endif // OPENMRN_HAVE_FUTEX
+
+/// Message handler that counts and drops the messages it receives.
+class CountingMessageHandler : public openlcb::MessageHandler
+{
+public:
+    /// @param count is incremented for every message.
+    CountingMessageHandler(std::atomic<unsigned> *count)
+        : count_(count)
+    {
+    }
+
+    void send(Buffer<openlcb::GenMessage> *message, unsigned priority) override
+    {
+        ++*count_;
+        message->unref();
+    }
+
+private:
+    /// Message counter.
+    std::atomic<unsigned> *count_;
+};
+
+/// Dispatches messages through the same dispatcher type as the If uses. The
+/// argument is the number of exact-MTI handlers; in addition there are a few
+/// masked handlers that half of the messages also match, similarly to the
+/// event handling and datagram flows of a real stack.
+class Dispatch : public Benchmark
+{
+public:
+    Dispatch(unsigned num_exact)
+        : numExact_(num_exact)
+    {
+        for (unsigned i = 0; i < num_exact; ++i)
+        {
+            handlers_.emplace_back(new CountingMessageHandler(&exactCount_));
+            dispatcher_.register_handler(
+                handlers_.back().get(), 0x2000 + i, openlcb::Defs::MTI_EXACT);
+        }
+        for (unsigned i = 0; i < 8; ++i)
+        {
+            handlers_.emplace_back(new CountingMessageHandler(&maskedCount_));
+            dispatcher_.register_handler(handlers_.back().get(),
+                0x2000 | (i << 8) | openlcb::Defs::MTI_EVENT_MASK,
+                openlcb::Defs::MTI_EVENT_MASK | 0xff00);
+        }
+    }
+
+    ~Dispatch()
+    {
+        for (auto &h : handlers_)
+        {
+            dispatcher_.unregister_handler_all(h.get());
+        }
+        wait_for_bench_executor();
+    }
+
+    void run(unsigned n) override
+    {
+        send_throttled(n, &exactCount_, 1, [this](unsigned i) {
+            auto *b = dispatcher_.alloc();
+            b->data()->mti = (openlcb::Defs::MTI)(0x2000 + (i % numExact_));
+            dispatcher_.send(b);
+        });
+    }
+
+private:
+    /// Number of exact-MTI handlers.
+    unsigned numExact_;
+    /// Messages delivered to the exact handlers.
+    std::atomic<unsigned> exactCount_{0};
+    /// Messages delivered to the masked handlers.
+    std::atomic<unsigned> maskedCount_{0};
+    /// Dispatcher under test.
+    openlcb::If::MessageDispatchFlow dispatcher_{&g_bench_service};
+    /// Registered handlers.
+    std::vector<std::unique_ptr<CountingMessageHandler>> handlers_;
+};
+
+BENCHMARK(Dispatch, "DispatchFlow/Dispatch", 1, 16, 64);
+
+} // namespace
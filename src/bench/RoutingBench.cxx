@@ -0,0 +1,224 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file RoutingBench.cxx
+ *
+ * Benchmarks for the routing tables of the OpenLCB routers.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "bench/Benchmark.hxx"
+
+#include "openlcb/RoutingLogic.hxx"
+
+namespace
+{
+
+using openlcb::EventId;
+using openlcb::NodeID;
+using openlcb::RoutingLogic;
+
+/// Number of ports of the router.
+constexpr unsigned NUM_PORTS = 64;
+/// Number of nodes known to the router. Must be a power of two.
+constexpr unsigned NUM_NODES = 16384;
+/// Number of nodes actually put into the table (10k).
+constexpr unsigned NUM_KNOWN = 10000;
+/// Number of consumed events per port.
+constexpr unsigned EVENTS_PER_PORT = 200;
+/// First event ID.
+constexpr EventId BASE_EVENT = 0x0501010118000000ULL;
+
+/// A router port.
+struct Port
+{
+};
+
+/// Routing table with NUM_PORTS ports and NUM_KNOWN nodes. Each port has
+/// EVENTS_PER_PORT consumers, and every eighth port a consumer range.
+class RoutingBase : public Benchmark
+{
+public:
+    RoutingBase()
+    {
+        for (unsigned i = 0; i < NUM_KNOWN; ++i)
+        {
+            tables_.add_node_id_to_route(&ports_[i % NUM_PORTS], node(i));
+        }
+        for (unsigned p = 0; p < NUM_PORTS; ++p)
+        {
+            for (unsigned i = 0; i < EVENTS_PER_PORT; ++i)
+            {
+                tables_.register_consumer(
+                    &ports_[p], BASE_EVENT + (i * NUM_PORTS + p) * 7);
+            }
+            if (p % 8 == 0)
+            {
+                tables_.register_consumer_range(
+                    &ports_[p], BASE_EVENT + 0x100000 * (p + 1) + 0xFF);
+            }
+        }
+    }
+
+protected:
+    /// @param i index. @return the node ID of the i-th node.
+    static NodeID node(unsigned i)
+    {
+        return 0x050101011800ULL + i * 0x10001;
+    }
+
+    /// The ports.
+    Port ports_[NUM_PORTS];
+    /// The routing tables.
+    RoutingLogic<Port, NodeID> tables_;
+};
+
+/// Looks up the port of a destination address. One operation is one lookup.
+class RoutingLookup : public RoutingBase
+{
+public:
+    RoutingLookup(unsigned)
+    {
+    }
+
+    void run(unsigned n) override
+    {
+        for (unsigned i = 0; i < n; ++i)
+        {
+            // Mostly known, sometimes unknown addresses.
+            do_not_optimize(tables_.lookup_port_for_address(
+                node((i * 7919) & (NUM_NODES - 1))));
+        }
+    }
+};
+
+BENCHMARK(RoutingLookup, "Routing/Lookup");
+
+/// Learns the source address of a frame, which is almost always known
+/// already. One operation is one frame.
+class RoutingLearn : public RoutingBase
+{
+public:
+    RoutingLearn(unsigned)
+    {
+    }
+
+    void run(unsigned n) override
+    {
+        for (unsigned i = 0; i < n; ++i)
+        {
+            unsigned k = (i * 7919) % NUM_KNOWN;
+            tables_.add_node_id_to_route(&ports_[k % NUM_PORTS], node(k));
+        }
+    }
+};
+
+BENCHMARK(RoutingLearn, "Routing/Learn");
+
+/// Decides for every port whether an event report has to be forwarded
+/// there, as the routing hub does. One operation is one event report
+/// (NUM_PORTS filter checks).
+class RoutingPcer : public RoutingBase
+{
+public:
+    RoutingPcer(unsigned)
+    {
+    }
+
+    void run(unsigned n) override
+    {
+        for (unsigned i = 0; i < n; ++i)
+        {
+            EventId e = BASE_EVENT + ((i * 7919) & 0xFFFFF);
+            unsigned count = 0;
+            for (unsigned p = 0; p < NUM_PORTS; ++p)
+            {
+                count += tables_.check_pcer(&ports_[p], e);
+            }
+            do_not_optimize(count);
+        }
+    }
+};
+
+BENCHMARK(RoutingPcer, "Routing/Pcer");
+
+/// Event reports through ports with many consumer ranges, as on a large
+/// layout. The argument is the number of ranges per port. One operation is
+/// one event report (NUM_PORTS filter checks).
+class RoutingPcerRanges : public Benchmark
+{
+public:
+    RoutingPcerRanges(unsigned num_ranges)
+        : numRanges_(num_ranges)
+    {
+        for (unsigned p = 0; p < NUM_PORTS; ++p)
+        {
+            for (unsigned r = 0; r < num_ranges; ++r)
+            {
+                // Ranges of 16 events, interleaved between the ports.
+                tables_.register_consumer_range(
+                    &ports_[p], range_base(r * NUM_PORTS + p) + 0xF);
+            }
+        }
+    }
+
+    void run(unsigned n) override
+    {
+        unsigned total = numRanges_ * NUM_PORTS;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            // Half of the events fall into a range of some port.
+            unsigned k = (i * 7919) % total;
+            EventId e = range_base(k) + ((i & 1) << 7) + (i & 0xF);
+            unsigned count = 0;
+            for (unsigned p = 0; p < NUM_PORTS; ++p)
+            {
+                count += tables_.check_pcer(&ports_[p], e);
+            }
+            do_not_optimize(count);
+        }
+    }
+
+private:
+    /// @param k index of a range. @return the first event of the range.
+    static EventId range_base(unsigned k)
+    {
+        return BASE_EVENT + (EventId(k) << 8);
+    }
+
+    /// The ports.
+    Port ports_[NUM_PORTS];
+    /// The routing tables.
+    RoutingLogic<Port, NodeID> tables_;
+    /// Number of ranges per port.
+    unsigned numRanges_;
+};
+
+BENCHMARK(RoutingPcerRanges, "Routing/PcerRanges", 10, 1000);
+
+} // namespace
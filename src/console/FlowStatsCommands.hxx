@@ -0,0 +1,111 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @file FlowStatsCommands.hxx
+ * Console command printing the StateFlow run time statistics.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#ifndef _CONSOLE_FLOWSTATSCOMMANDS_HXX_
+#define _CONSOLE_FLOWSTATSCOMMANDS_HXX_
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "console/Console.hxx"
+#include "executor/FlowStats.hxx"
+
+#if OPENMRN_FEATURE_FLOW_STATS
+
+/// Container for the flow statistics commands. Instantiate with a @ref
+/// Console instance to add the "flows" command to it.
+class FlowStatsCommands
+{
+public:
+    /// Constructor.
+    /// @param console console instance to add the commands to
+    FlowStatsCommands(Console *console)
+    {
+        console->add_command("flows", flows_command);
+    }
+
+private:
+    /// Prints the executors and the flows using the most CPU time.
+    /// @param fp file pointer to console
+    /// @param argc number of arguments including the command itself
+    /// @param argv array of arguments starting with the command itself
+    /// @param context unused
+    /// @return COMMAND_OK, or COMMAND_ERROR on invalid arguments
+    static Console::CommandStatus flows_command(
+        FILE *fp, int argc, const char *argv[], void *context)
+    {
+        if (argc == 0)
+        {
+            fprintf(fp,
+                "print the flows using the most CPU time: flows [count] "
+                "[states] [reset]\n");
+            return Console::COMMAND_OK;
+        }
+
+        unsigned count = 10;
+        bool with_states = false;
+        for (int i = 1; i < argc; ++i)
+        {
+            if (!strcmp(argv[i], "states"))
+            {
+                with_states = true;
+            }
+            else if (!strcmp(argv[i], "reset"))
+            {
+                FlowStats::reset_all();
+                fprintf(fp, "flow statistics cleared\n");
+                return Console::COMMAND_OK;
+            }
+            else
+            {
+                char *end;
+                count = strtoul(argv[i], &end, 0);
+                if (end == argv[i] || *end)
+                {
+                    fprintf(fp, "%s: invalid argument %s\n", argv[0],
+                        argv[i]);
+                    return Console::COMMAND_ERROR;
+                }
+            }
+        }
+
+        FlowStats::print_top(fp, count, with_states);
+        return Console::COMMAND_OK;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(FlowStatsCommands);
+};
+
+#endif // OPENMRN_FEATURE_FLOW_STATS
+
+#endif // _CONSOLE_FLOWSTATSCOMMANDS_HXX_
@@ -35,6 +35,9 @@
 #ifndef _EXECUTOR_DISPATCHER_HXX_
 #define _EXECUTOR_DISPATCHER_HXX_
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <vector>
 
 #include "executor/Notifiable.hxx"
@@ -46,6 +49,18 @@
    invoked.
 
    Handlers are called in no particular order.
+
+   The dispatch path does not take any locks. Handler add / remove builds a
+   new immutable snapshot of the handler table, which the flow picks up when
+   it starts working on the next message. The snapshot groups the handlers by
+   mask, and the groups with many handlers (e.g. one registration per MTI)
+   have a hash index, so that finding the handlers for an incoming message
+   does not need to look at every registered handler.
+
+   By default every handler gets its own copy of the message. Handlers that
+   only read the message and do not put it into a queue can be registered as
+   shared handlers instead; these get a reference to the same buffer, saving
+   the allocation and copy.
  */
 template <int NUM_PRIO>
 class DispatchFlowBase : public UntypedStateFlow<QList<NUM_PRIO>>
@@ -83,8 +98,11 @@ protected:
        one
        @param handler is the flow to forward message to. It must stay alive so
        long as *this is alive or the handler is removed.
+       @param shared if true, the handler gets a reference to the incoming
+       buffer instead of a copy; see @ref DispatchFlow::register_shared_handler.
      */
-    void register_handler(UntypedHandler *handler, ID id, ID mask);
+    void register_handler(
+        UntypedHandler *handler, ID id, ID mask, bool shared = false);
 
     /// Removes a specific instance of a handler from this dispatcher.
     ///
@@ -110,6 +128,10 @@ protected:
      */
     virtual void send_transfer() = 0;
 
+    /** Sends a new reference of the current message to a shared handler.
+     * @param handler is the handler to call. */
+    virtual void send_shared(UntypedHandler *handler) = 0;
+
     /*typedef typename StateFlow<MessageType, QList<NUM_PRIO>>::Callback Callback;
     using StateFlow<MessageType, QList<NUM_PRIO>>::again;
     using StateFlow<MessageType, QList<NUM_PRIO>>::allocate_and_call;
@@ -148,13 +170,15 @@ private:
     /// identifier, mask, handler pointer.
     struct HandlerInfo
     {
-        HandlerInfo() : handler(nullptr)
+        HandlerInfo() : handler(nullptr), shared(false)
         {
         }
         ID id; ///< Bits that this handler is registered for.
         ID mask; ///< Mask that should be applied for the bits check.
         /// Handler to call. NULL if the handler has been removed.
         UntypedHandler *handler;
+        /// True if the handler gets a reference instead of a copy.
+        bool shared;
 
         /// Equality comparison function on the handlers. Used for remove()
         /// calls.
@@ -172,17 +196,113 @@ private:
         }
     };
 
-    /// Registered handlers.
+    /// Immutable copy of the registered handlers that the dispatch path
+    /// uses without locking. Handlers with the same mask form a group; the
+    /// entries of a group are sorted by the masked identifier.
+    struct Table
+    {
+        /// Groups with at least this many entries get a hash index.
+        static constexpr unsigned HASH_MIN_ENTRIES = 8;
+        /// Marks the end of a probe sequence in the buckets array.
+        static constexpr unsigned NO_ENTRY = 0xFFFFFFFFu;
+
+        /// One registration.
+        struct Entry
+        {
+            /// id & mask of the registration.
+            ID key;
+            /// Handler to call. Cleared if the handler gets unregistered
+            /// while the table is still in use.
+            std::atomic<UntypedHandler *> handler;
+            /// True if the handler gets a reference instead of a copy.
+            bool shared;
+        };
+
+        /// Registrations with the same mask.
+        struct Group
+        {
+            /// Mask of all entries in this group.
+            ID mask;
+            /// Index of the first entry of the group.
+            unsigned begin;
+            /// One past the last entry of the group.
+            unsigned end;
+            /// Index of the first bucket belonging to this group.
+            unsigned bucketBegin;
+            /// Number of hash buckets, a power of two; 0 if this group is
+            /// searched linearly.
+            unsigned numBuckets;
+            /// Right shift that turns a 32-bit hash into a bucket index.
+            unsigned shift;
+        };
+
+        /// Builds the table. @param handlers the current registrations.
+        Table(const vector<HandlerInfo> &handlers);
+
+        /// Computes the bucket for a key. @param g group; @param key masked
+        /// identifier. @return bucket index relative to g.bucketBegin.
+        static unsigned hash(const Group &g, ID key)
+        {
+            return (uint32_t)(key * 0x9E3779B1u) >> g.shift;
+        }
+
+        /// Finds the first entry of a group with a given key. @param g
+        /// group; @param key masked identifier. @return entry index, or
+        /// g.end if there is no such entry.
+        unsigned find(const Group &g, ID key);
+
+        /// Clears the handler pointer of a registration, so that an
+        /// iteration that is in progress on this table does not call it
+        /// anymore.
+        /// @param handler the handler being removed
+        /// @param info if non-null, clears only one entry with this id and
+        /// mask; if null, clears all entries of the handler.
+        void clear(UntypedHandler *handler, const HandlerInfo *info);
+
+        /// Registrations, ordered by group then key.
+        std::unique_ptr<Entry[]> entries;
+        /// Hash index of the groups. Holds entry indexes.
+        std::unique_ptr<unsigned[]> buckets;
+        /// Groups in ascending order of mask.
+        vector<Group> groups;
+        /// Next table in the retired list.
+        Table *nextRetired;
+    };
+
+    /// Replaces the current table with a new one built from handlers_.
+    /// Caller must hold lock_.
+    void publish_table();
+
+    /// Deletes the retired tables. Caller must hold lock_.
+    void free_retired();
+
+    /// Registered handlers. Protected by lock_.
     vector<HandlerInfo> handlers_;
 
-    /// Index of the next handler to look at.
-    size_t currentIndex_;
+    /// Table that the next iteration will use. Written under lock_.
+    std::atomic<Table *> table_;
+    /// True while the flow is using snapshot_. Writers cannot free the
+    /// current table while this is set.
+    std::atomic<bool> busy_;
+    /// Tables that were replaced while an iteration was in progress. They
+    /// get deleted once the iteration is done. Written under lock_.
+    std::atomic<Table *> retired_;
+    /// Table used by the current iteration.
+    Table *snapshot_;
+
+    /// Index of the group that we are looking at.
+    unsigned groupIndex_;
+    /// Index of the next entry to look at, or NO_INDEX if we did not yet look
+    /// up the current group.
+    unsigned currentIndex_;
+    /// Value of currentIndex_ before starting on a group.
+    static constexpr unsigned NO_INDEX = 0xFFFFFFFFu;
 
 protected:
     /// If non-NULL we still need to call this handler.
     UntypedHandler *lastHandlerToCall_;
 private:
-    /// Protects handler add / remove against iteration.
+    /// Protects handler add / remove against each other.
     OSMutex lock_;
 };
 
@@ -245,6 +365,22 @@ public:
         Base::register_handler(handler, id, mask);
     }
 
+    /**
+       Adds a new handler that gets a reference to the incoming message
+       instead of a copy. The handler must not modify the message and must
+       not add the buffer to a queue (e.g. a StateFlow's input queue), because
+       other handlers may hold the same buffer. It may keep the buffer with
+       an extra reference, and has to unref it when done.
+
+       @param id is the identifier of the message to listen to.
+       @param mask is the mask of the ID matcher.
+       @param handler is the flow to forward message to. It must stay alive so
+       long as *this is alive or the handler is removed.
+     */
+    void register_shared_handler(HandlerType *handler, ID id, ID mask) {
+        Base::register_handler(handler, id, mask, true);
+    }
+
     /// Removes a specific instance of a handler from this dispatcher.
     ///
     /// @param handler handler pointer to unregister.
@@ -299,6 +435,12 @@ protected:
         HandlerType* h = static_cast<HandlerType *>(this->lastHandlerToCall_);
         h->send(this->transfer_message());
     }
+
+    /// Sends a new reference of the current message to a shared handler.
+    /// @param handler is the handler to call.
+    void send_shared(typename Base::UntypedHandler *handler) OVERRIDE {
+        static_cast<HandlerType *>(handler)->send(this->message()->ref());
+    }
 };
 
 
@@ -308,6 +450,10 @@ template <int NUM_PRIO>
 DispatchFlowBase<NUM_PRIO>::DispatchFlowBase(Service *service)
     : UntypedStateFlow<QList<NUM_PRIO>>(service)
     , negateMatch_(false)
+    , table_(nullptr)
+    , busy_(false)
+    , retired_(nullptr)
+    , snapshot_(nullptr)
     , lastHandlerToCall_(nullptr)
 {
 }
@@ -316,40 +462,192 @@ template<int NUM_PRIO>
 DispatchFlowBase<NUM_PRIO>::~DispatchFlowBase()
 {
     HASSERT(this->is_waiting());
+    OSMutexLock h(&lock_);
+    free_retired();
+    delete table_.load();
 }
 
 template<int NUM_PRIO>
 size_t DispatchFlowBase<NUM_PRIO>::size()
 {
     OSMutexLock h(&lock_);
-    size_t ret = 0;
-    for (auto &h : handlers_)
+    return handlers_.size();
+}
+
+template<int NUM_PRIO>
+DispatchFlowBase<NUM_PRIO>::Table::Table(const vector<HandlerInfo> &handlers)
+    : entries(new Entry[handlers.size()])
+    , nextRetired(nullptr)
+{
+    vector<const HandlerInfo *> order;
+    order.reserve(handlers.size());
+    for (auto &h : handlers)
+    {
+        order.push_back(&h);
+    }
+    std::sort(order.begin(), order.end(),
+        [](const HandlerInfo *a, const HandlerInfo *b) {
+            if (a->mask != b->mask)
+            {
+                return a->mask < b->mask;
+            }
+            return (a->id & a->mask) < (b->id & b->mask);
+        });
+    unsigned total_buckets = 0;
+    for (unsigned i = 0; i < order.size(); ++i)
+    {
+        entries[i].key = order[i]->id & order[i]->mask;
+        entries[i].handler.store(order[i]->handler, std::memory_order_relaxed);
+        entries[i].shared = order[i]->shared;
+        if (groups.empty() || groups.back().mask != order[i]->mask)
+        {
+            groups.push_back({order[i]->mask, i, i, 0, 0, 0});
+        }
+        groups.back().end = i + 1;
+    }
+    for (auto &g : groups)
     {
-        if (h.handler)
+        unsigned count = g.end - g.begin;
+        if (count < HASH_MIN_ENTRIES)
+        {
+            continue;
+        }
+        // Keeps the load factor at or below 1/2.
+        unsigned bits = 1;
+        while ((1u << bits) < 2 * count)
         {
-            ++ret;
+            ++bits;
+        }
+        g.bucketBegin = total_buckets;
+        g.numBuckets = 1u << bits;
+        g.shift = 32 - bits;
+        total_buckets += g.numBuckets;
+    }
+    if (!total_buckets)
+    {
+        return;
+    }
+    buckets.reset(new unsigned[total_buckets]);
+    std::fill(buckets.get(), buckets.get() + total_buckets, (unsigned)NO_ENTRY);
+    for (auto &g : groups)
+    {
+        for (unsigned i = g.begin; g.numBuckets && i < g.end; ++i)
+        {
+            if (i > g.begin && entries[i - 1].key == entries[i].key)
+            {
+                // Only the first entry of each key goes into the index.
+                continue;
+            }
+            unsigned b = hash(g, entries[i].key);
+            while (buckets[g.bucketBegin + b] != NO_ENTRY)
+            {
+                b = (b + 1) & (g.numBuckets - 1);
+            }
+            buckets[g.bucketBegin + b] = i;
         }
     }
-    return ret;
 }
 
 template<int NUM_PRIO>
-void DispatchFlowBase<NUM_PRIO>::register_handler(UntypedHandler *handler,
-                                                  ID id, ID mask)
+unsigned DispatchFlowBase<NUM_PRIO>::Table::find(const Group &g, ID key)
 {
-    OSMutexLock h(&lock_);
-    size_t idx = 0;
-    while (idx < handlers_.size() && handlers_[idx].handler)
+    if (!g.numBuckets)
     {
-        ++idx;
+        for (unsigned i = g.begin; i < g.end && entries[i].key <= key; ++i)
+        {
+            if (entries[i].key == key)
+            {
+                return i;
+            }
+        }
+        return g.end;
     }
-    if (idx >= handlers_.size())
+    unsigned b = hash(g, key);
+    unsigned idx;
+    while ((idx = buckets[g.bucketBegin + b]) != NO_ENTRY)
     {
-        handlers_.resize(handlers_.size() + 1);
+        if (entries[idx].key == key)
+        {
+            return idx;
+        }
+        b = (b + 1) & (g.numBuckets - 1);
     }
-    handlers_[idx].handler = handler;
-    handlers_[idx].id = id;
-    handlers_[idx].mask = mask;
+    return g.end;
+}
+
+template<int NUM_PRIO>
+void DispatchFlowBase<NUM_PRIO>::Table::clear(
+    UntypedHandler *handler, const HandlerInfo *info)
+{
+    for (auto &g : groups)
+    {
+        if (info && g.mask != info->mask)
+        {
+            continue;
+        }
+        for (unsigned i = g.begin; i < g.end; ++i)
+        {
+            if (info && entries[i].key != (info->id & info->mask))
+            {
+                continue;
+            }
+            if (entries[i].handler.load(std::memory_order_relaxed) == handler)
+            {
+                entries[i].handler.store(nullptr, std::memory_order_relaxed);
+                if (info)
+                {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+template<int NUM_PRIO>
+void DispatchFlowBase<NUM_PRIO>::publish_table()
+{
+    Table *old = table_.load(std::memory_order_relaxed);
+    table_.store(handlers_.empty() ? nullptr : new Table(handlers_));
+    if (!old)
+    {
+        return;
+    }
+    // Pairs with the store to busy_ and load of table_ in entry(). If the flow
+    // is not busy, it will pick up the new table next time.
+    if (!busy_.load())
+    {
+        delete old;
+        free_retired();
+        return;
+    }
+    old->nextRetired = retired_.load(std::memory_order_relaxed);
+    retired_.store(old, std::memory_order_relaxed);
+}
+
+template<int NUM_PRIO>
+void DispatchFlowBase<NUM_PRIO>::free_retired()
+{
+    Table *t = retired_.load(std::memory_order_relaxed);
+    retired_.store(nullptr, std::memory_order_relaxed);
+    while (t)
+    {
+        Table *next = t->nextRetired;
+        delete t;
+        t = next;
+    }
+}
+
+template<int NUM_PRIO>
+void DispatchFlowBase<NUM_PRIO>::register_handler(UntypedHandler *handler,
+                                                  ID id, ID mask, bool shared)
+{
+    OSMutexLock h(&lock_);
+    handlers_.resize(handlers_.size() + 1);
+    handlers_.back().handler = handler;
+    handlers_.back().id = id;
+    handlers_.back().mask = mask;
+    handlers_.back().shared = shared;
+    publish_table();
 }
 
 template<int NUM_PRIO>
@@ -358,7 +656,6 @@ DispatchFlowBase<NUM_PRIO>::unregister_handler(UntypedHandler *handler,
                                                ID id, ID mask)
 {
     OSMutexLock h(&lock_);
-    /// @todo(balazs.racz) optimize by looking at the current index - 1.
     size_t idx = 0;
     while (idx < handlers_.size() && !handlers_[idx].Equals(id, mask, handler))
     {
@@ -370,11 +667,18 @@ DispatchFlowBase<NUM_PRIO>::unregister_handler(UntypedHandler *handler,
     if (lastHandlerToCall_ == handlers_[idx].handler) {
         lastHandlerToCall_ = nullptr;
     }
-    handlers_[idx].handler = nullptr;
-    if (idx == handlers_.size() - 1)
+    // An iteration might be using any of the live tables.
+    for (Table *t = retired_.load(std::memory_order_relaxed); t;
+         t = t->nextRetired)
     {
-        handlers_.resize(handlers_.size() - 1);
+        t->clear(handler, &handlers_[idx]);
     }
+    if (table_.load(std::memory_order_relaxed))
+    {
+        table_.load(std::memory_order_relaxed)->clear(handler, &handlers_[idx]);
+    }
+    handlers_.erase(handlers_.begin() + idx);
+    publish_table();
 }
 
 template<int NUM_PRIO>
@@ -382,23 +686,35 @@ void DispatchFlowBase<NUM_PRIO>::unregister_handler_all(
     UntypedHandler *handler)
 {
     OSMutexLock h(&lock_);
-    for (size_t i = 0; i < handlers_.size(); ++i)
+    for (Table *t = retired_.load(std::memory_order_relaxed); t;
+         t = t->nextRetired)
     {
-        if (handlers_[i].handler == handler)
-        {
-            handlers_[i].handler = nullptr;
-        }
+        t->clear(handler, nullptr);
     }
-    while (!handlers_.empty() && handlers_.back().handler == nullptr)
+    if (table_.load(std::memory_order_relaxed))
     {
-        handlers_.pop_back();
+        table_.load(std::memory_order_relaxed)->clear(handler, nullptr);
+    }
+    size_t old_size = handlers_.size();
+    handlers_.erase(std::remove_if(handlers_.begin(), handlers_.end(),
+                        [handler](const HandlerInfo &h) {
+                            return h.handler == handler;
+                        }),
+        handlers_.end());
+    if (handlers_.size() != old_size)
+    {
+        publish_table();
     }
 }
 
 template<int NUM_PRIO>
 StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::entry()
 {
-    currentIndex_ = 0;
+    // Pairs with the table_ store and busy_ load in publish_table().
+    busy_.store(true);
+    snapshot_ = table_.load();
+    groupIndex_ = 0;
+    currentIndex_ = NO_INDEX;
     lastHandlerToCall_ = nullptr;
     return call_immediately(STATE(iterate));
 }
@@ -406,49 +722,70 @@ StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::entry()
 template<int NUM_PRIO>
 StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::iterate()
 {
+    Table *t = snapshot_;
+    if (!t)
+    {
+        return iteration_done();
+    }
     ID id = get_message_id();
+    for (; groupIndex_ < t->groups.size();
+         ++groupIndex_, currentIndex_ = NO_INDEX)
     {
-        // @todo(balazs.racz) make the registered handlers structure for the
-        // dispatcher lock-free. This mutex here is very expensive.
-        OSMutexLock l(&lock_);
-        for (; currentIndex_ < handlers_.size(); ++currentIndex_)
+        auto &g = t->groups[groupIndex_];
+        ID key = id & g.mask;
+        if (currentIndex_ == NO_INDEX)
+        {
+            currentIndex_ = negateMatch_ ? g.begin : t->find(g, key);
+        }
+        for (; currentIndex_ < g.end; ++currentIndex_)
         {
-            auto &h = handlers_[currentIndex_];
-            if (!h.handler)
+            auto &e = t->entries[currentIndex_];
+            if (negateMatch_ && e.key == key)
             {
                 continue;
             }
-            if (negateMatch_ && (id & h.mask) == (h.id & h.mask))
+            if ((!negateMatch_) && e.key != key)
+            {
+                // Entries are sorted by key, this was the last match.
+                break;
+            }
+            UntypedHandler *h = e.handler.load(std::memory_order_relaxed);
+            if (!h)
             {
                 continue;
             }
-            if ((!negateMatch_) && (id & h.mask) != (h.id & h.mask))
+            if (e.shared)
             {
+                send_shared(h);
                 continue;
             }
             // At this point: we have another handler.
             if (!lastHandlerToCall_)
             {
                 // This was the first we found.
-                lastHandlerToCall_ = handlers_[currentIndex_].handler;
+                lastHandlerToCall_ = h;
                 continue;
-            }            
-            break;
+            }
+            // Now: we have at least two different handler. We need to clone
+            // the message. We use the pool of the last handler to call by
+            // default.
+            return allocate_and_clone();
         }
     }
-    if (currentIndex_ >= handlers_.size())
-    {
-        return iteration_done();
-    }
-    // Now: we have at least two different handler. We need to clone the
-    // message. We use the pool of the last handler to call by default.
-    return allocate_and_clone();
+    return iteration_done();
 }
 
 template<int NUM_PRIO>
 StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::clone_done()
 {
-    lastHandlerToCall_ = handlers_[currentIndex_].handler;
+    if (groupIndex_ >= snapshot_->groups.size())
+    {
+        // This was the copy for the last handler.
+        lastHandlerToCall_ = nullptr;
+        return iteration_done();
+    }
+    lastHandlerToCall_ = snapshot_->entries[currentIndex_].handler.load(
+        std::memory_order_relaxed);
     ++currentIndex_;
     return call_immediately(STATE(iterate));
 }
@@ -458,8 +795,21 @@ StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::iteration_done()
 {
     if (lastHandlerToCall_)
     {
+        if (this->message()->references() > 1)
+        {
+            // A shared handler still holds a reference. The last handler
+            // might modify the message, so it needs a copy.
+            return allocate_and_clone();
+        }
         send_transfer();
     }
+    snapshot_ = nullptr;
+    busy_.store(false, std::memory_order_release);
+    if (retired_.load(std::memory_order_relaxed))
+    {
+        OSMutexLock h(&lock_);
+        free_retired();
+    }
     return release_and_exit();
 }
 
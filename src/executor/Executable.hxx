@@ -36,6 +36,7 @@
 #define _EXECUTOR_EXECUTABLE_HXX_
 
 #include "executor/Notifiable.hxx"
+#include "openmrn_features.h"
 #include "utils/QMember.hxx"
 
 /// An object that can be scheduled on an executor to run.
@@ -64,6 +65,17 @@ public:
     {
         HASSERT(0 && "unexpected call to alloc_result");
     }
+
+#if OPENMRN_FEATURE_EXECUTOR_POOL
+    /// An @ref ExecutorPool never runs two executables with the same
+    /// serialization domain at the same time.
+    /// @return the serialization domain of this executable. The default is
+    /// the executable itself.
+    virtual const void *serialization_domain()
+    {
+        return this;
+    }
+#endif
 };
 
 /** A notifiable class that calls a particular function object once when it is
@@ -46,6 +46,11 @@
 #include <sys/select.h>
 #endif
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+#include <vector>
+#include <sys/epoll.h>
+#endif
+
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
 #endif
@@ -68,6 +73,130 @@ Executable::~Executable() {
 }
 
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+/// Bookkeeping of the epoll based select loop. Every fd is added to the epoll
+/// set once and stays registered; waiting for an fd again only needs the
+/// interest to be re-armed, which is batched up until the next
+/// wait_with_epoll() call. Interests are registered with EPOLLONESHOT, so an
+/// fd that became ready but nobody waits for anymore does not cause the
+/// executor to spin.
+class ExecutorBase::EpollTable
+{
+public:
+    /// What we know about a given file descriptor.
+    struct Slot
+    {
+        /// Selectables waiting on this fd, indexed by SelectType - 1.
+        Selectable *waiting_[3] = {nullptr, nullptr, nullptr};
+        /// Events the kernel currently has armed for this fd. Becomes zero
+        /// when a oneshot event is delivered.
+        uint32_t armed_ = 0;
+        /// true if the fd has been added to the epoll set.
+        bool registered_ = false;
+        /// true if the fd is on the dirty list.
+        bool dirty_ = false;
+    };
+
+    EpollTable()
+        : fd_(::epoll_create1(EPOLL_CLOEXEC))
+    {
+        HASSERT(fd_ >= 0);
+    }
+
+    ~EpollTable()
+    {
+        ::close(fd_);
+    }
+
+    /// @param fd file descriptor
+    /// @return the slot for a given fd, allocating it if needed.
+    Slot *slot(int fd)
+    {
+        if ((unsigned)fd >= slots_.size())
+        {
+            slots_.resize(fd + 1);
+        }
+        return &slots_[fd];
+    }
+
+    /// Schedules an fd to have its interest re-armed before the next wait.
+    /// @param fd file descriptor @param slot is slot(fd).
+    void mark_dirty(int fd, Slot *slot)
+    {
+        if (!slot->dirty_)
+        {
+            slot->dirty_ = true;
+            dirty_.push_back(fd);
+        }
+    }
+
+    /// Called when a selectable was removed from a slot. If nobody waits on
+    /// the fd anymore, forgets what the kernel has armed. This ensures that
+    /// if the fd gets closed and the number reused, the next select() will
+    /// register the new file.
+    /// @param slot the slot where a waiter was removed.
+    void forget_if_idle(Slot *slot)
+    {
+        if (!wanted_events(slot))
+        {
+            slot->armed_ = 0;
+        }
+    }
+
+    /// @param slot an fd slot
+    /// @return the epoll events needed for the current waiters on slot.
+    static uint32_t wanted_events(Slot *slot)
+    {
+        uint32_t ev = 0;
+        if (slot->waiting_[Selectable::READ - 1])
+        {
+            ev |= EPOLLIN;
+        }
+        if (slot->waiting_[Selectable::WRITE - 1])
+        {
+            ev |= EPOLLOUT;
+        }
+        if (slot->waiting_[Selectable::EXCEPT - 1])
+        {
+            ev |= EPOLLPRI;
+        }
+        return ev;
+    }
+
+    /// Translates delivered epoll events to the condition select() would
+    /// have reported. @param ev events from the kernel @param type
+    /// SelectType - 1. @return true if a waiter of that type is ready.
+    static bool is_ready(uint32_t ev, unsigned type)
+    {
+        static const uint32_t masks[3] = {EPOLLIN | EPOLLHUP | EPOLLERR,
+            EPOLLOUT | EPOLLHUP | EPOLLERR, EPOLLPRI};
+        return (ev & masks[type]) != 0;
+    }
+
+    /// epoll file descriptor.
+    int fd_;
+    /// Indexed by the file descriptor.
+    std::vector<Slot> slots_;
+    /// List of file descriptors whose wanted events might be different from
+    /// what the kernel has armed.
+    std::vector<int> dirty_;
+};
+
+void ExecutorBase::set_use_epoll(bool use_epoll)
+{
+    HASSERT(!started_);
+    HASSERT(!epoll_ || epoll_->slots_.empty());
+    if (use_epoll)
+    {
+        epoll_.reset(new EpollTable);
+    }
+    else
+    {
+        epoll_.reset();
+    }
+}
+#endif // OPENMRN_FEATURE_EXECUTOR_EPOLL
+
 /** Constructor.
  */
 ExecutorBase::ExecutorBase()
@@ -81,6 +210,9 @@ ExecutorBase::ExecutorBase()
     FD_ZERO(&selectWrite_);
     FD_ZERO(&selectExcept_);
     selectNFds_ = 0;
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    set_use_epoll(config_executor_use_epoll() == CONSTANT_TRUE);
+#endif
 }
 
 /** Lookup an executor by its name.
@@ -178,9 +310,7 @@ bool ExecutorBase::loop_once()
         done_ = 1;
         return false;
     }
-    current_ = msg;
-    msg->run();
-    current_ = nullptr;
+    run_executable(msg);
     return true;
 }
 
@@ -202,9 +332,7 @@ long long ICACHE_FLASH_ATTR  ExecutorBase::loop_some() {
         }
         if (msg != NULL)
         {
-            current_ = msg;
-            msg->run();
-            current_ = nullptr;
+            run_executable(msg);
         }
     }
     // Still stuff pending to run.
@@ -320,9 +448,7 @@ void *ExecutorBase::entry()
         if (msg != NULL)
         {
             ++sequence_;
-            current_ = msg;
-            msg->run();
-            current_ = nullptr;
+            run_executable(msg);
         }
     }
 
@@ -331,35 +457,96 @@ void *ExecutorBase::entry()
 
 void ExecutorBase::select(Selectable *job)
 {
-    fd_set *s = get_select_set(job->type());
+#if OPENMRN_FEATURE_EXECUTOR_POOL
+    SelectLockHolder l(this);
+#endif
     int fd = job->fd_;
-    if (FD_ISSET(fd, s))
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    if (epoll_)
     {
-        LOG(FATAL,
-            "Multiple Selectables are waiting for the same fd %d type %u", fd,
-            job->selectType_);
+        EpollTable::Slot *slot = epoll_->slot(fd);
+        Selectable **w = &slot->waiting_[job->selectType_ - 1];
+        if (*w)
+        {
+            LOG(FATAL,
+                "Multiple Selectables are waiting for the same fd %d type %u",
+                fd, job->selectType_);
+        }
+        *w = job;
+        epoll_->mark_dirty(fd, slot);
     }
-    FD_SET(fd, s);
-    if (fd >= selectNFds_)
+    else
+#endif
     {
-        selectNFds_ = fd + 1;
+        fd_set *s = get_select_set(job->type());
+        if (FD_ISSET(fd, s))
+        {
+            LOG(FATAL,
+                "Multiple Selectables are waiting for the same fd %d type %u",
+                fd, job->selectType_);
+        }
+        FD_SET(fd, s);
+        if (fd >= selectNFds_)
+        {
+            selectNFds_ = fd + 1;
+        }
+        HASSERT(!job->next);
+        // Inserts the job into the select queue.
+        selectables_.push_front(job);
     }
-    HASSERT(!job->next);
-    // Inserts the job into the select queue.
-    selectables_.push_front(job);
+#if OPENMRN_FEATURE_EXECUTOR_POOL
+    if (isPool_ && os_thread_self() != selectHelper_.main_thread())
+    {
+        // Called from a pool worker. The select loop needs to wake up to
+        // pick up the new fd.
+        selectHelper_.wakeup();
+    }
+#endif
 }
 
 bool ExecutorBase::is_selected(Selectable *job)
 {
-    fd_set *s = get_select_set(job->type());
+#if OPENMRN_FEATURE_EXECUTOR_POOL
+    SelectLockHolder l(this);
+#endif
     int fd = job->fd_;
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    if (epoll_)
+    {
+        return (unsigned)fd < epoll_->slots_.size() &&
+            epoll_->slots_[fd].waiting_[job->selectType_ - 1] != nullptr;
+    }
+#endif
+    fd_set *s = get_select_set(job->type());
     return FD_ISSET(fd, s);
 }
 
 void ExecutorBase::unselect(Selectable *job)
 {
-    fd_set *s = get_select_set(job->type());
+#if OPENMRN_FEATURE_EXECUTOR_POOL
+    SelectLockHolder l(this);
+#endif
     int fd = job->fd_;
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    if (epoll_)
+    {
+        Selectable **w = nullptr;
+        if ((unsigned)fd < epoll_->slots_.size())
+        {
+            w = &epoll_->slots_[fd].waiting_[job->selectType_ - 1];
+        }
+        if (!w || *w != job)
+        {
+            LOG(FATAL,
+                "Tried to remove a non-active selectable: fd %d type %u", fd,
+                job->selectType_);
+        }
+        *w = nullptr;
+        epoll_->forget_if_idle(&epoll_->slots_[fd]);
+        return;
+    }
+#endif
+    fd_set *s = get_select_set(job->type());
     if (!FD_ISSET(fd, s))
     {
         LOG(FATAL, "Tried to remove a non-active selectable: fd %d type %u", fd,
@@ -383,9 +570,26 @@ void ExecutorBase::unselect(Selectable *job)
 
 void ExecutorBase::wait_with_select(long long wait_length)
 {
-    fd_set fd_r(selectRead_);
-    fd_set fd_w(selectWrite_);
-    fd_set fd_x(selectExcept_);
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    if (epoll_)
+    {
+        wait_with_epoll(wait_length);
+        return;
+    }
+#endif
+    fd_set fd_r;
+    fd_set fd_w;
+    fd_set fd_x;
+    int nfds;
+    {
+#if OPENMRN_FEATURE_EXECUTOR_POOL
+        SelectLockHolder l(this);
+#endif
+        fd_r = selectRead_;
+        fd_w = selectWrite_;
+        fd_x = selectExcept_;
+        nfds = selectNFds_;
+    }
     if (!empty()) {
         wait_length = 0;
     }
@@ -394,10 +598,13 @@ void ExecutorBase::wait_with_select(long long wait_length)
     {
         wait_length = max_sleep;
     }
-    int ret = selectHelper_.select(selectNFds_, &fd_r, &fd_w, &fd_x, wait_length);
+    int ret = selectHelper_.select(nfds, &fd_r, &fd_w, &fd_x, wait_length);
     if (ret <= 0) {
         return; // nothing to do
     }
+#if OPENMRN_FEATURE_EXECUTOR_POOL
+    SelectLockHolder l(this);
+#endif
     unsigned max_fd = 0;
     for (auto it = selectables_.begin(); it != selectables_.end();) {
         fd_set* s = nullptr;
@@ -419,6 +626,107 @@ void ExecutorBase::wait_with_select(long long wait_length)
     selectNFds_ = max_fd;
 }
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+void ExecutorBase::wait_with_epoll(long long wait_length)
+{
+    /// How many events we take from the kernel in one call. If there are
+    /// more, the next call will return them.
+    static constexpr int MAX_EVENTS = 64;
+    {
+#if OPENMRN_FEATURE_EXECUTOR_POOL
+        SelectLockHolder l(this);
+#endif
+        for (int fd : epoll_->dirty_)
+        {
+            EpollTable::Slot *slot = &epoll_->slots_[fd];
+            slot->dirty_ = false;
+            uint32_t want = EpollTable::wanted_events(slot);
+            if (!want || want == slot->armed_)
+            {
+                continue;
+            }
+            struct epoll_event ev;
+            ev.events = want | EPOLLONESHOT;
+            ev.data.fd = fd;
+            int ret = ::epoll_ctl(epoll_->fd_,
+                slot->registered_ ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev);
+            if (ret < 0 && (errno == ENOENT || errno == EEXIST))
+            {
+                // The fd was closed and reopened, or dup'ed into this number.
+                ret = ::epoll_ctl(epoll_->fd_,
+                    errno == ENOENT ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev);
+            }
+            if (ret < 0)
+            {
+                // Regular files cannot be added to epoll (EPERM); select()
+                // reports them as always ready. For other errors we wake up
+                // the flows so that they see the error on their next call.
+                for (unsigned t = 0; t < 3; ++t)
+                {
+                    Selectable *job = slot->waiting_[t];
+                    if (job)
+                    {
+                        slot->waiting_[t] = nullptr;
+                        add(job->wakeup_, job->priority_);
+                    }
+                }
+                slot->armed_ = 0;
+                continue;
+            }
+            slot->registered_ = true;
+            slot->armed_ = want;
+        }
+        epoll_->dirty_.clear();
+    }
+    if (!empty()) {
+        wait_length = 0;
+    }
+    long long max_sleep = MSEC_TO_NSEC(config_executor_max_sleep_msec());
+    if (wait_length > max_sleep)
+    {
+        wait_length = max_sleep;
+    }
+    struct epoll_event events[MAX_EVENTS];
+    int ret =
+        selectHelper_.epoll_wait(epoll_->fd_, events, MAX_EVENTS, wait_length);
+    if (ret <= 0) {
+        return; // nothing to do
+    }
+#if OPENMRN_FEATURE_EXECUTOR_POOL
+    SelectLockHolder l(this);
+#endif
+    for (int i = 0; i < ret; ++i)
+    {
+        int fd = events[i].data.fd;
+        EpollTable::Slot *slot = &epoll_->slots_[fd];
+        // Oneshot: the kernel has disabled the fd.
+        slot->armed_ = 0;
+        bool more = false;
+        for (unsigned t = 0; t < 3; ++t)
+        {
+            Selectable *job = slot->waiting_[t];
+            if (!job)
+            {
+                continue;
+            }
+            if (EpollTable::is_ready(events[i].events, t))
+            {
+                slot->waiting_[t] = nullptr;
+                add(job->wakeup_, job->priority_);
+            }
+            else
+            {
+                more = true;
+            }
+        }
+        if (more)
+        {
+            epoll_->mark_dirty(fd, slot);
+        }
+    }
+}
+#endif // OPENMRN_FEATURE_EXECUTOR_EPOLL
+
 #endif
 
 #if defined(ARDUINO)
@@ -38,8 +38,11 @@
 
 #include <functional>
 #include <atomic>
+#include <memory>
 
+#include "openmrn_features.h"
 #include "executor/Executable.hxx"
+#include "executor/FlowStats.hxx"
 #include "executor/Notifiable.hxx"
 #include "executor/Selectable.hxx"
 #include "executor/Timer.hxx"
@@ -102,7 +105,8 @@ public:
      * @param job Selectable structure that describes the descriptor to watch.
      * The pointer must stay alive until it is activated, or is unselected.
      *
-     * Must be called on the executor thread.
+     * Must be called on the executor thread (or on any of the worker threads
+     * of an ExecutorPool).
      *
      * @param job is a Selectable pointer that is not currently watched.
      */
@@ -121,12 +125,30 @@ public:
      * This stops watching the given file descriptor. The job must have been
      * previously inserted into the Executor and must be not yet activated.
      *
-     * Must be called on the executor thread.
+     * Must be called on the executor thread (or on any of the worker threads
+     * of an ExecutorPool).
      *
      * @param job is a Selectable pointer that was previously inserted.
      */
     void unselect(Selectable* job);
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    /** Chooses how the executor waits for the selected file descriptors. The
+     * default comes from config_executor_use_epoll().
+     *
+     * Must be called before any Selectable is added and before the executor
+     * thread is started, e.g. on an executor created with NO_THREAD.
+     *
+     * @param use_epoll true to use epoll, false to use ::pselect. */
+    void set_use_epoll(bool use_epoll);
+
+    /// @return true if this executor waits for fds using epoll.
+    bool use_epoll()
+    {
+        return epoll_.get() != nullptr;
+    }
+#endif
+
     /** Performs one loop of the execution on the calling thread. @return true
      * if there is more scheduled work to do. Returns false if the executor
      * loop would block right now. */
@@ -166,8 +188,38 @@ public:
     /// Helper function for debugging and tracing.
     /// @return currently running executable or nullptr if none active.
     Executable* volatile current() { return current_; }
-    
+
+    /// @return the name of this executor.
+    const char *name() { return name_; }
+
+#if OPENMRN_FEATURE_FLOW_STATS
+    /// @return the run time statistics of this executor.
+    ExecutorStats *stats() { return &stats_; }
+#endif
+
 protected:
+    /// Sets the name of this executor. @param name is the new name; must stay
+    /// alive as long as the executor.
+    void set_name(const char *name)
+    {
+        name_ = name;
+    }
+
+    /// Runs one executable on the calling thread. @param msg is the
+    /// executable to run; it may be deleted by the time this returns.
+    void run_executable(Executable *msg)
+    {
+        current_ = msg;
+#if OPENMRN_FEATURE_FLOW_STATS
+        long long start = stats_.run_start();
+        msg->run();
+        stats_.run_done(start);
+#else
+        msg->run();
+#endif
+        current_ = nullptr;
+    }
+
     /** Thread entry point.
      * @return Should never return
      */
@@ -178,6 +230,12 @@ protected:
     /** Helper object for interruptible select calls. */
     OSSelectWakeup selectHelper_;
 
+#if OPENMRN_FEATURE_EXECUTOR_POOL
+    /// Set by the ExecutorPool constructor. Only then can the select
+    /// structures be touched from more than one thread.
+    bool isPool_ {false};
+#endif
+
 private:
     /** Retrieve an item from the front of the queue.
      * @param priority pass back the priority of the queue pulled from
@@ -192,6 +250,44 @@ private:
      * @param next_timer_nsec is the maximum time to sleep in nanoseconds. */
     void wait_with_select(long long next_timer_nsec);
 
+#if OPENMRN_FEATURE_EXECUTOR_POOL
+    /// Holds selectLock_ for its lifetime if the executor is an ExecutorPool;
+    /// does nothing for a single-threaded executor.
+    class SelectLockHolder
+    {
+    public:
+        /// @param e is the executor whose select structures we are using.
+        SelectLockHolder(ExecutorBase *e)
+            : lock_(e->isPool_ ? &e->selectLock_ : nullptr)
+        {
+            if (lock_)
+            {
+                lock_->lock();
+            }
+        }
+
+        ~SelectLockHolder()
+        {
+            if (lock_)
+            {
+                lock_->unlock();
+            }
+        }
+
+    private:
+        /// The lock we hold, or nullptr.
+        OSMutex *lock_;
+    };
+#endif
+
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    class EpollTable;
+
+    /// Implementation of wait_with_select() using epoll. @param wait_length
+    /// is the maximum time to sleep in nanoseconds.
+    void wait_with_epoll(long long wait_length);
+#endif
+
     /// Helper function.
     ///
     /// @param type a select type: READ, WRITE or EXCEPT
@@ -219,6 +315,11 @@ private:
     /** List of active timers. */
     ActiveTimers activeTimers_;
 
+#if OPENMRN_FEATURE_FLOW_STATS
+    /** Run time statistics. */
+    ExecutorStats stats_;
+#endif
+
     /** fd to select for read. */
     fd_set selectRead_;
     /** fd to select for write. */
@@ -229,6 +330,18 @@ private:
     int selectNFds_;
     /** Head of the linked list for the select calls. */
     TypedQueue<Selectable> selectables_;
+#if OPENMRN_FEATURE_EXECUTOR_POOL
+    /** Protects the select structures (fd_sets and selectables_). Needed
+     * because in an ExecutorPool select() and unselect() may be called from
+     * a different thread than the one sleeping in wait_with_select(). Only
+     * taken if isPool_ is set. */
+    OSMutex selectLock_;
+#endif
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    /** State of the epoll implementation. nullptr if we use ::pselect, in
+     * which case the fd_sets above are used. */
+    std::unique_ptr<EpollTable> epoll_;
+#endif
 
     /** Set to 1 when the executor thread has exited and it is safe to delete
      * *this. */
@@ -245,6 +358,10 @@ protected:
     
     /** provide access to Executor::send method. */
     friend class Service;
+#if OPENMRN_FEATURE_FLOW_STATS
+    /** Enumerates the executors for the statistics snapshot. */
+    friend class FlowStats;
+#endif
 
     DISALLOW_COPY_AND_ASSIGN(ExecutorBase);
 };
@@ -292,6 +409,7 @@ public:
     ///
     void start_thread(const char *name, int priority, size_t stack_size)
     {
+        set_name(name);
         OSThread::start(name, priority, stack_size);
     }
 
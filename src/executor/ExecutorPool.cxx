@@ -0,0 +1,330 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file ExecutorPool.cxx
+ *
+ * An executor that runs its executables on multiple worker threads.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "executor/ExecutorPool.hxx"
+
+#if OPENMRN_FEATURE_EXECUTOR_POOL
+
+namespace
+{
+/// Which pool the current thread is a worker of.
+thread_local ExecutorPoolBase *tlsPool = nullptr;
+/// Worker index of the current thread in tlsPool.
+thread_local unsigned tlsWorker = 0;
+} // namespace
+
+/// Thread running a worker loop of the pool.
+class ExecutorPoolBase::Worker : public OSThread
+{
+public:
+    /// Constructor. @param parent is the pool; @param index is the worker
+    /// index of this thread.
+    Worker(ExecutorPoolBase *parent, unsigned index)
+        : parent_(parent)
+        , index_(index)
+    {
+    }
+
+    void *entry() override
+    {
+        parent_->worker_loop(index_);
+        return nullptr;
+    }
+
+private:
+    /// Pool that owns us.
+    ExecutorPoolBase *parent_;
+    /// Our worker index.
+    unsigned index_;
+};
+
+ExecutorPoolBase::ExecutorPoolBase(unsigned num_workers)
+    : numWorkers_(num_workers)
+    , workers_(new WorkerState[num_workers])
+    , threads_(new std::unique_ptr<Worker>[num_workers])
+{
+    HASSERT(num_workers >= 1 && num_workers <= MAX_WORKERS);
+    isPool_ = true;
+}
+
+ExecutorPoolBase::~ExecutorPoolBase()
+{
+    // The derived class has to call stop_pool(); by now the queues are gone.
+    HASSERT(numRunning_ == 0);
+}
+
+void ExecutorPoolBase::start_pool(
+    const char *name, int priority, size_t stack_size)
+{
+    numRunning_ = numWorkers_ - 1;
+    for (unsigned i = 1; i < numWorkers_; ++i)
+    {
+        threads_[i].reset(new Worker(this, i));
+        threads_[i]->start(name, priority, stack_size);
+    }
+    set_name(name);
+    OSThread::start(name, priority, stack_size);
+}
+
+void ExecutorPoolBase::stop_pool()
+{
+    shutdown();
+    stopping_ = true;
+    for (unsigned i = 1; i < numWorkers_; ++i)
+    {
+        workers_[i].sem_.post();
+    }
+    for (unsigned i = 1; i < numWorkers_; ++i)
+    {
+        exitSem_.wait();
+    }
+}
+
+void *ExecutorPoolBase::entry()
+{
+    tlsPool = this;
+    tlsWorker = 0;
+    return ExecutorBase::entry();
+}
+
+int ExecutorPoolBase::current_worker()
+{
+    if (tlsPool != this)
+    {
+        return -1;
+    }
+    return tlsWorker;
+}
+
+void ExecutorPoolBase::add(Executable *action, unsigned priority)
+{
+    if (action == this)
+    {
+        // Shutdown request. Only the select thread can act on this.
+        exitPending_ = true;
+        selectHelper_.wakeup();
+        return;
+    }
+    unsigned w;
+    int cw;
+    if (action == active_timers())
+    {
+        // The timer list is serviced by the select thread; it needs to wake
+        // up to recompute the sleep length.
+        w = 0;
+    }
+    else if ((cw = current_worker()) >= 0)
+    {
+        // Work generated by a worker stays local to that worker.
+        w = cw;
+    }
+    else
+    {
+        w = nextWorker_.fetch_add(1, std::memory_order_relaxed) % numWorkers_;
+    }
+    queue_insert(w, action, priority);
+    if (w == 0)
+    {
+        selectHelper_.wakeup();
+    }
+    uint32_t idle = idleMask_.load();
+    if (!idle)
+    {
+        return;
+    }
+    if (idle & (1u << w))
+    {
+        wakeup_worker(w);
+    }
+    else
+    {
+        // The target worker is busy. Wakes up an idle one to steal the work.
+        wakeup_worker(__builtin_ctz(idle));
+    }
+}
+
+void ExecutorPoolBase::wakeup_worker(unsigned index)
+{
+    uint32_t bit = 1u << index;
+    if ((idleMask_.fetch_and(~bit) & bit) == 0)
+    {
+        // Someone else woke it up already.
+        return;
+    }
+    if (index == 0)
+    {
+        selectHelper_.wakeup();
+    }
+    else
+    {
+        workers_[index].sem_.post();
+    }
+}
+
+bool ExecutorPoolBase::empty()
+{
+    for (unsigned i = 0; i < numWorkers_; ++i)
+    {
+        if (!queue_empty(i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ExecutorPoolBase::claim(unsigned index, Executable *e)
+{
+    const void *domain = e->serialization_domain();
+    AtomicHolder h(stripe(domain));
+    for (unsigned i = 0; i < numWorkers_; ++i)
+    {
+        if (i == index)
+        {
+            continue;
+        }
+        WorkerState *ws = &workers_[i];
+        if (ws->domain_.load(std::memory_order_relaxed) == domain)
+        {
+            // Running somewhere else. That worker will run it after it
+            // finished the current round.
+            e->next = nullptr;
+            if (ws->deferredTail_)
+            {
+                ws->deferredTail_->next = e;
+            }
+            else
+            {
+                ws->deferredHead_ = e;
+            }
+            ws->deferredTail_ = e;
+            if (i == 0)
+            {
+                // The select thread might go to sleep before releasing.
+                selectHelper_.wakeup();
+            }
+            return false;
+        }
+    }
+    workers_[index].domain_.store(domain, std::memory_order_relaxed);
+    return true;
+}
+
+Executable *ExecutorPoolBase::release_and_next(unsigned index)
+{
+    WorkerState *ws = &workers_[index];
+    const void *domain = ws->domain_.load(std::memory_order_relaxed);
+    Executable *e;
+    if (domain)
+    {
+        // Note: the executable we ran might have been deleted. We only use
+        // the domain pointer here.
+        AtomicHolder h(stripe(domain));
+        if ((e = ws->deferredHead_) != nullptr)
+        {
+            ws->deferredHead_ = static_cast<Executable *>(e->next);
+            if (!ws->deferredHead_)
+            {
+                ws->deferredTail_ = nullptr;
+            }
+            e->next = nullptr;
+            ++runCount_;
+            return e;
+        }
+        ws->domain_.store(nullptr, std::memory_order_relaxed);
+    }
+    for (unsigned i = 0; i < numWorkers_; ++i)
+    {
+        // Own queue first, then steal from the peers.
+        unsigned victim = (index + i) % numWorkers_;
+        while ((e = queue_next(victim)) != nullptr)
+        {
+            if (claim(index, e))
+            {
+                ++runCount_;
+                return e;
+            }
+        }
+    }
+    return nullptr;
+}
+
+Executable *ExecutorPoolBase::next(unsigned *priority)
+{
+    *priority = 0;
+    Executable *e = release_and_next(0);
+    if (!e && exitPending_)
+    {
+        return this;
+    }
+    if (e)
+    {
+        idleMask_.fetch_and(~1u);
+    }
+    else
+    {
+        // We are about to sleep in select(). add() will wake us up.
+        idleMask_.fetch_or(1u);
+    }
+    return e;
+}
+
+void ExecutorPoolBase::worker_loop(unsigned index)
+{
+    tlsPool = this;
+    tlsWorker = index;
+    uint32_t bit = 1u << index;
+    while (!stopping_)
+    {
+        Executable *e = release_and_next(index);
+        if (e)
+        {
+            run_executable(e);
+            continue;
+        }
+        idleMask_.fetch_or(bit);
+        if (!empty() || stopping_)
+        {
+            // Raced with an add(). Extra posts on the semaphore only cause a
+            // spurious loop.
+            idleMask_.fetch_and(~bit);
+            continue;
+        }
+        workers_[index].sem_.wait();
+    }
+    --numRunning_;
+    exitSem_.post();
+}
+
+#endif // OPENMRN_FEATURE_EXECUTOR_POOL
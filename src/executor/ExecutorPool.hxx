@@ -0,0 +1,273 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file ExecutorPool.hxx
+ *
+ * An executor that runs its executables on multiple worker threads.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#ifndef _EXECUTOR_EXECUTORPOOL_HXX_
+#define _EXECUTOR_EXECUTORPOOL_HXX_
+
+#include "executor/Executor.hxx"
+
+#if OPENMRN_FEATURE_EXECUTOR_POOL
+
+#include <memory>
+
+/// Base class for an executor that spreads its executables over a number of
+/// worker threads. Every worker has its own queue; an idle worker steals work
+/// from the queues of its peers.
+///
+/// Guarantees:
+/// - two executables with the same serialization domain (see
+///   Executable::serialization_domain()) never run at the same time. The
+///   domain of a StateFlow is its Service, so all flows of a Service run one
+///   after the other as on a single-threaded Executor. Other executables are
+///   their own domain. If an executable gets scheduled while its domain is
+///   running on a different worker, it is handed over to that worker, which
+///   runs it right after the current run returns.
+/// - timers and the select() loop are serviced by worker 0, which is the
+///   thread of the ExecutorBase itself.
+///
+/// Flows of different Services do run in parallel. Flows that share state
+/// with flows of another Service without locking have to be moved into the
+/// same Service before they can run on an ExecutorPool. To get parallelism,
+/// give the independent parts of the application their own Service.
+class ExecutorPoolBase : public ExecutorBase
+{
+public:
+    /// Maximum number of worker threads supported.
+    static constexpr unsigned MAX_WORKERS = 32;
+
+    /// Destructor. Stops all worker threads.
+    ~ExecutorPoolBase();
+
+    /** Send a message to this Executor's queue.
+     * @param action Executable instance to insert into the input queue
+     * @param priority priority of execution
+     */
+    void add(Executable *action, unsigned priority = UINT_MAX) override;
+
+    /// @return true if there are no executables waiting on any of the worker
+    /// queues. There could still be executables running.
+    bool empty() override;
+
+    /// @return a number that gets incremented by one every time an executable
+    /// runs on any of the worker threads.
+    uint32_t sequence() override
+    {
+        return runCount_.load(std::memory_order_relaxed);
+    }
+
+    /// @return number of threads executing work for this pool (including the
+    /// select thread).
+    unsigned num_workers()
+    {
+        return numWorkers_;
+    }
+
+protected:
+    /// Constructor.
+    /// @param num_workers how many threads to run executables on. Must be
+    /// between 1 and MAX_WORKERS.
+    ExecutorPoolBase(unsigned num_workers);
+
+    /// Starts all threads.
+    ///
+    /// @param name thread name prefix (passed to OS)
+    /// @param priority thread priority (0 == default prio)
+    /// @param stack_size number of bytes to allocate for the thread stacks
+    void start_pool(const char *name, int priority, size_t stack_size);
+
+    /// Shuts down the select thread and the worker threads. Must be called
+    /// from the destructor of the most derived class, since the worker
+    /// threads access the queues.
+    void stop_pool();
+
+    /// Adds an executable to the queue of a given worker.
+    /// @param worker index of the worker queue
+    /// @param action what to enqueue
+    /// @param priority priority band as given to add().
+    virtual void queue_insert(
+        unsigned worker, Executable *action, unsigned priority) = 0;
+
+    /// Takes the highest priority item from a worker's queue.
+    /// @param worker index of the worker queue
+    /// @return nullptr if that queue is empty.
+    virtual Executable *queue_next(unsigned worker) = 0;
+
+    /// @param worker index of the worker queue
+    /// @return true if that queue is empty.
+    virtual bool queue_empty(unsigned worker) = 0;
+
+    /// Thread entry point for the select thread (worker 0).
+    void *entry() override;
+
+private:
+    class Worker;
+
+    /// State we keep for each thread running executables.
+    struct WorkerState
+    {
+        /// The serialization domain this worker is running now. Transitions
+        /// to and from a given domain D are done under the stripe lock of D.
+        std::atomic<const void *> domain_{nullptr};
+        /// First of the executables of domain_ that were scheduled while this
+        /// worker was running that domain. Linked through QMember::next.
+        /// Protected by the stripe lock of domain_.
+        Executable *deferredHead_{nullptr};
+        /// Last entry of the deferred list.
+        Executable *deferredTail_{nullptr};
+        /// Idle worker threads sleep on this.
+        OSSem sem_;
+    };
+
+    /// Number of locks we use for claiming executables.
+    static constexpr unsigned NUM_STRIPES = 32;
+
+    /// Called by the ExecutorBase main loop on the select thread.
+    Executable *next(unsigned *priority) override;
+
+    /// Main loop for worker threads 1..N-1.
+    /// @param index the worker index.
+    void worker_loop(unsigned index);
+
+    /// Finishes the current executable of a worker and finds the next one to
+    /// run.
+    /// @param index the worker index.
+    /// @return the claimed executable to run, or nullptr if there is no work.
+    Executable *release_and_next(unsigned index);
+
+    /// Tries to mark the domain of an executable as running on a given
+    /// worker.
+    /// @param index the worker index.
+    /// @param e executable that was taken off a queue.
+    /// @return true if the worker may run e; false if the domain of e is
+    /// running on a different worker, in which case e was handed over to
+    /// that worker.
+    bool claim(unsigned index, Executable *e);
+
+    /// Wakes up a worker if it is idle.
+    /// @param index worker to wake up.
+    void wakeup_worker(unsigned index);
+
+    /// @param domain a serialization domain
+    /// @return the lock protecting the running state of domain.
+    Atomic *stripe(const void *domain)
+    {
+        uintptr_t p = reinterpret_cast<uintptr_t>(domain);
+        return &stripes_[(p >> 4) % NUM_STRIPES];
+    }
+
+    /// @return the index of the worker the calling thread is, or -1 if the
+    /// calling thread is not a worker of this pool.
+    int current_worker();
+
+    /// Number of worker threads, including the select thread.
+    unsigned numWorkers_;
+    /// Per-worker state. Indexed by the worker index.
+    std::unique_ptr<WorkerState[]> workers_;
+    /// Threads for worker 1..N-1. Index 0 is unused.
+    std::unique_ptr<std::unique_ptr<Worker>[]> threads_;
+    /// Locks protecting the running state of executables.
+    Atomic stripes_[NUM_STRIPES];
+    /// Bit i is set if worker i is idle.
+    std::atomic<uint32_t> idleMask_{0};
+    /// Round-robin counter for distributing work from external threads.
+    std::atomic<unsigned> nextWorker_{0};
+    /// Counts executions.
+    std::atomic<uint32_t> runCount_{0};
+    /// Number of worker threads still running.
+    std::atomic<unsigned> numRunning_{0};
+    /// Posted by each worker thread when it exits.
+    OSSem exitSem_;
+    /// true when the pool is being shut down.
+    std::atomic<bool> stopping_{false};
+    /// true when shutdown() asked the select thread to exit.
+    std::atomic<bool> exitPending_{false};
+
+    DISALLOW_COPY_AND_ASSIGN(ExecutorPoolBase);
+};
+
+/// ExecutorPool with a specific number of priority bands per worker. See
+/// @ref ExecutorPoolBase for the scheduling guarantees. Usage:
+///
+/// ExecutorPool<1> g_executor("g_executor", 0, 1024, 4);
+/// Service g_service(&g_executor);
+template <unsigned NUM_PRIO> class ExecutorPool : public ExecutorPoolBase
+{
+public:
+    /** Constructor.
+     * @param name name of executor threads
+     * @param priority thread priority
+     * @param stack_size thread stack size
+     * @param num_workers how many threads to run executables on
+     */
+    ExecutorPool(
+        const char *name, int priority, size_t stack_size, unsigned num_workers)
+        : ExecutorPoolBase(num_workers)
+        , queues_(new QListProtected<NUM_PRIO>[num_workers])
+    {
+        start_pool(name, priority, stack_size);
+    }
+
+    /// Destructor. Stops all threads.
+    ~ExecutorPool()
+    {
+        stop_pool();
+    }
+
+private:
+    void queue_insert(
+        unsigned worker, Executable *action, unsigned priority) override
+    {
+        queues_[worker].insert(
+            action, priority >= NUM_PRIO ? NUM_PRIO - 1 : priority);
+    }
+
+    Executable *queue_next(unsigned worker) override
+    {
+        return static_cast<Executable *>(queues_[worker].next().item);
+    }
+
+    bool queue_empty(unsigned worker) override
+    {
+        return queues_[worker].empty();
+    }
+
+    /// Per-worker queues of executables waiting to be scheduled.
+    std::unique_ptr<QListProtected<NUM_PRIO>[]> queues_;
+
+    DISALLOW_COPY_AND_ASSIGN(ExecutorPool);
+};
+
+#endif // OPENMRN_FEATURE_EXECUTOR_POOL
+
+#endif // _EXECUTOR_EXECUTORPOOL_HXX_
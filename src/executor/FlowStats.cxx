@@ -0,0 +1,384 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file FlowStats.cxx
+ *
+ * Run time statistics of StateFlows and Executors.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "executor/FlowStats.hxx"
+
+#if OPENMRN_FEATURE_FLOW_STATS
+
+#include <algorithm>
+#include <cxxabi.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "executor/Executor.hxx"
+#include "utils/LinkedObject.hxx"
+
+constexpr unsigned FlowStats::NUM_STATES;
+thread_local FlowStats *FlowStats::running_ = nullptr;
+FlowStats *FlowStats::head_ = nullptr;
+
+namespace
+{
+
+/// Protects the list of FlowStats objects. Usable during static
+/// initialization, because flows may be created in static constructors.
+CreateOnlyAtomic g_flow_stats_lock;
+
+/// @param nsec a time difference. @return the same saturated to 32 bits.
+uint32_t clamp32(long long nsec)
+{
+    if (nsec < 0)
+    {
+        return 0;
+    }
+    if (nsec > (long long)UINT32_MAX)
+    {
+        return UINT32_MAX;
+    }
+    return nsec;
+}
+
+/// @param name is a mangled type name, or nullptr. @return the demangled
+/// name.
+string demangle(const char *name)
+{
+    if (!name)
+    {
+        return string();
+    }
+    int status = -1;
+    char *d = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    string ret(status == 0 && d ? d : name);
+    free(d);
+    return ret;
+}
+
+/// @param nsec time in nanoseconds. @return the same in microseconds.
+double usec(uint64_t nsec)
+{
+    return nsec / 1000.0;
+}
+
+/// @param nsec time in nanoseconds. @return the same in milliseconds.
+double msec(uint64_t nsec)
+{
+    return nsec / 1000000.0;
+}
+
+} // namespace
+
+long long ExecutorStats::run_start()
+{
+    long long t = FlowStats::now();
+    currentStart_.store(t, std::memory_order_relaxed);
+    return t;
+}
+
+void ExecutorStats::run_done(long long start)
+{
+    uint32_t d = clamp32(FlowStats::now() - start);
+    currentStart_.store(0, std::memory_order_relaxed);
+    runCount_.fetch_add(1, std::memory_order_relaxed);
+    busyNsec_.fetch_add(d, std::memory_order_relaxed);
+    uint32_t m = maxRunNsec_.load(std::memory_order_relaxed);
+    while (d > m &&
+        !maxRunNsec_.compare_exchange_weak(m, d, std::memory_order_relaxed))
+    {
+    }
+}
+
+FlowStats::FlowStats(Executable *owner)
+    : owner_(owner)
+    , prev_(nullptr)
+{
+    reset();
+    AtomicHolder h(list_lock());
+    next_ = head_;
+    if (next_)
+    {
+        next_->prev_ = this;
+    }
+    head_ = this;
+}
+
+FlowStats::~FlowStats()
+{
+    if (running_ == this)
+    {
+        running_ = nullptr;
+    }
+    AtomicHolder h(list_lock());
+    if (prev_)
+    {
+        prev_->next_ = next_;
+    }
+    else
+    {
+        head_ = next_;
+    }
+    if (next_)
+    {
+        next_->prev_ = prev_;
+    }
+}
+
+// static
+Atomic *FlowStats::list_lock()
+{
+    return g_flow_stats_lock.get();
+}
+
+// static
+long long FlowStats::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void FlowStats::reset()
+{
+    runCount_ = 0;
+    maxRunNsec_ = 0;
+    runNsec_ = 0;
+    wakeupCount_ = 0;
+    maxWakeupNsec_ = 0;
+    wakeupNsec_ = 0;
+    queueHighWater_ = 0;
+    numStates_ = 0;
+    memset(states_, 0, sizeof(states_));
+}
+
+void FlowStats::run_start(long long t)
+{
+    ++runCount_;
+    long long n = notifyTime_.exchange(0, std::memory_order_relaxed);
+    if (n)
+    {
+        uint32_t d = clamp32(t - n);
+        ++wakeupCount_;
+        wakeupNsec_ += d;
+        maxWakeupNsec_ = std::max(maxWakeupNsec_, d);
+    }
+}
+
+void FlowStats::state_done(const void *state, long long nsec)
+{
+    StateStats *s = nullptr;
+    for (unsigned i = 0; i < numStates_; ++i)
+    {
+        if (states_[i].state == state)
+        {
+            s = states_ + i;
+            break;
+        }
+    }
+    if (!s)
+    {
+        if (numStates_ < NUM_STATES)
+        {
+            s = states_ + numStates_++;
+            s->state = state;
+        }
+        else
+        {
+            s = states_ + NUM_STATES;
+        }
+    }
+    uint32_t d = clamp32(nsec);
+    ++s->count;
+    s->totalNsec += d;
+    s->maxNsec = std::max(s->maxNsec, d);
+}
+
+void FlowStats::run_done(long long nsec)
+{
+    uint32_t d = clamp32(nsec);
+    runNsec_ += d;
+    maxRunNsec_ = std::max(maxRunNsec_, d);
+}
+
+// static
+void FlowStats::snapshot(std::vector<FlowStatsSnapshot> *flows,
+    std::vector<ExecutorStatsSnapshot> *executors)
+{
+    if (flows)
+    {
+        flows->clear();
+        std::vector<const char *> names;
+        {
+            AtomicHolder h(list_lock());
+            for (FlowStats *s = head_; s; s = s->next_)
+            {
+                flows->emplace_back();
+                FlowStatsSnapshot &f = flows->back();
+                f.flow = s->owner_;
+                f.runCount = s->runCount_;
+                f.maxRunNsec = s->maxRunNsec_;
+                f.runNsec = s->runNsec_;
+                f.wakeupCount = s->wakeupCount_;
+                f.maxWakeupNsec = s->maxWakeupNsec_;
+                f.wakeupNsec = s->wakeupNsec_;
+                f.queueHighWater = s->queueHighWater_;
+                f.states.assign(s->states_, s->states_ + s->numStates_);
+                if (s->states_[NUM_STATES].count)
+                {
+                    f.states.push_back(s->states_[NUM_STATES]);
+                }
+                names.push_back(s->typeName_);
+            }
+        }
+        // The type names are static strings, so the demangling can be done
+        // outside of the lock.
+        for (unsigned i = 0; i < names.size(); ++i)
+        {
+            (*flows)[i].name = demangle(names[i]);
+        }
+    }
+    if (executors)
+    {
+        executors->clear();
+        long long t = now();
+        AtomicHolder h(ExecutorBase::head_mu());
+        for (ExecutorBase *e = ExecutorBase::head_; e; e = e->link_next())
+        {
+            executors->emplace_back();
+            ExecutorStatsSnapshot &s = executors->back();
+            s.name = e->name_ ? e->name_ : "";
+            s.runCount = e->stats_.runCount_.load(std::memory_order_relaxed);
+            s.maxRunNsec =
+                e->stats_.maxRunNsec_.load(std::memory_order_relaxed);
+            s.busyNsec = e->stats_.busyNsec_.load(std::memory_order_relaxed);
+            s.current = e->current_;
+            long long start =
+                e->stats_.currentStart_.load(std::memory_order_relaxed);
+            s.currentNsec = s.current && start ? t - start : 0;
+        }
+    }
+}
+
+// static
+void FlowStats::reset_all()
+{
+    {
+        AtomicHolder h(list_lock());
+        for (FlowStats *s = head_; s; s = s->next_)
+        {
+            s->reset();
+        }
+    }
+    AtomicHolder h(ExecutorBase::head_mu());
+    for (ExecutorBase *e = ExecutorBase::head_; e; e = e->link_next())
+    {
+        e->stats_.runCount_ = 0;
+        e->stats_.maxRunNsec_ = 0;
+        e->stats_.busyNsec_ = 0;
+    }
+}
+
+// static
+void FlowStats::print_top(FILE *f, unsigned count, bool with_states)
+{
+    std::vector<FlowStatsSnapshot> flows;
+    std::vector<ExecutorStatsSnapshot> executors;
+    snapshot(&flows, &executors);
+
+    fprintf(f, "%-24s %10s %10s %10s  %s\n", "executor", "runs", "busy ms",
+        "max us", "current");
+    for (const auto &e : executors)
+    {
+        fprintf(f, "%-24s %10u %10.1f %10.1f", e.name.c_str(), e.runCount,
+            msec(e.busyNsec), usec(e.maxRunNsec));
+        if (e.current)
+        {
+            const char *name = "?";
+            for (const auto &fl : flows)
+            {
+                if (fl.flow == e.current)
+                {
+                    name = fl.name.c_str();
+                    break;
+                }
+            }
+            fprintf(f, "  %p %s for %.1f ms", e.current, name,
+                msec(e.currentNsec));
+        }
+        fprintf(f, "\n");
+    }
+
+    // Drops the flows that never ran, then orders by CPU time.
+    flows.erase(std::remove_if(flows.begin(), flows.end(),
+                    [](const FlowStatsSnapshot &fl) { return !fl.runCount; }),
+        flows.end());
+    std::sort(flows.begin(), flows.end(),
+        [](const FlowStatsSnapshot &a, const FlowStatsSnapshot &b) {
+            return a.runNsec > b.runNsec;
+        });
+    if (count && flows.size() > count)
+    {
+        flows.resize(count);
+    }
+    fprintf(f, "\n%10s %10s %8s %8s %8s %8s %6s  %s\n", "total ms", "runs",
+        "avg us", "max us", "wake us", "wmax us", "queue", "flow");
+    for (const auto &fl : flows)
+    {
+        fprintf(f, "%10.3f %10u %8.1f %8.1f %8.1f %8.1f %6u  %p %s\n",
+            msec(fl.runNsec), fl.runCount, usec(fl.runNsec) / fl.runCount,
+            usec(fl.maxRunNsec),
+            fl.wakeupCount ? usec(fl.wakeupNsec) / fl.wakeupCount : 0.0,
+            usec(fl.maxWakeupNsec), fl.queueHighWater, fl.flow,
+            fl.name.c_str());
+        if (!with_states)
+        {
+            continue;
+        }
+        for (const auto &st : fl.states)
+        {
+            fprintf(f, "%10.3f %10u %8.1f %8.1f %26s", msec(st.totalNsec),
+                st.count, usec(st.totalNsec) / st.count, usec(st.maxNsec),
+                "");
+            if (st.state)
+            {
+                fprintf(f, "state %p\n", st.state);
+            }
+            else
+            {
+                fprintf(f, "other states\n");
+            }
+        }
+    }
+}
+
+#endif // OPENMRN_FEATURE_FLOW_STATS
@@ -0,0 +1,318 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file FlowStats.hxx
+ *
+ * Run time statistics of StateFlows and Executors. Compiled only when
+ * OPENMRN_FEATURE_FLOW_STATS is set.
+ *
+ * Every StateFlowBase embeds a FlowStats object that records how many times
+ * the flow ran, how long each state handler took, how long the flow waited on
+ * the executor queue after notify(), and the high-water mark of its incoming
+ * message queue. Every executor records how busy it is and what it is running
+ * right now. The statistics are updated by the thread that runs the flow
+ * without locking; snapshots taken from other threads may therefore be
+ * slightly inconsistent.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#ifndef _EXECUTOR_FLOWSTATS_HXX_
+#define _EXECUTOR_FLOWSTATS_HXX_
+
+#include "openmrn_features.h"
+
+#if OPENMRN_FEATURE_FLOW_STATS
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "utils/macros.h"
+
+class Atomic;
+class Executable;
+
+/// Timing statistics of one state handler function of a flow.
+struct StateStats
+{
+    /// Address of the state handler function. nullptr for the entry that
+    /// collects the states that did not fit into the table.
+    const void *state;
+    /// How many times the state handler was called.
+    uint32_t count;
+    /// Longest call of the state handler, in nsec.
+    uint32_t maxNsec;
+    /// Total time spent in the state handler, in nsec.
+    uint64_t totalNsec;
+};
+
+/// Copy of the statistics of one flow, see FlowStats::snapshot().
+struct FlowStatsSnapshot
+{
+    /// The flow. Use only for identification, the flow may have been deleted
+    /// since the snapshot was taken.
+    const Executable *flow;
+    /// Demangled type name of the flow. Empty if the flow never ran or the
+    /// compiler has no RTTI.
+    string name;
+    /// How many times the flow was run by the executor.
+    uint32_t runCount;
+    /// Longest run, in nsec.
+    uint32_t maxRunNsec;
+    /// Total time the flow was running, in nsec.
+    uint64_t runNsec;
+    /// How many times the flow was run after a notify().
+    uint32_t wakeupCount;
+    /// Longest time between a notify() and the flow starting to run, nsec.
+    uint32_t maxWakeupNsec;
+    /// Sum of the times between notify() and the flow starting to run, nsec.
+    uint64_t wakeupNsec;
+    /// Largest number of messages seen in the incoming queue of the flow.
+    uint32_t queueHighWater;
+    /// Statistics of the individual state handlers, in order of first call.
+    std::vector<StateStats> states;
+};
+
+/// Copy of the statistics of one executor, see FlowStats::snapshot().
+struct ExecutorStatsSnapshot
+{
+    /// Name of the executor.
+    string name;
+    /// How many executables were run.
+    uint32_t runCount;
+    /// Longest run of a single executable, in nsec.
+    uint32_t maxRunNsec;
+    /// Total time spent running executables, in nsec.
+    uint64_t busyNsec;
+    /// The executable being run right now, nullptr if the executor is idle.
+    const Executable *current;
+    /// For how long current has been running, in nsec.
+    long long currentNsec;
+};
+
+/// Statistics of one executor. Embedded in ExecutorBase. The counters are
+/// atomic because the workers of an ExecutorPool update them concurrently.
+class ExecutorStats
+{
+public:
+    ExecutorStats()
+    {
+    }
+
+    /// Records the start of running an executable. @return the current time,
+    /// to be passed to run_done().
+    long long run_start();
+
+    /// Records that an executable finished running. @param start is the
+    /// return value of run_start().
+    void run_done(long long start);
+
+private:
+    friend class FlowStats;
+
+    /// How many executables were run.
+    std::atomic<uint32_t> runCount_ {0};
+    /// Longest run of a single executable, in nsec.
+    std::atomic<uint32_t> maxRunNsec_ {0};
+    /// Total time spent running executables, in nsec.
+    std::atomic<uint64_t> busyNsec_ {0};
+    /// Time when the current executable started running, 0 if idle.
+    std::atomic<long long> currentStart_ {0};
+
+    DISALLOW_COPY_AND_ASSIGN(ExecutorStats);
+};
+
+/// Statistics of one flow. Embedded in StateFlowBase; all live instances are
+/// kept on a global list so that they can be enumerated with snapshot().
+class FlowStats
+{
+public:
+    /// How many different state handlers are tracked per flow. Calls to
+    /// further states are accounted in one overflow entry.
+    static constexpr unsigned NUM_STATES = 8;
+
+    /// Constructor. @param owner is the flow whose statistics we collect.
+    FlowStats(Executable *owner);
+
+    ~FlowStats();
+
+    /// @return the current time in nsec. Cheaper than
+    /// os_get_time_monotonic(), which takes a global lock.
+    static long long now();
+
+    /// Called from notify(). Remembers the time of the first notification
+    /// since the flow last started to run.
+    void notified()
+    {
+        if (!notifyTime_.load(std::memory_order_relaxed))
+        {
+            long long expected = 0;
+            notifyTime_.compare_exchange_strong(
+                expected, now(), std::memory_order_relaxed);
+        }
+    }
+
+    /// Called when a message is added to the incoming queue of the flow.
+    /// @param size is the number of messages in the queue.
+    void queue_size(unsigned size)
+    {
+        if (size > queueHighWater_)
+        {
+            queueHighWater_ = size;
+        }
+    }
+
+    /// Called when the executor starts running the flow. @param t is the
+    /// current time.
+    void run_start(long long t);
+
+    /// @return true if set_type_name() was called.
+    bool has_type_name() const
+    {
+        return typeName_ != nullptr;
+    }
+
+    /// @param name is the mangled name of the dynamic type of the flow, as
+    /// returned by typeid().name().
+    void set_type_name(const char *name)
+    {
+        typeName_ = name;
+    }
+
+    /// Called after a state handler returned.
+    /// @param state identifies the state handler function.
+    /// @param nsec is how long the state handler took.
+    void state_done(const void *state, long long nsec);
+
+    /// Called when the flow yields the CPU. @param nsec is how long the flow
+    /// was running.
+    void run_done(long long nsec);
+
+    /// Marks this flow as the one running on the current thread.
+    /// @return the previously running flow, to be given to set_running() at
+    /// the end of the run.
+    FlowStats *start_running()
+    {
+        FlowStats *prev = running_;
+        running_ = this;
+        return prev;
+    }
+
+    /// @return true if this flow was not deleted since start_running().
+    bool still_running()
+    {
+        return running_ == this;
+    }
+
+    /// Sets the flow running on the current thread. @param s is the return
+    /// value of start_running().
+    static void set_running(FlowStats *s)
+    {
+        running_ = s;
+    }
+
+    /// @return the number of times the flow was run.
+    uint32_t run_count() const
+    {
+        return runCount_;
+    }
+
+    /// @return the largest incoming queue size seen.
+    uint32_t queue_high_water() const
+    {
+        return queueHighWater_;
+    }
+
+    /// Copies the statistics of all live flows and executors.
+    /// @param flows will be filled with the flow statistics (may be nullptr).
+    /// @param executors will be filled with the executor statistics (may be
+    /// nullptr).
+    static void snapshot(std::vector<FlowStatsSnapshot> *flows,
+        std::vector<ExecutorStatsSnapshot> *executors = nullptr);
+
+    /// Clears the statistics of all flows and executors.
+    static void reset_all();
+
+    /// Prints the flows with the most CPU time, and the executors.
+    /// @param f is the output stream.
+    /// @param count is the maximum number of flows to print.
+    /// @param with_states if true, prints the statistics of each state
+    /// handler of the printed flows.
+    static void print_top(FILE *f, unsigned count, bool with_states);
+
+private:
+    /// Clears the counters of this flow. Called with the list lock held.
+    void reset();
+
+    /// @return the lock protecting the list of live instances.
+    static Atomic *list_lock();
+
+    /// Head of the list of live instances.
+    static FlowStats *head_;
+
+    /// Flow that is running on the current thread; cleared by the destructor
+    /// so that StateFlowBase::run() can tell when the flow deleted itself.
+    static thread_local FlowStats *running_;
+
+    /// The flow whose statistics we collect.
+    Executable *owner_;
+    /// Linked list of all live instances.
+    FlowStats *prev_;
+    /// Linked list of all live instances.
+    FlowStats *next_;
+    /// Mangled name of the dynamic type of the owner.
+    const char *typeName_ {nullptr};
+    /// Time of the first notify() since the last run, 0 if none.
+    std::atomic<long long> notifyTime_ {0};
+    /// How many times the flow was run.
+    uint32_t runCount_ {0};
+    /// Longest run, in nsec.
+    uint32_t maxRunNsec_ {0};
+    /// Total time the flow was running, in nsec.
+    uint64_t runNsec_ {0};
+    /// How many times the flow was run after a notify().
+    uint32_t wakeupCount_ {0};
+    /// Longest time between a notify() and the run, nsec.
+    uint32_t maxWakeupNsec_ {0};
+    /// Sum of the times between notify() and the run, nsec.
+    uint64_t wakeupNsec_ {0};
+    /// Largest number of messages seen in the incoming queue.
+    uint32_t queueHighWater_ {0};
+    /// How many entries of states_ are in use.
+    uint8_t numStates_ {0};
+    /// Per-state statistics. The last entry is the overflow entry.
+    StateStats states_[NUM_STATES + 1];
+
+    DISALLOW_COPY_AND_ASSIGN(FlowStats);
+};
+
+#endif // OPENMRN_FEATURE_FLOW_STATS
+
+#endif // _EXECUTOR_FLOWSTATS_HXX_
@@ -33,6 +33,8 @@
  */
 
 #include <climits>
+#include <string.h>
+#include <typeinfo>
 
 #include "executor/StateFlow.hxx"
 
@@ -53,6 +55,68 @@ StateFlowWithQueue::~StateFlowWithQueue()
 }
 
 
+#if OPENMRN_FEATURE_FLOW_STATS
+
+const void *StateFlowBase::state_address(Callback c)
+{
+#if defined(__GNUC__) && !defined(__clang__)
+    // GCC extension: resolves the (possibly virtual) member function pointer
+    // to the address of the function that would be called.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpmf-conversions"
+    return (const void *)(this->*c);
+#pragma GCC diagnostic pop
+#else
+    // The first word of the member function pointer. Unique per non-virtual
+    // function; virtual functions are identified by their vtable slot.
+    const void *ret;
+    memcpy(&ret, &c, sizeof(ret));
+    return ret;
+#endif
+}
+
+/** Executes the current state (until we get a wait or yield return), and
+ * records the statistics of the run.
+ */
+void StateFlowBase::run()
+{
+    HASSERT(state_);
+    FlowStats *prev = stats_.start_running();
+    long long start = FlowStats::now();
+    long long last = start;
+    stats_.run_start(start);
+#if defined(__GXX_RTTI)
+    if (!stats_.has_type_name())
+    {
+        stats_.set_type_name(typeid(*this).name());
+    }
+#endif
+    do
+    {
+        const void *state = state_address(state_);
+        Action action = (this->*state_)();
+        long long now = FlowStats::now();
+        // The state handler may have deleted *this; the FlowStats destructor
+        // resets the running flow in that case.
+        if (!stats_.still_running())
+        {
+            FlowStats::set_running(prev);
+            return;
+        }
+        stats_.state_done(state, now - last);
+        last = now;
+        if (!action.next_state())
+        {
+            stats_.run_done(now - start);
+            FlowStats::set_running(prev);
+            return;
+        }
+        state_ = action.next_state();
+    } while (1);
+}
+
+#else
+
 /** Executes the current state (until we get a wait or yield return).
  */
 void StateFlowBase::run()
@@ -71,6 +135,8 @@ void StateFlowBase::run()
     } while (1);
 }
 
+#endif // OPENMRN_FEATURE_FLOW_STATS
+
 StateFlowBase::Action StateFlowWithQueue::wait_for_message()
 {
     AtomicHolder h(this);
@@ -94,8 +160,22 @@ StateFlowBase::Action StateFlowWithQueue::wait_for_message()
     }
 }
 
+BufferBase *StateFlowWithQueue::dequeue_message(unsigned *priority)
+{
+    AtomicHolder h(this);
+    BufferBase *m = static_cast<BufferBase *>(queue_next(priority));
+    if (m)
+    {
+        queueSize_--;
+    }
+    return m;
+}
+
 void StateFlowBase::notify()
 {
+#if OPENMRN_FEATURE_FLOW_STATS
+    stats_.notified();
+#endif
     service()->executor()->add(this);
 }
 
@@ -108,6 +188,9 @@ void StateFlowBase::notify_from_isr()
 
 void StateFlowWithQueue::notify()
 {
+#if OPENMRN_FEATURE_FLOW_STATS
+    flow_stats()->notified();
+#endif
     service()->executor()->add(this, currentPriority_);
 }
 
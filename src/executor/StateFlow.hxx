@@ -40,6 +40,7 @@
 #include <functional>
 #include <sys/stat.h>
 
+#include "executor/FlowStats.hxx"
 #include "executor/Service.hxx"
 #include "executor/Timer.hxx"
 #include "utils/Buffer.hxx"
@@ -193,6 +194,24 @@ public:
         return service_;
     }
 
+#if OPENMRN_FEATURE_EXECUTOR_POOL
+    /// All flows of a Service are serialized with each other on an
+    /// ExecutorPool, because they may share the state of the Service.
+    /// @return the service.
+    const void *serialization_domain() override
+    {
+        return service_;
+    }
+#endif
+
+#if OPENMRN_FEATURE_FLOW_STATS
+    /// @return the run time statistics of this flow.
+    FlowStats *flow_stats()
+    {
+        return &stats_;
+    }
+#endif
+
 protected:
     /** Constructor.
      * @param service Service that this state flow is part of
@@ -201,6 +220,9 @@ protected:
         : service_(service)
         , state_(STATE(terminated))
         , allocationResult_(nullptr)
+#if OPENMRN_FEATURE_FLOW_STATS
+        , stats_(this)
+#endif
     {
     }
 
@@ -947,6 +969,15 @@ private:
     /** The result of the next allocation that comes in. */
     QMember *allocationResult_;
 
+#if OPENMRN_FEATURE_FLOW_STATS
+    /** Run time statistics. */
+    FlowStats stats_;
+
+    /** @return an identifier of a state handler function, for the per-state
+     * statistics. @param c is the state handler. */
+    const void *state_address(Callback c);
+#endif
+
     /** Default constructor.
      */
     StateFlowBase();
@@ -1041,6 +1072,14 @@ protected:
         return m;
     }
 
+    /** Removes the next message from the incoming queue without making it
+     * the current message. Allows a flow to process several queued messages
+     * in one go.
+     * @param priority will be set to the priority of the message.
+     * @return the message, or nullptr if the queue is empty. Ownership is
+     * transferred to the caller. */
+    BufferBase *dequeue_message(unsigned *priority);
+
     /** Sets the current message being processed.
      * @param message is the buffer of the new message. This request transfers
      * one reference of ownership.
@@ -1238,6 +1277,9 @@ protected:
         AtomicHolder h(this);
         queue_.insert_locked(msg, priority);
         queueSize_ = queue_.size();
+#if OPENMRN_FEATURE_FLOW_STATS
+        flow_stats()->queue_size(queueSize_);
+#endif
         if (isWaiting_)
         {
             isWaiting_ = 0;
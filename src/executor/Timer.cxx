@@ -33,6 +33,10 @@
  */
 
 #include "executor/Timer.hxx"
+
+#include <algorithm>
+#include <string.h>
+
 #include "executor/Executor.hxx"
 #include "os/os.h"
 
@@ -81,6 +85,275 @@ void ActiveTimers::run()
     // call.
 }
 
+#if OPENMRN_FEATURE_TIMER_WHEEL
+
+ActiveTimers::ActiveTimers(ExecutorBase *executor)
+    : executor_(executor)
+    , currentTick_(to_tick(OSTime::get_monotonic()))
+    , numTimers_(0)
+    , cacheSlot_(-1)
+    , cacheMin_(0)
+    , isPending_(0)
+{
+    memset(slots_, 0, sizeof(slots_));
+    memset(occupied_, 0, sizeof(occupied_));
+}
+
+long long ActiveTimers::get_next_timeout()
+{
+    OSMutexLock l(&lock_);
+    long long now = OSTime::get_monotonic();
+    if (advance_locked(now))
+    {
+        return 0;
+    }
+    if (occupied_[0])
+    {
+        // Slots of level 0 before the current tick are all empty.
+        return slots_[__builtin_ctzll(occupied_[0])].head_->when_ - now;
+    }
+    uint64_t tick;
+    int slot = next_cascade_locked(&tick);
+    if (slot >= 0)
+    {
+        // This slot has the earliest timers of all, but it is not sorted.
+        if (slot != cacheSlot_)
+        {
+            cacheMin_ = INT64_MAX;
+            for (Timer *t = slots_[slot].head_; t;
+                 t = static_cast<Timer *>(t->next))
+            {
+                cacheMin_ = std::min(cacheMin_, t->when_);
+            }
+            cacheSlot_ = slot;
+        }
+        return cacheMin_ - now;
+    }
+    // Wakes up the timer service every now and then. It won't make any
+    // difference.
+    return SEC_TO_NSEC(3600);
+}
+
+bool ActiveTimers::empty()
+{
+    OSMutexLock l(&lock_);
+    return numTimers_ == 0;
+}
+
+int ActiveTimers::next_cascade_locked(uint64_t *tick)
+{
+    for (unsigned level = 1; level < LEVELS; ++level)
+    {
+        unsigned shift = level * LEVEL_BITS;
+        unsigned current = (currentTick_ >> shift) & (SLOTS - 1);
+        // Slots at or before the current one are empty on the upper levels.
+        uint64_t later = occupied_[level] & ~((2ULL << current) - 1);
+        if (later)
+        {
+            unsigned idx = __builtin_ctzll(later);
+            *tick = ((currentTick_ >> (shift + LEVEL_BITS))
+                        << (shift + LEVEL_BITS)) |
+                ((uint64_t)idx << shift);
+            return level * SLOTS + idx;
+        }
+    }
+    if (slots_[OVERFLOW_SLOT].head_)
+    {
+        unsigned shift = LEVELS * LEVEL_BITS;
+        *tick = ((currentTick_ >> shift) + 1) << shift;
+        return OVERFLOW_SLOT;
+    }
+    return -1;
+}
+
+bool ActiveTimers::advance_locked(long long now)
+{
+    uint64_t target = std::max(to_tick(now), currentTick_);
+    bool found_timer = false;
+    while (true)
+    {
+        // Expires level 0 up to the target tick.
+        bool same_block = ((target ^ currentTick_) >> LEVEL_BITS) == 0;
+        unsigned last = same_block ? (target & (SLOTS - 1)) : SLOTS - 1;
+        uint64_t bits = occupied_[0];
+        if (last < SLOTS - 1)
+        {
+            bits &= (2ULL << last) - 1;
+        }
+        while (bits)
+        {
+            unsigned idx = __builtin_ctzll(bits);
+            bits &= bits - 1;
+            Slot *slot = &slots_[idx];
+            ::Timer *t;
+            while ((t = slot->head_) != nullptr && t->when_ <= now)
+            {
+                found_timer = true;
+                remove_locked(t);
+                t->isActive_ = 0;
+                t->isExpired_ = 1;
+                // Puts it on the executor.
+                executor_->add(t, t->priority_);
+            }
+        }
+        if (same_block)
+        {
+            currentTick_ = target;
+            return found_timer;
+        }
+        // Level 0 is empty now. Jumps to the next block that has timers.
+        uint64_t tick;
+        int cascade = next_cascade_locked(&tick);
+        if (cascade < 0 || tick > target)
+        {
+            currentTick_ = target;
+            return found_timer;
+        }
+        currentTick_ = tick;
+        // All timers in this slot are in the current block of that level, so
+        // they go to lower levels now.
+        Slot *slot = &slots_[cascade];
+        if (cascade == cacheSlot_)
+        {
+            cacheSlot_ = -1;
+        }
+        ::Timer *t = slot->head_;
+        slot->head_ = slot->tail_ = nullptr;
+        if (cascade < (int)OVERFLOW_SLOT)
+        {
+            occupied_[cascade / SLOTS] &= ~(1ULL << (cascade % SLOTS));
+        }
+        while (t)
+        {
+            ::Timer *next = static_cast<::Timer *>(t->next);
+            t->next = nullptr;
+            --numTimers_;
+            insert_locked(t);
+            t = next;
+        }
+    }
+}
+
+void ActiveTimers::schedule_timer(Timer *timer)
+{
+    OSMutexLock l(&lock_);
+    insert_locked(timer);
+    // This will wake up the executor, which will schedule all expired timers
+    // and recompute sleep length.
+    notify();
+}
+
+void ActiveTimers::insert_locked(Timer *timer)
+{
+    HASSERT(timer);
+    HASSERT(timer->next == nullptr);
+
+    uint64_t tick = std::max(to_tick(timer->when_), currentTick_);
+    unsigned idx = OVERFLOW_SLOT;
+    for (unsigned level = 0; level < LEVELS; ++level)
+    {
+        unsigned shift = level * LEVEL_BITS;
+        if (((tick ^ currentTick_) >> (shift + LEVEL_BITS)) == 0)
+        {
+            unsigned i = (tick >> shift) & (SLOTS - 1);
+            occupied_[level] |= 1ULL << i;
+            idx = level * SLOTS + i;
+            break;
+        }
+    }
+    timer->slot_ = idx;
+    Slot *slot = &slots_[idx];
+    Timer *prev = slot->tail_;
+    if (idx < SLOTS)
+    {
+        // Level 0 is kept sorted. Finds the insertion point from the
+        // back. Timers usually get started with increasing deadlines, and a
+        // slot of level 0 is only one tick long, so this is typically O(1).
+        while (prev && prev->when_ > timer->when_)
+        {
+            prev = prev->prev_;
+        }
+    }
+    else if ((int)idx == cacheSlot_ && timer->when_ < cacheMin_)
+    {
+        cacheMin_ = timer->when_;
+    }
+    Timer *next = prev ? static_cast<Timer *>(prev->next) : slot->head_;
+    timer->prev_ = prev;
+    timer->next = next;
+    if (prev)
+    {
+        prev->next = timer;
+    }
+    else
+    {
+        slot->head_ = timer;
+    }
+    if (next)
+    {
+        next->prev_ = timer;
+    }
+    else
+    {
+        slot->tail_ = timer;
+    }
+    ++numTimers_;
+}
+
+void ActiveTimers::remove_locked(Timer *timer)
+{
+    HASSERT(timer);
+    unsigned idx = timer->slot_;
+    Slot *slot = &slots_[idx];
+    if ((int)idx == cacheSlot_)
+    {
+        // We might be removing the earliest one.
+        cacheSlot_ = -1;
+    }
+    Timer *next = static_cast<Timer *>(timer->next);
+    if (timer->prev_)
+    {
+        timer->prev_->next = next;
+    }
+    else
+    {
+        HASSERT(slot->head_ == timer);
+        slot->head_ = next;
+    }
+    if (next)
+    {
+        next->prev_ = timer->prev_;
+    }
+    else
+    {
+        slot->tail_ = timer->prev_;
+    }
+    if (!slot->head_ && idx < OVERFLOW_SLOT)
+    {
+        occupied_[idx / SLOTS] &= ~(1ULL << (idx % SLOTS));
+    }
+    timer->next = nullptr;
+    timer->prev_ = nullptr;
+    --numTimers_;
+}
+
+void ActiveTimers::update_timer(Timer *timer)
+{
+    HASSERT(timer);
+    OSMutexLock l(&lock_);
+    remove_locked(timer);
+    insert_locked(timer);
+    notify();
+}
+
+#else // not timer wheel
+
+ActiveTimers::ActiveTimers(ExecutorBase *executor)
+    : executor_(executor)
+    , isPending_(0)
+{
+}
+
 long long ActiveTimers::get_next_timeout()
 {
     OSMutexLock l(&lock_);
@@ -133,6 +406,9 @@ void ActiveTimers::schedule_timer(Timer *timer)
 {
     OSMutexLock l(&lock_);
     insert_locked(timer);
+    // This will wake up the executor, which will schedule all expired timers
+    // and recompute sleep length.
+    notify();
 }
 
 void ActiveTimers::insert_locked(Timer *timer)
@@ -150,10 +426,6 @@ void ActiveTimers::insert_locked(Timer *timer)
     // Inserts into the queue.
     timer->next = current_timer;
     *last = timer;
-
-    // This will wake up the executor, which will schedule all expired timers
-    // and recompute sleep length.
-    notify();
 }
 
 void ActiveTimers::remove_locked(Timer *timer)
@@ -176,8 +448,11 @@ void ActiveTimers::update_timer(Timer *timer)
     OSMutexLock l(&lock_);
     remove_locked(timer);
     insert_locked(timer);
+    notify();
 }
 
+#endif // OPENMRN_FEATURE_TIMER_WHEEL
+
 void ActiveTimers::remove_timer(Timer *timer)
 {
     HASSERT(timer);
@@ -35,6 +35,7 @@
 #ifndef _EXECUTOR_TIMER_HXX_
 #define _EXECUTOR_TIMER_HXX_
 
+#include "openmrn_features.h"
 #include "executor/Notifiable.hxx"
 #include "utils/Buffer.hxx"
 #include "utils/QMember.hxx"
@@ -44,18 +45,29 @@ class Timer;
 class ExecutorBase;
 
 /** Class that manages the list of active timers. The Executor uses this class
- * tightly in its sleep-execute loop. */
+ * tightly in its sleep-execute loop.
+ *
+ * When OPENMRN_FEATURE_TIMER_WHEEL is set, the timers are kept in a
+ * hierarchical timer wheel: level L has 64 slots, each covering 64^L ticks of
+ * ~1 msec. Level 0 holds the timers expiring in the same 64-tick block as the
+ * current time, level L the timers in the same 64^(L+1)-tick block. When the
+ * current time moves to a new block, the matching slot of the next level is
+ * redistributed to the lower levels. Every slot is a doubly linked list, so
+ * insertion and removal are O(1). The slots of level 0 are sorted by
+ * expiration time, which keeps the firing order exact; there the insertion
+ * point is searched from the back, which is O(1) in the common case of
+ * timers being started with increasing deadlines. When level 0 is empty, the
+ * next expiration time is computed from the slot to be redistributed next
+ * and cached until that slot changes.
+ *
+ * Without the feature, timers are in a single sorted list. */
 class ActiveTimers : public Executable
 {
 public:
     /// Constructor.
     ///
     /// @param executor parent that will use this instance.
-    ActiveTimers(ExecutorBase *executor)
-        : executor_(executor)
-        , isPending_(0)
-    {
-    }
+    ActiveTimers(ExecutorBase *executor);
 
     ~ActiveTimers();
 
@@ -75,17 +87,18 @@ public:
      * scheduled. */
     void schedule_timer(::Timer *timer);
 
-    /** Updates the expiration time of an already scheduled timer. This call is
-     * somewhat expensive, because it needs to walk the entire queue of active
-     * timers. May wake up the executor.
+    /** Updates the expiration time of an already scheduled timer. Without the
+     * timer wheel this call is somewhat expensive, because it needs to walk
+     * the entire queue of active timers. May wake up the executor.
      *
      * @param timer is the timer whose next execution time has been updated. It
      * must already be scheduled. */
     void update_timer(::Timer *timer);
 
-    /** Deletes an already scheduled but not yet expired timer. This call is
-     * somewhat expensive, because it needs to walk the entire queue of active
-     * timers. Asserts that the timer is in fact not yet expired.
+    /** Deletes an already scheduled but not yet expired timer. Without the
+     * timer wheel this call is somewhat expensive, because it needs to walk
+     * the entire queue of active timers. Asserts that the timer is in fact not
+     * yet expired.
      *
      * @param timer is the timer to delete. */
     void remove_timer(::Timer *timer);
@@ -113,12 +126,71 @@ private:
      * @param timer what to insert into the active list. */
     void insert_locked(::Timer *timer);
 
+#if OPENMRN_FEATURE_TIMER_WHEEL
+    /// log2 of the length of a wheel tick in nanoseconds (~1 msec).
+    static constexpr unsigned TICK_SHIFT = 20;
+    /// log2 of the number of slots per level.
+    static constexpr unsigned LEVEL_BITS = 6;
+    /// Number of slots per level.
+    static constexpr unsigned SLOTS = 1 << LEVEL_BITS;
+    /// Number of levels in the wheel. Covers 2^56 nsec, about 2 years.
+    static constexpr unsigned LEVELS = 6;
+    /// Index of the slot holding timers that are too far in the future for
+    /// the wheel.
+    static constexpr unsigned OVERFLOW_SLOT = LEVELS * SLOTS;
+
+    /// A list of timers.
+    struct Slot
+    {
+        /// Earliest timer.
+        ::Timer *head_;
+        /// Latest timer.
+        ::Timer *tail_;
+    };
+
+    /// @param when_nsec a timestamp @return the wheel tick of the timestamp.
+    static uint64_t to_tick(long long when_nsec)
+    {
+        return when_nsec < 0 ? 0 : (uint64_t)when_nsec >> TICK_SHIFT;
+    }
+
+    /// Finds the next block boundary where a slot of the upper levels has to
+    /// be redistributed. Caller must hold the lock.
+    /// @param tick will be set to the tick of the boundary.
+    /// @return the slot index to redistribute, or -1 if there is no timer in
+    /// the upper levels.
+    int next_cascade_locked(uint64_t *tick);
+
+    /// Moves the current time forward, scheduling every timer that expired on
+    /// the executor. Caller must hold the lock.
+    /// @param now current time in nanoseconds.
+    /// @return true if at least one timer expired.
+    bool advance_locked(long long now);
+#endif
+
     /// Parent.
     ExecutorBase *executor_;
     /// Protects the timer list.
     OSMutex lock_;
+#if OPENMRN_FEATURE_TIMER_WHEEL
+    /// Slots of the wheel. Indexed by level * SLOTS + slot.
+    Slot slots_[LEVELS * SLOTS + 1];
+    /// Bit i in occupied_[L] is set when slot i of level L is not empty.
+    uint64_t occupied_[LEVELS];
+    /// The wheel tick we last advanced to. Every timer in the wheel expires
+    /// at this tick or later.
+    uint64_t currentTick_;
+    /// Number of timers in the wheel.
+    unsigned numTimers_;
+    /// Index of the upper level slot whose earliest deadline is in
+    /// cacheMin_, or -1.
+    int cacheSlot_;
+    /// Earliest deadline in the slot cacheSlot_.
+    long long cacheMin_;
+#else
     /// List of timers that are scheduled.
     QMember activeTimers_;
+#endif
     /// 1 if we in the executor's queue.
     std::atomic_uint_least8_t isPending_;
 
@@ -303,6 +375,12 @@ private:
     unsigned isCancelled_ : 1;
     /** For children: 1 if a repeated timer should stop sending wakeups. */
     unsigned tcRequestStop_ : 1;
+#if OPENMRN_FEATURE_TIMER_WHEEL
+    /** Previous timer in the wheel slot's list. */
+    Timer *prev_;
+    /** Which wheel slot this timer is in, when isActive_. */
+    unsigned short slot_;
+#endif
 
     DISALLOW_COPY_AND_ASSIGN(Timer);
 };
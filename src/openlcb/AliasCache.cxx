@@ -33,8 +33,6 @@
 
 #include "openlcb/AliasCache.hxx"
 
-#include "os/OS.hxx"
-
 namespace openlcb
 {
 
@@ -42,19 +40,47 @@ namespace openlcb
 
 const NodeID AliasCache::RESERVED_ALIAS_NODE_ID = 1;
 
+AliasCache::AliasCache(NodeID seed, size_t _entries,
+                       void (*remove_callback)(NodeID id, NodeAlias alias,
+                                               void *),
+                       void *context)
+    : pool(new Metadata[_entries]),
+      seed(seed),
+      entries(_entries),
+      removeCallback(remove_callback),
+      context(context)
+{
+    HASSERT(_entries < NONE);
+    /* the indexes are at most half full */
+    unsigned bits = 1;
+    while ((1u << bits) < 2 * _entries)
+    {
+        ++bits;
+    }
+    indexMask = (1u << bits) - 1;
+    indexShift = 32 - bits;
+    aliasIndex = new uint16_t[indexMask + 1];
+    idIndex = new uint16_t[indexMask + 1];
+    clear();
+}
+
 void AliasCache::clear()
 {
-    idMap.clear();
-    aliasMap.clear();
-    oldest = nullptr;
-    newest = nullptr;
-    freeList = nullptr;
+    for (unsigned i = 0; i <= indexMask; ++i)
+    {
+        aliasIndex[i] = NONE;
+        idIndex[i] = NONE;
+    }
+    freeList = NONE;
+    clockHand = 0;
     /* initialize the freeList */
-    for (size_t i = 0; i < entries; ++i)
+    for (size_t i = entries; i > 0; --i)
     {
-        pool[i].prev = NULL;
-        pool[i].next = freeList;
-        freeList = pool + i;
+        pool[i - 1].id = 0;
+        pool[i - 1].alias = 0;
+        pool[i - 1].referenced = false;
+        pool[i - 1].next = freeList;
+        freeList = i - 1;
     }
 }
 
@@ -67,80 +93,71 @@ void AliasCache::add(NodeID id, NodeAlias alias)
     HASSERT(id != 0);
     HASSERT(alias != 0);
     
-    Metadata *insert;
-
-    AliasMap::Iterator it = aliasMap.find(alias);
-    if (it != aliasMap.end())
+    unsigned insert = aliasIndex[find(aliasIndex, &Metadata::alias, alias)];
+    if (insert != NONE)
     {
         /* we already have a mapping for this alias, so lets remove it */
-        insert = (*it).second;
-        remove(alias);
+        NodeID old_id = pool[insert].id;
+        release(insert);
         
         if (removeCallback)
         {
             /* tell the interface layer that we removed this mapping */
-            (*removeCallback)(insert->id, insert->alias, context);
+            (*removeCallback)(old_id, alias, context);
         }
     }
 
-    if (freeList)
+    if (freeList == NONE)
     {
-        /* found an empty slot */
-        insert = freeList;
-        freeList = insert->next;        
-    }
-    else
-    {
-        HASSERT(oldest != NULL && newest != NULL);
+        HASSERT(entries > 0);
 
-        /* kick out the oldest mapping and re-link the oldest endpoint */
-        insert = oldest;
-        if (oldest->newer)
-        {
-            oldest->newer->older = NULL;
-        }
-        if (insert == newest)
+        /* kick out the first entry the clock hand finds unreferenced since
+         * its last pass */
+        while (pool[clockHand].referenced)
         {
-            newest = NULL;
+            pool[clockHand].referenced = false;
+            clockHand = (clockHand + 1) % entries;
         }
-        oldest = oldest->newer;
+        insert = clockHand;
+        clockHand = (clockHand + 1) % entries;
 
-        aliasMap.erase(insert->alias);
-        idMap.erase(insert->id);
+        NodeID old_id = pool[insert].id;
+        NodeAlias old_alias = pool[insert].alias;
+        release(insert);
 
         if (removeCallback)
         {
             /* tell the interface layer that we removed this mapping */
-            (*removeCallback)(insert->id, insert->alias, context);
+            (*removeCallback)(old_id, old_alias, context);
         }
     }
-        
-    insert->timestamp = OSTime::get_monotonic();
-    insert->id = id;
-    insert->alias = alias;
 
-    aliasMap[alias] = insert;
-    idMap[id] = insert;
+    /* found an empty slot */
+    insert = freeList;
+    freeList = pool[insert].next;
 
-    /* update the time based list */
-    insert->newer = NULL;
-    if (newest == NULL)
-    {
-        /* if newest == NULL, then oldest must also be NULL */
-        HASSERT(oldest == NULL);
+    pool[insert].id = id;
+    pool[insert].alias = alias;
+    pool[insert].referenced = false;
 
-        insert->older = NULL;
-        oldest = insert;
-    }
-    else
+    aliasIndex[find(aliasIndex, &Metadata::alias, alias)] = insert;
+    /* a stale mapping of the same Node ID is shadowed by the new one */
+    idIndex[find(idIndex, &Metadata::id, id)] = insert;
+}
+
+void AliasCache::release(unsigned e)
+{
+    erase(aliasIndex, &Metadata::alias, find(aliasIndex, &Metadata::alias,
+                                             pool[e].alias));
+    unsigned i = find(idIndex, &Metadata::id, pool[e].id);
+    if (idIndex[i] == e)
     {
-        insert->older = newest;
-        newest->newer = insert;
+        erase(idIndex, &Metadata::id, i);
     }
-
-    newest = insert;
-    
-    return;
+    pool[e].id = 0;
+    pool[e].alias = 0;
+    pool[e].next = freeList;
+    freeList = e;
 }
 
 /** Remove an alias from an alias cache.  This method does not call the
@@ -150,35 +167,12 @@ void AliasCache::add(NodeID id, NodeAlias alias)
  */
 void AliasCache::remove(NodeAlias alias)
 {
-    AliasMap::Iterator it = aliasMap.find(alias);
+    unsigned a = find(aliasIndex, &Metadata::alias, alias);
 
-    if (it != aliasMap.end())
+    if (aliasIndex[a] != NONE)
     {
-        Metadata *metadata = (*it).second;
-        aliasMap.erase(it);
-        idMap.erase(metadata->id);
-        
-        if (metadata->newer)
-        {
-            metadata->newer->older = metadata->older;
-        }
-        if (metadata->older)
-        {
-            metadata->older->newer = metadata->newer;
-        }
-        if (metadata == newest)
-        {
-            newest = metadata->older;
-        }
-        if (metadata == oldest)
-        {
-            oldest = metadata->newer;
-        }
-    
-        metadata->next = freeList;
-        freeList = metadata;
+        release(aliasIndex[a]);
     }
-    
 }
 
 bool AliasCache::retrieve(unsigned entry, NodeID* node, NodeAlias* alias)
@@ -199,14 +193,17 @@ NodeAlias AliasCache::lookup(NodeID id)
 {
     HASSERT(id != 0);
 
-    IdMap::Iterator it = idMap.find(id);
+    unsigned e = idIndex[find(idIndex, &Metadata::id, id)];
 
-    if (it != idMap.end())
+    if (e != NONE)
     {
-        Metadata *metadata = (*it).second;
+        Metadata *metadata = pool + e;
         
-        /* update timestamp */
-        touch(metadata);
+        /* give it a second chance; written only if it changes */
+        if (!metadata->referenced)
+        {
+            metadata->referenced = true;
+        }
         return metadata->alias;
     }
 
@@ -222,14 +219,17 @@ NodeID AliasCache::lookup(NodeAlias alias)
 {
     HASSERT(alias != 0);
 
-    AliasMap::Iterator it = aliasMap.find(alias);
+    unsigned e = aliasIndex[find(aliasIndex, &Metadata::alias, alias)];
 
-    if (it != aliasMap.end())
+    if (e != NONE)
     {
-        Metadata *metadata = (*it).second;
+        Metadata *metadata = pool + e;
         
-        /* update timestamp */
-        touch(metadata);
+        /* give it a second chance; written only if it changes */
+        if (!metadata->referenced)
+        {
+            metadata->referenced = true;
+        }
         return metadata->id;
     }
     
@@ -238,7 +238,7 @@ NodeID AliasCache::lookup(NodeAlias alias)
 }
 
 /** Call the given callback function once for each alias tracked.  The order
- * will be in last "touched" order.
+ * is unspecified.
  * @param callback method to call
  * @param context context pointer to pass to callback
  */
@@ -246,9 +246,12 @@ void AliasCache::for_each(void (*callback)(void*, NodeID, NodeAlias), void *cont
 {
     HASSERT(callback != NULL);
 
-    for (Metadata *metadata = newest; metadata != NULL; metadata = metadata->older)
+    for (size_t i = 0; i < entries; ++i)
     {
-        (*callback)(context, metadata->id, metadata->alias);
+        if (pool[i].alias)
+        {
+            (*callback)(context, pool[i].id, pool[i].alias);
+        }
     }
 }
 
@@ -272,31 +275,4 @@ NodeAlias AliasCache::generate()
     return alias;
 }
 
-/** Update the time stamp for a given entry.
- * @param  metadata metadata associated with the entry
- */
-void AliasCache::touch(Metadata* metadata)
-{
-    metadata->timestamp = OSTime::get_monotonic();
-
-    if (metadata != newest)
-    {
-        if (metadata == oldest)
-        {
-            oldest = metadata->newer;
-            oldest->older = NULL;
-        }
-        else
-        {
-            /* we have someone older */
-            metadata->older->newer = metadata->newer;
-        }
-        metadata->newer->older = metadata->older;
-        metadata->newer = NULL;
-        metadata->older = newest;
-        newest->newer = metadata;
-        newest = metadata;
-    }
-}
-
 }
@@ -36,8 +36,6 @@
 
 #include "openlcb/Defs.hxx"
 #include "utils/macros.h"
-#include "utils/Map.hxx"
-#include "utils/RBTree.hxx"
 
 namespace openlcb
 {
@@ -48,8 +46,12 @@ namespace openlcb
  * is no mutual exclusion locking mechanism built into this class.  Mutual
  * exclusion must be handled by the user as needed.
  *
- * @todo the class uses RBTree, consider a version that is a linear search for
- * a small number of entries.
+ * The entries are kept in a flat pool, and found through two open addressing
+ * hash indexes (alias to entry and node ID to entry). When the cache is full,
+ * the entry to evict is chosen by the CLOCK (second chance) approximation of
+ * least recently used: a lookup only sets the referenced bit of the entry if
+ * it is not set yet, and the clock hand clears these bits as it looks for an
+ * unreferenced entry.
  */
 class AliasCache
 {
@@ -63,20 +65,7 @@ public:
      */
     AliasCache(NodeID seed, size_t _entries,
                void (*remove_callback)(NodeID id, NodeAlias alias, void *) = NULL,
-               void *context = NULL)
-        : pool(new Metadata[_entries]),
-          freeList(NULL),
-          aliasMap(_entries),
-          idMap(_entries),
-          oldest(NULL),
-          newest(NULL),
-          seed(seed),
-          entries(_entries),
-          removeCallback(remove_callback),
-          context(context)
-    {
-        clear();
-    }
+               void *context = NULL);
 
     /** This NodeID will be used for reserved but unused local aliases. */
     static const NodeID RESERVED_ALIAS_NODE_ID;
@@ -109,8 +98,8 @@ public:
      */
     NodeID lookup(NodeAlias alias);
 
-    /** Call the given callback function once for each alias tracked.  The order
-     * will be in last "touched" order.
+    /** Call the given callback function once for each alias tracked.  The
+     * order is unspecified.
      * @param callback method to call
      * @param context context pointer to pass to callback
      */
@@ -139,6 +128,8 @@ public:
     /** Default destructor */
     ~AliasCache()
     {
+        delete [] idIndex;
+        delete [] aliasIndex;
         delete [] pool;
     }
 
@@ -148,51 +139,100 @@ public:
 private:
     enum
     {
-        /** marks an unused mapping */
-        UNUSED_MASK = 0x10000000
+        /** marks an empty slot of the indexes and the end of the freeList */
+        NONE = 0xffff
     };
 
     /** Interesting information about a given cache entry. */
     struct Metadata
     {
-        NodeID id = 0; /**< 48-bit NMRAnet Node ID */
-        NodeAlias alias = 0; /**< NMRAnet alias */
-        long long timestamp; /**< time stamp of last usage */
-        union
+        NodeID id = 0; /**< 48-bit NMRAnet Node ID, 0 if unused */
+        NodeAlias alias = 0; /**< NMRAnet alias, 0 if unused */
+        uint16_t next; /**< index of the next freeList entry */
+        bool referenced; /**< used since the clock hand last passed */
+    };
+
+    /** @return the home slot of an alias in aliasIndex. @param alias is the
+     * alias to look for. */
+    unsigned hash(NodeAlias alias)
+    {
+        return (uint32_t)(alias * 0x9E3779B1u) >> indexShift;
+    }
+
+    /** @return the home slot of a node ID in idIndex. @param id is the node ID
+     * to look for. */
+    unsigned hash(NodeID id)
+    {
+        return (uint32_t)((id * 0x9E3779B97F4A7C15ULL) >> 32) >> indexShift;
+    }
+
+    /** Finds a key in an index.
+     * @param index is aliasIndex or idIndex.
+     * @param field is the member of Metadata the index is keyed by.
+     * @param key is the value to look for.
+     * @return the slot in index that points to the entry with key, or the
+     * empty slot where key would be inserted.
+     */
+    template <class K>
+    unsigned find(const uint16_t *index, K Metadata::*field, K key)
+    {
+        unsigned i = hash(key);
+        while (index[i] != NONE && pool[index[i]].*field != key)
         {
-            Metadata *prev; /**< unused */
-            Metadata *newer; /**< pointer to the next newest entry */
-        };
-        union
+            i = (i + 1) & indexMask;
+        }
+        return i;
+    }
+
+    /** Clears a slot of an index, and moves the following entries back so
+     * that they can still be found without tombstones.
+     * @param index is aliasIndex or idIndex.
+     * @param field is the member of Metadata the index is keyed by.
+     * @param i is the slot to clear.
+     */
+    template <class K>
+    void erase(uint16_t *index, K Metadata::*field, unsigned i)
+    {
+        for (unsigned j = (i + 1) & indexMask; index[j] != NONE;
+             j = (j + 1) & indexMask)
         {
-            Metadata *next; /**< pointer to next freeList entry */
-            Metadata *older; /**< pointer to the next oldest entry */
-        };
-    };
+            unsigned home = hash(pool[index[j]].*field);
+            // The entry in j may move to i if i is on its probe sequence.
+            if (((j - home) & indexMask) >= ((j - i) & indexMask))
+            {
+                index[i] = index[j];
+                i = j;
+            }
+        }
+        index[i] = NONE;
+    }
+
+    /** Removes an entry from both indexes and puts it on the freeList.
+     * @param e index of the entry in pool
+     */
+    void release(unsigned e);
 
     /** pointer to allocated Metadata pool */
     Metadata *pool;
-    
-    /** list of unused mapping entries */
-    Metadata *freeList;
-    
-    /** Short hand for the alias Map type */
-    typedef Map <NodeAlias, Metadata*> AliasMap;
-    
-    /** Short hand for the ID Map type */
-    typedef Map <NodeID, Metadata*> IdMap;
 
-    /** Map of alias to corresponding Metadata */
-    AliasMap aliasMap;
-    
-    /** Map of Node ID to corresponding Metadata */
-    IdMap idMap;
-    
-    /** oldest untouched entry */
-    Metadata *oldest;
-    
-    /** newest, most recently touched entry */
-    Metadata *newest;
+    /** open addressing index of aliases to pool entries */
+    uint16_t *aliasIndex;
+
+    /** open addressing index of Node IDs to pool entries */
+    uint16_t *idIndex;
+
+    /** number of slots in the indexes minus one; the number of slots is a
+     * power of two */
+    unsigned indexMask;
+
+    /** shift that turns a 32-bit hash into a slot of the indexes */
+    unsigned indexShift;
+
+    /** index of the first unused mapping entry in pool, or NONE */
+    uint16_t freeList;
+
+    /** index of the next entry to look at for eviction */
+    uint16_t clockHand;
 
     /** Seed for the generation of the next alias */
     NodeID seed;
@@ -206,11 +246,6 @@ private:
     /** context pointer to pass in with remove_callback */
     void *context;
 
-    /** Update the time stamp for a given entry.
-     * @param  metadata metadata associated with the entry
-     */
-    void touch(Metadata* metadata);
-
     DISALLOW_COPY_AND_ASSIGN(AliasCache);
 };
 
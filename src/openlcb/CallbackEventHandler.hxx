@@ -70,14 +70,17 @@ public:
     typedef std::function<EventState(const EventRegistryEntry &registry_entry,
         EventReport *report)> EventStateHandlerFn;
 
+    /// The flags live in the top bits of EventRegistryEntry::user_arg, which
+    /// has 24 bits. API change: they used to be bits 31 and 30, leaving 30
+    /// user bits; now they are bits 23 and 22, leaving 22.
     enum RegistryEntryBits
     {
         /// Set this bit in the param entry_bits in order to mark the event as
         /// being produced. See {@ref add_entry}.
-        IS_PRODUCER = (1U << 31),
+        IS_PRODUCER = (1U << 23),
         /// Set this bit in the param entry_bits in order to mark the event as
         /// being consumed. See {@ref add_entry}.
-        IS_CONSUMER = (1U << 30),
+        IS_CONSUMER = (1U << 22),
         /// This is the mask of bits that can be used by the caller for storing
         /// arbitrary information next to the event registration.
         USER_BIT_MASK = IS_CONSUMER - 1,
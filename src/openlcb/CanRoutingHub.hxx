@@ -95,17 +95,13 @@ public:
                 cb->data()->skipMember_ = reinterpret_cast<
                     FlowInterface<Buffer<HubContainer<CanFrameContainer>>> *>(
                     b->data()->skipMember_);
-                deliveryFlow_.send(
-                    cb, reprioritize_frame(cb->data()->frame(), priority));
+                deliveryFlow_.send(cb, priority);
             }
         }
     }
 
     CanHubPortInterface *can_hub()
     {
-        /// @TODO: need a priority wrapper:
-        // deliveryFlow_.send(b, reprioritize_frame(b->data()->frame(),
-        // priority));
         return &deliveryFlow_;
     }
 
@@ -132,44 +128,118 @@ public:
 private:
     class PortParser;
     typedef std::map<void *, PortParser> PortsMap;
+    /// Priority levels of the delivery queue, from the most urgent.
+    enum RoutingPriority
+    {
+        /// CAN control frames (alias allocation) and high priority frames.
+        PRIORITY_CONTROL = 0,
+        /// Traction control; a throttle user is waiting for these.
+        PRIORITY_TRACTION,
+        /// Most global and addressed messages, such as event reports.
+        PRIORITY_NORMAL,
+        /// Datagrams and low priority messages.
+        PRIORITY_BULK,
+        /// Stream data and unknown frames.
+        PRIORITY_STREAM,
+        /// Number of priority levels.
+        NUM_PRIORITIES
+    };
+
+    /// How many frames of higher priority may be delivered while a lower
+    /// priority frame is waiting, before that frame goes next.
+    static constexpr unsigned MAX_STARVATION = 16;
+
     /**
-       Computes the desired priority of a CAN frame.
+       Computes the desired priority of a CAN frame from its CAN priority,
+       frame type and MTI.
 
        @param frame is the CAN frame (at the input side).
        @param old_priority is the incoming priority of the frame, as it arrived
        from the previous flow.
        @return the desired priority of the frame, in the range of 0..4.
      */
-    unsigned reprioritize_frame(
+    static unsigned reprioritize_frame(
         const struct can_frame &frame, unsigned old_priority)
     {
-        // @TODO(balazs.racz): check actual priority.
-        return old_priority;
+        if (IS_CAN_FRAME_ERR(frame) || IS_CAN_FRAME_RTR(frame))
+        {
+            return old_priority;
+        }
+        if (!IS_CAN_FRAME_EFF(frame))
+        {
+            return PRIORITY_NORMAL;
+        }
+        uint32_t can_id = GET_CAN_FRAME_ID_EFF(frame);
+        if (CanDefs::get_priority(can_id) == CanDefs::HIGH_PRIORITY ||
+            CanDefs::get_frame_type(can_id) == CanDefs::CONTROL_MSG)
+        {
+            return PRIORITY_CONTROL;
+        }
+        switch (CanDefs::get_can_frame_type(can_id))
+        {
+            case CanDefs::GLOBAL_ADDRESSED:
+                break;
+            case CanDefs::DATAGRAM_ONE_FRAME:
+            case CanDefs::DATAGRAM_FIRST_FRAME:
+            case CanDefs::DATAGRAM_MIDDLE_FRAME:
+            case CanDefs::DATAGRAM_FINAL_FRAME:
+                return PRIORITY_BULK;
+            default:
+                return PRIORITY_STREAM;
+        }
+        Defs::MTI mti = static_cast<Defs::MTI>(CanDefs::get_mti(can_id));
+        switch (mti)
+        {
+            case Defs::MTI_TRACTION_CONTROL_COMMAND:
+            case Defs::MTI_TRACTION_CONTROL_REPLY:
+            case Defs::MTI_TRACTION_PROXY_COMMAND:
+            case Defs::MTI_TRACTION_PROXY_REPLY:
+                return PRIORITY_TRACTION;
+            default:
+                break;
+        }
+        return Defs::mti_priority(mti) >= 2 ? PRIORITY_BULK : PRIORITY_NORMAL;
     }
 
+    /// Queue of the delivery flow: strict priority with a bound on
+    /// starvation.
+    typedef QListAging<NUM_PRIORITIES, MAX_STARVATION> DeliveryQueue;
+
     /// Flow responsible for queuing outgoing CAN frames as well as sending out
     /// the actual frames to the recipients.
-    class DeliveryFlow : public StateFlow<Buffer<CanHubData>, QList<5>>
+    class DeliveryFlow : public StateFlow<Buffer<CanHubData>, DeliveryQueue>
     {
     public:
         DeliveryFlow(Service *s, GcCanRoutingHub *parent)
-            : StateFlow<Buffer<CanHubData>, QList<5>>(s)
+            : StateFlow<Buffer<CanHubData>, DeliveryQueue>(s)
             , parent_(parent)
         {
         }
 
+        /// Enqueues a frame at the priority computed from its contents.
+        void send(Buffer<CanHubData> *b, unsigned priority = UINT_MAX) override
+        {
+            StateFlow<Buffer<CanHubData>, DeliveryQueue>::send(
+                b, reprioritize_frame(b->data()->frame(), priority));
+        }
+
     private:
         Action entry() override
         {
-            OSMutexLock l(&parent_->lock_);
-            // First we apply any pending removes.
-            for (void *p : parent_->pendingRemove_)
             {
-                parent_->ports_.erase(p);
+                OSMutexLock l(&parent_->lock_);
+                // First we apply any pending removes.
+                for (void *p : parent_->pendingRemove_)
+                {
+                    parent_->ports_.erase(p);
+                    parent_->routingTable_.remove_port(
+                        static_cast<CanHubPortInterface *>(p));
+                }
+                parent_->pendingRemove_.clear();
             }
-            parent_->pendingRemove_.clear();
 
-            // Classifies the packet.
+            // Classifies the packet. The routing table does its own locking,
+            // and lookups in it do not block each other.
             srcAddress_ = 0;
             dstAddress_ = 0;
             const struct can_frame &frame = message()->data()->frame();
@@ -191,6 +261,7 @@ private:
             {
                 void *port =
                     parent_->routingTable_.lookup_port_for_address(dstAddress_);
+                OSMutexLock l(&parent_->lock_);
                 nextIt_ = parent_->ports_.find(port);
                 if (nextIt_ != parent_->ports_.end())
                 {
@@ -203,8 +274,8 @@ private:
                 }
             }
 
+            OSMutexLock l(&parent_->lock_);
             nextIt_ = parent_->ports_.begin();
-
             return call_immediately(STATE(try_next_entry));
         }
 
@@ -119,12 +119,36 @@ public:
     /// Pointer to the handler.
     EventHandler *handler;
     /// Opaque user argument. The event handlers may use this to store
-    /// arbitrary data.
-    uint32_t user_arg;
+    /// arbitrary data. API change: this used to be a full 32-bit word; now
+    /// only values below 2^24 are accepted (the constructors assert), so
+    /// handlers that packed pointers or wide bit fields here have to keep
+    /// that data elsewhere.
+    uint32_t user_arg : 24;
+    /// Bit mask of the flags below. Shares a word with user_arg, so that the
+    /// entry stays 16 bytes on 32-bit targets.
+    uint32_t flags : 8;
+
+    enum
+    {
+        /// The handler notifies the done barrier before returning from every
+        /// call. The event service may call such handlers one after the other
+        /// without going through the executor. If a handler with this flag
+        /// does not notify done in time, it is waited for, but the calls are
+        /// made from the event iterator flow and not the EventCallerFlow.
+        SYNCHRONOUS = 1,
+        /// The handler produces the events of this registration. Used by
+        /// @ref EventRangeCoalescer; ignored by the registry.
+        PRODUCER = 2,
+        /// The handler consumes the events of this registration. Used by
+        /// @ref EventRangeCoalescer; ignored by the registry.
+        CONSUMER = 4,
+    };
+
     EventRegistryEntry(EventHandler *_handler, EventId _event)
         : event(_event)
         , handler(_handler)
         , user_arg(0)
+        , flags(0)
     {
     }
     EventRegistryEntry(EventHandler *_handler, EventId _event,
@@ -132,10 +156,25 @@ public:
         : event(_event)
         , handler(_handler)
         , user_arg(_user_arg)
+        , flags(0)
+    {
+        HASSERT(_user_arg < (1u << 24));
+    }
+    EventRegistryEntry(EventHandler *_handler, EventId _event,
+                       unsigned _user_arg, uint32_t _flags)
+        : event(_event)
+        , handler(_handler)
+        , user_arg(_user_arg)
+        , flags(_flags)
     {
+        HASSERT(_user_arg < (1u << 24));
+        HASSERT(_flags < (1u << 8));
     }
 };
 
+static_assert(sizeof(void *) != 4 || sizeof(EventRegistryEntry) == 16,
+    "EventRegistryEntry grew; the registries store many of these");
+
 /// Abstract base class for all event handlers. Instances of this class can
 /// get registered with the event service to receive notifications of incoming
 /// event messages from the bus.
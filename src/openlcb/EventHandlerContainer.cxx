@@ -158,4 +158,269 @@ TreeEventHandlers::TreeEventHandlers()
 {
 }
 
+FlatEventHandlers::FlatEventHandlers()
+{
+}
+
+void FlatEventHandlers::register_handler(
+    const EventRegistryEntry &entry, unsigned mask)
+{
+    LOG(VERBOSE, "%p: register %p", this, entry.handler);
+    while (true)
+    {
+        size_t need;
+        {
+            AtomicHolder h(this);
+            if (slots_.size() < slots_.capacity())
+            {
+                set_dirty();
+                // Does not allocate.
+                slots_.emplace_back(entry, mask, nextSeq_++);
+                dirty_ = true;
+                return;
+            }
+            need = slots_.size() + 1;
+        }
+        // Grows the array outside the lock, then swaps it in.
+        std::vector<Slot> bigger;
+        bigger.reserve(std::max(need * 2, size_t(8)));
+        {
+            AtomicHolder h(this);
+            if (slots_.size() < bigger.capacity() &&
+                slots_.capacity() < bigger.capacity())
+            {
+                set_dirty();
+                bigger.insert(bigger.end(), slots_.begin(), slots_.end());
+                slots_.swap(bigger);
+            }
+        }
+        // The old array is freed here, outside the lock.
+    }
+}
+
+void FlatEventHandlers::unregister_handler(EventHandler *handler)
+{
+    AtomicHolder h(this);
+    set_dirty();
+    LOG(VERBOSE, "%p: unregister %p", this, handler);
+    auto erase_it = std::remove_if(slots_.begin(), slots_.end(),
+        [handler](const Slot &s) { return s.entry.handler == handler; });
+    if (erase_it == slots_.end())
+    {
+        DIE("tried to unregister a handler that was not registered");
+    }
+    slots_.erase(erase_it, slots_.end());
+    dirty_ = true;
+}
+
+void FlatEventHandlers::lazy_index()
+{
+    if (!dirty_)
+    {
+        return;
+    }
+    dirty_ = false;
+    // Registrations of the same range stay in registration order.
+    std::sort(slots_.begin(), slots_.end(), [](const Slot &a, const Slot &b) {
+        EventId af = a.first();
+        EventId bf = b.first();
+        return af < bf || (af == bf && a.seq < b.seq);
+    });
+    // Builds the implicit interval tree bottom-up. The nodes of level k are
+    // at the indexes that have exactly k trailing one bits; the children of
+    // node i on level k are i - 2^(k-1) and i + 2^(k-1).
+    int64_t n = slots_.size();
+    if (n == 0)
+    {
+        rootLevel_ = -1;
+        return;
+    }
+    // Rightmost node of the tree so far, and the maxLast value there.
+    int64_t last_i = 0;
+    EventId last = 0;
+    for (int64_t i = 0; i < n; i += 2)
+    {
+        last_i = i;
+        last = slots_[i].maxLast = slots_[i].last();
+    }
+    int k;
+    for (k = 1; (int64_t(1) << k) <= n; ++k)
+    {
+        int64_t x = int64_t(1) << (k - 1);
+        for (int64_t i = (x << 1) - 1; i < n; i += x << 2)
+        {
+            EventId m = slots_[i].last();
+            m = std::max(m, slots_[i - x].maxLast);
+            m = std::max(m, i + x < n ? slots_[i + x].maxLast : last);
+            slots_[i].maxLast = m;
+        }
+        // Moves last_i to its parent.
+        last_i = ((last_i >> k) & 1) ? last_i - x : last_i + x;
+        if (last_i < n)
+        {
+            last = std::max(last, slots_[last_i].maxLast);
+        }
+    }
+    rootLevel_ = k - 1;
+}
+
+size_t FlatEventHandlers::find_overlapping(
+    EventId first, EventId last, uint32_t *out, size_t capacity)
+{
+    size_t count = 0;
+    if (rootLevel_ < 0)
+    {
+        return count;
+    }
+    /// A node of the interval tree to visit.
+    struct StackEntry
+    {
+        /// Index of the node. May be beyond the end of the array; then only
+        /// the left part of its subtree exists.
+        int64_t x;
+        /// Level of the node.
+        int k;
+        /// True if the left subtree was already visited.
+        bool left_done;
+    };
+    // Each level holds at most two entries.
+    StackEntry stack[2 * 64 + 2];
+    unsigned t = 0;
+    const Slot *a = slots_.data();
+    int64_t n = slots_.size();
+    stack[t++] = {(int64_t(1) << rootLevel_) - 1, rootLevel_, false};
+    while (t)
+    {
+        StackEntry z = stack[--t];
+        if (z.k <= 3)
+        {
+            // Small subtree: scans it linearly.
+            if (z.x < n && a[z.x].maxLast < first)
+            {
+                continue;
+            }
+            int64_t i = (z.x >> z.k) << z.k;
+            int64_t end = std::min(i + (int64_t(1) << (z.k + 1)) - 1, n);
+            for (; i < end && a[i].first() <= last; ++i)
+            {
+                if (a[i].last() >= first && count++ < capacity)
+                {
+                    out[count - 1] = i;
+                }
+            }
+        }
+        else if (!z.left_done)
+        {
+            // Visits the left subtree first, then comes back to this node.
+            int64_t y = z.x - (int64_t(1) << (z.k - 1));
+            stack[t++] = {z.x, z.k, true};
+            if (y >= n || a[y].maxLast >= first)
+            {
+                stack[t++] = {y, z.k - 1, false};
+            }
+        }
+        else if (z.x < n && a[z.x].first() <= last)
+        {
+            if (a[z.x].last() >= first && count++ < capacity)
+            {
+                out[count - 1] = z.x;
+            }
+            int64_t y = z.x + (int64_t(1) << (z.k - 1));
+            if (y >= n || a[y].maxLast >= first)
+            {
+                stack[t++] = {y, z.k - 1, false};
+            }
+        }
+    }
+    return count;
+}
+
+/// Class representing the iteration state on the flat event handler
+/// registry. The matching registrations are collected when the iteration
+/// starts.
+class FlatEventHandlers::Iterator : public EventIterator
+{
+public:
+    Iterator(FlatEventHandlers *parent)
+        : parent_(parent)
+    {
+        clear_iteration();
+    }
+
+    EventRegistryEntry *next_entry() OVERRIDE
+    {
+        if (all_)
+        {
+            if (next_ < parent_->slots_.size())
+            {
+                return &parent_->slots_[next_++].entry;
+            }
+            return nullptr;
+        }
+        if (next_ < numMatches_)
+        {
+            return &parent_->slots_[matches_[next_++]].entry;
+        }
+        return nullptr;
+    }
+
+    void clear_iteration() OVERRIDE
+    {
+        all_ = false;
+        numMatches_ = 0;
+        next_ = 0;
+    }
+
+    void init_iteration(EventReport *r) OVERRIDE
+    {
+        clear_iteration();
+        EventId last = r->event + r->mask;
+        if (last < r->event)
+        {
+            last = ~EventId(0);
+        }
+        while (true)
+        {
+            {
+                // Nothing may allocate memory under this lock.
+                AtomicHolder h(parent_);
+                parent_->lazy_index();
+                if (r->event == 0 && r->mask == ~EventId(0))
+                {
+                    // Everything matches (e.g. global identify); no need to
+                    // search.
+                    all_ = true;
+                    return;
+                }
+                numMatches_ = parent_->find_overlapping(
+                    r->event, last, matches_.data(), matches_.size());
+            }
+            if (numMatches_ <= matches_.size())
+            {
+                return;
+            }
+            // Too many matches for the buffer; grows it and searches again.
+            matches_.resize(numMatches_);
+        }
+    }
+
+private:
+    /// Registry we are iterating.
+    FlatEventHandlers *parent_;
+    /// Indexes of the matching slots. Only grows, and only outside the
+    /// registry lock.
+    std::vector<uint32_t> matches_;
+    /// Number of valid entries in matches_.
+    size_t numMatches_;
+    /// Next entry to return from matches_ (or from all slots).
+    size_t next_;
+    /// True if the iteration returns every slot.
+    bool all_;
+};
+
+EventIterator *FlatEventHandlers::create_iterator()
+{
+    return new Iterator(this);
+}
+
 } // namespace openlcb
@@ -37,6 +37,7 @@
 
 #include "utils/logging.h"
 #include "openlcb/EventHandlerTemplates.hxx"
+#include "openlcb/EventRangeCoalescer.hxx"
 #include "openlcb/EventService.hxx"
 
 #ifdef __linux__
@@ -528,8 +529,10 @@ BitEventHandler::BitEventHandler(BitEventInterface *bit) : bit_(bit)
 {
 }
 
-void BitEventHandler::register_handler(uint64_t event_on, uint64_t event_off)
+void BitEventHandler::register_handler(
+    uint64_t event_on, uint64_t event_off, uint32_t roles)
 {
+    Node *node = bit_->node();
     if ((event_on ^ event_off) == 1ULL)
     {
         // Register once for two eventids.
@@ -540,21 +543,21 @@ void BitEventHandler::register_handler(uint64_t event_on, uint64_t event_off)
         } else {
             user_data |= BOTH_ON_IS_ZERO;
         }
-        EventRegistry::instance()->register_handler(
-            EventRegistryEntry(this, id, user_data), 1);
+        EventRangeCoalescer::register_for_node(
+            node, EventRegistryEntry(this, id, user_data, roles), 1);
     }
     else
     {
-        EventRegistry::instance()->register_handler(
-            EventRegistryEntry(this, event_on, EVENT_ON), 0);
-        EventRegistry::instance()->register_handler(
-            EventRegistryEntry(this, event_off, EVENT_OFF), 0);
+        EventRangeCoalescer::register_for_node(
+            node, EventRegistryEntry(this, event_on, EVENT_ON, roles), 0);
+        EventRangeCoalescer::register_for_node(
+            node, EventRegistryEntry(this, event_off, EVENT_OFF, roles), 0);
     }
 }
 
 void BitEventHandler::unregister_handler()
 {
-    EventRegistry::instance()->unregister_handler(this);
+    EventRangeCoalescer::unregister_for_node(bit_->node(), this);
 }
 
 void BitEventHandler::SendProducerIdentified(
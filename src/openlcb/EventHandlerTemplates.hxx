@@ -543,9 +543,11 @@ public:
     void SendEventReport(WriteHelper *writer, Notifiable *done);
 
 protected:
-    /// Registers this event handler with the global event manager. Call this
-    /// from the constructor of the derived class.
-    void register_handler(uint64_t event_on, uint64_t event_off);
+    /// Registers this event handler with the global event manager, or with
+    /// the EventRangeCoalescer of the node. Call this from the constructor of
+    /// the derived class.
+    /// @param roles is EventRegistryEntry::PRODUCER and/or CONSUMER.
+    void register_handler(uint64_t event_on, uint64_t event_off, uint32_t roles);
     /// Removes this event handler from the global event manager. Call this
     /// from the destructor of the derived class.
     void unregister_handler();
@@ -613,7 +615,8 @@ public:
     {
         /// @TODO (balazs.racz) this should be more efficient when done from
         /// the update configuration callback.
-        register_handler(bit->event_on(), bit->event_off());
+        register_handler(
+            bit->event_on(), bit->event_off(), EventRegistryEntry::PRODUCER);
     }
     ~BitEventProducer()
     {
@@ -667,7 +670,8 @@ class BitEventConsumer : public BitEventHandler
 public:
     BitEventConsumer(BitEventInterface *bit) : BitEventHandler(bit)
     {
-        register_handler(bit->event_on(), bit->event_off());
+        register_handler(
+            bit->event_on(), bit->event_off(), EventRegistryEntry::CONSUMER);
     }
     ~BitEventConsumer()
     {
@@ -677,6 +681,16 @@ public:
     /// Queries producers and acquires the current state of the bit.
     void SendQuery(WriteHelper *writer, BarrierNotifiable *done);
 
+protected:
+    /// Constructor for subclasses. @param bit is the event bit. @param roles
+    /// are the flags to register the events with.
+    BitEventConsumer(BitEventInterface *bit, uint32_t roles)
+        : BitEventHandler(bit)
+    {
+        register_handler(bit->event_on(), bit->event_off(), roles);
+    }
+
+public:
     void handle_event_report(const EventRegistryEntry &entry, EventReport *event,
                            BarrierNotifiable *done) override;
     void handle_identify_global(const EventRegistryEntry &entry,
@@ -706,7 +720,9 @@ class BitEventPC : public BitEventConsumer
 public:
     /// @param bit represents the event bits and the getter/setter of the
     /// hardware state.
-    BitEventPC(BitEventInterface *bit) : BitEventConsumer(bit)
+    BitEventPC(BitEventInterface *bit)
+        : BitEventConsumer(bit,
+              EventRegistryEntry::PRODUCER | EventRegistryEntry::CONSUMER)
     {
     }
 
@@ -0,0 +1,574 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file EventRangeCoalescer.cxx
+ *
+ * Merges the single-event registrations of a node into event ranges.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "openlcb/EventRangeCoalescer.hxx"
+
+#include <algorithm>
+
+#include "openlcb/EventHandlerTemplates.hxx"
+#include "openlcb/Node.hxx"
+
+namespace openlcb
+{
+
+/// Calls one function of a list of event handlers one after the other,
+/// waiting for each to be done. Goes back to the free list of the coalescer
+/// at the end.
+class EventRangeCoalescer::Forwarder : public Notifiable
+{
+public:
+    Forwarder(EventRangeCoalescer *parent)
+        : parent_(parent)
+    {
+    }
+
+    /// Registrations to call. Only the first count_ entries are valid. Keeps
+    /// its size when the forwarder is reused.
+    std::vector<EventRegistryEntry> entries_;
+
+    /// Sets up a new round of calls. Must be called with the lock of the
+    /// parent held. @param fn is the function to call. @param event is the
+    /// incoming message. @param done is to be notified when all handlers are
+    /// done. @param count is the number of valid entries.
+    void start(EventHandlerFunction fn, EventReport *event,
+        BarrierNotifiable *done, size_t count)
+    {
+        fn_ = fn;
+        event_ = event;
+        done_ = done;
+        count_ = count;
+        next_ = 0;
+        epoch_ = parent_->epoch_;
+    }
+
+    /// Calls the handlers until one of them does not finish inline.
+    void notify() override
+    {
+        while (next_ < count_)
+        {
+            {
+                AtomicHolder h(parent_);
+                if (epoch_ != parent_->epoch_)
+                {
+                    // A handler was removed; it may be in our list.
+                    break;
+                }
+            }
+            const EventRegistryEntry &e = entries_[next_++];
+            n_.reset(this);
+            auto *c = n_.new_child();
+            (e.handler->*fn_)(e, event_, &n_);
+            if (n_.abort_if_almost_done())
+            {
+                continue;
+            }
+            c->notify();
+            return;
+        }
+        // We may be reused as soon as we are on the free list.
+        BarrierNotifiable *done = done_;
+        parent_->free_forwarder(this);
+        done->notify();
+    }
+
+    /// Next forwarder on the free list.
+    Forwarder *nextFree_ {nullptr};
+
+private:
+    EventRangeCoalescer *parent_;
+    EventHandlerFunction fn_;
+    EventReport *event_;
+    /// Notified when all handlers are done.
+    BarrierNotifiable *done_;
+    /// Epoch of the parent when we started.
+    unsigned epoch_;
+    /// Number of valid entries.
+    size_t count_ {0};
+    /// Index of the next entry to call.
+    size_t next_ {0};
+    /// Done callback of the handler being called.
+    BarrierNotifiable n_;
+};
+
+EventRangeCoalescer::EventRangeCoalescer(Node *node, unsigned min_events)
+    : node_(node)
+    , minEvents_(min_events)
+{
+    HASSERT(min_events >= 2);
+}
+
+EventRangeCoalescer::~EventRangeCoalescer()
+{
+    OSMutexLock l(&updateLock_);
+    HASSERT(!rebuildPending_);
+    if (numRanges_)
+    {
+        EventRegistry::instance()->unregister_handler(this);
+    }
+    while (freeForwarders_)
+    {
+        Forwarder *f = freeForwarders_;
+        freeForwarders_ = f->nextFree_;
+        delete f;
+    }
+}
+
+// static
+EventRangeCoalescer *EventRangeCoalescer::find(Node *node)
+{
+    AtomicHolder h(head_mu());
+    for (EventRangeCoalescer *c = head_; c; c = c->link_next())
+    {
+        if (c->node_ == node)
+        {
+            return c;
+        }
+    }
+    return nullptr;
+}
+
+// static
+void EventRangeCoalescer::register_for_node(
+    Node *node, const EventRegistryEntry &entry, unsigned mask)
+{
+    EventRangeCoalescer *c = find(node);
+    if (c)
+    {
+        c->register_handler(entry, mask);
+    }
+    else
+    {
+        EventRegistry::instance()->register_handler(entry, mask);
+    }
+}
+
+// static
+void EventRangeCoalescer::unregister_for_node(Node *node, EventHandler *handler)
+{
+    EventRangeCoalescer *c = find(node);
+    if (c)
+    {
+        c->unregister_handler(handler);
+    }
+    else
+    {
+        EventRegistry::instance()->unregister_handler(handler);
+    }
+}
+
+void EventRangeCoalescer::register_handler(
+    const EventRegistryEntry &entry, unsigned mask)
+{
+    OSMutexLock l(&updateLock_);
+    pending_.emplace_back(entry, mask);
+    EventRegistry::instance()->register_handler(entry, mask);
+    schedule_rebuild();
+}
+
+void EventRangeCoalescer::unregister_handler(EventHandler *handler)
+{
+    OSMutexLock l(&updateLock_);
+    bool direct = false;
+    auto is_handler = [handler, &direct](const Member &m) {
+        if (m.entry.handler != handler)
+        {
+            return false;
+        }
+        direct |= !m.coalesced;
+        return true;
+    };
+    pending_.erase(
+        std::remove_if(pending_.begin(), pending_.end(), is_handler),
+        pending_.end());
+    {
+        // Erasing does not allocate memory.
+        AtomicHolder h(this);
+        members_.erase(
+            std::remove_if(members_.begin(), members_.end(), is_handler),
+            members_.end());
+        ++epoch_;
+    }
+    if (direct)
+    {
+        EventRegistry::instance()->unregister_handler(handler);
+    }
+    schedule_rebuild();
+}
+
+void EventRangeCoalescer::schedule_rebuild()
+{
+    if (!rebuildPending_)
+    {
+        rebuildPending_ = true;
+        node_->iface()->executor()->add(this);
+    }
+}
+
+void EventRangeCoalescer::run()
+{
+    OSMutexLock l(&updateLock_);
+    rebuildPending_ = false;
+    // All writers of members_ hold updateLock_, so we can read it without
+    // the atomic lock.
+    std::vector<Member> members(members_);
+    members.insert(members.end(), pending_.begin(), pending_.end());
+    pending_.clear();
+    // These are in the registry directly now.
+    std::vector<EventHandler *> direct;
+    for (const Member &m : members)
+    {
+        if (!m.coalesced)
+        {
+            direct.push_back(m.entry.handler);
+        }
+    }
+    std::vector<Block> blocks;
+    unsigned num_coalesced = compute_blocks(&members, &blocks);
+    EventId max_span = 0;
+    for (const Member &m : members)
+    {
+        max_span = std::max(max_span, m.last - m.entry.event);
+    }
+
+    unsigned old_ranges;
+    {
+        AtomicHolder h(this);
+        members_.swap(members);
+        maxSpan_ = max_span;
+        numCoalesced_ = num_coalesced;
+        old_ranges = numRanges_;
+        numRanges_ = blocks.size();
+    }
+
+    // Updates the registry.
+    EventRegistry *registry = EventRegistry::instance();
+    if (old_ranges)
+    {
+        registry->unregister_handler(this);
+    }
+    std::sort(direct.begin(), direct.end());
+    direct.erase(std::unique(direct.begin(), direct.end()), direct.end());
+    for (EventHandler *h : direct)
+    {
+        registry->unregister_handler(h);
+    }
+    for (const Block &b : blocks)
+    {
+        registry->register_handler(
+            EventRegistryEntry(this, b.first, b.bits | (b.roles << ROLE_SHIFT)),
+            b.bits);
+    }
+    // members_ only changes under updateLock_.
+    for (const Member &m : members_)
+    {
+        if (!m.coalesced)
+        {
+            registry->register_handler(m.entry, m.mask);
+        }
+    }
+}
+
+unsigned EventRangeCoalescer::compute_blocks(
+    std::vector<Member> *members, std::vector<Block> *blocks)
+{
+    std::stable_sort(members->begin(), members->end(),
+        [](const Member &a, const Member &b) {
+            return a.entry.event < b.entry.event;
+        });
+
+    // Finds where the set of roles changes: each registration adds its roles
+    // at its first event and removes them after its last event.
+    struct Edge
+    {
+        EventId at;
+        int producers;
+        int consumers;
+    };
+    std::vector<Edge> edges;
+    for (const Member &m : *members)
+    {
+        int p = (m.entry.flags & EventRegistryEntry::PRODUCER) ? 1 : 0;
+        int c = (m.entry.flags & EventRegistryEntry::CONSUMER) ? 1 : 0;
+        if (!p && !c)
+        {
+            continue;
+        }
+        edges.push_back({m.entry.event, p, c});
+        if (m.last != ~EventId(0))
+        {
+            edges.push_back({m.last + 1, -p, -c});
+        }
+    }
+    std::sort(edges.begin(), edges.end(),
+        [](const Edge &a, const Edge &b) { return a.at < b.at; });
+
+    // Cuts the runs of equal roles into aligned power-of-two blocks.
+    auto add_run = [this, blocks](EventId first, EventId last, unsigned roles) {
+        while (true)
+        {
+            unsigned bits = first ? __builtin_ctzll(first) : 63;
+            bits = std::min(bits, 31u);
+            while (bits && (first + ((EventId(1) << bits) - 1) > last ||
+                               first + ((EventId(1) << bits) - 1) < first))
+            {
+                --bits;
+            }
+            EventId size = EventId(1) << bits;
+            if (size >= minEvents_)
+            {
+                blocks->push_back({first, bits, roles});
+            }
+            if (first + (size - 1) >= last)
+            {
+                return;
+            }
+            first += size;
+        }
+    };
+    int producers = 0;
+    int consumers = 0;
+    unsigned run_roles = 0;
+    EventId run_first = 0;
+    for (unsigned i = 0; i < edges.size();)
+    {
+        EventId at = edges[i].at;
+        for (; i < edges.size() && edges[i].at == at; ++i)
+        {
+            producers += edges[i].producers;
+            consumers += edges[i].consumers;
+        }
+        unsigned roles = (producers ? EventRegistryEntry::PRODUCER : 0) |
+            (consumers ? EventRegistryEntry::CONSUMER : 0);
+        if (roles == run_roles)
+        {
+            continue;
+        }
+        if (run_roles)
+        {
+            add_run(run_first, at - 1, run_roles);
+        }
+        run_roles = roles;
+        run_first = at;
+    }
+    if (run_roles)
+    {
+        add_run(run_first, ~EventId(0), run_roles);
+    }
+
+    // A registration is coalesced if all its events are in blocks. The
+    // blocks are sorted and disjoint.
+    unsigned num_coalesced = 0;
+    for (Member &m : *members)
+    {
+        m.coalesced = false;
+        if (!(m.entry.flags &
+                (EventRegistryEntry::PRODUCER | EventRegistryEntry::CONSUMER)))
+        {
+            continue;
+        }
+        auto it = std::upper_bound(blocks->begin(), blocks->end(),
+            m.entry.event, [](EventId e, const Block &b) {
+                return e < b.first;
+            });
+        if (it == blocks->begin())
+        {
+            continue;
+        }
+        --it;
+        EventId covered = it->first - 1;
+        for (; it != blocks->end() && it->first == covered + 1; ++it)
+        {
+            covered = it->first + ((EventId(1) << it->bits) - 1);
+            if (covered >= m.last)
+            {
+                m.coalesced = true;
+                ++num_coalesced;
+                break;
+            }
+        }
+    }
+    return num_coalesced;
+}
+
+void EventRangeCoalescer::forward(const EventRegistryEntry &registry_entry,
+    EventHandlerFunction fn, EventReport *event, BarrierNotifiable *done)
+{
+    // The matches are copied out, because members_ may change after we
+    // release the lock.
+    EventRegistryEntry single(nullptr, 0);
+    size_t count;
+    {
+        AtomicHolder h(this);
+        count = find_matches(registry_entry, event, &single, 1);
+    }
+    if (count <= 1)
+    {
+        if (count)
+        {
+            (single.handler->*fn)(single, event, done);
+        }
+        else
+        {
+            done->notify();
+        }
+        return;
+    }
+    Forwarder *f = alloc_forwarder();
+    while (true)
+    {
+        if (f->entries_.size() < count)
+        {
+            // Grows the buffer outside of the lock.
+            f->entries_.resize(count, single);
+        }
+        AtomicHolder h(this);
+        count = find_matches(
+            registry_entry, event, f->entries_.data(), f->entries_.size());
+        if (count <= f->entries_.size())
+        {
+            f->start(fn, event, done, count);
+            break;
+        }
+    }
+    f->notify();
+}
+
+size_t EventRangeCoalescer::find_matches(
+    const EventRegistryEntry &registry_entry, EventReport *event,
+    EventRegistryEntry *out, size_t capacity)
+{
+    // The part of the incoming message that falls into this range.
+    unsigned bits = registry_entry.user_arg & ((1u << ROLE_SHIFT) - 1);
+    EventId block_last =
+        registry_entry.event + ((EventId(1) << bits) - 1);
+    EventId first = std::max(event->event, registry_entry.event);
+    EventId last = event->event + event->mask;
+    if (last < event->event)
+    {
+        last = ~EventId(0);
+    }
+    last = std::min(last, block_last);
+
+    // A registration matches if it is the first one to overlap with the
+    // message in this block, so that it is called only once when the message
+    // covers several blocks.
+    size_t count = 0;
+    EventId from = first - std::min(first, maxSpan_);
+    auto it = std::lower_bound(members_.begin(), members_.end(), from,
+        [](const Member &m, EventId e) { return m.entry.event < e; });
+    for (; it != members_.end() && it->entry.event <= last; ++it)
+    {
+        if (!it->coalesced || it->last < first)
+        {
+            continue;
+        }
+        if (std::max(it->entry.event, event->event) < registry_entry.event)
+        {
+            continue;
+        }
+        if (count < capacity)
+        {
+            out[count] = it->entry;
+        }
+        ++count;
+    }
+    return count;
+}
+
+EventRangeCoalescer::Forwarder *EventRangeCoalescer::alloc_forwarder()
+{
+    {
+        AtomicHolder h(this);
+        if (freeForwarders_)
+        {
+            Forwarder *f = freeForwarders_;
+            freeForwarders_ = f->nextFree_;
+            return f;
+        }
+    }
+    // One per message being forwarded at the same time.
+    return new Forwarder(this);
+}
+
+void EventRangeCoalescer::free_forwarder(Forwarder *f)
+{
+    AtomicHolder h(this);
+    f->nextFree_ = freeForwarders_;
+    freeForwarders_ = f;
+}
+
+void EventRangeCoalescer::handle_identify_global(
+    const EventRegistryEntry &registry_entry, EventReport *event,
+    BarrierNotifiable *done)
+{
+    if (event->dst_node && event->dst_node != node_)
+    {
+        return done->notify();
+    }
+    unsigned bits = registry_entry.user_arg & ((1u << ROLE_SHIFT) - 1);
+    unsigned roles = registry_entry.user_arg >> ROLE_SHIFT;
+    uint64_t range = EncodeRange(registry_entry.event, 1u << bits);
+    if (roles & EventRegistryEntry::PRODUCER)
+    {
+        event->event_write_helper<1>()->WriteAsync(node_,
+            Defs::MTI_PRODUCER_IDENTIFIED_RANGE, WriteHelper::global(),
+            eventid_to_buffer(range), done->new_child());
+    }
+    if (roles & EventRegistryEntry::CONSUMER)
+    {
+        event->event_write_helper<2>()->WriteAsync(node_,
+            Defs::MTI_CONSUMER_IDENTIFIED_RANGE, WriteHelper::global(),
+            eventid_to_buffer(range), done->new_child());
+    }
+    done->maybe_done();
+}
+
+#define FORWARDFN(FN)                                                          \
+    void EventRangeCoalescer::FN(const EventRegistryEntry &registry_entry,     \
+        EventReport *event, BarrierNotifiable *done)                           \
+    {                                                                          \
+        forward(registry_entry, &EventHandler::FN, event, done);               \
+    }
+
+FORWARDFN(handle_event_report);
+FORWARDFN(handle_consumer_identified);
+FORWARDFN(handle_consumer_range_identified);
+FORWARDFN(handle_producer_identified);
+FORWARDFN(handle_producer_range_identified);
+FORWARDFN(handle_identify_consumer);
+FORWARDFN(handle_identify_producer);
+
+#undef FORWARDFN
+
+} // namespace openlcb
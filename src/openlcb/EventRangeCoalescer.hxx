@@ -0,0 +1,265 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file EventRangeCoalescer.hxx
+ *
+ * Merges the single-event registrations of a node into event ranges.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#ifndef _OPENLCB_EVENTRANGECOALESCER_HXX_
+#define _OPENLCB_EVENTRANGECOALESCER_HXX_
+
+#include <vector>
+
+#include "executor/Executable.hxx"
+#include "openlcb/EventHandler.hxx"
+#include "os/OS.hxx"
+#include "utils/Atomic.hxx"
+#include "utils/LinkedObject.hxx"
+
+namespace openlcb
+{
+
+class Node;
+
+/// Sits between the event handlers of one node and the event registry, and
+/// merges contiguous event IDs into ranges.
+///
+/// The handlers register with the coalescer instead of the registry, and mark
+/// their registrations with the EventRegistryEntry::PRODUCER and CONSUMER
+/// flags. The coalescer finds the aligned power-of-two blocks of event IDs
+/// that have the same roles, and registers each block of at least min_events
+/// events as one range entry in the registry. It answers Identify Events for
+/// such a block with one Producer and/or Consumer Identified Range message,
+/// and forwards every other call for the block to the handlers whose events
+/// it covers. Registrations outside of the blocks go to the registry
+/// unchanged.
+///
+/// The range messages do not carry the state of the events. Nodes that want
+/// to know it can still send Identify Producer / Identify Consumer for the
+/// single events; these are answered by the handlers.
+///
+/// BitEventHandler (and therefore BitEventProducer, BitEventConsumer,
+/// BitEventPC, ConfiguredConsumer and ConfiguredProducer) registers through
+/// the coalescer of its node if there is one. The coalescer has to be created
+/// before the event handlers of the node.
+///
+/// The blocks are recomputed on the executor of the node's interface after
+/// the registrations change. Until then the new registrations go to the
+/// registry directly. The computation and the registry updates run without
+/// the atomic lock, which only guards swapping in the result.
+class EventRangeCoalescer : public EventHandler,
+                            private Executable,
+                            private Atomic,
+                            public LinkedObject<EventRangeCoalescer>
+{
+public:
+    /// Constructor.
+    /// @param node is the node whose event handlers will register here.
+    /// @param min_events is the size of the smallest block that will be
+    /// registered and advertised as a range. Must be at least 2.
+    EventRangeCoalescer(Node *node, unsigned min_events = 4);
+
+    ~EventRangeCoalescer();
+
+    /// @param node is a virtual node. @return the coalescer of that node, or
+    /// nullptr if it does not have one.
+    static EventRangeCoalescer *find(Node *node);
+
+    /// Registers an event handler with the coalescer of a node, or with the
+    /// event registry if the node has no coalescer.
+    /// @param node is the node owning the handler.
+    /// @param entry is the registration.
+    /// @param mask is the number of low bits of entry.event that are covered
+    /// by the registration, as in EventRegistry::register_handler.
+    static void register_for_node(
+        Node *node, const EventRegistryEntry &entry, unsigned mask);
+
+    /// Removes all registrations of an event handler made by
+    /// register_for_node. @param node is the node owning the handler.
+    /// @param handler is the event handler to remove.
+    static void unregister_for_node(Node *node, EventHandler *handler);
+
+    /// Adds a registration. Same arguments as
+    /// EventRegistry::register_handler. Registrations without the PRODUCER
+    /// or CONSUMER flag are never coalesced.
+    void register_handler(const EventRegistryEntry &entry, unsigned mask);
+
+    /// Removes all registrations of a given event handler.
+    void unregister_handler(EventHandler *handler);
+
+    /// @return the number of ranges currently registered in the registry.
+    unsigned num_ranges()
+    {
+        AtomicHolder h(this);
+        return numRanges_;
+    }
+
+    /// @return the number of registrations currently covered by ranges.
+    unsigned num_coalesced()
+    {
+        AtomicHolder h(this);
+        return numCoalesced_;
+    }
+
+    void handle_event_report(const EventRegistryEntry &registry_entry,
+        EventReport *event, BarrierNotifiable *done) override;
+    void handle_consumer_identified(const EventRegistryEntry &registry_entry,
+        EventReport *event, BarrierNotifiable *done) override;
+    void handle_consumer_range_identified(
+        const EventRegistryEntry &registry_entry, EventReport *event,
+        BarrierNotifiable *done) override;
+    void handle_producer_identified(const EventRegistryEntry &registry_entry,
+        EventReport *event, BarrierNotifiable *done) override;
+    void handle_producer_range_identified(
+        const EventRegistryEntry &registry_entry, EventReport *event,
+        BarrierNotifiable *done) override;
+    void handle_identify_global(const EventRegistryEntry &registry_entry,
+        EventReport *event, BarrierNotifiable *done) override;
+    void handle_identify_consumer(const EventRegistryEntry &registry_entry,
+        EventReport *event, BarrierNotifiable *done) override;
+    void handle_identify_producer(const EventRegistryEntry &registry_entry,
+        EventReport *event, BarrierNotifiable *done) override;
+
+private:
+    class Forwarder;
+
+    /// One registration made with the coalescer.
+    struct Member
+    {
+        Member(const EventRegistryEntry &e, unsigned m)
+            : entry(e)
+            , last(m >= 64 ? ~EventId(0) : e.event | ((EventId(1) << m) - 1))
+            , mask(m)
+        {
+        }
+
+        /// The registration as the handler made it.
+        EventRegistryEntry entry;
+        /// Last event ID of the registration.
+        EventId last;
+        /// Mask argument of the registration.
+        uint8_t mask;
+        /// True if the registration is covered by ranges; false if it is
+        /// registered in the registry directly.
+        bool coalesced {false};
+    };
+
+    /// An aligned power-of-two block of event IDs registered as one range.
+    struct Block
+    {
+        /// First event ID of the block.
+        EventId first;
+        /// The block has 2^bits events.
+        unsigned bits;
+        /// EventRegistryEntry::PRODUCER and/or CONSUMER.
+        unsigned roles;
+    };
+
+    /// Recomputes the ranges and updates the registry. Called on the
+    /// executor.
+    void run() override;
+
+    /// Computes the ranges of a set of registrations. Does not touch the
+    /// state of the coalescer.
+    /// @param members are the registrations. They get sorted, and their
+    /// coalesced field is set if the blocks cover them.
+    /// @param blocks is where the blocks are appended.
+    /// @return the number of covered registrations.
+    unsigned compute_blocks(
+        std::vector<Member> *members, std::vector<Block> *blocks);
+
+    /// Makes sure run will be called on the executor. Must be called with
+    /// updateLock_ held.
+    void schedule_rebuild();
+
+    /// Calls a function of the coalesced handlers matching an incoming
+    /// message.
+    /// @param registry_entry is the range entry the registry called us for.
+    /// @param fn is the function to call.
+    /// @param event is the incoming message.
+    /// @param done is to be notified when all handlers are done.
+    void forward(const EventRegistryEntry &registry_entry,
+        EventHandlerFunction fn, EventReport *event, BarrierNotifiable *done);
+
+    /// Finds the coalesced registrations matching an incoming message. Must
+    /// be called with the lock held. Does not allocate memory.
+    /// @param registry_entry is the range entry the registry called us for.
+    /// @param event is the incoming message.
+    /// @param out is where the matching registrations are written.
+    /// @param capacity is how many registrations fit into out.
+    /// @return the number of matching registrations; if more than capacity,
+    /// only the first capacity ones were written.
+    size_t find_matches(const EventRegistryEntry &registry_entry,
+        EventReport *event, EventRegistryEntry *out, size_t capacity);
+
+    /// @return a Forwarder that is not in use, taken from the free list or
+    /// newly allocated.
+    Forwarder *alloc_forwarder();
+
+    /// Puts a Forwarder that finished back on the free list. @param f is the
+    /// forwarder.
+    void free_forwarder(Forwarder *f);
+
+    /// The user_arg of a range entry in the registry is the number of mask
+    /// bits, plus the roles shifted by this much.
+    static constexpr unsigned ROLE_SHIFT = 8;
+
+    /// Node owning the event handlers.
+    Node *node_;
+    /// Smallest block to make into a range.
+    unsigned minEvents_;
+    /// Serializes the changes of the registrations and the registry updates
+    /// that follow them. Guards pending_ and rebuildPending_, and the writes
+    /// of members_.
+    OSMutex updateLock_;
+    /// Registrations, sorted by event ID. Written with both updateLock_ and
+    /// the atomic lock held; forward() reads it with the atomic lock only.
+    std::vector<Member> members_;
+    /// Registrations not yet added to members_. They are registered in the
+    /// registry directly.
+    std::vector<Member> pending_;
+    /// Largest (last - event) in members_.
+    EventId maxSpan_ {0};
+    /// Number of range entries we have in the registry.
+    unsigned numRanges_ {0};
+    /// Number of coalesced registrations in members_.
+    unsigned numCoalesced_ {0};
+    /// Incremented every time a handler is removed. Stops calls that are in
+    /// progress.
+    unsigned epoch_ {0};
+    /// Forwarders that finished and can be reused.
+    Forwarder *freeForwarders_ {nullptr};
+    /// True if we are on the executor queue waiting for run().
+    bool rebuildPending_ {false};
+};
+
+} // namespace openlcb
+
+#endif // _OPENLCB_EVENTRANGECOALESCER_HXX_
@@ -13,6 +13,7 @@
 #include "openlcb/EventHandlerContainer.hxx"
 #include "openlcb/Defs.hxx"
 #include "openlcb/EndianHelper.hxx"
+#include "nmranet_config.h"
 
 namespace openlcb
 {
@@ -54,12 +55,25 @@ void EventService::register_interface(If *iface)
         EventService::Impl::MTI_MASK_ADDRESSED_ALL));
 }
 
-EventService::Impl::Impl(EventService *service) : callerFlow_(service)
+void EventService::set_identify_pacing(
+    unsigned max_messages, unsigned interval_msec)
 {
-#ifdef TARGET_LPC11Cxx
+    impl()->identifyMaxMessages_ = max_messages;
+    impl()->identifyIntervalNsec_ = MSEC_TO_NSEC(interval_msec);
+}
+
+EventService::Impl::Impl(EventService *service)
+    : callerFlow_(service)
+    , identifyMaxMessages_(config_event_identify_max_messages())
+    , identifyIntervalNsec_(MSEC_TO_NSEC(config_event_identify_interval_msec()))
+{
+#if defined(TARGET_LPC11Cxx)
     registry.reset(new VectorEventHandlers());
-#else
+#elif defined(OPENMRN_TREE_EVENT_REGISTRY) || defined(__FreeRTOS__)
+    // The flat registry takes twice the RAM per registration.
     registry.reset(new TreeEventHandlers());
+#else
+    registry.reset(new FlatEventHandlers());
 #endif
 }
 
@@ -67,6 +81,45 @@ EventService::Impl::~Impl()
 {
 }
 
+long long EventService::Impl::identify_pacing_delay(Node *node, unsigned sent)
+{
+    if (!identifyMaxMessages_ || !sent)
+    {
+        return 0;
+    }
+    long long now = os_get_time_monotonic();
+    auto it = identifyBudgets_.find(node);
+    if (it == identifyBudgets_.end())
+    {
+        // Drops the nodes whose period is over, so that nodes that went away
+        // do not pile up.
+        for (auto jt = identifyBudgets_.begin(); jt != identifyBudgets_.end();)
+        {
+            if (now - jt->second.periodStart >= identifyIntervalNsec_)
+            {
+                jt = identifyBudgets_.erase(jt);
+            }
+            else
+            {
+                ++jt;
+            }
+        }
+        it = identifyBudgets_.insert({node, {now, 0}}).first;
+    }
+    IdentifyBudget *b = &it->second;
+    if (now - b->periodStart >= identifyIntervalNsec_)
+    {
+        b->periodStart = now;
+        b->count = 0;
+    }
+    b->count += sent;
+    if (b->count < identifyMaxMessages_)
+    {
+        return 0;
+    }
+    return b->periodStart + identifyIntervalNsec_ - now;
+}
+
 StateFlowBase::Action EventCallerFlow::entry()
 {
     EventHandlerCall *c = message()->data();
@@ -232,47 +285,121 @@ StateFlowBase::Action EventIteratorFlow::entry()
 
     eventRegistryEpoch_ = eventService_->impl()->registry->get_epoch();
     iterator_->init_iteration(rep);
+    reset_sent_messages();
     return yield_and_call(STATE(iterate_next));
 }
 
 StateFlowBase::Action EventIteratorFlow::iterate_next()
 {
-    if (eventRegistryEpoch_ != eventService_->impl()->registry->get_epoch())
+    for (int i = 0; i < config_event_sync_handler_batch(); ++i)
     {
-        // Iterators are invalidated. We need to start over. This may cause
-        // duplicate delivery of the same events.
-        iterator_->clear_iteration();
-        eventRegistryEpoch_ = eventService_->impl()->registry->get_epoch();
-        iterator_->init_iteration(&eventReport_);
-    }
-
-    EventRegistryEntry *entry = iterator_->next_entry();
-    if (!entry)
-    {
-        if (incomingDone_)
+        if (eventRegistryEpoch_ !=
+            eventService_->impl()->registry->get_epoch())
+        {
+            // Iterators are invalidated. We need to start over. This may
+            // cause duplicate delivery of the same events.
+            iterator_->clear_iteration();
+            eventRegistryEpoch_ = eventService_->impl()->registry->get_epoch();
+            iterator_->init_iteration(&eventReport_);
+        }
+        if (fn_ == &EventHandler::handle_identify_global)
         {
-            incomingDone_->notify();
-            incomingDone_ = nullptr;
+            // Paces the responses. The iterator keeps our place in the
+            // registry, and no buffers are held while sleeping.
+            long long delay = pace_sent_messages();
+            if (delay)
+            {
+                return sleep_and_call(&timer_, delay, STATE(iterate_next));
+            }
         }
 
-#ifdef DEBUG_EVENT_PERFORMANCE
-        long long len = os_get_time_monotonic() - currentProcessStart_;
-        numProcessNsec_ += len;
-        countEvents_++;
-        if (countEvents_ >= REPORT_COUNT)
+        EventRegistryEntry *entry = iterator_->next_entry();
+        if (!entry)
+        {
+            return iteration_done();
+        }
+        if (!(entry->flags & EventRegistryEntry::SYNCHRONOUS))
         {
-            //long msec = numProcessNsec_ / 1000000;
-            //printf("event perf for mti %04x: %ld msec for %d events\n",
-            //       mtiValue_, msec, REPORT_COUNT);
-            countEvents_ = 0;
-            numProcessNsec_ = 0;
+            return dispatch_event(entry);
         }
+        if (!call_inline(entry))
+        {
+            return wait_and_call(STATE(iterate_next));
+        }
+    }
+    // Lets the other flows on the executor run before we continue with the
+    // synchronous handlers.
+    return yield_and_call(STATE(iterate_next));
+}
+
+StateFlowBase::Action EventIteratorFlow::iteration_done()
+{
+    if (fn_ == &EventHandler::handle_identify_global)
+    {
+        // Accounts for the responses of the last handler.
+        pace_sent_messages();
+    }
+    if (incomingDone_)
+    {
+        incomingDone_->notify();
+        incomingDone_ = nullptr;
+    }
+
+#ifdef DEBUG_EVENT_PERFORMANCE
+    long long len = os_get_time_monotonic() - currentProcessStart_;
+    numProcessNsec_ += len;
+    countEvents_++;
+    if (countEvents_ >= REPORT_COUNT)
+    {
+        //long msec = numProcessNsec_ / 1000000;
+        //printf("event perf for mti %04x: %ld msec for %d events\n",
+        //       mtiValue_, msec, REPORT_COUNT);
+        countEvents_ = 0;
+        numProcessNsec_ = 0;
+    }
 
 #endif
 
-        return exit();
+    return exit();
+}
+
+void EventIteratorFlow::reset_sent_messages()
+{
+    for (unsigned i = 0; i < ARRAYSIZE(lastSendCount_); ++i)
+    {
+        lastSendCount_[i] = eventReport_.write_helpers[i].send_count();
     }
-    return dispatch_event(entry);
+}
+
+long long EventIteratorFlow::pace_sent_messages()
+{
+    long long delay = 0;
+    for (unsigned i = 0; i < ARRAYSIZE(lastSendCount_); ++i)
+    {
+        WriteHelper *h = &eventReport_.write_helpers[i];
+        unsigned sent = h->send_count() - lastSendCount_[i];
+        lastSendCount_[i] = h->send_count();
+        // Each helper was used by one handler call at most, so all its
+        // messages came from the same node.
+        delay = std::max(delay,
+            eventService_->impl()->identify_pacing_delay(h->node(), sent));
+    }
+    return delay;
+}
+
+bool EventIteratorFlow::call_inline(const EventRegistryEntry *entry)
+{
+    n_.reset(this);
+    // It is required to hold on to a child to call abort_if_almost_done.
+    auto *c = n_.new_child();
+    (entry->handler->*(fn_))(*entry, &eventReport_, &n_);
+    if (n_.abort_if_almost_done())
+    {
+        // Event handler did not do any asynchronous action.
+        return true;
+    }
+    c->notify();
+    return false;
 }
 
 StateFlowBase::Action EventIteratorFlow::dispatch_event(const EventRegistryEntry *entry)
@@ -298,20 +425,11 @@ InlineEventIteratorFlow::dispatch_event(const EventRegistryEntry *entry)
         // Will restart iteration.
         return call_immediately(STATE(iterate_next));
     }
-    n_.reset(this);
-    // It is required to hold on to a child to call abort_if_almost_done.
-    auto *c = n_.new_child();
-    (currentEntry_->handler->*(fn_))(*currentEntry_, &eventReport_, &n_);
-    if (n_.abort_if_almost_done())
+    if (call_inline(currentEntry_))
     {
-        // Aborted. Event handler did not do any asynchronous action.
         return call_immediately(STATE(iterate_next));
     }
-    else
-    {
-        c->notify();
-        return wait_and_call(STATE(iterate_next));
-    }
+    return wait_and_call(STATE(iterate_next));
 }
 
 } /* namespace openlcb */
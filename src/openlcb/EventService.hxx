@@ -88,6 +88,14 @@ public:
      * handled. */
     bool event_processing_pending();
 
+    /** Sets how fast the responses to Identify Events messages may be sent
+     * out. The defaults come from event_identify_max_messages and
+     * event_identify_interval_msec.
+     * @param max_messages is the number of messages each local node may send
+     * in one period. 0 turns off the limit.
+     * @param interval_msec is the length of the period in milliseconds. */
+    void set_identify_pacing(unsigned max_messages, unsigned interval_msec);
+
     static EventService *instance;
 
 private:
@@ -37,6 +37,7 @@
 #ifndef _OPENLCB_EVENTSERVICEIMPL_HXX_
 #define _OPENLCB_EVENTSERVICEIMPL_HXX_
 
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -107,6 +108,30 @@ public:
     /// calls need to be sent to this flow.
     EventCallerFlow callerFlow_;
 
+    /// Accounts for messages sent by a node in response to Identify Events.
+    /// Shared by the identify flows of all interfaces.
+    /// @param node is the node that sent the messages.
+    /// @param sent is how many messages it sent since the last call.
+    /// @return 0 if the node may send more messages now, otherwise the number
+    /// of nanoseconds until its next period starts.
+    long long identify_pacing_delay(Node *node, unsigned sent);
+
+    /// Pacing state of the identify responses of one node.
+    struct IdentifyBudget
+    {
+        /// When the current pacing period started.
+        long long periodStart;
+        /// Messages sent in the current pacing period.
+        unsigned count;
+    };
+
+    /// Messages allowed per node in one pacing period; 0 for unlimited.
+    unsigned identifyMaxMessages_;
+    /// Length of the pacing period.
+    long long identifyIntervalNsec_;
+    /// Pacing state of the nodes that sent identify responses recently.
+    std::map<Node *, IdentifyBudget> identifyBudgets_;
+
     enum
     {
         // These address/mask should match all the messages carrying an event
@@ -134,8 +159,28 @@ public:
 protected:
     Action entry() OVERRIDE;
     Action iterate_next();
+    /// Finishes processing the current message.
+    Action iteration_done();
+
+    /// Forgets about the messages sent by the event handlers through
+    /// eventReport_ so far.
+    void reset_sent_messages();
+
+    /// Accounts for the messages sent by the event handlers through
+    /// eventReport_ since the last call against the identify pacing budget of
+    /// the sending nodes. @return 0 if the iteration may continue now,
+    /// otherwise the number of nanoseconds to wait.
+    long long pace_sent_messages();
+
+    /// Calls the current function of an event handler directly from this
+    /// flow. @param entry is the handler to call. @return true if the handler
+    /// finished before returning; false if it is still running, and this flow
+    /// will be notified when it is done.
+    bool call_inline(const EventRegistryEntry *entry);
 
 private:
+    /// Calls an event handler that does not have the SYNCHRONOUS flag.
+    /// @param entry is the handler to call.
     virtual Action dispatch_event(const EventRegistryEntry *entry);
 
 protected:
@@ -158,6 +203,12 @@ protected:
     BarrierNotifiable n_;
     EventHandlerFunction fn_;
 
+    /// Send counts of the eventReport_ write helpers at the last
+    /// pace_sent_messages() call.
+    unsigned lastSendCount_[4] {0, 0, 0, 0};
+    /// Waits for the next pacing period of the identify responses.
+    StateFlowTimer timer_ {this};
+
 #ifdef DEBUG_EVENT_PERFORMANCE
     static const int REPORT_COUNT = 100;
     /// How many events' cost are accumulated so far.
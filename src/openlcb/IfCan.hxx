@@ -267,7 +267,7 @@ private:
         ReplyHandler(NodeIdLookupFlow *parent)
             : parent_(parent)
         {
-            parent_->iface()->dispatcher()->register_handler(
+            parent_->iface()->dispatcher()->register_shared_handler(
                 this, Defs::MTI_VERIFIED_NODE_ID_NUMBER, Defs::MTI_EXACT);
         }
 
@@ -58,9 +58,9 @@ void NodeBrowser::refresh()
 
 void NodeBrowser::register_callbacks()
 {
-    node_->iface()->dispatcher()->register_handler(
+    node_->iface()->dispatcher()->register_shared_handler(
         &handler_, Defs::MTI_VERIFIED_NODE_ID_NUMBER, Defs::MTI_EXACT);
-    node_->iface()->dispatcher()->register_handler(
+    node_->iface()->dispatcher()->register_shared_handler(
         &handler_, Defs::MTI_INITIALIZATION_COMPLETE, Defs::MTI_EXACT);
 }
 
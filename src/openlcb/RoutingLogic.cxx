@@ -35,6 +35,12 @@
 
 #include "openlcb/RoutingLogic.hxx"
 
+#include <algorithm>
+
+#ifndef __FreeRTOS__
+#include <sched.h>
+#endif
+
 namespace openlcb {
 
 /** Decodes an event range, encoded according to the Event Transport protocol
@@ -60,4 +66,107 @@ uint8_t event_range_to_bit_count(EventId* event) {
     return ret;
 }
 
+constexpr unsigned EventIntervalSet::BLOCK_BITS;
+constexpr unsigned EventIntervalSet::MAX_BLOCKS_PER_INTERVAL;
+
+EventIntervalSet::EventIntervalSet(std::vector<Interval> intervals)
+    : intervals_(std::move(intervals))
+{
+    build();
+}
+
+EventIntervalSet *EventIntervalSet::copy_with(Interval iv) const
+{
+    std::vector<Interval> v;
+    v.reserve(intervals_.size() + 1);
+    v = intervals_;
+    v.push_back(iv);
+    return new EventIntervalSet(std::move(v));
+}
+
+bool EventIntervalSet::covers(Interval iv) const
+{
+    // The first interval that starts after iv.lo.
+    auto it = std::upper_bound(intervals_.begin(), intervals_.end(), iv.lo,
+        [](EventId e, const Interval &i) { return e < i.lo; });
+    if (it == intervals_.begin())
+    {
+        return false;
+    }
+    --it;
+    // Since the intervals are merged, iv has to fit into a single one.
+    return iv.hi <= it->hi;
+}
+
+bool EventIntervalSet::find(EventId event) const
+{
+    return covers(Interval {event, event});
+}
+
+void EventIntervalSet::build()
+{
+    std::sort(intervals_.begin(), intervals_.end(),
+        [](const Interval &a, const Interval &b) { return a.lo < b.lo; });
+    // Merges overlapping and adjacent intervals.
+    unsigned out = 0;
+    for (unsigned i = 0; i < intervals_.size(); ++i)
+    {
+        if (out && (intervals_[i].lo <= intervals_[out - 1].hi ||
+                       intervals_[i].lo - 1 == intervals_[out - 1].hi))
+        {
+            intervals_[out - 1].hi =
+                std::max(intervals_[out - 1].hi, intervals_[i].hi);
+        }
+        else
+        {
+            intervals_[out++] = intervals_[i];
+        }
+    }
+    intervals_.resize(out);
+    intervals_.shrink_to_fit();
+
+    // Sizes the bloom filter to eight bits per block touched.
+    uint64_t blocks = 0;
+    for (const Interval &iv : intervals_)
+    {
+        uint64_t n = (iv.hi >> BLOCK_BITS) - (iv.lo >> BLOCK_BITS) + 1;
+        if (n > MAX_BLOCKS_PER_INTERVAL)
+        {
+            // Such a wide interval would fill the filter; the range check
+            // and binary search are good enough then.
+            return;
+        }
+        blocks += n;
+    }
+    unsigned bits = 9;
+    while (bits < 16 && (UINT64_C(1) << bits) < 8 * blocks)
+    {
+        ++bits;
+    }
+    bloomShift_ = 64 - bits;
+    bloom_.assign((1u << bits) / 64, 0);
+    for (const Interval &iv : intervals_)
+    {
+        for (uint64_t b = iv.lo >> BLOCK_BITS; b <= (iv.hi >> BLOCK_BITS); ++b)
+        {
+            unsigned bit = bloom_bit(b);
+            bloom_[bit / 64] |= UINT64_C(1) << (bit % 64);
+        }
+    }
+}
+
+void RoutingEpoch::synchronize()
+{
+    // Readers arriving from now on use the other counter.
+    unsigned phase = epoch_.fetch_add(1) & 1;
+    while (active_[phase].load())
+    {
+#ifdef __FreeRTOS__
+        usleep(1000);
+#else
+        sched_yield();
+#endif
+    }
+}
+
 } // namespace openlcb
@@ -36,9 +36,9 @@
 #ifndef _OPENLCB_ROUTNGLOGIC_HXX_
 #define _OPENLCB_ROUTNGLOGIC_HXX_
 
-#include <set>
-#include <map>
-#include <unordered_map>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 #include "os/OS.hxx"
 #include "openlcb/EventHandler.hxx"
@@ -57,19 +57,184 @@ namespace openlcb
  */
 uint8_t event_range_to_bit_count(EventId *event);
 
+/** Tracks readers of lock-free data structures, so that a writer can find out
+ * when memory it has unlinked is not used anymore.
+ *
+ * Readers wrap their accesses into a ReadLock, which costs two atomic
+ * increments and never waits. A writer first publishes the new version of the
+ * data, then calls synchronize(), which waits until every read section that
+ * might still see the old version has ended. Writers must be serialized by
+ * the caller.
+ */
+class RoutingEpoch
+{
+public:
+    RoutingEpoch()
+    {
+        active_[0] = 0;
+        active_[1] = 0;
+    }
+
+    /// Marks the scope of an object as a read section.
+    class ReadLock
+    {
+    public:
+        /// @param parent is the epoch of the data structure being read.
+        ReadLock(RoutingEpoch *parent)
+            : parent_(parent)
+        {
+            for (;;)
+            {
+                unsigned e = parent_->epoch_.load();
+                phase_ = e & 1;
+                parent_->active_[phase_].fetch_add(1);
+                // If a writer flipped the epoch in the meantime, it might not
+                // have seen our increment.
+                if (parent_->epoch_.load() == e)
+                {
+                    return;
+                }
+                parent_->active_[phase_].fetch_sub(1);
+            }
+        }
+
+        ~ReadLock()
+        {
+            parent_->active_[phase_].fetch_sub(1);
+        }
+
+    private:
+        /// Whose read section this is.
+        RoutingEpoch *parent_;
+        /// Which counter we incremented.
+        unsigned phase_;
+    };
+
+    /// Waits until all read sections that were started before this call
+    /// have ended. Must not be called from within a read section.
+    void synchronize();
+
+private:
+    /// Incremented by every synchronize() call. The lowest bit selects the
+    /// active_ counter that new readers increment.
+    std::atomic<unsigned> epoch_ {0};
+    /// Number of readers in the two phases.
+    std::atomic<unsigned> active_[2];
+};
+
+/** Set of event IDs stored as sorted, disjoint intervals, with a bloom filter
+ * in front of the binary search to quickly reject events that are in none of
+ * the intervals. Used by RoutingLogic for the event ranges of a port. Not
+ * modified once built, so it can be read by any number of threads.
+ */
+class EventIntervalSet
+{
+public:
+    /// A closed interval of event IDs.
+    struct Interval
+    {
+        /// First event of the interval.
+        EventId lo;
+        /// Last event of the interval.
+        EventId hi;
+    };
+
+    /// Builds the set. @param intervals in any order, may overlap.
+    explicit EventIntervalSet(std::vector<Interval> intervals);
+
+    /// @param iv an interval. @return a new set containing the intervals of
+    /// this set and iv.
+    EventIntervalSet *copy_with(Interval iv) const;
+
+    /// @param event an event ID. @return true if event is in the set.
+    bool contains(EventId event) const
+    {
+        if (intervals_.empty() || event < intervals_.front().lo ||
+            event > intervals_.back().hi)
+        {
+            return false;
+        }
+        if (!bloom_.empty())
+        {
+            unsigned b = bloom_bit(event >> BLOCK_BITS);
+            if (!((bloom_[b / 64] >> (b % 64)) & 1))
+            {
+                return false;
+            }
+        }
+        return find(event);
+    }
+
+    /// @param iv an interval. @return true if all events of iv are in the
+    /// set.
+    bool covers(Interval iv) const;
+
+    /// @return the merged intervals, in increasing order.
+    const std::vector<Interval> &intervals() const
+    {
+        return intervals_;
+    }
+
+private:
+    /// log2 of the number of events that share a bloom filter bit.
+    static constexpr unsigned BLOCK_BITS = 8;
+    /// Intervals spanning more blocks than this switch off the bloom filter.
+    static constexpr unsigned MAX_BLOCKS_PER_INTERVAL = 16;
+
+    /// Sorts and merges intervals_ and computes bloom_.
+    void build();
+
+    /// @param block an event ID shifted by BLOCK_BITS. @return which bit of
+    /// bloom_ represents it.
+    unsigned bloom_bit(uint64_t block) const
+    {
+        return (block * UINT64_C(0x9E3779B97F4A7C15)) >> bloomShift_;
+    }
+
+    /// Binary search. @param event an event ID. @return true if event is in
+    /// the set.
+    bool find(EventId event) const;
+
+    /// Sorted, disjoint and non-adjacent intervals.
+    std::vector<Interval> intervals_;
+    /// Bloom filter over the blocks touched by the intervals, or empty if the
+    /// intervals are too wide for one.
+    std::vector<uint64_t> bloom_;
+    /// 64 - log2 of the number of bits in bloom_.
+    unsigned bloomShift_ {64};
+};
+
 /** Routing table for gateways and routers in OpenLCB.
  *
  * The routing table contains which direction to send addressed packets as well
  * as filters for the event IDs that have listeners in a given port.
+ *
+ * All tables are flat open-addressing hash tables that are read without
+ * taking any lock, so any number of threads can route packets at the same
+ * time. Modifications are serialized by a mutex. Known entries are updated in
+ * place; when a table needs to grow or an entry has to be removed, a new copy
+ * is published and the old one is freed after the readers left it. Since the
+ * same addresses and events arrive over and over again, the update calls
+ * check with a lock-free lookup first whether there is anything to do.
  */
 template <class Port, typename Address> class RoutingLogic
 {
 public:
     RoutingLogic()
+        : addresses_(new AddressTable(INITIAL_ADDRESS_BITS))
+        , ports_(new PortTable(INITIAL_PORT_BITS))
     {
     }
+
     ~RoutingLogic()
     {
+        delete addresses_.load();
+        PortTable *t = ports_.load();
+        for (unsigned i = 0; i < t->size(); ++i)
+        {
+            delete t->entry(i)->value.load();
+        }
+        delete t;
     }
 
     /** Clears all entries in the routing table related to a given port, as the
@@ -80,19 +245,26 @@ public:
     void remove_port(Port *port)
     {
         OSMutexLock l(&lock_);
-        eventRoutingTable_.erase(port);
-        // Removing entries from a hashmap invalidates an iterator, thus it is
-        // safer to null them out than actually remove. Having a null value
-        // will cause address lookup to return null for a node that has not
-        // been seen since then elsewhere, which is exactly the behavior we
-        // want.
-        for (auto &it : addressRoutingTable_)
-        {
-            if (it.second == port)
+        // Nulling out the address entries instead of removing them will cause
+        // address lookup to return null for a node that has not been seen
+        // since then elsewhere, which is exactly the behavior we want.
+        AddressTable *at = addresses_.load(std::memory_order_relaxed);
+        for (unsigned i = 0; i < at->size(); ++i)
+        {
+            if (at->entry(i)->value.load(std::memory_order_relaxed) == port)
             {
-                it.second = nullptr;
+                at->entry(i)->value.store(nullptr, std::memory_order_relaxed);
             }
         }
+        PortTable *pt = ports_.load(std::memory_order_relaxed);
+        typename PortTable::Entry *e = pt->find(port_key(port));
+        if (!e)
+        {
+            return;
+        }
+        EventFilter *f = e->value.load(std::memory_order_relaxed);
+        publish(&ports_, pt->copy(pt->bits(), port_key(port)));
+        delete f;
     }
 
     /** Declares that a given node ID is reachable via a specific port. Used
@@ -104,8 +276,18 @@ public:
      */
     void add_node_id_to_route(Port *port, Address source)
     {
+        uint64_t key = address_key(source);
+        {
+            RoutingEpoch::ReadLock r(&epoch_);
+            typename AddressTable::Entry *e =
+                addresses_.load(std::memory_order_acquire)->find(key);
+            if (e && e->value.load(std::memory_order_relaxed) == port)
+            {
+                return;
+            }
+        }
         OSMutexLock l(&lock_);
-        addressRoutingTable_[source] = port;
+        put(&addresses_, key, port);
     }
 
     /** Looks up which port an addressed packet should be sent to.
@@ -117,11 +299,15 @@ public:
      */
     Port *lookup_port_for_address(Address dest)
     {
-        OSMutexLock l(&lock_);
-        auto it = addressRoutingTable_.find(dest);
-        if (it == addressRoutingTable_.end())
+        RoutingEpoch::ReadLock r(&epoch_);
+        typename AddressTable::Entry *e =
+            addresses_.load(std::memory_order_acquire)->find(
+                address_key(dest));
+        if (!e)
+        {
             return nullptr;
-        return it->second;
+        }
+        return e->value.load(std::memory_order_relaxed);
     }
 
     /** Declares that there is a consumer for the given event ID on the given
@@ -132,8 +318,22 @@ public:
      * that port. */
     void register_consumer(Port *port, EventId event)
     {
+        if (!event)
+        {
+            // Zero marks the empty slots of the hash table.
+            add_range(port, EventIntervalSet::Interval {0, 0});
+            return;
+        }
+        {
+            RoutingEpoch::ReadLock r(&epoch_);
+            EventFilter *f = find_filter(port);
+            if (f && f->events.load(std::memory_order_acquire)->find(event))
+            {
+                return;
+            }
+        }
         OSMutexLock l(&lock_);
-        eventRoutingTable_[port].registeredConsumers_[0].insert(event);
+        put(&get_filter_locked(port)->events, event, true);
     }
 
     /** Declares that there is a consumer for the given event ID range on the
@@ -144,10 +344,8 @@ public:
      * method. */
     void register_consumer_range(Port *port, EventId encoded_range)
     {
-        OSMutexLock l(&lock_);
         uint8_t bit_count = event_range_to_bit_count(&encoded_range);
-        eventRoutingTable_[port].registeredConsumers_[bit_count].insert(
-            encoded_range);
+        add_range(port, range_to_interval(bit_count, encoded_range));
     }
 
     /** Declares that there is a producer for the given event ID on the given
@@ -176,6 +374,63 @@ public:
         register_consumer_range(port, encoded_range);
     }
 
+    /** Replaces all event information of a port at once. Use when the
+     * complete list of consumers and producers of a port is known, for
+     * example after collecting the replies to an Identify Events message.
+     * This is much cheaper than registering a large number of ranges one by
+     * one.
+     *
+     * @param port is the port to set the events for.
+     * @param events are the individual event IDs.
+     * @param encoded_ranges are the event ranges, encoded via the OpenLCB
+     * method. */
+    void set_port_events(Port *port, const std::vector<EventId> &events,
+        const std::vector<EventId> &encoded_ranges)
+    {
+        std::vector<EventIntervalSet::Interval> intervals;
+        for (EventId r : encoded_ranges)
+        {
+            uint8_t bit_count = event_range_to_bit_count(&r);
+            intervals.push_back(range_to_interval(bit_count, r));
+        }
+        unsigned bits = INITIAL_EVENT_BITS;
+        while ((1u << bits) < 2 * events.size() + 2)
+        {
+            ++bits;
+        }
+        EventFilter *n = new EventFilter(bits);
+        EventSet *es = n->events.load(std::memory_order_relaxed);
+        for (EventId e : events)
+        {
+            if (e)
+            {
+                bool ok = es->put(e, true);
+                HASSERT(ok);
+            }
+            else
+            {
+                intervals.push_back(EventIntervalSet::Interval {0, 0});
+            }
+        }
+        if (!intervals.empty())
+        {
+            n->ranges.store(new EventIntervalSet(std::move(intervals)),
+                std::memory_order_relaxed);
+        }
+
+        OSMutexLock l(&lock_);
+        typename PortTable::Entry *e =
+            ports_.load(std::memory_order_relaxed)->find(port_key(port));
+        if (e)
+        {
+            publish(&e->value, n);
+        }
+        else
+        {
+            put(&ports_, port_key(port), n);
+        }
+    }
+
     /** Checks if a given PCER message should be forwarded to the given port.
      *
      * @param port is the port to query.
@@ -184,55 +439,303 @@ public:
      * @return true if the given event has a consumer on the given port. */
     bool check_pcer(Port *port, EventId event)
     {
-        OSMutexLock l(&lock_);
-        auto ip = eventRoutingTable_.find(port);
-        if (ip == eventRoutingTable_.end())
+        RoutingEpoch::ReadLock r(&epoch_);
+        EventFilter *f = find_filter(port);
+        if (!f)
         {
             return false;
         }
-        for (auto im = ip->second.registeredConsumers_.begin();
-             im != ip->second.registeredConsumers_.end(); ++im)
+        if (event && f->events.load(std::memory_order_acquire)->find(event))
+        {
+            return true;
+        }
+        EventIntervalSet *ranges = f->ranges.load(std::memory_order_acquire);
+        return ranges && ranges->contains(event);
+    }
+
+private:
+    /** Open-addressing hash table with linear probing, keyed by non-zero
+     * 64-bit integers. Lookups and value updates are safe while one writer
+     * inserts new keys; entries are never removed, instead the table is
+     * copied. */
+    template <typename V> class HashTable
+    {
+    public:
+        /// One slot of the table.
+        struct Entry
+        {
+            /// Zero if the slot is empty. Written last when filling a slot.
+            std::atomic<uint64_t> key;
+            /// Value belonging to the key.
+            std::atomic<V> value;
+        };
+
+        /// @param bits log2 of the number of slots.
+        explicit HashTable(unsigned bits)
+            : bits_(bits)
+            , entries_(new Entry[1u << bits]())
+        {
+        }
+
+        /// @return log2 of the number of slots.
+        unsigned bits() const
+        {
+            return bits_;
+        }
+
+        /// @return the number of slots.
+        unsigned size() const
+        {
+            return 1u << bits_;
+        }
+
+        /// @param i slot index, 0..size()-1. @return the slot.
+        Entry *entry(unsigned i) const
         {
-            if (im->first == 0)
+            return entries_.get() + i;
+        }
+
+        /// Looks up a key. @param key non-zero key. @return the entry
+        /// holding the key, or nullptr if the key is not in the table.
+        Entry *find(uint64_t key) const
+        {
+            for (unsigned i = slot(key);; i = (i + 1) & (size() - 1))
             {
-                if (im->second.find(event) != im->second.end())
-                    return true;
+                uint64_t k = entries_[i].key.load(std::memory_order_acquire);
+                if (k == key)
+                {
+                    return &entries_[i];
+                }
+                if (!k)
+                {
+                    return nullptr;
+                }
             }
-            else if (im->first == 64)
+        }
+
+        /// Inserts or updates a key. Writer only.
+        /// @param key non-zero key. @param value new value.
+        /// @return false if the key is new and the table is too full to take
+        /// it; true if the value is set.
+        bool put(uint64_t key, V value)
+        {
+            unsigned i = slot(key);
+            for (;; i = (i + 1) & (size() - 1))
             {
-                if (!im->second.empty())
+                uint64_t k = entries_[i].key.load(std::memory_order_relaxed);
+                if (k == key)
+                {
+                    entries_[i].value.store(value, std::memory_order_release);
                     return true;
+                }
+                if (!k)
+                {
+                    break;
+                }
             }
-            else
+            // Keeps the load factor at or below 1/2.
+            if (2 * (count_ + 1) > size())
             {
-                EventId masked_range =
-                    event & ~((UINT64_C(1) << im->first) - 1);
-                if (im->second.find(masked_range) != im->second.end())
-                    return true;
+                return false;
             }
+            entries_[i].value.store(value, std::memory_order_relaxed);
+            entries_[i].key.store(key, std::memory_order_release);
+            ++count_;
+            return true;
         }
-        return false;
-    }
 
-private:
-    /// Protects all internal data structures.
-    OSMutex lock_;
+        /// Creates a copy of this table. Writer only.
+        /// @param bits log2 of the number of slots of the copy.
+        /// @param skip_key if not zero, this key is left out.
+        /// @return newly allocated table.
+        HashTable *copy(unsigned bits, uint64_t skip_key = 0) const
+        {
+            HashTable *t = new HashTable(bits);
+            for (unsigned i = 0; i < size(); ++i)
+            {
+                uint64_t k = entries_[i].key.load(std::memory_order_relaxed);
+                if (k && k != skip_key)
+                {
+                    bool ok = t->put(
+                        k, entries_[i].value.load(std::memory_order_relaxed));
+                    HASSERT(ok);
+                }
+            }
+            return t;
+        }
 
-    /// Stores all known addresses and which port they route to.
-    std::unordered_map<Address, Port *> addressRoutingTable_;
+    private:
+        /// @param key a key. @return the first slot to probe for key.
+        unsigned slot(uint64_t key) const
+        {
+            // Fibonacci hashing.
+            return (key * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - bits_);
+        }
+
+        /// log2 of the number of slots.
+        unsigned bits_;
+        /// Number of keys in the table.
+        unsigned count_ {0};
+        /// The slots.
+        std::unique_ptr<Entry[]> entries_;
+    };
+
+    typedef HashTable<bool> EventSet;
 
     /// The per-port event information.
-    struct EventSet
+    struct EventFilter
     {
-        /// key: number of bits set in the mask part. Valid values:
-        /// 0..64. Value of 0 means individual event.
-        std::map<uint8_t, std::set<EventId>> registeredConsumers_;
+        /// @param event_bits log2 size of the event set.
+        EventFilter(unsigned event_bits = INITIAL_EVENT_BITS)
+            : events(new EventSet(event_bits))
+            , ranges(nullptr)
+        {
+        }
+
+        ~EventFilter()
+        {
+            delete events.load();
+            delete ranges.load();
+        }
+
+        /// Individual events registered.
+        std::atomic<EventSet *> events;
+        /// Event ranges registered, or nullptr if none. Replaced by a new
+        /// copy when a range is added.
+        std::atomic<EventIntervalSet *> ranges;
     };
 
+    typedef HashTable<Port *> AddressTable;
+    typedef HashTable<EventFilter *> PortTable;
+
+    /// Initial log2 size of the address table.
+    static constexpr unsigned INITIAL_ADDRESS_BITS = 6;
+    /// Initial log2 size of the port table.
+    static constexpr unsigned INITIAL_PORT_BITS = 3;
+    /// Initial log2 size of the event set of each port.
+    static constexpr unsigned INITIAL_EVENT_BITS = 3;
+
+    /// @param a an address. @return the key of the address in addresses_.
+    static uint64_t address_key(Address a)
+    {
+        return static_cast<uint64_t>(a) + 1;
+    }
+
+    /// @param p a port. @return the key of the port in ports_.
+    static uint64_t port_key(Port *p)
+    {
+        return reinterpret_cast<uintptr_t>(p);
+    }
+
+    /// Replaces a data structure and deletes the old version once no reader
+    /// uses it anymore. Must be called with lock_ held.
+    /// @param where pointer to the published version. @param n new version.
+    template <typename T> void publish(std::atomic<T *> *where, T *n)
+    {
+        T *old = where->load(std::memory_order_relaxed);
+        where->store(n);
+        epoch_.synchronize();
+        delete old;
+    }
+
+    /// Inserts or updates a key in a hash table, growing the table if
+    /// needed. Must be called with lock_ held.
+    /// @param where the published table. @param key non-zero key. @param
+    /// value new value.
+    template <typename V>
+    void put(std::atomic<HashTable<V> *> *where, uint64_t key, V value)
+    {
+        HashTable<V> *t = where->load(std::memory_order_relaxed);
+        if (t->put(key, value))
+        {
+            return;
+        }
+        HashTable<V> *n = t->copy(t->bits() + 1);
+        bool ok = n->put(key, value);
+        HASSERT(ok);
+        publish(where, n);
+    }
+
+    /// Looks up the event filter of a port. Must be called in a read
+    /// section. @param port the port. @return the filter or nullptr.
+    EventFilter *find_filter(Port *port)
+    {
+        typename PortTable::Entry *e =
+            ports_.load(std::memory_order_acquire)->find(port_key(port));
+        return e ? e->value.load(std::memory_order_acquire) : nullptr;
+    }
+
+    /// Looks up the event filter of a port, creating it if needed. Must be
+    /// called with lock_ held. @param port the port. @return the filter.
+    EventFilter *get_filter_locked(Port *port)
+    {
+        typename PortTable::Entry *e =
+            ports_.load(std::memory_order_relaxed)->find(port_key(port));
+        if (e)
+        {
+            return e->value.load(std::memory_order_relaxed);
+        }
+        EventFilter *f = new EventFilter;
+        put(&ports_, port_key(port), f);
+        return f;
+    }
+
+    /// @param bit_count number of mask bits, 1..64. @param base the first
+    /// event of the range. @return the events of the range.
+    static EventIntervalSet::Interval range_to_interval(
+        uint8_t bit_count, EventId base)
+    {
+        EventId mask =
+            bit_count >= 64 ? ~UINT64_C(0) : (UINT64_C(1) << bit_count) - 1;
+        return EventIntervalSet::Interval {base, base | mask};
+    }
+
+    /// Adds an event range to the filter of a port.
+    /// @param port the port. @param iv the events of the range.
+    void add_range(Port *port, EventIntervalSet::Interval iv)
+    {
+        {
+            RoutingEpoch::ReadLock r(&epoch_);
+            EventFilter *f = find_filter(port);
+            EventIntervalSet *ranges =
+                f ? f->ranges.load(std::memory_order_acquire) : nullptr;
+            if (ranges && ranges->covers(iv))
+            {
+                return;
+            }
+        }
+        OSMutexLock l(&lock_);
+        EventFilter *f = get_filter_locked(port);
+        EventIntervalSet *old = f->ranges.load(std::memory_order_relaxed);
+        if (!old)
+        {
+            publish(&f->ranges,
+                new EventIntervalSet(
+                    std::vector<EventIntervalSet::Interval>(1, iv)));
+        }
+        else if (!old->covers(iv))
+        {
+            publish(&f->ranges, old->copy_with(iv));
+        }
+    }
+
+    /// Serializes the writers.
+    OSMutex lock_;
+    /// Tracks the readers.
+    RoutingEpoch epoch_;
+    /// Stores all known addresses and which port they route to.
+    std::atomic<AddressTable *> addresses_;
     /// Stores per-port event information.
-    std::map<Port *, EventSet> eventRoutingTable_;
+    std::atomic<PortTable *> ports_;
 };
 
+template <class Port, typename Address>
+constexpr unsigned RoutingLogic<Port, Address>::INITIAL_ADDRESS_BITS;
+template <class Port, typename Address>
+constexpr unsigned RoutingLogic<Port, Address>::INITIAL_PORT_BITS;
+template <class Port, typename Address>
+constexpr unsigned RoutingLogic<Port, Address>::INITIAL_EVENT_BITS;
+
 } // namespace openlcb
 
 #endif // _OPENLCB_ROUTNGLOGIC_HXX_
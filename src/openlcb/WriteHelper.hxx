@@ -79,6 +79,20 @@ public:
         waitForLocalLoopback_ = (wait ? 1 : 0);
     }
 
+    /// @return how many messages were sent through this helper since it was
+    /// created. Wraps around.
+    unsigned send_count()
+    {
+        return sendCount_;
+    }
+
+    /// @return the node that sent the last message through this helper. Only
+    /// valid if send_count() is not zero.
+    Node *node()
+    {
+        return node_;
+    }
+
     /** Originates an NMRAnet message from a particular node.
      *
      * @param node is the originating node.
@@ -106,6 +120,7 @@ public:
             done_.notify();
             return;
         }
+        ++sendCount_;
         node_ = node;
         mti_ = mti;
         dst_ = dst;
@@ -163,6 +178,8 @@ private:
     }
 
     unsigned waitForLocalLoopback_ : 1;
+    /// Number of messages sent, for send_count().
+    unsigned sendCount_ {0};
     NodeHandle dst_;
     Defs::MTI mti_;
     Node *node_;
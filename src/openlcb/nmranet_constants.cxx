@@ -63,3 +63,17 @@ DEFAULT_CONST_FALSE(enable_all_memory_space);
  * identified messages at boot time. This is required by the OpenLCB
  * standard. */
 DEFAULT_CONST_TRUE(node_init_identify);
+
+/** Maximum number of event handlers registered with the SYNCHRONOUS flag that
+ * the event service calls one after the other, before yielding the executor
+ * to other work. */
+DEFAULT_CONST(event_sync_handler_batch, 32);
+
+/** Maximum number of messages each local node sends in response to an
+ * Identify Events message during one event_identify_interval_msec
+ * period. Responding handlers after that wait for the next period. 0 means no
+ * limit, which is the default. */
+DEFAULT_CONST(event_identify_max_messages, 0);
+
+/** Length of the period for event_identify_max_messages in milliseconds. */
+DEFAULT_CONST(event_identify_interval_msec, 10);
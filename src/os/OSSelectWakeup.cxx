@@ -32,6 +32,9 @@
 */
 
 #include "os/OSSelectWakeup.hxx"
+
+#include <atomic>
+
 #include "utils/logging.h"
 #if defined(__MACH__)
 #define _DARWIN_C_SOURCE // pselect
@@ -105,6 +108,51 @@ int OSSelectWakeup::select(int nfds, fd_set *readfds,
     return ret;
 }
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+int OSSelectWakeup::epoll_wait(int epfd, struct epoll_event *events,
+                               int maxevents, long long deadline_nsec)
+{
+    {
+        AtomicHolder l(this);
+        inSelect_ = true;
+        if (pendingWakeup_)
+        {
+            deadline_nsec = 0;
+        }
+    }
+    int ret = -1;
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 35)
+    /// Set to false when the kernel is too old to support epoll_pwait2. Read
+    /// and written by every executor thread.
+    static std::atomic<bool> have_pwait2 {true};
+    if (have_pwait2.load(std::memory_order_relaxed))
+    {
+        struct timespec timeout;
+        timeout.tv_sec = deadline_nsec / 1000000000;
+        timeout.tv_nsec = deadline_nsec % 1000000000;
+        ret = ::epoll_pwait2(epfd, events, maxevents, &timeout, &origMask_);
+        if (ret < 0 && errno == ENOSYS)
+        {
+            have_pwait2.store(false, std::memory_order_relaxed);
+        }
+    }
+    if (!have_pwait2.load(std::memory_order_relaxed))
+#endif
+    {
+        // Rounds up to full msec so that we do not wake up before the next
+        // timer is due.
+        int timeout_msec = (deadline_nsec + 999999) / 1000000;
+        ret = ::epoll_pwait(epfd, events, maxevents, timeout_msec, &origMask_);
+    }
+    {
+        AtomicHolder l(this);
+        pendingWakeup_ = false;
+        inSelect_ = false;
+    }
+    return ret;
+}
+#endif // OPENMRN_FEATURE_EXECUTOR_EPOLL
+
 #ifdef ESP32
 #include <sys/types.h>
 #include <sys/stat.h>
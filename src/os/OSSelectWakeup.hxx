@@ -48,6 +48,10 @@
 #include <signal.h>
 #endif
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef __WINNT__
 #include <winsock2.h>
 #elif OPENMRN_HAVE_SELECT
@@ -183,6 +187,24 @@ public:
     int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
                long long deadline_nsec);
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    /** Calls ::epoll_pwait in a way that can be woken up asynchronously from a
+     * different thread.
+     *
+     * @param epfd is the epoll instance to wait on.
+     * @param events is as a regular ::epoll_wait call.
+     * @param maxevents is as a regular ::epoll_wait call.
+     * @param deadline_nsec is the maximum time to sleep if no fd activity and
+     * no wakeup happens. 0 to return immediately.
+     *
+     * @return what ::epoll_wait would return (number of events, 0 in case of
+     * timeout), or -1 and errno==EINTR if the wait was woken up
+     * asynchronously
+     */
+    int epoll_wait(int epfd, struct epoll_event *events, int maxevents,
+                   long long deadline_nsec);
+#endif
+
 private:
 #ifdef ESP32
     void esp_allocate_vfs_fd();
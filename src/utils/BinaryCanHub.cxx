@@ -0,0 +1,589 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file BinaryCanHub.cxx
+ *
+ * Compact binary framing of CAN frames for hub-to-hub TCP links.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "openmrn_features.h"
+
+#include "utils/BinaryCanHub.hxx"
+
+#include <algorithm>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "can_frame.h"
+#include "executor/StateFlow.hxx"
+#include "nmranet_config.h"
+#include "os/os.h"
+#include "utils/Buffer.hxx"
+#include "utils/BufferPort.hxx"
+#include "utils/HubDevice.hxx"
+#if OPENMRN_FEATURE_EXECUTOR_SELECT
+#include "utils/HubDeviceSelect.hxx"
+#endif
+
+namespace
+{
+
+/// First bytes of the hello.
+const uint8_t HELLO_MAGIC[4] = {'O', 'M', 'C', 'B'};
+/// Protocol version in the hello.
+constexpr uint8_t PROTOCOL_VERSION = 1;
+/// Flags in byte 0 of a record.
+constexpr uint8_t RECORD_EFF = 0x80;
+/// Flags in byte 0 of a record.
+constexpr uint8_t RECORD_RTR = 0x40;
+/// Bits of byte 0 that must be zero.
+constexpr uint8_t RECORD_RESERVED = 0x30;
+
+} // namespace
+
+void binary_can_hello(uint8_t *buf, uint8_t flags)
+{
+    memcpy(buf, HELLO_MAGIC, 4);
+    buf[4] = PROTOCOL_VERSION;
+    buf[5] = flags;
+    buf[6] = 0;
+    buf[7] = 0;
+}
+
+int binary_can_parse_hello(const uint8_t *buf)
+{
+    if (memcmp(buf, HELLO_MAGIC, 4) || buf[4] != PROTOCOL_VERSION ||
+        (buf[5] & ~BINARY_CAN_FLAG_TIMESTAMP))
+    {
+        return -1;
+    }
+    return buf[5];
+}
+
+size_t binary_can_encode(
+    const struct can_frame *frame, uint8_t *buf, bool timestamp, uint32_t usec)
+{
+    uint8_t dlc = frame->can_dlc > 8 ? 8 : frame->can_dlc;
+    uint32_t id;
+    uint8_t b0 = dlc;
+    if (IS_CAN_FRAME_EFF(*frame))
+    {
+        b0 |= RECORD_EFF;
+        id = GET_CAN_FRAME_ID_EFF(*frame);
+    }
+    else
+    {
+        id = GET_CAN_FRAME_ID(*frame);
+    }
+    if (IS_CAN_FRAME_RTR(*frame))
+    {
+        b0 |= RECORD_RTR;
+    }
+    buf[0] = b0;
+    buf[1] = id >> 24;
+    buf[2] = id >> 16;
+    buf[3] = id >> 8;
+    buf[4] = id;
+    memcpy(buf + 5, frame->data, dlc);
+    memset(buf + 5 + dlc, 0, 8 - dlc);
+    if (!timestamp)
+    {
+        return BINARY_CAN_RECORD_SIZE;
+    }
+    buf[13] = usec >> 16;
+    buf[14] = usec >> 8;
+    buf[15] = usec;
+    return BINARY_CAN_RECORD_SIZE_TS;
+}
+
+bool binary_can_decode(const uint8_t *buf, struct can_frame *frame)
+{
+    uint8_t b0 = buf[0];
+    uint8_t dlc = b0 & 0xF;
+    if ((b0 & RECORD_RESERVED) || dlc > 8)
+    {
+        return false;
+    }
+    uint32_t id = ((uint32_t)buf[1] << 24) | ((uint32_t)buf[2] << 16) |
+        ((uint32_t)buf[3] << 8) | buf[4];
+    memset(frame, 0, sizeof(*frame));
+    if (b0 & RECORD_EFF)
+    {
+        if (id > 0x1FFFFFFFu)
+        {
+            return false;
+        }
+        SET_CAN_FRAME_EFF(*frame);
+        SET_CAN_FRAME_ID_EFF(*frame, id);
+    }
+    else
+    {
+        if (id > 0x7FFu)
+        {
+            return false;
+        }
+        CLR_CAN_FRAME_EFF(*frame);
+        SET_CAN_FRAME_ID(*frame, id);
+    }
+    if (b0 & RECORD_RTR)
+    {
+        SET_CAN_FRAME_RTR(*frame);
+    }
+    else
+    {
+        CLR_CAN_FRAME_RTR(*frame);
+    }
+    CLR_CAN_FRAME_ERR(*frame);
+    frame->can_dlc = dlc;
+    memcpy(frame->data, buf + 5, dlc);
+    return true;
+}
+
+size_t BinaryCanStreamParser::parse_bulk(const uint8_t *buf, size_t len,
+    struct can_frame *frames, size_t max_frames, size_t *consumed)
+{
+    size_t ofs = 0;
+    size_t count = 0;
+    if (error_)
+    {
+        *consumed = len;
+        return 0;
+    }
+    if (!recordSize_)
+    {
+        size_t n = std::min<size_t>(BINARY_CAN_HELLO_SIZE - bufLen_, len);
+        memcpy(buf_ + bufLen_, buf, n);
+        bufLen_ += n;
+        ofs += n;
+        if (bufLen_ < BINARY_CAN_HELLO_SIZE)
+        {
+            *consumed = ofs;
+            return 0;
+        }
+        int flags = binary_can_parse_hello(buf_);
+        bufLen_ = 0;
+        if (flags < 0)
+        {
+            error_ = true;
+            *consumed = len;
+            return 0;
+        }
+        recordSize_ = (flags & BINARY_CAN_FLAG_TIMESTAMP)
+            ? BINARY_CAN_RECORD_SIZE_TS
+            : BINARY_CAN_RECORD_SIZE;
+    }
+    const uint8_t rs = recordSize_;
+    while (count < max_frames)
+    {
+        const uint8_t *rec;
+        if (bufLen_ || len - ofs < rs)
+        {
+            // Record crossing the buffer boundary.
+            size_t n = std::min<size_t>(rs - bufLen_, len - ofs);
+            memcpy(buf_ + bufLen_, buf + ofs, n);
+            bufLen_ += n;
+            ofs += n;
+            if (bufLen_ < rs)
+            {
+                break;
+            }
+            bufLen_ = 0;
+            rec = buf_;
+        }
+        else
+        {
+            rec = buf + ofs;
+            ofs += rs;
+        }
+        if (!binary_can_decode(rec, frames + count))
+        {
+            error_ = true;
+            *consumed = len;
+            return count;
+        }
+        if (rs == BINARY_CAN_RECORD_SIZE_TS)
+        {
+            lastTimestamp_ = ((uint32_t)rec[13] << 16) |
+                ((uint32_t)rec[14] << 8) | rec[15];
+        }
+        ++count;
+    }
+    *consumed = ofs;
+    return count;
+}
+
+/// Translates between a CAN hub and a byte-stream hub carrying the binary CAN
+/// protocol. The structure is the same as the gridconnect bridge.
+class BinaryCanBridge
+{
+public:
+    /// Constructor.
+    ///
+    /// @param raw_side A hub of type string, carrying the binary protocol.
+    /// @param can_side A hub of type struct can_frame.
+    /// @param fd the connection; shut down when the peer sends invalid data.
+    /// @param timestamps if true, the outgoing records carry a timestamp.
+    /// @param client_limits if true, the output queue in can_side is bounded
+    /// by the hub_port_queue_* constants.
+    BinaryCanBridge(HubFlow *raw_side, CanHubFlow *can_side, int fd,
+        bool timestamps, bool client_limits)
+        : decoder_(can_side->service(), can_side, &encoder_, fd)
+        , encoder_(can_side->service(), raw_side, &decoder_, timestamps)
+        , disconnect_(fd)
+        , rawSide_(raw_side)
+        , canSide_(can_side)
+        , isRegistered_(1)
+    {
+        raw_side->register_port(&decoder_);
+        HubPortLimits limits;
+        if (client_limits &&
+            hub_port_limits_from_config(&limits, &disconnect_))
+        {
+            can_side->register_port(&encoder_, limits);
+        }
+        else
+        {
+            can_side->register_port(&encoder_);
+        }
+    }
+
+    ~BinaryCanBridge()
+    {
+        unregister();
+    }
+
+    /// Unregisters *this from the hubs.
+    void unregister()
+    {
+        if (isRegistered_)
+        {
+            canSide_->unregister_port(&encoder_);
+            rawSide_->unregister_port(&decoder_);
+            isRegistered_ = 0;
+        }
+    }
+
+    /// Unregisters *this from the hubs. @return true if it is safe to destroy
+    /// *this. Should be called on the executor of the CAN side service.
+    bool shutdown()
+    {
+        unregister();
+        return encoder_.shutdown() && decoder_.is_waiting() &&
+            encoder_.is_waiting();
+    }
+
+private:
+    /// HubPort (on the CAN hub) that renders CAN frames to binary records and
+    /// sends them to the byte-stream hub.
+    class Encoder : public CanHubPort
+    {
+    public:
+        /// Constructor.
+        ///
+        /// @param service which executor to run on
+        /// @param destination byte-stream hub to write the records to.
+        /// @param skip_member what to set the skipMember_ field of the
+        /// outgoing buffers to.
+        /// @param timestamps if true, the records will carry a timestamp.
+        Encoder(Service *service, HubFlow *destination, HubPort *skip_member,
+            bool timestamps)
+            : CanHubPort(service)
+            , delayPort_(service, destination, config_gridconnect_buffer_size(),
+                  USEC_TO_NSEC(config_gridconnect_buffer_delay_usec()))
+            , skipMember_(skip_member)
+            , timestamps_(timestamps)
+        {
+        }
+
+        /// @return true if the encoder is idle.
+        bool shutdown()
+        {
+            return delayPort_.shutdown();
+        }
+
+        Action entry() override
+        {
+            if (IS_CAN_FRAME_ERR(*message()->data()))
+            {
+                return release_and_exit();
+            }
+            uint32_t usec = 0;
+            if (timestamps_)
+            {
+                usec = NSEC_TO_USEC(os_get_time_monotonic());
+            }
+            size_t size = binary_can_encode(
+                message()->data(), record_, timestamps_, usec);
+            Buffer<HubData> *target_buffer = nullptr;
+            mainBufferPool->alloc(&target_buffer);
+            target_buffer->data()->skipMember_ = skipMember_;
+            target_buffer->data()->assign((const char *)record_, size);
+            target_buffer->set_done(bn_.reset(this));
+            delayPort_.send(target_buffer, 0);
+            release();
+            return wait_and_call(STATE(buffer_accepted));
+        }
+
+        /// Called when the delay port took the record. @return exit.
+        Action buffer_accepted()
+        {
+            return exit();
+        }
+
+    private:
+        /// Assembles larger outgoing chunks from the individual records.
+        BufferPort delayPort_;
+        /// Rendered record.
+        uint8_t record_[BINARY_CAN_RECORD_SIZE_TS];
+        /// The hub member that should be sent as "source".
+        HubPort *skipMember_;
+        /// Whether to render timestamps.
+        bool timestamps_;
+        /// Helper object.
+        BarrierNotifiable bn_;
+    };
+
+    /// HubPort (on the byte-stream hub) that parses the incoming records and
+    /// sends the frames to the CAN hub.
+    class Decoder : public HubPort
+    {
+    public:
+        /// Constructor.
+        ///
+        /// @param service defines the executor to run on.
+        /// @param destination where to write the parsed frames.
+        /// @param skip_member what to set skipMember_ of the outgoing frames
+        /// to.
+        /// @param fd the connection.
+        Decoder(Service *service, CanHubFlow *destination,
+            CanHubPort *skip_member, int fd)
+            : HubPort(service)
+            , destination_(destination)
+            , skipMember_(skip_member)
+            , fd_(fd)
+        {
+            int max_frames_to_parse =
+                config_gridconnect_bridge_max_incoming_packets();
+            if (max_frames_to_parse > 1)
+            {
+                frameAllocator_.reset(new FixedPool(
+                    sizeof(CanHubFlow::buffer_type), max_frames_to_parse));
+            }
+        }
+
+        Action entry() override
+        {
+            inBuf_ = (const uint8_t *)message()->data()->data();
+            inBufSize_ = message()->data()->size();
+            return call_immediately(STATE(parse_more_data));
+        }
+
+        /// Parses the next record from the incoming bytes. @return next
+        /// state.
+        Action parse_more_data()
+        {
+            size_t consumed;
+            size_t found =
+                parser_.parse_bulk(inBuf_, inBufSize_, &frame_, 1, &consumed);
+            inBuf_ += consumed;
+            inBufSize_ -= consumed;
+            if (found)
+            {
+                return allocate_and_call(destination_,
+                    STATE(send_output_frame), frameAllocator_.get());
+            }
+            if (parser_.has_error() && fd_ >= 0)
+            {
+                LOG_ERROR("binary CAN: invalid data on fd %d, closing.", fd_);
+                // The read flow of the port will see EOF and tear down the
+                // connection.
+                ::shutdown(fd_, SHUT_RDWR);
+                fd_ = -1;
+            }
+            return release_and_exit();
+        }
+
+        /// Sends off the parsed frame. @return next state.
+        Action send_output_frame()
+        {
+            auto *b = get_allocation_result(destination_);
+            *b->data()->mutable_frame() = frame_;
+            b->data()->skipMember_ = skipMember_;
+            destination_->send(b);
+            return call_immediately(STATE(parse_more_data));
+        }
+
+    private:
+        /// Holds the partial record.
+        BinaryCanStreamParser parser_;
+        /// The frame that was parsed last.
+        struct can_frame frame_;
+        /// The incoming bytes.
+        const uint8_t *inBuf_;
+        /// The remaining number of bytes in inBuf_.
+        size_t inBufSize_;
+        /// Allocator to get the frames from. If null, the target's default
+        /// buffer pool will be used.
+        std::unique_ptr<FixedPool> frameAllocator_;
+        /// Hub to send data to.
+        CanHubFlow *destination_;
+        /// The hub member that should be sent as "source".
+        CanHubPortInterface *skipMember_;
+        /// The connection, -1 after it was shut down.
+        int fd_;
+    };
+
+    /// Parses the incoming records.
+    Decoder decoder_;
+    /// Renders the outgoing records.
+    Encoder encoder_;
+    /// Closes the connection if the output queue of the encoder overflows.
+    FdShutdownNotifiable disconnect_;
+    /// Hub with the binary protocol bytes.
+    HubFlow *rawSide_;
+    /// Hub with the CAN frames.
+    CanHubFlow *canSide_;
+    /// 1 if the ports are registered.
+    unsigned isRegistered_ : 1;
+};
+
+/// Adds a connection speaking the binary CAN protocol to a CAN hub. Deletes
+/// itself when the connection is closed. Same structure as the GcHubPort.
+struct BinaryCanHubPort : public Executable
+{
+    /// Constructor.
+    ///
+    /// @param can_hub Parent (binary) hub flow.
+    /// @param fd the connection.
+    /// @param on_exit Notifiable that will be called when the connection is
+    /// closed.
+    /// @param use_select true if fd can be used with select, false if threads
+    /// are needed.
+    /// @param timestamps if true, the outgoing records carry a timestamp.
+    /// @param client_limits if true, the output queue in can_hub is bounded by
+    /// the hub_port_queue_* constants.
+    BinaryCanHubPort(CanHubFlow *can_hub, int fd, Notifiable *on_exit,
+        bool use_select, bool timestamps, bool client_limits)
+        : rawHub_(can_hub->service())
+        , onExit_(on_exit)
+    {
+        // The hello goes out before anything else. The socket is fresh, so
+        // this does not block.
+        uint8_t hello[BINARY_CAN_HELLO_SIZE];
+        binary_can_hello(hello, timestamps ? BINARY_CAN_FLAG_TIMESTAMP : 0);
+        ssize_t ret;
+        do
+        {
+            ret = ::write(fd, hello, sizeof(hello));
+        } while (ret < 0 && errno == EINTR);
+        if (ret != (ssize_t)sizeof(hello))
+        {
+            // The port will find out about the error when reading.
+            LOG_ERROR("binary CAN: failed to send hello on fd %d", fd);
+        }
+        bridge_.reset(new BinaryCanBridge(
+            &rawHub_, can_hub, fd, timestamps, client_limits));
+        if (use_select)
+        {
+#ifndef OPENMRN_FEATURE_EXECUTOR_SELECT
+            DIE("select is not supported");
+#else
+            fdPort_.reset(new HubDeviceSelect<HubFlow>(&rawHub_, fd, this));
+#endif
+        }
+        else
+        {
+            fdPort_.reset(new FdHubPort<HubFlow>(&rawHub_, fd, this));
+        }
+    }
+
+    /// Carries the bytes of the connection. Must be empty before
+    /// destruction.
+    HubFlow rawHub_;
+    /// Translates between the CAN hub and rawHub_.
+    std::unique_ptr<BinaryCanBridge> bridge_;
+    /// Reads and writes the fd.
+    std::unique_ptr<FdHubPortInterface> fdPort_;
+    /// If not null, will be called when the connection is closed.
+    Notifiable *onExit_;
+
+    /// Callback when the connection is closed due to error.
+    void notify() override
+    {
+        // Cannot delete *this here, see GcHubPort.
+        rawHub_.service()->executor()->add(this);
+    }
+
+    void run() override
+    {
+        if (!bridge_->shutdown() || !rawHub_.is_waiting())
+        {
+            // Yield.
+            rawHub_.service()->executor()->add(this);
+            return;
+        }
+        LOG(INFO, "BinaryCanHubPort: Shutting down port %d.", fdPort_->fd());
+        if (onExit_)
+        {
+            onExit_->notify();
+            onExit_ = nullptr;
+        }
+        delete this;
+    }
+};
+
+void create_binary_can_port_for_can_hub(CanHubFlow *can_hub, int fd,
+    Notifiable *on_exit, bool use_select, bool timestamps, bool client_limits)
+{
+    new BinaryCanHubPort(
+        can_hub, fd, on_exit, use_select, timestamps, client_limits);
+}
+
+BinaryCanTcpHub::BinaryCanTcpHub(CanHubFlow *can_hub, int port, bool timestamps)
+    : canHub_(can_hub)
+    , timestamps_(timestamps)
+    , tcpListener_(port,
+          std::bind(&BinaryCanTcpHub::on_new_connection, this,
+              std::placeholders::_1))
+{
+}
+
+BinaryCanTcpHub::~BinaryCanTcpHub()
+{
+    tcpListener_.shutdown();
+}
+
+void BinaryCanTcpHub::on_new_connection(int fd)
+{
+    const bool use_select =
+        (config_gridconnect_tcp_use_select() == CONSTANT_TRUE);
+    create_binary_can_port_for_can_hub(
+        canHub_, fd, nullptr, use_select, timestamps_, true);
+}
@@ -0,0 +1,210 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file BinaryCanHub.hxx
+ *
+ * Compact binary framing of CAN frames for hub-to-hub TCP links.
+ *
+ * Both ends of a connection start by sending an 8-byte hello: the magic
+ * "OMCB", a version byte, a flags byte and two zero bytes. After the hello
+ * every CAN frame is one fixed size record:
+ *
+ *   byte 0      bits 0-3: dlc; bit 7: extended frame; bit 6: remote frame
+ *   bytes 1-4   CAN identifier, big-endian
+ *   bytes 5-12  payload, zero padded to 8 bytes
+ *   bytes 13-15 (only if the sender's hello had BINARY_CAN_FLAG_TIMESTAMP)
+ *               sender's monotonic clock in microseconds, mod 2^24,
+ *               big-endian
+ *
+ * The hello announces the format of the records that its sender will write,
+ * so no round trip is needed before frames can flow; each side parses
+ * according to the peer's hello. A connection with an invalid hello or
+ * record is closed.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#ifndef _UTILS_BINARYCANHUB_HXX_
+#define _UTILS_BINARYCANHUB_HXX_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/Hub.hxx"
+#include "utils/socket_listener.hxx"
+
+struct can_frame;
+
+/// Number of bytes in the hello that opens a binary CAN connection.
+#define BINARY_CAN_HELLO_SIZE 8
+/// Record size without timestamp.
+#define BINARY_CAN_RECORD_SIZE 13
+/// Record size with timestamp.
+#define BINARY_CAN_RECORD_SIZE_TS 16
+/// Hello flag: the records written by the sender carry a timestamp.
+#define BINARY_CAN_FLAG_TIMESTAMP 1
+
+/// Renders the hello of a binary CAN connection.
+/// @param buf output, BINARY_CAN_HELLO_SIZE bytes.
+/// @param flags BINARY_CAN_FLAG_* bits.
+void binary_can_hello(uint8_t *buf, uint8_t flags);
+
+/// Checks the hello of the peer.
+/// @param buf the first BINARY_CAN_HELLO_SIZE bytes of the connection.
+/// @return the flags of the peer, or -1 if this is not a valid hello.
+int binary_can_parse_hello(const uint8_t *buf);
+
+/// Renders a CAN frame to a binary record.
+/// @param frame the frame to render. Must not be an error frame.
+/// @param buf output, BINARY_CAN_RECORD_SIZE or BINARY_CAN_RECORD_SIZE_TS
+/// bytes.
+/// @param timestamp if true, the record will have a timestamp.
+/// @param usec the timestamp, in microseconds. Truncated to 24 bits.
+/// @return the number of bytes written.
+size_t binary_can_encode(const struct can_frame *frame, uint8_t *buf,
+    bool timestamp, uint32_t usec = 0);
+
+/// Parses a binary record.
+/// @param buf the record. The timestamp bytes (if any) are not read.
+/// @param frame output.
+/// @return true on success, false if the record is invalid.
+bool binary_can_decode(const uint8_t *buf, struct can_frame *frame);
+
+/// Splits the incoming byte stream of a binary CAN connection into frames.
+/// Holds the partial record between calls.
+///
+/// This class is not thread-safe, but thread-compatible.
+class BinaryCanStreamParser
+{
+public:
+    BinaryCanStreamParser()
+    {
+    }
+
+    /// Parses all complete records in a buffer of incoming bytes. The first
+    /// bytes of the stream are the hello of the peer.
+    ///
+    /// @param buf the incoming bytes.
+    /// @param len number of bytes in buf.
+    /// @param frames output array for the parsed frames.
+    /// @param max_frames number of entries in frames. Parsing stops when the
+    /// array is full.
+    /// @param consumed will be set to the number of bytes processed. If less
+    /// than len, the caller should call again with the rest.
+    /// @return the number of frames written to frames.
+    size_t parse_bulk(const uint8_t *buf, size_t len, struct can_frame *frames,
+        size_t max_frames, size_t *consumed);
+
+    /// @return true if the stream had an invalid hello or record. After this
+    /// parse_bulk() ignores all data; the connection should be closed.
+    bool has_error()
+    {
+        return error_;
+    }
+
+    /// @return true if the hello of the peer was received.
+    bool has_hello()
+    {
+        return recordSize_ != 0;
+    }
+
+    /// @return the timestamp of the last parsed frame, or 0 if the peer does
+    /// not send timestamps.
+    uint32_t last_timestamp()
+    {
+        return lastTimestamp_;
+    }
+
+private:
+    /// Collects a partial hello or record.
+    uint8_t buf_[BINARY_CAN_RECORD_SIZE_TS];
+    /// Number of bytes in buf_.
+    uint8_t bufLen_ {0};
+    /// Record size of the peer; 0 until the hello was received.
+    uint8_t recordSize_ {0};
+    /// 1 if the stream is broken.
+    bool error_ {false};
+    /// Timestamp of the last frame.
+    uint32_t lastTimestamp_ {0};
+};
+
+/** Creates a new port on a CAN hub that speaks the binary CAN protocol on a
+ * file descriptor (typically a TCP socket to another hub). The port will
+ * automatically be closed, deleted and on_exit notified when the fd
+ * encounters an error or the peer sends invalid data.
+ *
+ * @param can_hub the raw CAN packets are coming/going to this object.
+ * @param fd the file descriptor of the connection.
+ * @param on_exit is a notifiable (may be null) which will be called when the
+ * port is closed.
+ * @param use_select when true, the FD will be used with select, when false,
+ * separate threads will be started with blocking read and write calls.
+ * @param timestamps when true, the outgoing records carry a timestamp.
+ * @param client_limits if true, the output queue of the port is bounded by
+ * the hub_port_queue_* constants. Meant for the connections accepted by a
+ * server; upstream links are better served without limits. */
+void create_binary_can_port_for_can_hub(CanHubFlow *can_hub, int fd,
+    Notifiable *on_exit = nullptr, bool use_select = false,
+    bool timestamps = false, bool client_limits = false);
+
+/** Listens on a TCP port and wires every incoming connection into a CAN hub
+ * using the binary CAN protocol. Can be used side by side with a GcTcpHub on
+ * the same CAN hub; the packets are forwarded between the binary and the
+ * GridConnect participants. */
+class BinaryCanTcpHub
+{
+public:
+    /// Constructor.
+    ///
+    /// @param can_hub Which CAN-hub should we attach the TCP connections to.
+    /// @param port TCP port number to listen on.
+    /// @param timestamps if true, the records sent by the hub carry a
+    /// timestamp.
+    BinaryCanTcpHub(CanHubFlow *can_hub, int port, bool timestamps = false);
+    ~BinaryCanTcpHub();
+
+    /// @return true of the listener is ready to accept incoming connections.
+    bool is_started()
+    {
+        return tcpListener_.is_started();
+    }
+
+private:
+    /// Callback when a new connection arrives.
+    ///
+    /// @param fd filedes of the freshly established incoming connection.
+    void on_new_connection(int fd);
+
+    /// Which CAN-hub we attach the connections onto.
+    CanHubFlow *canHub_;
+    /// Whether to send timestamps.
+    bool timestamps_;
+    /// Helper object representing the listening on the socket.
+    SocketListener tcpListener_;
+};
+
+#endif // _UTILS_BINARYCANHUB_HXX_
@@ -39,8 +39,8 @@ Pool* init_main_buffer_pool()
 {
     if (!mainBufferPool)
     {
-        mainBufferPool =
-            new DynamicPool(Bucket::init(32, 48, LARGEST_BUFFERPOOL_BUCKET, 0));
+        mainBufferPool = new DynamicPool(
+            Bucket::init(32, 48, LARGEST_BUFFERPOOL_BUCKET, 0), true);
     }
     return mainBufferPool;
 }
@@ -51,9 +51,13 @@ Pool* init_main_buffer_pool()
 size_t DynamicPool::free_items()
 {
     size_t total = 0;
-    for (Bucket *current = buckets; current->size() != 0; ++current)
+    unsigned index = 0;
+    for (Bucket *current = buckets; current->size() != 0; ++current, ++index)
     {
         total += current->pending();
+#if OPENMRN_FEATURE_POOL_THREAD_CACHE
+        total += magazine_items(index);
+#endif
     }
     return total;
 }
@@ -64,11 +68,16 @@ size_t DynamicPool::free_items()
  */
 size_t DynamicPool::free_items(size_t size)
 {
-    for (Bucket *current = buckets; current->size() != 0; ++current)
+    unsigned index = 0;
+    for (Bucket *current = buckets; current->size() != 0; ++current, ++index)
     {
         if (current->size() >= size)
         {
+#if OPENMRN_FEATURE_POOL_THREAD_CACHE
+            return current->pending() + magazine_items(index);
+#else
             return current->pending();
+#endif
         }
     }
     return 0;
@@ -100,10 +109,15 @@ BufferBase *DynamicPool::alloc_untyped(size_t size, Executable *flow)
 {
     BufferBase *result = NULL;
 
-    for (Bucket *current = buckets; current->size() != 0; ++current)
+    unsigned index = 0;
+    for (Bucket *current = buckets; current->size() != 0; ++current, ++index)
     {
         if (size <= current->size())
         {
+#if OPENMRN_FEATURE_POOL_THREAD_CACHE
+            result = magazine_alloc(index, current);
+            if (result == NULL)
+#endif
             result = static_cast<BufferBase*>(current->next().item);
             if (result == NULL)
             {
@@ -164,10 +178,17 @@ void DynamicPool::free(BufferBase *item)
         g_alloc_source.erase(item);
     }
 #endif
-    for (Bucket *current = buckets; current->size() != 0; ++current)
+    unsigned index = 0;
+    for (Bucket *current = buckets; current->size() != 0; ++current, ++index)
     {
         if (item->size() <= current->size())
         {
+#if OPENMRN_FEATURE_POOL_THREAD_CACHE
+            if (magazine_free(index, current, item))
+            {
+                return;
+            }
+#endif
             current->insert(item);
             return;
         }
@@ -180,6 +201,288 @@ void DynamicPool::free(BufferBase *item)
     free_large(item);
 }
 
+#if OPENMRN_FEATURE_POOL_THREAD_CACHE
+/// Per-thread cache of free buffers of one DynamicPool. Only the owning
+/// thread touches the buffers, except when the pool gets destroyed. The list
+/// linkage and pool_ are protected by magazine_lock().
+struct DynamicPool::Magazine
+{
+    /// Buckets above this index are not cached.
+    static constexpr unsigned MAX_BUCKETS = 4;
+    /// Number of buffers cached per bucket.
+    static constexpr unsigned SIZE = 32;
+    /// How many buffers move between a magazine and a bucket at once.
+    static constexpr unsigned BATCH = SIZE / 2;
+
+    /// Pool that we are caching for. nullptr after the pool is destroyed.
+    std::atomic<DynamicPool *> pool_;
+    /// Next magazine of the same pool.
+    Magazine *next_;
+    /// Number of cached buffers per bucket. Atomic, because free_items()
+    /// reads it from other threads.
+    std::atomic<unsigned> count_[MAX_BUCKETS];
+    /// Cached buffers.
+    BufferBase *items_[MAX_BUCKETS][SIZE];
+};
+
+/// Magazines of one thread, one per pool. The lookup uses a plain
+/// thread_local array; the destructor is only registered with the thread
+/// once the thread created a magazine.
+class DynamicPool::ThreadCache
+{
+public:
+    /// How many pools a thread can have magazines for. Further pools are not
+    /// cached.
+    static constexpr unsigned MAX_POOLS = 4;
+
+    ~ThreadCache()
+    {
+        for (unsigned i = 0; i < MAX_POOLS; ++i)
+        {
+            if (magazines_[i])
+            {
+                release_magazine(magazines_[i]);
+                magazines_[i] = nullptr;
+            }
+        }
+    }
+
+    /// @param pool the pool to look up. @return the magazine of the current
+    /// thread for that pool, or nullptr if there are no free slots.
+    static Magazine *get(DynamicPool *pool)
+    {
+        Magazine **free_slot = nullptr;
+        for (unsigned i = 0; i < MAX_POOLS; ++i)
+        {
+            Magazine *m = magazines_[i];
+            if (m)
+            {
+                DynamicPool *owner = m->pool_.load(std::memory_order_relaxed);
+                if (owner == pool)
+                {
+                    return m;
+                }
+                if (!owner)
+                {
+                    // The pool was destroyed.
+                    discard_magazine(m);
+                    magazines_[i] = nullptr;
+                }
+            }
+            if (!magazines_[i] && !free_slot)
+            {
+                free_slot = &magazines_[i];
+            }
+        }
+        if (!free_slot)
+        {
+            return nullptr;
+        }
+        // Makes sure the destructor runs at thread exit.
+        tlsCache_.registered_ = true;
+        *free_slot = pool->create_magazine();
+        return *free_slot;
+    }
+
+    /// @param m is a magazine. @return true if m belongs to the current
+    /// thread.
+    static bool is_current(Magazine *m)
+    {
+        for (unsigned i = 0; i < MAX_POOLS; ++i)
+        {
+            if (magazines_[i] == m)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    /// Magazines of the current thread, one per pool.
+    static thread_local Magazine *magazines_[MAX_POOLS];
+    /// Dummy member that forces the construction of the thread's instance.
+    bool registered_ = false;
+};
+
+thread_local DynamicPool::Magazine
+    *DynamicPool::ThreadCache::magazines_[MAX_POOLS];
+thread_local DynamicPool::ThreadCache DynamicPool::tlsCache_;
+
+/// @return the lock protecting the magazine lists and the pool_ pointers of
+/// the magazines. Never destroyed, as threads may exit late.
+static Atomic *magazine_lock()
+{
+    static Atomic *lock = new Atomic;
+    return lock;
+}
+
+BufferBase *DynamicPool::magazine_alloc(unsigned index, Bucket *bucket)
+{
+    if (!useThreadCache_ || index >= Magazine::MAX_BUCKETS)
+    {
+        return nullptr;
+    }
+    Magazine *m = ThreadCache::get(this);
+    if (!m)
+    {
+        return nullptr;
+    }
+    unsigned count = m->count_[index].load(std::memory_order_relaxed);
+    if (!count)
+    {
+        // Refills half of the magazine while taking the lock once.
+        AtomicHolder h(bucket->lock());
+        while (count < Magazine::BATCH)
+        {
+            QMember *q = bucket->next_locked().item;
+            if (!q)
+            {
+                break;
+            }
+            m->items_[index][count++] = static_cast<BufferBase *>(q);
+        }
+    }
+    if (!count)
+    {
+        return nullptr;
+    }
+    --count;
+    m->count_[index].store(count, std::memory_order_relaxed);
+    return m->items_[index][count];
+}
+
+bool DynamicPool::magazine_free(
+    unsigned index, Bucket *bucket, BufferBase *item)
+{
+    if (!useThreadCache_ || index >= Magazine::MAX_BUCKETS)
+    {
+        return false;
+    }
+    Magazine *m = ThreadCache::get(this);
+    if (!m)
+    {
+        return false;
+    }
+    unsigned count = m->count_[index].load(std::memory_order_relaxed);
+    if (count >= Magazine::SIZE)
+    {
+        // Flushes half of the magazine while taking the lock once.
+        AtomicHolder h(bucket->lock());
+        for (unsigned i = 0; i < Magazine::BATCH; ++i)
+        {
+            bucket->insert_locked(m->items_[index][--count]);
+        }
+    }
+    m->items_[index][count++] = item;
+    m->count_[index].store(count, std::memory_order_relaxed);
+    return true;
+}
+
+DynamicPool::Magazine *DynamicPool::create_magazine()
+{
+    Magazine *m = new Magazine;
+    m->pool_.store(this, std::memory_order_relaxed);
+    for (unsigned i = 0; i < Magazine::MAX_BUCKETS; ++i)
+    {
+        m->count_[i].store(0, std::memory_order_relaxed);
+    }
+    AtomicHolder h(magazine_lock());
+    m->next_ = magazines_;
+    magazines_ = m;
+    return m;
+}
+
+void DynamicPool::flush_magazine(Magazine *m)
+{
+    unsigned index = 0;
+    for (Bucket *current = buckets;
+         current->size() != 0 && index < Magazine::MAX_BUCKETS;
+         ++current, ++index)
+    {
+        unsigned count = m->count_[index].load(std::memory_order_relaxed);
+        while (count)
+        {
+            current->insert(m->items_[index][--count]);
+        }
+        m->count_[index].store(0, std::memory_order_relaxed);
+    }
+}
+
+void DynamicPool::release_magazine(Magazine *m)
+{
+    {
+        AtomicHolder h(magazine_lock());
+        DynamicPool *pool = m->pool_.load(std::memory_order_relaxed);
+        if (pool)
+        {
+            pool->flush_magazine(m);
+            Magazine **link = &pool->magazines_;
+            while (*link != m)
+            {
+                link = &(*link)->next_;
+            }
+            *link = m->next_;
+        }
+    }
+    // If the pool is gone, the buffers left in the magazine are ours.
+    discard_magazine(m);
+}
+
+void DynamicPool::discard_magazine(Magazine *m)
+{
+#ifdef GTEST
+    // Frees the buffers the same way as the pool destructor does for the
+    // buckets.
+    for (unsigned i = 0; i < Magazine::MAX_BUCKETS; ++i)
+    {
+        unsigned count = m->count_[i].load(std::memory_order_relaxed);
+        while (count)
+        {
+            ::free(m->items_[i][--count]);
+        }
+    }
+#endif
+    delete m;
+}
+
+void DynamicPool::drain_magazines()
+{
+    AtomicHolder h(magazine_lock());
+    Magazine *next;
+    for (Magazine *m = magazines_; m; m = next)
+    {
+        // The owner thread may delete the magazine as soon as it sees the
+        // null pool_.
+        next = m->next_;
+        if (ThreadCache::is_current(m))
+        {
+            flush_magazine(m);
+        }
+        // The magazines of other threads are not touched: their owners use
+        // them without a lock. The owner thread discards the magazine when it
+        // notices that the pool is gone.
+        m->pool_.store(nullptr, std::memory_order_relaxed);
+    }
+    magazines_ = nullptr;
+}
+
+size_t DynamicPool::magazine_items(unsigned index)
+{
+    if (index >= Magazine::MAX_BUCKETS)
+    {
+        return 0;
+    }
+    size_t total = 0;
+    AtomicHolder h(magazine_lock());
+    for (Magazine *m = magazines_; m; m = m->next_)
+    {
+        total += m->count_[index].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+#endif // OPENMRN_FEATURE_POOL_THREAD_CACHE
+
 /** Get a free item out of the pool.
  * @param size how many payload bytes should he allocated buffer have. Usually
  * sizeof<T> for Buffer<T>.
@@ -44,6 +44,7 @@
 #include <cstdlib>
 #include <cstdarg>
 
+#include "openmrn_features.h"
 #include "executor/Executable.hxx"
 #include "executor/Notifiable.hxx"
 #include "os/OS.hxx"
@@ -476,16 +477,28 @@ class DynamicPool : public Pool, private Atomic
 public:
     /** Constructor.
      * @param sizes array of bucket sizes for the pool
+     * @param thread_cache if true, each thread keeps a small cache (magazine)
+     * of free buffers per bucket, which is refilled from and flushed to the
+     * shared buckets in batches. Ignored if the platform does not support
+     * it.
      */
-    DynamicPool(Bucket sizes[])
+    DynamicPool(Bucket sizes[], bool thread_cache = false)
         : Pool()
         , buckets(sizes)
+#if OPENMRN_FEATURE_POOL_THREAD_CACHE
+        , useThreadCache_(thread_cache)
+        , magazines_(nullptr)
+#endif
     {
     }
 
-    /** default destructor */
+    /** Destructor. Other threads may still hold magazines of this pool, but
+     * must not allocate from or free to it anymore. */
     ~DynamicPool()
     {
+#if OPENMRN_FEATURE_POOL_THREAD_CACHE
+        drain_magazines();
+#endif
 #ifdef GTEST
         for (unsigned i = 0; buckets[i].size() != 0; ++i)
         {
@@ -542,6 +555,56 @@ private:
      */
     void free(BufferBase *item) override;
 
+#if OPENMRN_FEATURE_POOL_THREAD_CACHE
+    struct Magazine;
+    class ThreadCache;
+
+    /// Takes a buffer from the current thread's magazine. @param index is the
+    /// bucket index; @param bucket is the bucket. @return a free buffer, or
+    /// nullptr if the caller should allocate directly from the bucket.
+    BufferBase *magazine_alloc(unsigned index, Bucket *bucket);
+
+    /// Puts a buffer into the current thread's magazine. @param index is the
+    /// bucket index; @param bucket is the bucket; @param item is the buffer to
+    /// release. @return false if the caller should release directly to the
+    /// bucket.
+    bool magazine_free(unsigned index, Bucket *bucket, BufferBase *item);
+
+    /// Creates a new magazine for the current thread. @return the magazine.
+    Magazine *create_magazine();
+
+    /// Moves all buffers from a magazine back to the buckets. Caller must
+    /// hold the magazine lock. @param m is the magazine to flush.
+    void flush_magazine(Magazine *m);
+
+    /// Called at thread exit. Returns the cached buffers to the pool (if it
+    /// still exists) and deletes the magazine. @param m is the magazine.
+    static void release_magazine(Magazine *m);
+
+    /// Deletes a magazine that no longer belongs to a pool, along with the
+    /// buffers in it. @param m is the magazine.
+    static void discard_magazine(Magazine *m);
+
+    /// Detaches the magazines of all threads from this pool. Only the
+    /// current thread's magazine is flushed to the buckets; the other
+    /// magazines are used by their owners without a lock, so those threads
+    /// discard them when they notice that the pool is gone. Called from the
+    /// destructor.
+    void drain_magazines();
+
+    /// @return number of buffers in the magazines of all threads for a given
+    /// bucket. @param index is the bucket index.
+    size_t magazine_items(unsigned index);
+
+    /// True if this pool uses per-thread magazines.
+    bool useThreadCache_;
+    /// Magazines of all threads for this pool. Protected by the magazine
+    /// lock.
+    Magazine *magazines_;
+    /// Magazines of the current thread.
+    static thread_local ThreadCache tlsCache_;
+#endif
+
     /** Default constructor.
      */
     DynamicPool();
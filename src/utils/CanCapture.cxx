@@ -0,0 +1,437 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file CanCapture.cxx
+ *
+ * Binary capture of the traffic of a CAN hub to files, and replay of such
+ * files into a CAN hub.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "utils/CanCapture.hxx"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if OPENMRN_HAVE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "can_frame.h"
+#include "os/os.h"
+#include "utils/StringPrintf.hxx"
+#include "utils/logging.h"
+
+namespace
+{
+
+/// Magic bytes at the start of a capture file.
+const char CAPTURE_MAGIC[4] = {'O', 'M', 'C', 'C'};
+/// Version of the file format.
+constexpr uint8_t CAPTURE_VERSION = 1;
+
+/// Writes a big-endian 32-bit value. @param p output. @param v value.
+void put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+/// @param p input. @return the big-endian 32-bit value at p.
+uint32_t get_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+        ((uint32_t)p[2] << 8) | p[3];
+}
+
+} // namespace
+
+constexpr size_t CanCapturePort::BUFFER_SIZE;
+
+CanCapturePort::CanCapturePort(
+    CanHubFlow *hub, const string &path, size_t max_bytes, unsigned max_files)
+    : hub_(hub)
+    , path_(path)
+    , maxBytes_(max_bytes)
+    , maxFiles_(max_files ? max_files : 1)
+    , buf_(new uint8_t[BUFFER_SIZE])
+    , writeBuf_(new uint8_t[BUFFER_SIZE])
+{
+    lastFrame_ = os_get_time_monotonic();
+    open_file();
+    start("can_capture", 0, 2048);
+    hub_->register_port(this);
+}
+
+CanCapturePort::~CanCapturePort()
+{
+    hub_->unregister_port(this);
+    {
+        OSMutexLock l(&lock_);
+        exit_ = true;
+    }
+    wakeup_.post();
+    exited_.wait();
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+    }
+}
+
+void CanCapturePort::send(Buffer<CanHubData> *message, unsigned priority)
+{
+    AutoReleaseBuffer<CanHubData> b(message);
+    const struct can_frame &frame = message->data()->frame();
+    if (IS_CAN_FRAME_ERR(frame))
+    {
+        return;
+    }
+    long long now = os_get_time_monotonic();
+    OSMutexLock l(&lock_);
+    if (bufLen_ + CAN_CAPTURE_RECORD_SIZE > BUFFER_SIZE)
+    {
+        if (!handoff_locked())
+        {
+            ++dropped_;
+            return;
+        }
+        wakeup_.post();
+    }
+    uint64_t usec = (now - lastFrame_) / 1000;
+    if (usec > UINT32_MAX)
+    {
+        usec = UINT32_MAX;
+        lastFrame_ = now;
+    }
+    else
+    {
+        // Keeps the remainder, so that the rounding errors do not add up.
+        lastFrame_ += usec * 1000;
+    }
+    uint8_t *p = buf_.get() + bufLen_;
+    put_be32(p, usec);
+    binary_can_encode(&frame, p + 4, false);
+    bufLen_ += CAN_CAPTURE_RECORD_SIZE;
+    ++frames_;
+}
+
+void CanCapturePort::flush()
+{
+    OSMutexLock f(&flushLock_);
+    {
+        OSMutexLock l(&lock_);
+        flushRequested_ = true;
+    }
+    wakeup_.post();
+    flushed_.wait();
+}
+
+void *CanCapturePort::entry()
+{
+    bool timeout = false;
+    // True while writing the buffer handed off for a flush().
+    bool flushing = false;
+    lock_.lock();
+    while (true)
+    {
+        if (writeBusy_)
+        {
+            lock_.unlock();
+            write_out();
+            lock_.lock();
+            writeBusy_ = false;
+            continue;
+        }
+        if (flushing)
+        {
+            flushing = false;
+            flushed_.post();
+        }
+        if (flushRequested_ || exit_ || timeout)
+        {
+            // buf_ has every frame recorded before the request.
+            flushing = flushRequested_;
+            flushRequested_ = false;
+            timeout = false;
+            if (bufLen_)
+            {
+                handoff_locked();
+                continue;
+            }
+            if (flushing)
+            {
+                continue;
+            }
+        }
+        if (exit_)
+        {
+            break;
+        }
+        lock_.unlock();
+        timeout = wakeup_.timedwait(SEC_TO_NSEC(1)) != 0;
+        lock_.lock();
+    }
+    lock_.unlock();
+    exited_.post();
+    return nullptr;
+}
+
+bool CanCapturePort::handoff_locked()
+{
+    if (writeBusy_)
+    {
+        return false;
+    }
+    buf_.swap(writeBuf_);
+    writeLen_ = bufLen_;
+    writeBusy_ = true;
+    bufLen_ = 0;
+    return true;
+}
+
+void CanCapturePort::write_out()
+{
+    uint8_t *p = writeBuf_.get();
+    size_t len = writeLen_;
+    while (len)
+    {
+        size_t n = len;
+        if (maxBytes_)
+        {
+            if (fileBytes_ + CAN_CAPTURE_RECORD_SIZE > maxBytes_)
+            {
+                open_file();
+                // The first record of the file has no predecessor.
+                put_be32(p, 0);
+            }
+            size_t room = maxBytes_ > fileBytes_ ? maxBytes_ - fileBytes_ : 0;
+            room -= room % CAN_CAPTURE_RECORD_SIZE;
+            if (room < CAN_CAPTURE_RECORD_SIZE)
+            {
+                // The limit is below one record; every file gets one.
+                room = CAN_CAPTURE_RECORD_SIZE;
+            }
+            n = std::min(n, room);
+        }
+        size_t written = write_all(p, n);
+        // The records that were not written in full are lost.
+        dropped_ += (n - written + CAN_CAPTURE_RECORD_SIZE - 1) /
+            CAN_CAPTURE_RECORD_SIZE;
+        fileBytes_ += n;
+        p += n;
+        len -= n;
+    }
+}
+
+size_t CanCapturePort::write_all(const uint8_t *data, size_t len)
+{
+    size_t ofs = 0;
+    while (fd_ >= 0 && ofs < len)
+    {
+        ssize_t ret = ::write(fd_, data + ofs, len - ofs);
+        if (ret < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (ret <= 0)
+        {
+            LOG_ERROR("CanCapture: error writing %s: %s", path_.c_str(),
+                strerror(errno));
+            break;
+        }
+        ofs += ret;
+    }
+    return ofs;
+}
+
+void CanCapturePort::open_file()
+{
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+    }
+    // path.(N-2) -> path.(N-1), ..., path -> path.1. rename() replaces the
+    // oldest file.
+    for (unsigned i = maxFiles_ - 1; i > 0; --i)
+    {
+        string from = i > 1 ? StringPrintf("%s.%u", path_.c_str(), i - 1)
+                            : path_;
+        string to = StringPrintf("%s.%u", path_.c_str(), i);
+        ::rename(from.c_str(), to.c_str());
+    }
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    // Counts the header even if the file could not be opened, so that the
+    // records keep going into files of the right size.
+    fileBytes_ = CAN_CAPTURE_HEADER_SIZE;
+    if (fd_ < 0)
+    {
+        LOG_ERROR("CanCapture: cannot open %s: %s", path_.c_str(),
+            strerror(errno));
+        return;
+    }
+    uint8_t hdr[CAN_CAPTURE_HEADER_SIZE];
+    memcpy(hdr, CAPTURE_MAGIC, 4);
+    hdr[4] = CAPTURE_VERSION;
+    hdr[5] = hdr[6] = hdr[7] = 0;
+    uint64_t t = ::time(nullptr);
+    put_be32(hdr + 8, t >> 32);
+    put_be32(hdr + 12, t);
+    write_all(hdr, sizeof(hdr));
+}
+
+#if OPENMRN_HAVE_MMAP
+
+constexpr unsigned CanReplay::BATCH;
+
+CanReplay::CanReplay(
+    CanHubFlow *hub, const string &path, double speed, Notifiable *done)
+    : StateFlowBase(hub->service())
+    , hub_(hub)
+    , speed_(speed)
+    , doneNotify_(done)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size >= CAN_CAPTURE_HEADER_SIZE)
+        {
+            void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+                data_ = static_cast<const uint8_t *>(p);
+                size_ = st.st_size;
+            }
+        }
+        ::close(fd);
+    }
+    if (data_ &&
+        (memcmp(data_, CAPTURE_MAGIC, 4) != 0 || data_[4] != CAPTURE_VERSION))
+    {
+        munmap(const_cast<uint8_t *>(data_), size_);
+        data_ = nullptr;
+    }
+    if (!data_)
+    {
+        LOG_ERROR("CanReplay: cannot use %s", path.c_str());
+    }
+    start_ = os_get_time_monotonic();
+    start_flow(data_ ? STATE(send_batch) : STATE(finish));
+}
+
+CanReplay::~CanReplay()
+{
+    stop_ = true;
+    while (!done_)
+    {
+        service()->executor()->sync_run([this]() {
+            timer_.ensure_triggered();
+        });
+        usleep(1000);
+    }
+    if (data_)
+    {
+        munmap(const_cast<uint8_t *>(data_), size_);
+    }
+}
+
+StateFlowBase::Action CanReplay::send_batch()
+{
+    if (stop_)
+    {
+        return call_immediately(STATE(finish));
+    }
+    long long now = os_get_time_monotonic();
+    BarrierNotifiable *bn = nullptr;
+    unsigned n = 0;
+    while (n < BATCH && ofs_ + CAN_CAPTURE_RECORD_SIZE <= size_)
+    {
+        const uint8_t *rec = data_ + ofs_;
+        uint32_t usec = get_be32(rec);
+        if (speed_ > 0)
+        {
+            long long due =
+                start_ + (long long)((fileUsec_ + usec) * 1000.0 / speed_);
+            if (due > now)
+            {
+                if (!bn)
+                {
+                    return sleep_and_call(
+                        &timer_, due - now, STATE(send_batch));
+                }
+                break;
+            }
+        }
+        fileUsec_ += usec;
+        ofs_ += CAN_CAPTURE_RECORD_SIZE;
+        struct can_frame frame;
+        if (!binary_can_decode(rec + 4, &frame))
+        {
+            continue;
+        }
+        if (!bn)
+        {
+            bn = bn_.reset(this);
+        }
+        auto *b = hub_->alloc();
+        *b->data()->mutable_frame() = frame;
+        b->data()->skipMember_ = nullptr;
+        b->set_done(bn->new_child());
+        hub_->send(b);
+        ++n;
+        ++frames_;
+    }
+    if (bn)
+    {
+        // We are woken up when the hub released the batch.
+        bn->notify();
+        return wait_and_call(STATE(send_batch));
+    }
+    return call_immediately(STATE(finish));
+}
+
+StateFlowBase::Action CanReplay::finish()
+{
+    if (doneNotify_)
+    {
+        doneNotify_->notify();
+    }
+    done_ = true;
+    return exit();
+}
+
+#endif // OPENMRN_HAVE_MMAP
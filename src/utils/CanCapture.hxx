@@ -0,0 +1,260 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file CanCapture.hxx
+ *
+ * Binary capture of the traffic of a CAN hub to files, and replay of such
+ * files into a CAN hub.
+ *
+ * A capture file starts with a 16-byte header: the magic "OMCC", a version
+ * byte (1), three zero bytes and the wall clock time when the file was
+ * started, in seconds since the Unix epoch, 64-bit big-endian. Then every
+ * frame is one fixed size record of CAN_CAPTURE_RECORD_SIZE bytes:
+ *
+ *   bytes 0-3   microseconds since the previous record (for the first record
+ *               since the file was started), big-endian, saturated
+ *   bytes 4-16  the frame as a record of the binary CAN protocol, see
+ *               BinaryCanHub.hxx
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#ifndef _UTILS_CANCAPTURE_HXX_
+#define _UTILS_CANCAPTURE_HXX_
+
+#include <atomic>
+#include <memory>
+
+#include "executor/StateFlow.hxx"
+#include "openmrn_features.h"
+#include "utils/BinaryCanHub.hxx"
+#include "utils/Hub.hxx"
+
+/// Number of bytes in the header of a capture file.
+#define CAN_CAPTURE_HEADER_SIZE 16
+/// Number of bytes of one frame in a capture file.
+#define CAN_CAPTURE_RECORD_SIZE (4 + BINARY_CAN_RECORD_SIZE)
+
+/** Hub port that appends every frame of a CAN hub to a capture file.
+ *
+ * The records are collected in memory and handed to a writer thread in large
+ * blocks, when the buffer is full or at the latest a second later. There are
+ * two buffers: the hub fills one while the thread writes the other, so the
+ * hub never waits for the disk. If both buffers are full, the frames are
+ * dropped and counted in dropped().
+ *
+ * When the file reaches a size limit, the writer thread rotates it: "path"
+ * is renamed to "path.1", the previous "path.1" to "path.2" and so on, the
+ * oldest one is deleted, and a new "path" is started. */
+class CanCapturePort : public CanHubPortInterface, private OSThread
+{
+public:
+    /// Constructor. Registers the port on the hub.
+    ///
+    /// @param hub the CAN hub whose traffic to capture.
+    /// @param path name of the capture file. An existing file is rotated
+    /// like a full one.
+    /// @param max_bytes the file is rotated when it would grow beyond this
+    /// many bytes. 0 for no limit.
+    /// @param max_files how many files to keep, including the current one.
+    CanCapturePort(CanHubFlow *hub, const string &path, size_t max_bytes = 0,
+        unsigned max_files = 1);
+
+    /// Unregisters the port, writes out the buffered frames and stops the
+    /// writer thread.
+    ~CanCapturePort();
+
+    /// Records a frame. Called by the hub.
+    void send(Buffer<CanHubData> *message, unsigned priority) override;
+
+    /// Writes all buffered frames to the file. Returns when they are written.
+    void flush();
+
+    /// @return the number of frames recorded.
+    unsigned frames()
+    {
+        return frames_;
+    }
+
+    /// @return the number of frames that could not be written.
+    unsigned dropped()
+    {
+        return dropped_;
+    }
+
+private:
+    /// Size of each memory buffer.
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+    /// Writer thread.
+    void *entry() override;
+
+    /// Hands buf_ to the writer thread. Must be called with lock_ held.
+    /// @return false if the writer is still busy with the other buffer.
+    bool handoff_locked();
+
+    /// Writes out writeBuf_. Called on the writer thread without lock_.
+    void write_out();
+
+    /// Writes a block of bytes to the current file. Called on the writer
+    /// thread. @param data what to write. @param len number of bytes.
+    /// @return number of bytes written.
+    size_t write_all(const uint8_t *data, size_t len);
+
+    /// Rotates the files, opens a new one and writes the header. Called on
+    /// the writer thread (or before it is started).
+    void open_file();
+
+    /// The hub we are registered on.
+    CanHubFlow *hub_;
+    /// Name of the current file.
+    string path_;
+    /// Rotation limit of the file size, or 0.
+    size_t maxBytes_;
+    /// Number of files to keep.
+    unsigned maxFiles_;
+    /// Current file, or -1 if it could not be opened. Used by the writer
+    /// thread only.
+    int fd_ {-1};
+    /// Bytes written to the current file. Used by the writer thread only.
+    size_t fileBytes_ {0};
+    /// Protects everything below.
+    OSMutex lock_;
+    /// Collects records before writing them.
+    std::unique_ptr<uint8_t[]> buf_;
+    /// Number of bytes in buf_.
+    size_t bufLen_ {0};
+    /// Buffer owned by the writer thread while writeBusy_ is set.
+    std::unique_ptr<uint8_t[]> writeBuf_;
+    /// Number of bytes in writeBuf_.
+    size_t writeLen_ {0};
+    /// True while the writer thread owns writeBuf_.
+    bool writeBusy_ {false};
+    /// Set by flush(), cleared by the writer when everything is written.
+    bool flushRequested_ {false};
+    /// Set by the destructor.
+    bool exit_ {false};
+    /// Monotonic time of the last record, nsec.
+    long long lastFrame_;
+    /// Allows one flush() at a time.
+    OSMutex flushLock_;
+    /// Wakes up the writer thread.
+    OSSem wakeup_;
+    /// Posted by the writer thread when a flush() is done.
+    OSSem flushed_;
+    /// Posted by the writer thread when it exits.
+    OSSem exited_;
+    /// Number of frames recorded.
+    std::atomic<unsigned> frames_ {0};
+    /// Number of frames lost due to full buffers or write errors.
+    std::atomic<unsigned> dropped_ {0};
+};
+
+#if OPENMRN_HAVE_MMAP
+
+/** Plays back a capture file into a CAN hub. The file is mapped into memory,
+ * and the frames are injected in batches, with the next batch going out when
+ * the hub has released the previous one. The frames are sent to every port
+ * of the hub. */
+class CanReplay : public StateFlowBase
+{
+public:
+    /// Constructor. Starts the replay on the executor of the hub.
+    ///
+    /// @param hub where to send the frames.
+    /// @param path name of the capture file.
+    /// @param speed 1 to keep the timing of the capture, 2 to go twice as
+    /// fast etc. 0 to send the frames as fast as the hub takes them.
+    /// @param done if not null, will be notified when all frames were sent,
+    /// or immediately if the file cannot be used.
+    CanReplay(CanHubFlow *hub, const string &path, double speed,
+        Notifiable *done = nullptr);
+
+    /// Stops the replay if it is still running. Must not be called on the
+    /// executor of the hub.
+    ~CanReplay();
+
+    /// @return false if the file could not be opened or is not a capture
+    /// file.
+    bool is_valid()
+    {
+        return data_ != nullptr;
+    }
+
+    /// @return true if all frames were sent or the replay was stopped.
+    bool is_done()
+    {
+        return done_;
+    }
+
+    /// @return number of frames sent so far.
+    unsigned frames()
+    {
+        return frames_;
+    }
+
+private:
+    /// Most frames sent in one batch.
+    static constexpr unsigned BATCH = 64;
+
+    /// Sends the next batch of due frames.
+    Action send_batch();
+
+    /// Finishes the replay.
+    Action finish();
+
+    /// Where to send the frames.
+    CanHubFlow *hub_;
+    /// Timing scale, or 0 for no timing.
+    double speed_;
+    /// Notified when done.
+    Notifiable *doneNotify_;
+    /// The mapped file, or nullptr.
+    const uint8_t *data_ {nullptr};
+    /// Length of the file.
+    size_t size_ {0};
+    /// Offset of the next record.
+    size_t ofs_ {CAN_CAPTURE_HEADER_SIZE};
+    /// Capture time of the last record sent, usec since the file start.
+    uint64_t fileUsec_ {0};
+    /// Monotonic time when the replay started, nsec.
+    long long start_;
+    /// Number of frames sent.
+    std::atomic<unsigned> frames_ {0};
+    /// Set when the replay finished.
+    std::atomic<bool> done_ {false};
+    /// Set by the destructor.
+    std::atomic<bool> stop_ {false};
+    /// Tracks when the hub released a batch.
+    BarrierNotifiable bn_;
+    /// For waiting until the next frame is due.
+    StateFlowTimer timer_ {this};
+};
+
+#endif // OPENMRN_HAVE_MMAP
+
+#endif // _UTILS_CANCAPTURE_HXX_
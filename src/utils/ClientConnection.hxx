@@ -35,6 +35,7 @@
 #ifndef _UTILS_CLIENTCONNECTION_HXX_
 #define _UTILS_CLIENTCONNECTION_HXX_
 
+#include "utils/BinaryCanHub.hxx"
 #include "utils/GridConnectHub.hxx"
 #include <stdio.h>
 #include <termios.h> /* tc* functions */
@@ -90,9 +91,13 @@ public:
     ///
     /// @param name user-readable name for this port.
     /// @param hub CAN packet hub to connect this port to
-    GCFdConnectionClient(const string &name, CanHubFlow *hub)
+    /// @param binary if true, the connection uses the binary CAN protocol
+    /// (see BinaryCanHub.hxx) instead of GridConnect.
+    GCFdConnectionClient(const string &name, CanHubFlow *hub,
+        bool binary = false)
         : closedNotify_(&fd_, name)
         , hub_(hub)
+        , binary_(binary)
     {
     }
 
@@ -121,7 +126,14 @@ protected:
     void connection_complete(int fd)
     {
         fd_ = fd;
-        create_gc_port_for_can_hub(hub_, fd, &closedNotify_);
+        if (binary_)
+        {
+            create_binary_can_port_for_can_hub(hub_, fd, &closedNotify_);
+        }
+        else
+        {
+            create_gc_port_for_can_hub(hub_, fd, &closedNotify_);
+        }
     }
 
 private:
@@ -132,6 +144,8 @@ private:
     int fd_{-1};
     /// CAN hub to read-write data to.
     CanHubFlow *hub_;
+    /// True if the binary CAN protocol is used.
+    bool binary_;
 };
 
 /// Connection client that opens a character device (such as an usb-serial) and
@@ -197,9 +211,11 @@ public:
     /// @param hub CAN hub to connect device to
     /// @param host where to connect to
     /// @param port where to connect to
-    UpstreamConnectionClient(
-        const string &name, CanHubFlow *hub, const string &host, int port)
-        : GCFdConnectionClient(name, hub)
+    /// @param binary if true, uses the binary CAN protocol instead of
+    /// GridConnect. The upstream has to be a BinaryCanTcpHub.
+    UpstreamConnectionClient(const string &name, CanHubFlow *hub,
+        const string &host, int port, bool binary = false)
+        : GCFdConnectionClient(name, hub, binary)
         , host_(host)
         , port_(port)
     {
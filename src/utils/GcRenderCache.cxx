@@ -0,0 +1,113 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file GcRenderCache.cxx
+ *
+ * Shared cache of GridConnect renderings of CAN frames.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "utils/GcRenderCache.hxx"
+
+#include <string.h>
+
+#include "can_frame.h"
+
+constexpr unsigned GcRenderCache::NUM_ENTRIES;
+constexpr uint8_t GcRenderCache::NOT_RENDERED;
+
+GcRenderCache::GcRenderCache()
+    : next_(0)
+    , hits_(0)
+    , misses_(0)
+{
+    for (unsigned i = 0; i < NUM_ENTRIES; ++i)
+    {
+        entries_[i].dlc = 0xFF;
+    }
+}
+
+size_t GcRenderCache::render(
+    const struct can_frame *frame, int double_format, char *buf)
+{
+    if (IS_CAN_FRAME_ERR(*frame))
+    {
+        return 0;
+    }
+    uint32_t id;
+    if (IS_CAN_FRAME_EFF(*frame))
+    {
+        id = GET_CAN_FRAME_ID_EFF(*frame) | (UINT32_C(1) << 31);
+    }
+    else
+    {
+        id = GET_CAN_FRAME_ID(*frame);
+    }
+    if (IS_CAN_FRAME_RTR(*frame))
+    {
+        id |= UINT32_C(1) << 30;
+    }
+    uint8_t dlc = frame->can_dlc > 8 ? 8 : frame->can_dlc;
+    uint64_t data = 0;
+    memcpy(&data, frame->data, dlc);
+    unsigned v = double_format ? 1 : 0;
+
+    AtomicHolder h(&lock_);
+    Entry *e = nullptr;
+    // Searches backwards from the newest entry, which is the likely hit.
+    for (unsigned i = 1; i <= NUM_ENTRIES; ++i)
+    {
+        Entry *c = entries_ + ((next_ + NUM_ENTRIES - i) % NUM_ENTRIES);
+        if (c->id == id && c->dlc == dlc && c->data == data)
+        {
+            e = c;
+            break;
+        }
+    }
+    if (!e)
+    {
+        e = entries_ + next_;
+        next_ = (next_ + 1) % NUM_ENTRIES;
+        e->id = id;
+        e->dlc = dlc;
+        e->data = data;
+        e->len[0] = e->len[1] = NOT_RENDERED;
+    }
+    char *text = v ? e->dbl : e->single;
+    if (e->len[v] == NOT_RENDERED)
+    {
+        ++misses_;
+        e->len[v] = gc_format_generate(frame, text, double_format) - text;
+    }
+    else
+    {
+        ++hits_;
+    }
+    memcpy(buf, text, e->len[v]);
+    return e->len[v];
+}
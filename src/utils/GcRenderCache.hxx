@@ -0,0 +1,133 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file GcRenderCache.hxx
+ *
+ * Shared cache of GridConnect renderings of CAN frames. Lets the GridConnect
+ * ports of a hub format each frame only once, no matter how many clients are
+ * connected.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#ifndef _UTILS_GCRENDERCACHE_HXX_
+#define _UTILS_GCRENDERCACHE_HXX_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/Atomic.hxx"
+#include "utils/gc_format.h"
+#include "utils/macros.h"
+
+struct can_frame;
+
+/// Remembers the GridConnect text of the most recently rendered CAN frames.
+///
+/// A CAN hub sends every frame to every registered port. When many GridConnect
+/// ports (e.g. the clients of a GcTcpHub) are attached to the same hub, they
+/// all render the same frame one after the other. If these ports share a
+/// GcRenderCache, only the first one runs gc_format_generate; the others copy
+/// the stored text.
+///
+/// Entries are keyed by the frame contents (identifier, flags and payload),
+/// not the buffer address, so no reference to the CAN buffer is held. Each
+/// entry stores the single and the double format separately, both rendered
+/// lazily. The newline setting is the global gc_generate_newlines constant,
+/// thus it is the same for all entries.
+///
+/// Thread-safe; the ports may run on different executor threads.
+class GcRenderCache
+{
+public:
+    /// How many recent frames are remembered. The hub delivers a frame to all
+    /// ports before the next frames catch up, so a few entries are plenty.
+    static constexpr unsigned NUM_ENTRIES = 8;
+
+    GcRenderCache();
+
+    /// Renders a CAN frame in GridConnect format, from the cache if possible.
+    /// @param frame is the frame to render.
+    /// @param double_format if non-zero, the doubling format is generated.
+    /// @param buf will receive the output. Must have space for
+    /// GC_FORMAT_MAX_FRAME_LENGTH characters (twice that for the double
+    /// format).
+    /// @return the number of characters written to buf; 0 for error frames.
+    size_t render(const struct can_frame *frame, int double_format, char *buf);
+
+    /// @return how many render() calls were served from the cache.
+    uint32_t hits()
+    {
+        AtomicHolder h(&lock_);
+        return hits_;
+    }
+
+    /// @return how many render() calls had to format the frame.
+    uint32_t misses()
+    {
+        AtomicHolder h(&lock_);
+        return misses_;
+    }
+
+private:
+    /// Marks a format in Entry::len that was not rendered yet.
+    static constexpr uint8_t NOT_RENDERED = 0xFF;
+
+    /// One remembered frame.
+    struct Entry
+    {
+        /// CAN identifier, with bit 31 set for extended frames and bit 30 set
+        /// for remote frames.
+        uint32_t id;
+        /// Number of payload bytes. 0xFF for an unused entry.
+        uint8_t dlc;
+        /// Length of the rendered text for the single (0) and double (1)
+        /// format, or NOT_RENDERED.
+        uint8_t len[2];
+        /// Payload bytes, the ones after dlc zeroed.
+        uint64_t data;
+        /// Rendered text for the single format.
+        char single[GC_FORMAT_MAX_FRAME_LENGTH];
+        /// Rendered text for the double format.
+        char dbl[2 * GC_FORMAT_MAX_FRAME_LENGTH];
+    };
+
+    /// Protects all fields below.
+    Atomic lock_;
+    /// Remembered frames.
+    Entry entries_[NUM_ENTRIES];
+    /// Index of the entry to be overwritten next.
+    unsigned next_;
+    /// Number of renderings served from the cache.
+    uint32_t hits_;
+    /// Number of renderings that had to be formatted.
+    uint32_t misses_;
+
+    DISALLOW_COPY_AND_ASSIGN(GcRenderCache);
+};
+
+#endif // _UTILS_GCRENDERCACHE_HXX_
@@ -32,11 +32,47 @@
  * @date 26 May 2016
  */
 
+#include <string.h>
 #include <string>
 
 #include "utils/GcStreamParser.hxx"
+#include "can_frame.h"
 #include "utils/gc_format.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/// Finds the next frame boundary character.
+/// @param p first character to look at.
+/// @param end end of the buffer.
+/// @return pointer to the first ':' or ';' in [p, end), or end if none.
+static const char *find_delimiter(const char *p, const char *end)
+{
+#if defined(__SSE2__)
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i semicolon = _mm_set1_epi8(';');
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i c = _mm_loadu_si128((const __m128i *)p);
+        int mask = _mm_movemask_epi8(_mm_or_si128(
+            _mm_cmpeq_epi8(c, colon), _mm_cmpeq_epi8(c, semicolon)));
+        if (mask)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+#endif
+    for (; p < end; ++p)
+    {
+        if (*p == ':' || *p == ';')
+        {
+            break;
+        }
+    }
+    return p;
+}
+
 bool GcStreamParser::consume_byte(char c)
 {
     if (c == ':')
@@ -87,3 +123,68 @@ bool GcStreamParser::parse_frame_to_output(struct can_frame* output_frame) {
     int ret = gc_format_parse(cbuf_, output_frame);
     return (ret == 0);
 }
+
+size_t GcStreamParser::parse_bulk(const char *buf, size_t len,
+    struct can_frame *frames, size_t max_frames, size_t *consumed)
+{
+    const char *p = buf;
+    const char *end = buf + len;
+    size_t count = 0;
+    while (p < end && count < max_frames)
+    {
+        if (offset_ < 0)
+        {
+            // Not in a frame; look for the next start.
+            p = static_cast<const char *>(memchr(p, ':', end - p));
+            if (!p)
+            {
+                p = end;
+                break;
+            }
+            ++p;
+            offset_ = 0;
+            continue;
+        }
+        const char *d = find_delimiter(p, end);
+        size_t n = d - p;
+        if (offset_ + n >= sizeof(cbuf_))
+        {
+            // We overran the buffer, so this can't be a valid frame. Same as
+            // in consume_byte: look for the sync byte again.
+            offset_ = -1;
+            p = d;
+            continue;
+        }
+        if (d == end)
+        {
+            // Partial frame; the rest comes in the next buffer.
+            memcpy(cbuf_ + offset_, p, n);
+            offset_ += n;
+            p = end;
+            break;
+        }
+        if (*d == ':')
+        {
+            // A new frame is starting; drop the partial one.
+            offset_ = 0;
+            p = d + 1;
+            continue;
+        }
+        const char *frame = p;
+        if (offset_ > 0)
+        {
+            // Completes the frame started in a previous buffer.
+            memcpy(cbuf_ + offset_, p, n);
+            n += offset_;
+            frame = cbuf_;
+        }
+        offset_ = -1;
+        p = d + 1;
+        if (gc_format_parse_len(frame, n, frames + count) == 0)
+        {
+            ++count;
+        }
+    }
+    *consumed = p - buf;
+    return count;
+}
@@ -35,8 +35,11 @@
 #ifndef _UTILS_GCSTREAMPARSER_HXX_
 #define _UTILS_GCSTREAMPARSER_HXX_
 
+#include <stddef.h>
 #include <string>
 
+struct can_frame;
+
 /**
    Parses a sequence of characters; finds GridConnect protocol packet
    boundaries in the sequence of packets. Contains an internal buffer holding
@@ -66,9 +69,26 @@ public:
      * the frame is set to an error frame. */
     bool parse_frame_to_output(struct can_frame *output_frame);
 
-    /** @param payload fills with the current contents of the frame buffer. */
+    /** @param payload fills with the current contents of the frame buffer.
+     * Only valid when the frame was found by consume_byte(). */
     void frame_buffer(std::string *payload);
 
+    /** Finds and parses all complete frames in a buffer of incoming
+     * characters. Frames that are only partially contained in the buffer are
+     * kept and completed by the next call (or by consume_byte()). Frames with
+     * a parse error are dropped.
+     *
+     * @param buf the incoming characters.
+     * @param len number of characters in buf.
+     * @param frames output array for the parsed frames.
+     * @param max_frames number of entries in frames. Parsing stops when the
+     * array is full.
+     * @param consumed will be set to the number of characters processed. If
+     * less than len, the caller should call again with the rest.
+     * @return the number of frames written to frames. */
+    size_t parse_bulk(const char *buf, size_t len, struct can_frame *frames,
+        size_t max_frames, size_t *consumed);
+
 private:
     /// Collects data from a partial GC packet.
     char cbuf_[32];
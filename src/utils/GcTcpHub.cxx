@@ -36,17 +36,52 @@
 #include "utils/GcTcpHub.hxx"
 
 #include "nmranet_config.h"
+#include "utils/GcRenderCache.hxx"
 #include "utils/GridConnectHub.hxx"
+#include "utils/ShardedCanHub.hxx"
+
+/// @param count how many caches to create. @return the rendering caches for
+/// the shards. Created before the listener starts, so that a connection never
+/// sees a missing cache.
+static std::vector<std::shared_ptr<GcRenderCache>> make_render_caches(
+    unsigned count)
+{
+    std::vector<std::shared_ptr<GcRenderCache>> ret(count);
+    for (auto &c : ret)
+    {
+        c.reset(new GcRenderCache());
+    }
+    return ret;
+}
 
 void GcTcpHub::OnNewConnection(int fd)
 {
     const bool use_select =
         (config_gridconnect_tcp_use_select() == CONSTANT_TRUE);
-    create_gc_port_for_can_hub(canHub_, fd, nullptr, use_select);
+    if (shards_)
+    {
+        unsigned i = shards_->next_shard();
+        create_gc_port_for_can_hub(shards_->shard(i), fd, nullptr, use_select,
+            renderCaches_[i], true);
+        return;
+    }
+    create_gc_port_for_can_hub(
+        canHub_, fd, nullptr, use_select, renderCaches_[0], true);
 }
 
 GcTcpHub::GcTcpHub(CanHubFlow *can_hub, int port)
     : canHub_(can_hub)
+    , shards_(nullptr)
+    , renderCaches_(make_render_caches(1))
+    , tcpListener_(port, std::bind(&GcTcpHub::OnNewConnection, this,
+                                   std::placeholders::_1))
+{
+}
+
+GcTcpHub::GcTcpHub(ShardedCanHub *shards, int port)
+    : canHub_(shards->shard(0))
+    , shards_(shards)
+    , renderCaches_(make_render_caches(shards->size()))
     , tcpListener_(port, std::bind(&GcTcpHub::OnNewConnection, this,
                                    std::placeholders::_1))
 {
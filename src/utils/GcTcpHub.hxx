@@ -34,15 +34,21 @@
 #ifndef _UTILS_GCTCPHUB_HXX_
 #define _UTILS_GCTCPHUB_HXX_
 
+#include <memory>
+#include <vector>
+
 #include "utils/socket_listener.hxx"
 #include "utils/Hub.hxx"
 
 class ExecutorBase;
+class GcRenderCache;
+class ShardedCanHub;
 
 /** This class runs a CAN-bus HUB listening on TCP socket using the gridconnect
  * format. Any new incoming connection will be wired into the same virtual CAN
  * hub. All packets will be forwarded to every participant, without
- * loopback. */
+ * loopback. The connections share one GcRenderCache, so every CAN frame is
+ * rendered to text only once, regardless of the number of clients. */
 class GcTcpHub
 {
 public:
@@ -52,6 +58,14 @@ public:
     /// onto.
     /// @param port TCp port number to listen on.
     GcTcpHub(CanHubFlow *can_hub, int port);
+
+    /// Constructor for a sharded hub. The incoming connections are assigned
+    /// to the shards round-robin. Each shard has its own rendering cache.
+    ///
+    /// @param shards the sharded CAN hub to attach the connections to.
+    /// @param port TCP port number to listen on.
+    GcTcpHub(ShardedCanHub *shards, int port);
+
     ~GcTcpHub();
 
     /// @return true of the listener is ready to accept incoming connections.
@@ -60,6 +74,13 @@ public:
         return tcpListener_.is_started();
     }
 
+    /// @return the rendering cache shared by the connections (of the first
+    /// shard).
+    GcRenderCache *render_cache()
+    {
+        return renderCaches_[0].get();
+    }
+
 private:
     /// Callback when a new connection arrives.
     ///
@@ -70,6 +91,11 @@ private:
     /// @param can_hub Which CAN-hub should we attach the TCP gridconnect hub
     /// onto.
     CanHubFlow *canHub_;
+    /// If not null, the connections are distributed over these shards.
+    ShardedCanHub *shards_;
+    /// Shared by all connections (of a shard), indexed by the shard
+    /// number. Reference counted, because the connections may outlive *this.
+    std::vector<std::shared_ptr<GcRenderCache>> renderCaches_;
     /// Helper object representing the listening on the socket.
     SocketListener tcpListener_;
 };
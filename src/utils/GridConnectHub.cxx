@@ -47,6 +47,7 @@
 #include "utils/HubDeviceSelect.hxx"
 #endif
 #include "utils/Hub.hxx"
+#include "utils/GcRenderCache.hxx"
 #include "utils/GcStreamParser.hxx"
 #include "utils/gc_format.h"
 
@@ -61,12 +62,25 @@ public:
     /// @param can_side A hub of type struct can_frame, the binary side.
     /// @param double_bytes if true, upon rendering data each byte will be
     /// doubled. This is an anciant workaround.
-    GCAdapter(HubFlow *gc_side, CanHubFlow *can_side, bool double_bytes)
+    /// @param render_cache if not null, frames are rendered via this cache.
+    /// @param limits if not null, the formatter is registered to can_side
+    /// with a bounded output queue.
+    GCAdapter(HubFlow *gc_side, CanHubFlow *can_side, bool double_bytes,
+        std::shared_ptr<GcRenderCache> render_cache,
+        const HubPortLimits *limits = nullptr)
         : parser_(can_side->service(), can_side, &formatter_)
-        , formatter_(can_side->service(), gc_side, &parser_, double_bytes)
+        , formatter_(can_side->service(), gc_side, &parser_, double_bytes,
+              std::move(render_cache))
     {
         gc_side->register_port(&parser_);
-        can_side->register_port(&formatter_);
+        if (limits)
+        {
+            can_side->register_port(&formatter_, *limits);
+        }
+        else
+        {
+            can_side->register_port(&formatter_);
+        }
         isRegistered_ = 1;
     }
 
@@ -79,10 +93,13 @@ public:
     /// @param can_side  A hub of type struct can_frame, the binary side.
     /// @param double_bytes  if true, upon rendering data each byte will be
     /// doubled. This is an anciant workaround.
+    /// @param render_cache if not null, frames are rendered via this cache.
     GCAdapter(HubFlow *gc_side_read, HubFlow *gc_side_write,
-        CanHubFlow *can_side, bool double_bytes)
+        CanHubFlow *can_side, bool double_bytes,
+        std::shared_ptr<GcRenderCache> render_cache)
         : parser_(can_side->service(), can_side, &formatter_)
-        , formatter_(can_side->service(), gc_side_write, &parser_, double_bytes)
+        , formatter_(can_side->service(), gc_side_write, &parser_, double_bytes,
+              std::move(render_cache))
     {
         gc_side_read->register_port(&parser_);
         can_side->register_port(&formatter_);
@@ -126,14 +143,19 @@ public:
         /// packets to.
         /// @param double_bytes if true, upon rendering data each byte will be
         /// doubled. This is an anciant workaround.
+        /// @param render_cache if not null, the rendering is looked up in
+        /// (and stored to) this cache shared with other ports of the same
+        /// CAN hub.
         BinaryToGCMember(Service *service, HubFlow *destination,
-            HubPort *skip_member, int double_bytes)
+            HubPort *skip_member, int double_bytes,
+            std::shared_ptr<GcRenderCache> render_cache)
             : CanHubPort(service)
             , delayPort_(service, destination, config_gridconnect_buffer_size(),
                   USEC_TO_NSEC(config_gridconnect_buffer_delay_usec()))
             , destination_(destination)
             , skipMember_(skip_member)
             , double_bytes_(double_bytes)
+            , renderCache_(std::move(render_cache))
         {
         }
 
@@ -151,9 +173,17 @@ public:
         {
             LOG(VERBOSE, "can packet arrived: %" PRIx32,
                 GET_CAN_FRAME_ID_EFF(*message()->data()));
-            char *end =
-                gc_format_generate(message()->data(), dbuf_, double_bytes_);
-            size_t size = (end - dbuf_);
+            size_t size;
+            if (renderCache_)
+            {
+                size = renderCache_->render(
+                    message()->data(), double_bytes_, dbuf_);
+            }
+            else
+            {
+                size = gc_format_generate(
+                           message()->data(), dbuf_, double_bytes_) - dbuf_;
+            }
             if (size)
             {
                 Buffer<HubData> *target_buffer = nullptr;
@@ -186,13 +216,15 @@ public:
         /// individual packets by delaying data a little bit.
         BufferPort delayPort_;
         /// Destination buffer (characters).
-        char dbuf_[56];
+        char dbuf_[2 * GC_FORMAT_MAX_FRAME_LENGTH];
         /// Pipe to send data to.
         HubFlow *destination_;
         /// The pipe member that should be sent as "source".
         HubPort *skipMember_;
         /// Non-zero if doubling was requested.
         int double_bytes_;
+        /// Shared rendering cache, or null.
+        std::shared_ptr<GcRenderCache> renderCache_;
         /// Helper object
         BarrierNotifiable bn_;
     };
@@ -241,42 +273,38 @@ public:
         /// frames. @return next state.
         Action parse_more_data()
         {
-            while (inBufSize_--)
+            size_t consumed;
+            size_t found = streamSegmenter_.parse_bulk(
+                inBuf_, inBufSize_, &frame_, 1, &consumed);
+            inBuf_ += consumed;
+            inBufSize_ -= consumed;
+            if (found)
             {
-                char c = *inBuf_++;
-                if (streamSegmenter_.consume_byte(c))
-                {
-                    // End of frame. Allocate an output buffer and parse the
-                    // frame.
-                    return allocate_and_call(destination_, STATE(parse_to_output_frame), frameAllocator_.get());
-                }
+                // Allocate an output buffer for the parsed frame.
+                return allocate_and_call(destination_,
+                    STATE(send_output_frame), frameAllocator_.get());
             }
             // Will notify the caller.
             return release_and_exit();
         }
 
-        /** Takes the completed frame in cbuf_, parses it into the allocation
-         * result (a can pipe buffer) and sends off frame. Then comes back to
-         * process buffer. @return next state. */
-        Action parse_to_output_frame()
+        /** Copies the parsed frame into the allocation result (a can pipe
+         * buffer) and sends off frame. Then comes back to process buffer.
+         * @return next state. */
+        Action send_output_frame()
         {
             auto* b = get_allocation_result(destination_);
-            if (streamSegmenter_.parse_frame_to_output(b->data()))
-            {
-                b->data()->skipMember_ = skipMember_;
-                destination_->send(b);
-            }
-            else
-            {
-                // Releases the buffer.
-                b->unref();
-            }
+            *b->data()->mutable_frame() = frame_;
+            b->data()->skipMember_ = skipMember_;
+            destination_->send(b);
             return call_immediately(STATE(parse_more_data));
         }
 
     private:
         /// Holds the state of the incoming characters and the boundary.
         GcStreamParser streamSegmenter_;
+        /// The frame that was parsed last.
+        struct can_frame frame_;
         
         /// The incoming characters.
         const char *inBuf_;
@@ -305,18 +333,19 @@ private:
 };
 
 GCAdapterBase *GCAdapterBase::CreateGridConnectAdapter(HubFlow *gc_side,
-                                                       CanHubFlow *can_side,
-                                                       bool double_bytes)
+    CanHubFlow *can_side, bool double_bytes,
+    std::shared_ptr<GcRenderCache> render_cache)
 {
-    return new GCAdapter(gc_side, can_side, double_bytes);
+    return new GCAdapter(
+        gc_side, can_side, double_bytes, std::move(render_cache));
 }
 
 GCAdapterBase *GCAdapterBase::CreateGridConnectAdapter(HubFlow *gc_side_read,
-                                                       HubFlow *gc_side_write,
-                                                       CanHubFlow *can_side,
-                                                       bool double_bytes)
+    HubFlow *gc_side_write, CanHubFlow *can_side, bool double_bytes,
+    std::shared_ptr<GcRenderCache> render_cache)
 {
-    return new GCAdapter(gc_side_read, gc_side_write, can_side, double_bytes);
+    return new GCAdapter(gc_side_read, gc_side_write, can_side, double_bytes,
+        std::move(render_cache));
 }
 
 /// Implementation for the gridconnect bridge. Owns all necessary structures,
@@ -398,12 +427,21 @@ struct GcHubPort : public Executable
     /// experiences an error (typically upon device closed or connection lost).
     /// @param use_select true if fd can be used with select, false if threads
     /// are needed.
-    GcHubPort(CanHubFlow *can_hub, int fd, Notifiable *on_exit, bool use_select)
+    /// @param render_cache if not null, rendering cache shared with the other
+    /// ports of can_hub.
+    /// @param client_limits if true, the output queue in can_hub is bounded by
+    /// the hub_port_queue_* constants.
+    GcHubPort(CanHubFlow *can_hub, int fd, Notifiable *on_exit, bool use_select,
+        std::shared_ptr<GcRenderCache> render_cache, bool client_limits)
         : gcHub_(can_hub->service())
-        , bridge_(
-              GCAdapterBase::CreateGridConnectAdapter(&gcHub_, can_hub, false))
+        , disconnect_(fd)
         , onExit_(on_exit)
     {
+        HubPortLimits limits;
+        bool limited = client_limits &&
+            hub_port_limits_from_config(&limits, &disconnect_);
+        bridge_.reset(new GCAdapter(&gcHub_, can_hub, false,
+            std::move(render_cache), limited ? &limits : nullptr));
         LOG(VERBOSE, "gchub port %p", (Executable *)this);
         if (use_select) {
 #ifndef OPENMRN_FEATURE_EXECUTOR_SELECT
@@ -426,6 +464,9 @@ struct GcHubPort : public Executable
      * disconnection of the bridge (write side) and the FdHubport (read side)
      * we need to wait for the executor until this flow drains. */
     HubFlow gcHub_;
+    /** Closes the connection if the output queue of the port in the CAN hub
+     * overflows. */
+    FdShutdownNotifiable disconnect_;
     /** Translates packets between the can-hub of the device and the char-hub
      * of this port.
      *
@@ -472,8 +513,10 @@ struct GcHubPort : public Executable
     }
 };
 
-void create_gc_port_for_can_hub(
-    CanHubFlow *can_hub, int fd, Notifiable *on_exit, bool use_select)
+void create_gc_port_for_can_hub(CanHubFlow *can_hub, int fd,
+    Notifiable *on_exit, bool use_select,
+    std::shared_ptr<GcRenderCache> render_cache, bool client_limits)
 {
-    new GcHubPort(can_hub, fd, on_exit, use_select);
+    new GcHubPort(can_hub, fd, on_exit, use_select, std::move(render_cache),
+        client_limits);
 }
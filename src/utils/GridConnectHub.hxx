@@ -38,6 +38,7 @@
 
 #include "utils/Hub.hxx"
 
+class GcRenderCache;
 class Pipe;
 template <class T> class FlowInterface;
 template <class T, int N> class DispatchFlow;
@@ -77,12 +78,16 @@ public:
        @param double_bytes if true, any frame rendered into the GC protocol
        will have their characters doubled.
 
+       @param render_cache if not null, frames are rendered through this
+       cache. Share one cache between all adapters of the same CAN hub to
+       format each frame only once.
+
        @return a pointer to the created object. It can be deleted, which will
        terminate the link and unregister the link members from both pipes.
     */
     static GCAdapterBase *CreateGridConnectAdapter(HubFlow *gc_side,
-                                                   CanHubFlow *can_side,
-                                                   bool double_bytes);
+        CanHubFlow *can_side, bool double_bytes,
+        std::shared_ptr<GcRenderCache> render_cache = nullptr);
 
     /// Creates a gridconnect-CAN bridge with separate pipes for reading
     /// (parsing) from the GC side and writing (formatting) to the GC side. */
@@ -95,12 +100,15 @@ public:
     /// is done via.
     /// @param double_bytes  if true, any frame rendered into the GC protocol
     ///   will have their characters doubled.
+    /// @param render_cache if not null, frames are rendered through this
+    ///   cache, see above.
     ///
     /// @return a pointer to the created object. It can be deleted, which will
     ///   terminate the link and unregister the link members from both pipes.
     ///
     static GCAdapterBase *CreateGridConnectAdapter(HubFlow *gc_side_read,
-        HubFlow *gc_side_write, CanHubFlow *can_side, bool double_bytes);
+        HubFlow *gc_side_write, CanHubFlow *can_side, bool double_bytes,
+        std::shared_ptr<GcRenderCache> render_cache = nullptr);
 };
 
 /** Create this port for a CAN hub and all packets will be written to stdout in
@@ -135,8 +143,16 @@ private:
  * @param on_exit is a notifiable (may be null) which will be called in case
  * an error is encountered on this port and the port is subsequently closed.
  * @param use_select when true, the FD will be used with select, when false,
- * separate threads will be started with blocking read and write calls. */
+ * separate threads will be started with blocking read and write calls.
+ * @param render_cache if not null, the outgoing frames are rendered through
+ * this cache, which is shared with the other ports of can_hub. The port keeps
+ * a reference to the cache.
+ * @param client_limits if true, the output queue of the port is bounded by
+ * the hub_port_queue_* constants. Meant for the connections accepted by a
+ * server; device and upstream links are better served without limits. */
 void create_gc_port_for_can_hub(CanHubFlow *can_hub, int fd,
-    Notifiable *on_exit = nullptr, bool use_select = false);
+    Notifiable *on_exit = nullptr, bool use_select = false,
+    std::shared_ptr<GcRenderCache> render_cache = nullptr,
+    bool client_limits = false);
 
 #endif //_UTILS_GRIDCONNECTHUB_HXX_
@@ -39,6 +39,7 @@
 
 #include "executor/Dispatcher.hxx"
 #include "can_frame.h"
+#include "utils/HubPortQueue.hxx"
 
 class PipeBuffer;
 class PipeMember;
@@ -162,6 +163,12 @@ public:
         this->negateMatch_ = true;
     }
 
+    /// Destructor. All ports must have been unregistered and drained.
+    ~GenericHubFlow()
+    {
+        delete queues_.load();
+    }
+
     /// Adds a new port. After add return, all messages puslished to the hub
     /// will be sent to 'port'. @param port is the object to add.
     void register_port(port_type *port)
@@ -170,12 +177,91 @@ public:
                                POINTER_MASK);
     }
 
+    /// Adds a new port with a bounded output queue. The hub holds at most
+    /// the given amount of messages for this port; see HubQueuePolicy for
+    /// what happens with the rest.
+    /// @param port is the object to add.
+    /// @param limits the limits and policy of the queue.
+    void register_port(port_type *port, const HubPortLimits &limits)
+    {
+        HubPortQueueSet *set = queues_.load();
+        if (!set)
+        {
+            HubPortQueueSet *n = new HubPortQueueSet();
+            if (queues_.compare_exchange_strong(set, n))
+            {
+                set = n;
+            }
+            else
+            {
+                delete n;
+            }
+        }
+        auto *q = new HubPortQueue<buffer_type>(port, limits, set);
+        set->add(q);
+        this->register_handler(
+            q, reinterpret_cast<uintptr_t>(port), POINTER_MASK);
+    }
+
     /// Removes a previously added port. @param port is the port to remove.
     void unregister_port(port_type *port)
     {
+        HubPortQueueSet *set = queues_.load();
+        HubPortQueueBase *q = set ? set->remove(port) : nullptr;
+        if (q)
+        {
+            this->unregister_handler(
+                static_cast<HubPortQueue<buffer_type> *>(q),
+                reinterpret_cast<uintptr_t>(port), POINTER_MASK);
+            q->detach();
+            return;
+        }
         this->unregister_handler(port, reinterpret_cast<uintptr_t>(port),
                                  POINTER_MASK);
     }
+
+    /// Reads the counters of a port registered with limits.
+    /// @param port the port.
+    /// @param stats will be filled in.
+    /// @return false if the port was not registered with limits.
+    bool port_stats(port_type *port, HubPortStats *stats)
+    {
+        HubPortQueueSet *set = queues_.load();
+        return set && set->port_stats(port, stats);
+    }
+
+    /// Reads the counters of all ports registered with limits.
+    /// @param stats will be filled in.
+    void all_port_stats(std::vector<HubPortStats> *stats)
+    {
+        HubPortQueueSet *set = queues_.load();
+        if (set)
+        {
+            set->all_port_stats(stats);
+        }
+        else
+        {
+            stats->clear();
+        }
+    }
+
+protected:
+    /// Holds back the next message while a port with HubQueuePolicy::BLOCK
+    /// is full. @return next action.
+    StateFlowBase::Action entry() override
+    {
+        HubPortQueueSet *set = queues_.load();
+        if (set && !set->may_proceed(this))
+        {
+            return this->wait();
+        }
+        return DispatchFlow<Buffer<D>, 1>::entry();
+    }
+
+private:
+    /// Queues of the ports registered with limits. Created with the first
+    /// such port.
+    std::atomic<HubPortQueueSet *> queues_ {nullptr};
 };
 
 /** A generic hub that proxies packets of untyped (aka string) data. */
@@ -39,9 +39,42 @@
 #include "openmrn_features.h"
 #include "utils/Hub.hxx"
 #include "executor/SemaphoreNotifiableBlock.hxx"
+#include "utils/logging.h"
+
+#if OPENMRN_FEATURE_BSD_SOCKETS
+#include <sys/socket.h>
+#endif
 
 template <class Data> class FdHubWriteFlow;
 
+/// Notifiable that shuts down a socket, which makes the FdHubPort or
+/// HubDeviceSelect using it see an error and exit. Used as
+/// HubPortLimits::onDisconnect for the ports of network connections.
+class FdShutdownNotifiable : public Notifiable
+{
+public:
+    /// Constructor. @param fd the socket.
+    FdShutdownNotifiable(int fd)
+        : fd_(fd)
+    {
+    }
+
+    /// Shuts down the socket.
+    void notify() override
+    {
+#if OPENMRN_FEATURE_BSD_SOCKETS
+        LOG(INFO, "fd %d: output queue overflow, disconnecting.", fd_);
+        ::shutdown(fd_, SHUT_RDWR);
+#else
+        LOG(WARNING, "fd %d: output queue overflow.", fd_);
+#endif
+    }
+
+private:
+    /// The socket.
+    int fd_;
+};
+
 /// Template-nonspecific base class for @ref FdHubPort. The purpose of this
 /// class is to avoid compiling this code multiple times for differently typed
 /// devices (and thus saving flash space).
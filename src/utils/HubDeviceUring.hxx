@@ -0,0 +1,569 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file HubDeviceUring.hxx
+ *
+ * Hub port reading and writing a file descriptor through io_uring.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#ifndef _UTILS_HUBDEVICEURING_HXX_
+#define _UTILS_HUBDEVICEURING_HXX_
+
+#include "utils/IoUring.hxx"
+
+#if OPENMRN_HAVE_IO_URING && defined(OPENMRN_FEATURE_EXECUTOR_SELECT)
+
+#include <errno.h>
+#include <string.h>
+
+#include "utils/HubDeviceSelect.hxx"
+
+/// HubPort that connects a device, socket or pipe to a strongly typed Hub
+/// using an IoUring.
+///
+/// Works like HubDeviceSelect, with the units of reads and writes defined by
+/// the SelectBufferInfo traits of the hub's buffer type. The difference is
+/// that there are no readiness notifications and read or write system calls:
+/// one read is always pending in the kernel, and the writes are handed to the
+/// kernel as operations. All ports sharing an IoUring submit their operations
+/// with one system call per executor round, and all their completions are
+/// collected at once.
+///
+/// Reads go into a registered buffer of the ring, and every read is cut into
+/// as many hub messages as it contains. Writes collect all queued messages
+/// (as long as they fit) into another registered buffer and send them with
+/// one operation.
+template <class HFlow> class HubDeviceUring : public FdHubPortService
+{
+public:
+    /// Buffer type.
+    typedef typename HFlow::buffer_type buffer_type;
+
+    /// Creates a port for the opened device specified by `fd'. The fd will
+    /// be put to blocking mode, so that the kernel waits for the data instead
+    /// of failing the operations with EAGAIN.
+    ///
+    /// @param ring the io_uring to use. Its executor will run the port.
+    /// @param hub the hub to open the port on.
+    /// @param fd the filedes to read/write data from/to.
+    /// @param on_error notifiable that will be called when a write or read
+    /// error is encountered.
+    HubDeviceUring(
+        IoUring *ring, HFlow *hub, int fd, Notifiable *on_error = nullptr)
+        : FdHubPortService(ring->executor(), set_blocking(fd))
+        , ring_(ring)
+        , hub_(hub)
+        , readOp_(this)
+        , writeFlow_(this)
+    {
+        HASSERT(fd_ >= 0);
+        HASSERT(ring_->is_valid());
+        barrier_.reset(
+            on_error ? on_error : EmptyNotifiable::DefaultInstance());
+        barrier_.new_child();
+        hub_->register_port(write_port());
+        executor()->add(new CallbackExecutable([this]() { readOp_.start(); }));
+    }
+
+    /// If the barrier has not been called yet, will notify it inline.
+    ~HubDeviceUring()
+    {
+        if (fd_ >= 0)
+        {
+            unregister_write_port();
+            int fd = -1;
+            executor()->sync_run([this, &fd]() {
+                fd = fd_;
+                fd_ = -1;
+                readOp_.cancel();
+                writeFlow_.cancel();
+            });
+            ::close(fd);
+        }
+        bool completed = false;
+        while (!completed)
+        {
+            executor()->sync_run([this, &completed]() {
+                completed = barrier_.is_done() && !readOp_.active() &&
+                    !writeFlow_.active();
+            });
+        }
+        readOp_.free_buffer();
+        writeFlow_.free_buffer();
+    }
+
+    /// @return parent hub flow.
+    HFlow *hub()
+    {
+        return hub_;
+    }
+
+    /// @return the write flow belonging to this device.
+    typename HFlow::port_type *write_port()
+    {
+        return &writeFlow_;
+    }
+
+    /// @return the counters of the written data. The ratio of syscalls
+    /// (here: write operations) to messages shows how well the writes are
+    /// coalesced.
+    const HubDeviceSelectWriteStats &write_stats()
+    {
+        return writeFlow_.stats();
+    }
+
+private:
+    /// Puts a file descriptor into blocking mode. @param fd the file
+    /// descriptor. @return fd.
+    static int set_blocking(int fd)
+    {
+        int flags = ::fcntl(fd, F_GETFL);
+        ::fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+        return fd;
+    }
+
+    /// Removes the write port from the hub, and queues the marker that
+    /// notifies the barrier after the pending messages.
+    void unregister_write_port()
+    {
+        hub_->unregister_port(&writeFlow_);
+        auto *b = writeFlow_.alloc();
+        b->set_done(&barrier_);
+        writeFlow_.send(b);
+    }
+
+    /// Takes a registered buffer, or if there are none left, allocates one.
+    /// @param index will be set to the buffer index or -1. @return the
+    /// memory.
+    uint8_t *alloc_buffer(int *index)
+    {
+        *index = ring_->alloc_buffer();
+        if (*index >= 0)
+        {
+            return ring_->buffer(*index);
+        }
+        return new uint8_t[ring_->buffer_size()];
+    }
+
+    /// Releases a buffer from alloc_buffer. @param index buffer index or -1.
+    /// @param buf the memory.
+    void free_buffer(int index, uint8_t *buf)
+    {
+        if (index >= 0)
+        {
+            ring_->free_buffer(index);
+        }
+        else
+        {
+            delete[] buf;
+        }
+    }
+
+    /// Keeps one read operation pending in the kernel and forwards the data
+    /// to the hub.
+    class ReadOp : public IoUringOp
+    {
+    public:
+        /// @param dev parent object.
+        ReadOp(HubDeviceUring *dev)
+            : dev_(dev)
+        {
+            buf_ = dev_->alloc_buffer(&bufIndex_);
+        }
+
+        /// Submits a read into the free part of the buffer. Must be called
+        /// on the executor.
+        void start()
+        {
+            active_ = true;
+            dev_->ring_->read(this, dev_->fd_, buf_ + pending_,
+                dev_->ring_->buffer_size() - pending_, bufIndex_);
+        }
+
+        /// Requests the pending read to be cancelled.
+        void cancel()
+        {
+            if (active_)
+            {
+                dev_->ring_->cancel(this);
+            }
+        }
+
+        /// @return true if a read is pending in the kernel.
+        bool active()
+        {
+            return active_;
+        }
+
+        /// Returns the buffer to the ring.
+        void free_buffer()
+        {
+            dev_->free_buffer(bufIndex_, buf_);
+        }
+
+        void complete(int result) override
+        {
+            active_ = false;
+            if (dev_->fd_ < 0)
+            {
+                // Shutting down.
+                notify_barrier();
+                return;
+            }
+            if (result == -EINTR || result == -EAGAIN)
+            {
+                start();
+                return;
+            }
+            if (result <= 0)
+            {
+                // Error or EOF.
+                notify_barrier();
+                dev_->report_read_error();
+                return;
+            }
+            forward(pending_ + result);
+            start();
+        }
+
+    private:
+        /// Sends the complete units of the data in the buffer to the hub and
+        /// keeps the rest for the next read. @param len number of bytes in
+        /// the buffer.
+        void forward(size_t len)
+        {
+            typedef SelectBufferInfo<buffer_type> Info;
+            size_t ofs = 0;
+            while (ofs < len)
+            {
+                buffer_type *b = dev_->hub_->alloc();
+                b->data()->skipMember_ = dev_->write_port();
+                Info::resize_target(b);
+                size_t want = b->data()->size();
+                if (len - ofs < want && Info::needs_read_fully())
+                {
+                    b->unref();
+                    break;
+                }
+                size_t n = std::min(want, len - ofs);
+                memcpy((void *)b->data()->data(), buf_ + ofs, n);
+                Info::check_target_size(b, want - n);
+                dev_->hub_->send(b, 0);
+                ofs += n;
+            }
+            pending_ = len - ofs;
+            if (pending_ && ofs)
+            {
+                memmove(buf_, buf_ + ofs, pending_);
+            }
+        }
+
+        /// Notifies the parent's barrier, but only once in the lifetime of
+        /// *this.
+        void notify_barrier()
+        {
+            if (barrierOwned_)
+            {
+                barrierOwned_ = false;
+                dev_->barrier_.notify();
+            }
+        }
+
+        /// Parent object.
+        HubDeviceUring *dev_;
+        /// Read buffer.
+        uint8_t *buf_;
+        /// Registered buffer index of buf_, or -1.
+        int bufIndex_;
+        /// Bytes at the beginning of buf_ that were not yet forwarded,
+        /// because they are not a complete unit.
+        size_t pending_ {0};
+        /// True while a read is pending in the kernel.
+        bool active_ {false};
+        /// true iff pending parent->barrier_.notify()
+        bool barrierOwned_ {true};
+    };
+
+    /// Base stateflow for the WriteFlow.
+    typedef StateFlow<buffer_type, QList<1>> WriteFlowBase;
+
+    /// State flow collecting the messages of the hub into a buffer and
+    /// writing them out with one operation.
+    class WriteFlow : public WriteFlowBase, public IoUringOp
+    {
+    public:
+        /// Maximum number of messages sent with one operation.
+        static constexpr unsigned MAX_BATCH = 64;
+
+        /// Constructor. @param dev is the parent object.
+        WriteFlow(HubDeviceUring *dev)
+            : WriteFlowBase(dev)
+            , dev_(dev)
+        {
+            buf_ = dev_->alloc_buffer(&bufIndex_);
+        }
+
+        /// Destructor.
+        ~WriteFlow()
+        {
+            HASSERT(this->is_waiting());
+        }
+
+        /// Requests the pending write to be cancelled.
+        void cancel()
+        {
+            if (active_)
+            {
+                dev_->ring_->cancel(this);
+            }
+        }
+
+        /// @return true if a write is pending in the kernel.
+        bool active()
+        {
+            return active_;
+        }
+
+        /// Returns the buffer to the ring.
+        void free_buffer()
+        {
+            dev_->free_buffer(bufIndex_, buf_);
+        }
+
+        /// @return the write counters.
+        const HubDeviceSelectWriteStats &stats()
+        {
+            return stats_;
+        }
+
+        StateFlowBase::Action entry() override
+        {
+            if (dev_->fd_ < 0)
+            {
+                return this->release_and_exit();
+            }
+            numBatch_ = 0;
+            copied_ = 0;
+            len_ = 0;
+            add(this->message());
+            // Stops at the first message that does not fit into the buffer.
+            while (numBatch_ < MAX_BATCH && copied_ == numBatch_)
+            {
+                unsigned prio;
+                BufferBase *m = this->dequeue_message(&prio);
+                if (!m)
+                {
+                    break;
+                }
+                add(static_cast<buffer_type *>(m));
+            }
+            current_ = -1;
+            ofs_ = 0;
+            return this->call_immediately(STATE(do_write));
+        }
+
+        /// Submits the unwritten part of the current piece of data: first
+        /// the buffer with the copied messages, then the messages that did
+        /// not fit, each from where it is. @return next state.
+        StateFlowBase::Action do_write()
+        {
+            if (dev_->fd_ < 0)
+            {
+                return this->call_immediately(STATE(write_done));
+            }
+            const uint8_t *data;
+            size_t len;
+            int index = -1;
+            while (true)
+            {
+                if (current_ < 0)
+                {
+                    data = buf_;
+                    len = len_;
+                    index = bufIndex_;
+                }
+                else
+                {
+                    data = (const uint8_t *)batch_[current_]->data()->data();
+                    len = batch_[current_]->data()->size();
+                    index = -1;
+                }
+                if (ofs_ < len)
+                {
+                    break;
+                }
+                current_ = current_ < 0 ? copied_ : current_ + 1;
+                ofs_ = 0;
+                if (current_ >= (int)numBatch_)
+                {
+                    return this->call_immediately(STATE(write_done));
+                }
+            }
+            ++stats_.syscalls;
+            active_ = true;
+            dev_->ring_->write(this, dev_->fd_, data + ofs_, len - ofs_, index);
+            return this->wait_and_call(STATE(write_complete));
+        }
+
+        void complete(int result) override
+        {
+            active_ = false;
+            result_ = result;
+            this->notify();
+        }
+
+        /// Called when the write operation is done. @return next state.
+        StateFlowBase::Action write_complete()
+        {
+            if (result_ > 0)
+            {
+                stats_.bytes += result_;
+                ofs_ += result_;
+                return this->call_immediately(STATE(do_write));
+            }
+            if (result_ == -EINTR || result_ == -EAGAIN)
+            {
+                return this->call_immediately(STATE(do_write));
+            }
+            if (dev_->fd_ >= 0)
+            {
+                // Error or EOF.
+                hasError_ = true;
+            }
+            return this->call_immediately(STATE(write_done));
+        }
+
+        /// Releases the messages. @return next state.
+        StateFlowBase::Action write_done()
+        {
+            if (hasError_)
+            {
+                hasError_ = false;
+                dev_->report_write_error();
+            }
+            else if (dev_->fd_ >= 0)
+            {
+                stats_.messages += numBatch_;
+            }
+            // The first message is the current message of the flow; the
+            // others were taken from the queue by entry(). They are released
+            // in queue order, because the last one may be the shutdown marker
+            // from unregister_write_port().
+            this->release();
+            for (unsigned i = 1; i < numBatch_; ++i)
+            {
+                batch_[i]->unref();
+            }
+            numBatch_ = 0;
+            return this->exit();
+        }
+
+    private:
+        /// Appends a message to the batch, copying it into the buffer if it
+        /// fits. @param b is the message, ownership is transferred.
+        void add(buffer_type *b)
+        {
+            size_t n = b->data()->size();
+            if (copied_ == numBatch_ && len_ + n <= dev_->ring_->buffer_size())
+            {
+                memcpy(buf_ + len_, b->data()->data(), n);
+                len_ += n;
+                ++copied_;
+            }
+            batch_[numBatch_++] = b;
+        }
+
+        /// Parent object.
+        HubDeviceUring *dev_;
+        /// Write buffer.
+        uint8_t *buf_;
+        /// Registered buffer index of buf_, or -1.
+        int bufIndex_;
+        /// Messages being written. The first one is the current message.
+        buffer_type *batch_[MAX_BATCH];
+        /// Number of entries in batch_.
+        unsigned numBatch_ {0};
+        /// The first this many entries of batch_ are copied into buf_.
+        unsigned copied_ {0};
+        /// Number of bytes in buf_.
+        size_t len_ {0};
+        /// What is being written: -1 for buf_, otherwise an index into
+        /// batch_.
+        int current_ {-1};
+        /// Number of bytes of the current piece already written.
+        size_t ofs_ {0};
+        /// Result of the last write operation.
+        int result_ {0};
+        /// True while a write is pending in the kernel.
+        bool active_ {false};
+        /// True if the write failed.
+        bool hasError_ {false};
+        /// Counters.
+        HubDeviceSelectWriteStats stats_;
+    };
+
+    /// Called by the write flow on a write error. The read operation is
+    /// cancelled; its completion notifies the barrier.
+    void report_write_error() override
+    {
+        readOp_.cancel();
+        unregister_write_port();
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    /// Called by the read operation on a read error or EOF. The read count
+    /// is already taken out of the barrier.
+    void report_read_error() override
+    {
+        writeFlow_.cancel();
+        unregister_write_port();
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    /// The ring doing the I/O.
+    IoUring *ring_;
+    /// Hub whose data we are trying to send.
+    HFlow *hub_;
+    /// Pending read.
+    ReadOp readOp_;
+    /// StateFlow for writing data to the fd.
+    WriteFlow writeFlow_;
+};
+
+#endif // OPENMRN_HAVE_IO_URING
+
+#endif // _UTILS_HUBDEVICEURING_HXX_
@@ -0,0 +1,479 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file HubPortQueue.cxx
+ *
+ * Bounded per-port output queues for hubs, with a policy for slow
+ * consumers.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "utils/HubPortQueue.hxx"
+
+#include "nmranet_config.h"
+#include "os/os.h"
+#include "utils/Buffer.hxx"
+
+constexpr unsigned HubPortQueueBase::WINDOW;
+constexpr unsigned HubPortQueueBase::DROP_BATCH;
+constexpr unsigned HubPortQueueBase::MIN_RING_SIZE;
+
+HubPortQueueBase::HubPortQueueBase(
+    const void *port, const HubPortLimits &limits, HubPortQueueSet *set)
+    : port_(port)
+    , limits_(limits)
+    , set_(set)
+    , ring_(MIN_RING_SIZE)
+{
+    HASSERT(limits.maxFrames || limits.maxBytes);
+    for (unsigned i = 0; i < WINDOW; ++i)
+    {
+        slots_[i].parent = this;
+        slots_[i].upstream = nullptr;
+        slots_[i].busy = false;
+    }
+}
+
+HubPortQueueBase::~HubPortQueueBase()
+{
+}
+
+HubPortQueueBase::Slot *HubPortQueueBase::free_slot()
+{
+    for (unsigned i = 0; i < WINDOW; ++i)
+    {
+        if (!slots_[i].busy)
+        {
+            return slots_ + i;
+        }
+    }
+    return nullptr;
+}
+
+void HubPortQueueBase::grow_ring(size_t size)
+{
+    std::vector<Pending> bigger(size * 2);
+    {
+        AtomicHolder h(set_);
+        if (ring_.size() != size)
+        {
+            // Somebody else grew or took the ring meanwhile.
+            return;
+        }
+        unsigned count = ringCount_;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            bigger[i] = pending_front();
+            pending_pop();
+        }
+        ringCount_ = count;
+        ringHead_ = 0;
+        ring_.swap(bigger);
+    }
+    // The old ring is freed here, outside of the lock.
+}
+
+void HubPortQueueBase::take_pending(TakenPending *out)
+{
+    for (unsigned i = 0, j = ringHead_; i < ringCount_; ++i)
+    {
+        --count_;
+        bytes_ -= ring_[j].bytes;
+        ++dropped_;
+        if (++j == ring_.size())
+        {
+            j = 0;
+        }
+    }
+    out->ring.swap(ring_);
+    out->head = ringHead_;
+    out->count = ringCount_;
+    ringHead_ = 0;
+    ringCount_ = 0;
+}
+
+void HubPortQueueBase::drop_taken(TakenPending *t)
+{
+    for (unsigned i = 0, j = t->head; i < t->count; ++i)
+    {
+        drop(t->ring[j].b);
+        if (++j == t->ring.size())
+        {
+            j = 0;
+        }
+    }
+}
+
+void HubPortQueueBase::enqueue(BufferBase *b, size_t bytes)
+{
+    Pending p {b, os_get_time_monotonic(), (uint32_t)bytes};
+    bool done = false;
+    while (!done)
+    {
+        // Everything we need to do after releasing the lock.
+        BufferBase *dropped[DROP_BATCH + 1];
+        unsigned num_dropped = 0;
+        TakenPending taken;
+        size_t grow_from = 0;
+        bool do_forward = false;
+        Notifiable *disconnect = nullptr;
+        Notifiable *wake = nullptr;
+        {
+            AtomicHolder h(set_);
+            done = true;
+            bool accept = true;
+            if (detached_ || disconnected_)
+            {
+                accept = false;
+            }
+            else if (over_limit(bytes))
+            {
+                switch (limits_.policy)
+                {
+                    case HubQueuePolicy::BLOCK:
+                        break;
+                    case HubQueuePolicy::DROP_OLDEST:
+                        while (over_limit(bytes) && ringCount_ &&
+                            num_dropped < DROP_BATCH)
+                        {
+                            Pending &o = pending_front();
+                            --count_;
+                            bytes_ -= o.bytes;
+                            ++dropped_;
+                            dropped[num_dropped++] = o.b;
+                            pending_pop();
+                        }
+                        if (over_limit(bytes) && ringCount_)
+                        {
+                            // Frees this batch, then drops some more.
+                            done = false;
+                        }
+                        // Otherwise all held messages are at the port
+                        // already.
+                        accept = !over_limit(bytes);
+                        break;
+                    case HubQueuePolicy::DROP_NEWEST:
+                        accept = false;
+                        break;
+                    case HubQueuePolicy::DISCONNECT:
+                        disconnected_ = true;
+                        disconnect = limits_.onDisconnect;
+                        take_pending(&taken);
+                        accept = false;
+                        break;
+                }
+            }
+            if (done && accept && ringCount_ == ring_.size())
+            {
+                // Grows the ring without the lock, then tries again.
+                grow_from = ring_.size();
+                done = false;
+            }
+            else if (done && accept)
+            {
+                ++count_;
+                bytes_ += bytes;
+                if (count_ > maxQueued_)
+                {
+                    maxQueued_ = count_;
+                }
+                pending_push(p);
+                if (!forwarding_)
+                {
+                    forwarding_ = true;
+                    do_forward = true;
+                }
+                if (limits_.policy == HubQueuePolicy::BLOCK && !blocked_ &&
+                    full())
+                {
+                    blocked_ = true;
+                    wake = set_->set_blocked(true);
+                }
+            }
+            else if (done)
+            {
+                ++dropped_;
+                dropped[num_dropped++] = b;
+            }
+        }
+        for (unsigned i = 0; i < num_dropped; ++i)
+        {
+            drop(dropped[i]);
+        }
+        drop_taken(&taken);
+        if (grow_from)
+        {
+            grow_ring(grow_from);
+        }
+        if (disconnect)
+        {
+            disconnect->notify();
+        }
+        if (wake)
+        {
+            wake->notify();
+        }
+        if (do_forward)
+        {
+            run_forwarding();
+        }
+    }
+}
+
+void HubPortQueueBase::run_forwarding()
+{
+    while (true)
+    {
+        BufferBase *b;
+        bool del = false;
+        {
+            AtomicHolder h(set_);
+            Slot *s = free_slot();
+            if (!s || !ringCount_)
+            {
+                forwarding_ = false;
+                del = detached_ && !count_;
+                b = nullptr;
+            }
+            else
+            {
+                Pending &p = pending_front();
+                b = p.b;
+                s->busy = true;
+                s->enqueueTime = p.enqueueTime;
+                s->bytes = p.bytes;
+                pending_pop();
+                // Takes over the done notifiable of the buffer. The child
+                // keeps the original barrier open until the port is done.
+                s->upstream = b->new_child();
+                b->set_done(s->bn.reset(s));
+                ++sent_;
+            }
+        }
+        if (!b)
+        {
+            if (del)
+            {
+                delete this;
+            }
+            return;
+        }
+        // The port may release the message before send returns; slot_done
+        // does not start another forwarding loop while we are in this one.
+        forward(b);
+    }
+}
+
+void HubPortQueueBase::slot_done(Slot *s)
+{
+    long long now = os_get_time_monotonic();
+    BarrierNotifiable *upstream;
+    Notifiable *wake = nullptr;
+    bool do_forward = false;
+    bool del = false;
+    {
+        AtomicHolder h(set_);
+        upstream = s->upstream;
+        s->upstream = nullptr;
+        s->busy = false;
+        --count_;
+        bytes_ -= s->bytes;
+        long long lat = (now - s->enqueueTime) / 1000;
+        if (lat > maxLatencyUsec_)
+        {
+            maxLatencyUsec_ = lat > UINT32_MAX ? UINT32_MAX : lat;
+        }
+        if (ringCount_ && !forwarding_)
+        {
+            forwarding_ = true;
+            do_forward = true;
+        }
+        if (blocked_ && !full())
+        {
+            blocked_ = false;
+            wake = set_->set_blocked(false);
+        }
+        del = detached_ && !count_ && !forwarding_;
+    }
+    if (upstream)
+    {
+        upstream->notify();
+    }
+    if (wake)
+    {
+        wake->notify();
+    }
+    if (do_forward)
+    {
+        run_forwarding();
+    }
+    else if (del)
+    {
+        delete this;
+    }
+}
+
+void HubPortQueueBase::detach()
+{
+    TakenPending dropped;
+    Notifiable *wake = nullptr;
+    bool del;
+    {
+        AtomicHolder h(set_);
+        detached_ = true;
+        take_pending(&dropped);
+        // These are not counted as drops of the port.
+        dropped_ -= dropped.count;
+        if (blocked_)
+        {
+            blocked_ = false;
+            wake = set_->set_blocked(false);
+        }
+        del = !count_ && !forwarding_;
+    }
+    drop_taken(&dropped);
+    if (wake)
+    {
+        wake->notify();
+    }
+    if (del)
+    {
+        delete this;
+    }
+}
+
+void HubPortQueueBase::get_stats(HubPortStats *stats)
+{
+    stats->port = port_;
+    stats->queued = count_;
+    stats->queuedBytes = bytes_;
+    stats->maxQueued = maxQueued_;
+    stats->sent = sent_;
+    stats->dropped = dropped_;
+    stats->maxLatencyUsec = maxLatencyUsec_;
+}
+
+bool hub_port_limits_from_config(
+    HubPortLimits *limits, Notifiable *on_disconnect)
+{
+    limits->maxFrames = config_hub_port_queue_max_frames();
+    limits->maxBytes = config_hub_port_queue_max_bytes();
+    limits->policy = (HubQueuePolicy)config_hub_port_queue_policy();
+    limits->onDisconnect = on_disconnect;
+    return limits->maxFrames || limits->maxBytes;
+}
+
+void HubPortQueueSet::add(HubPortQueueBase *q)
+{
+    AtomicHolder h(this);
+    q->nextQueue_ = head_;
+    head_ = q;
+    ++numQueues_;
+}
+
+HubPortQueueBase *HubPortQueueSet::remove(const void *port)
+{
+    AtomicHolder h(this);
+    for (HubPortQueueBase **p = &head_; *p; p = &(*p)->nextQueue_)
+    {
+        HubPortQueueBase *q = *p;
+        if (q->port() == port)
+        {
+            *p = q->nextQueue_;
+            q->nextQueue_ = nullptr;
+            --numQueues_;
+            return q;
+        }
+    }
+    return nullptr;
+}
+
+bool HubPortQueueSet::may_proceed(Notifiable *hub)
+{
+    AtomicHolder h(this);
+    if (numBlocked_)
+    {
+        waiter_ = hub;
+        return false;
+    }
+    return true;
+}
+
+Notifiable *HubPortQueueSet::set_blocked(bool blocked)
+{
+    if (blocked)
+    {
+        ++numBlocked_;
+        return nullptr;
+    }
+    HASSERT(numBlocked_);
+    if (--numBlocked_ == 0 && waiter_)
+    {
+        Notifiable *n = waiter_;
+        waiter_ = nullptr;
+        return n;
+    }
+    return nullptr;
+}
+
+bool HubPortQueueSet::port_stats(const void *port, HubPortStats *stats)
+{
+    AtomicHolder h(this);
+    for (HubPortQueueBase *q = head_; q; q = q->nextQueue_)
+    {
+        if (q->port() == port)
+        {
+            q->get_stats(stats);
+            return true;
+        }
+    }
+    return false;
+}
+
+void HubPortQueueSet::all_port_stats(std::vector<HubPortStats> *stats)
+{
+    while (true)
+    {
+        size_t num;
+        {
+            AtomicHolder h(this);
+            num = numQueues_;
+            if (stats->size() == num)
+            {
+                unsigned i = 0;
+                for (HubPortQueueBase *q = head_; q; q = q->nextQueue_)
+                {
+                    q->get_stats(&(*stats)[i++]);
+                }
+                return;
+            }
+        }
+        // Resizes without the lock, then tries again.
+        stats->resize(num);
+    }
+}
@@ -0,0 +1,423 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file HubPortQueue.hxx
+ *
+ * Bounded per-port output queues for hubs, with a policy for slow
+ * consumers.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#ifndef _UTILS_HUBPORTQUEUE_HXX_
+#define _UTILS_HUBPORTQUEUE_HXX_
+
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+#include "executor/Notifiable.hxx"
+#include "executor/StateFlow.hxx"
+#include "utils/Atomic.hxx"
+#include "utils/macros.h"
+
+class HubPortQueueSet;
+
+/// What a hub does with a message for a port whose queue is full.
+enum class HubQueuePolicy : uint8_t
+{
+    /// Accepts the message, then stops dispatching until the port catches
+    /// up. The sources see this as backpressure. No message is lost, but one
+    /// slow port slows down everybody.
+    BLOCK = 0,
+    /// Drops the oldest message that was not yet handed to the port.
+    DROP_OLDEST = 1,
+    /// Drops the incoming message.
+    DROP_NEWEST = 2,
+    /// Drops the queue and all further messages, and calls
+    /// HubPortLimits::onDisconnect once. The owner of the port should close
+    /// the connection and unregister the port.
+    DISCONNECT = 3,
+};
+
+/// Limits of the output queue of one hub port. Either limit may be 0
+/// (unlimited), but not both.
+struct HubPortLimits
+{
+    /// Maximum number of messages held for the port, including the ones
+    /// already handed to it but not yet released.
+    uint32_t maxFrames;
+    /// Maximum number of payload bytes held for the port.
+    uint32_t maxBytes;
+    /// What to do when the limit is reached.
+    HubQueuePolicy policy;
+    /// Called for HubQueuePolicy::DISCONNECT. May be null.
+    Notifiable *onDisconnect;
+};
+
+/// Counters of one queued hub port, see GenericHubFlow::port_stats().
+struct HubPortStats
+{
+    /// The port.
+    const void *port;
+    /// Number of messages held for the port right now.
+    uint32_t queued;
+    /// Number of payload bytes held for the port right now.
+    uint32_t queuedBytes;
+    /// Largest value of queued seen.
+    uint32_t maxQueued;
+    /// Number of messages handed to the port.
+    uint32_t sent;
+    /// Number of messages dropped because of the limits.
+    uint32_t dropped;
+    /// Longest time between the hub dispatching a message and the port
+    /// releasing it, in microseconds.
+    uint32_t maxLatencyUsec;
+};
+
+/// Type-independent part of HubPortQueue.
+///
+/// The queue is registered to the hub in place of the port. It hands at most
+/// WINDOW messages to the port at a time, and holds the rest itself, so that
+/// it can apply the limits and drop old messages. It notices that the port is
+/// done with a message by replacing the done notifiable of the buffer; the
+/// original done notifiable is called afterwards, so the flow control of the
+/// sources is kept.
+///
+/// Nothing allocates memory, releases a message or calls the port with the
+/// lock held, since on some platforms the lock disables interrupts. The
+/// messages are handed to the port by one thread at a time (see forwarding_),
+/// which keeps them in order.
+class HubPortQueueBase
+{
+public:
+    /// How many messages are handed to the port at a time. More than one,
+    /// so that ports can batch their writes.
+    static constexpr unsigned WINDOW = 8;
+
+    /// @return the port this queue belongs to.
+    const void *port()
+    {
+        return port_;
+    }
+
+    /// Called by the hub after the port was unregistered. Drops the messages
+    /// not yet handed to the port, and deletes *this now or after the port
+    /// released the rest.
+    void detach();
+
+protected:
+    /// Constructor.
+    /// @param port the port that this queue feeds.
+    /// @param limits the limits of the queue.
+    /// @param set the hub's set of queues.
+    HubPortQueueBase(
+        const void *port, const HubPortLimits &limits, HubPortQueueSet *set);
+
+    virtual ~HubPortQueueBase();
+
+    /// Takes a message from the hub.
+    /// @param b the message; ownership is transferred.
+    /// @param bytes the payload size of the message.
+    void enqueue(BufferBase *b, size_t bytes);
+
+    /// Sends a message to the port.
+    virtual void forward(BufferBase *b) = 0;
+
+    /// Releases a dropped message.
+    virtual void drop(BufferBase *b) = 0;
+
+private:
+    friend class HubPortQueueSet;
+
+    /// How many messages enqueue() drops in one go for DROP_OLDEST before
+    /// releasing the lock to free them.
+    static constexpr unsigned DROP_BATCH = 8;
+    /// Initial size of the ring of pending messages.
+    static constexpr unsigned MIN_RING_SIZE = 16;
+
+    /// Tracks one message handed to the port.
+    struct Slot : public Notifiable
+    {
+        /// Called when the port released the message.
+        void notify() override
+        {
+            parent->slot_done(this);
+        }
+
+        /// The queue.
+        HubPortQueueBase *parent;
+        /// Replaces the done notifiable of the buffer.
+        BarrierNotifiable bn;
+        /// Original done notifiable of the buffer, or null.
+        BarrierNotifiable *upstream;
+        /// When the message arrived.
+        long long enqueueTime;
+        /// Payload size of the message.
+        uint32_t bytes;
+        /// True if the slot holds a message.
+        bool busy;
+    };
+
+    /// A message waiting to be handed to the port.
+    struct Pending
+    {
+        /// The message.
+        BufferBase *b;
+        /// When the message arrived.
+        long long enqueueTime;
+        /// Payload size of the message.
+        uint32_t bytes;
+    };
+
+    /// Pending messages taken out of the queue, to be dropped after the lock
+    /// is released.
+    struct TakenPending
+    {
+        /// The ring buffer that held them.
+        std::vector<Pending> ring;
+        /// Index of the oldest message in ring.
+        unsigned head {0};
+        /// Number of messages.
+        unsigned count {0};
+    };
+
+    /// @return true if one more message of the given size exceeds the
+    /// limits. Caller holds the lock.
+    bool over_limit(size_t bytes)
+    {
+        return (limits_.maxFrames && count_ + 1 > limits_.maxFrames) ||
+            (limits_.maxBytes && bytes_ + bytes > limits_.maxBytes);
+    }
+
+    /// @return true if the queue is at its limits. Caller holds the lock.
+    bool full()
+    {
+        return (limits_.maxFrames && count_ >= limits_.maxFrames) ||
+            (limits_.maxBytes && bytes_ >= limits_.maxBytes);
+    }
+
+    /// @return the oldest pending message. Caller holds the lock.
+    Pending &pending_front()
+    {
+        return ring_[ringHead_];
+    }
+
+    /// Removes the oldest pending message. Caller holds the lock.
+    void pending_pop()
+    {
+        if (++ringHead_ == ring_.size())
+        {
+            ringHead_ = 0;
+        }
+        --ringCount_;
+    }
+
+    /// Appends a pending message. The ring must have space. Caller holds the
+    /// lock. @param p the message.
+    void pending_push(const Pending &p)
+    {
+        size_t i = ringHead_ + ringCount_;
+        if (i >= ring_.size())
+        {
+            i -= ring_.size();
+        }
+        ring_[i] = p;
+        ++ringCount_;
+    }
+
+    /// Makes the ring of pending messages bigger. Allocates without holding
+    /// the lock. @param size the size of the ring when it was found full.
+    void grow_ring(size_t size);
+
+    /// Moves all pending messages out of the queue. Caller holds the lock.
+    /// @param out receives the messages; drop them with drop_taken().
+    void take_pending(TakenPending *out);
+
+    /// Releases messages taken by take_pending(). Called without the lock.
+    /// @param t the messages.
+    void drop_taken(TakenPending *t);
+
+    /// Hands pending messages to the port while there are free slots, until
+    /// there are none left. Called without the lock, after setting
+    /// forwarding_. May delete *this.
+    void run_forwarding();
+
+    /// @return a free slot or null. Caller holds the lock.
+    Slot *free_slot();
+
+    /// Callback when the port released a message.
+    void slot_done(Slot *s);
+
+    /// Fills in the counters. Caller holds the lock.
+    void get_stats(HubPortStats *stats);
+
+    /// The port.
+    const void *port_;
+    /// The limits.
+    HubPortLimits limits_;
+    /// The hub's set of queues. Its lock protects all fields below.
+    HubPortQueueSet *set_;
+    /// Next queue in the set.
+    HubPortQueueBase *nextQueue_ {nullptr};
+    /// Ring buffer of the messages not yet handed to the port.
+    std::vector<Pending> ring_;
+    /// Index of the oldest pending message in ring_.
+    unsigned ringHead_ {0};
+    /// Number of pending messages.
+    unsigned ringCount_ {0};
+    /// Messages handed to the port.
+    Slot slots_[WINDOW];
+    /// Number of messages held (pending or in a slot).
+    uint32_t count_ {0};
+    /// Number of payload bytes held.
+    uint32_t bytes_ {0};
+    /// Largest count_ seen.
+    uint32_t maxQueued_ {0};
+    /// Number of messages handed to the port.
+    uint32_t sent_ {0};
+    /// Number of messages dropped.
+    uint32_t dropped_ {0};
+    /// Longest latency, in usec.
+    uint32_t maxLatencyUsec_ {0};
+    /// True while a thread is in run_forwarding().
+    bool forwarding_ {false};
+    /// True if this queue blocks the hub.
+    bool blocked_ {false};
+    /// True after the port was disconnected because of an overflow.
+    bool disconnected_ {false};
+    /// True after the port was unregistered.
+    bool detached_ {false};
+
+    DISALLOW_COPY_AND_ASSIGN(HubPortQueueBase);
+};
+
+/// Bounded output queue of one hub port. Created by
+/// GenericHubFlow::register_port(port, limits).
+template <class MessageType>
+class HubPortQueue : public HubPortQueueBase, public FlowInterface<MessageType>
+{
+public:
+    /// Constructor.
+    /// @param port the port that this queue feeds.
+    /// @param limits the limits of the queue.
+    /// @param set the hub's set of queues.
+    HubPortQueue(FlowInterface<MessageType> *port, const HubPortLimits &limits,
+        HubPortQueueSet *set)
+        : HubPortQueueBase(port, limits, set)
+        , port_(port)
+    {
+    }
+
+    /// @return the pool of the port.
+    Pool *pool() override
+    {
+        return port_->pool();
+    }
+
+    /// Takes a message from the hub. @param message the message. @param
+    /// priority ignored.
+    void send(MessageType *message, unsigned priority) override
+    {
+        enqueue(message, message->data()->size());
+    }
+
+private:
+    void forward(BufferBase *b) override
+    {
+        port_->send(static_cast<MessageType *>(b));
+    }
+
+    void drop(BufferBase *b) override
+    {
+        static_cast<MessageType *>(b)->unref();
+    }
+
+    /// The port.
+    FlowInterface<MessageType> *port_;
+};
+
+/// The queued ports of one hub. Created by the hub when the first port with
+/// limits is registered. One lock protects this object and all its queues;
+/// nothing allocates memory while holding it.
+class HubPortQueueSet : public Atomic
+{
+public:
+    HubPortQueueSet()
+    {
+    }
+
+    /// Adds a queue. @param q the new queue.
+    void add(HubPortQueueBase *q);
+
+    /// Removes the queue of a port. The caller has to unregister the queue
+    /// from the hub, then call detach() on it.
+    /// @param port the port.
+    /// @return the queue, or null if the port has no queue.
+    HubPortQueueBase *remove(const void *port);
+
+    /// Called by the hub before dispatching a message.
+    /// @param hub will be notified when the hub may proceed.
+    /// @return true if the hub may proceed, false if it has to wait.
+    bool may_proceed(Notifiable *hub);
+
+    /// @param port a port. @param stats will be filled in. @return false if
+    /// the port has no queue.
+    bool port_stats(const void *port, HubPortStats *stats);
+
+    /// @param stats will be filled with the counters of all queued ports.
+    void all_port_stats(std::vector<HubPortStats> *stats);
+
+private:
+    friend class HubPortQueueBase;
+
+    /// Called with the lock held when a queue starts or stops blocking the
+    /// hub. @param blocked true if it starts blocking. @return the hub to
+    /// notify after releasing the lock, or null.
+    Notifiable *set_blocked(bool blocked);
+
+    /// All queues, linked through HubPortQueueBase::nextQueue_.
+    HubPortQueueBase *head_ {nullptr};
+    /// Number of queues.
+    unsigned numQueues_ {0};
+    /// Number of queues blocking the hub.
+    unsigned numBlocked_ {0};
+    /// The hub, if it is waiting for the blocking queues.
+    Notifiable *waiter_ {nullptr};
+
+    DISALLOW_COPY_AND_ASSIGN(HubPortQueueSet);
+};
+
+/// Reads the limits for client ports (connections accepted by a server) from
+/// the hub_port_queue_* configuration constants.
+/// @param limits will be filled in.
+/// @param on_disconnect notifiable for HubQueuePolicy::DISCONNECT.
+/// @return false if no limit is configured.
+bool hub_port_limits_from_config(
+    HubPortLimits *limits, Notifiable *on_disconnect);
+
+#endif // _UTILS_HUBPORTQUEUE_HXX_
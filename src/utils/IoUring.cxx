@@ -0,0 +1,371 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file IoUring.cxx
+ *
+ * Asynchronous I/O with the Linux io_uring interface, completing on an
+ * Executor.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "utils/IoUring.hxx"
+
+#if OPENMRN_HAVE_IO_URING && defined(OPENMRN_FEATURE_EXECUTOR_SELECT)
+
+#include <algorithm>
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "utils/logging.h"
+
+namespace
+{
+
+/// @param entries ring size. @param p parameters. @return fd or -errno.
+int sys_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    int ret = syscall(__NR_io_uring_setup, entries, p);
+    return ret < 0 ? -errno : ret;
+}
+
+/// @param fd ring. @param to_submit number of new entries. @return number
+/// submitted or -errno.
+int sys_io_uring_enter(int fd, unsigned to_submit)
+{
+    int ret = syscall(__NR_io_uring_enter, fd, to_submit, 0, 0, nullptr, 0);
+    return ret < 0 ? -errno : ret;
+}
+
+/// @param fd ring. @param opcode what to register. @param arg data.
+/// @param nr_args count. @return 0 or -errno.
+int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+    int ret = syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+    return ret < 0 ? -errno : ret;
+}
+
+/// @param p pointer into the shared ring. @return the value, with acquire
+/// semantics against the kernel's updates.
+inline unsigned load_acquire(unsigned *p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+/// Publishes a value to the kernel. @param p pointer into the shared ring.
+/// @param v new value.
+inline void store_release(unsigned *p, unsigned v)
+{
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+/// @param base start of a mapping. @param ofs offset. @return pointer.
+inline unsigned *ring_ptr(void *base, unsigned ofs)
+{
+    return (unsigned *)((uint8_t *)base + ofs);
+}
+
+} // namespace
+
+IoUring::IoUring(ExecutorBase *executor, unsigned entries,
+    unsigned num_buffers, size_t buffer_size)
+    : executor_(executor)
+    , numBuffers_(num_buffers)
+    , bufferSize_(buffer_size)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = entries * 2;
+    int fd = sys_io_uring_setup(entries, &p);
+    if (fd < 0)
+    {
+        LOG(WARNING, "io_uring_setup: %s", strerror(-fd));
+        return;
+    }
+    sqRingSize_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqRingSize_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single)
+    {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+    sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    cqRing_ = single ? sqRing_
+                     : mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    void *sqes = mmap(nullptr, p.sq_entries * sizeof(struct io_uring_sqe),
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+        IORING_OFF_SQES);
+    if (sqRing_ == MAP_FAILED || cqRing_ == MAP_FAILED || sqes == MAP_FAILED)
+    {
+        LOG(WARNING, "io_uring mmap: %s", strerror(errno));
+        HASSERT(0 && "io_uring mmap failed");
+    }
+    sqes_ = (struct io_uring_sqe *)sqes;
+    sqEntries_ = p.sq_entries;
+    sqHead_ = ring_ptr(sqRing_, p.sq_off.head);
+    sqTail_ = ring_ptr(sqRing_, p.sq_off.tail);
+    sqMask_ = ring_ptr(sqRing_, p.sq_off.ring_mask);
+    sqArray_ = ring_ptr(sqRing_, p.sq_off.array);
+    cqHead_ = ring_ptr(cqRing_, p.cq_off.head);
+    cqTail_ = ring_ptr(cqRing_, p.cq_off.tail);
+    cqMask_ = ring_ptr(cqRing_, p.cq_off.ring_mask);
+    cqes_ = (struct io_uring_cqe *)((uint8_t *)cqRing_ + p.cq_off.cqes);
+    tail_ = submittedTail_ = *sqTail_;
+
+    if (numBuffers_)
+    {
+        arena_ = (uint8_t *)mmap(nullptr, numBuffers_ * bufferSize_,
+            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        HASSERT(arena_ != MAP_FAILED);
+        std::vector<struct iovec> iov(numBuffers_);
+        for (unsigned i = 0; i < numBuffers_; ++i)
+        {
+            iov[i].iov_base = buffer(i);
+            iov[i].iov_len = bufferSize_;
+            freeBuffers_.push_back(numBuffers_ - 1 - i);
+        }
+        int ret = sys_io_uring_register(
+            fd, IORING_REGISTER_BUFFERS, iov.data(), numBuffers_);
+        // Without registration (e.g. over RLIMIT_MEMLOCK) the buffers still
+        // work with plain reads and writes.
+        fixedBuffers_ = ret == 0;
+        if (ret < 0)
+        {
+            LOG(INFO, "io_uring buffer registration: %s", strerror(-ret));
+        }
+    }
+    fd_ = fd;
+    executor_->sync_run([this]() { arm(); });
+}
+
+IoUring::~IoUring()
+{
+    if (fd_ < 0)
+    {
+        return;
+    }
+    bool pending = true;
+    while (pending)
+    {
+        executor_->sync_run([this, &pending]() {
+            if (armed_)
+            {
+                executor_->unselect(&selectHelper_);
+                armed_ = false;
+            }
+            pending = submitPending_;
+        });
+    }
+    ::close(fd_);
+    munmap(sqes_, sqEntries_ * sizeof(struct io_uring_sqe));
+    if (cqRing_ != sqRing_)
+    {
+        munmap(cqRing_, cqRingSize_);
+    }
+    munmap(sqRing_, sqRingSize_);
+    if (arena_)
+    {
+        munmap(arena_, numBuffers_ * bufferSize_);
+    }
+}
+
+int IoUring::alloc_buffer()
+{
+    AtomicHolder h(this);
+    if (freeBuffers_.empty())
+    {
+        return -1;
+    }
+    int ret = freeBuffers_.back();
+    freeBuffers_.pop_back();
+    return ret;
+}
+
+void IoUring::free_buffer(int index)
+{
+    AtomicHolder h(this);
+    freeBuffers_.push_back(index);
+}
+
+struct io_uring_sqe *IoUring::get_sqe()
+{
+    if (tail_ - load_acquire(sqHead_) >= sqEntries_)
+    {
+        // Full. The kernel takes all the entries in io_uring_enter.
+        submit();
+    }
+    unsigned idx = tail_ & *sqMask_;
+    struct io_uring_sqe *sqe = sqes_ + idx;
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray_[idx] = idx;
+    ++tail_;
+    return sqe;
+}
+
+void IoUring::read(IoUringOp *op, int fd, void *buf, size_t len, int buf_index)
+{
+    struct io_uring_sqe *sqe = get_sqe();
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t)buf;
+    sqe->len = len;
+    sqe->off = (uint64_t)-1; // current file position
+    sqe->user_data = (uintptr_t)op;
+    if (buf_index >= 0 && fixedBuffers_)
+    {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->buf_index = buf_index;
+    }
+    else
+    {
+        sqe->opcode = IORING_OP_READ;
+    }
+    submit_soon();
+}
+
+void IoUring::write(
+    IoUringOp *op, int fd, const void *buf, size_t len, int buf_index)
+{
+    struct io_uring_sqe *sqe = get_sqe();
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t)buf;
+    sqe->len = len;
+    sqe->off = (uint64_t)-1; // current file position
+    sqe->user_data = (uintptr_t)op;
+    if (buf_index >= 0 && fixedBuffers_)
+    {
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->buf_index = buf_index;
+    }
+    else
+    {
+        sqe->opcode = IORING_OP_WRITE;
+    }
+    submit_soon();
+}
+
+void IoUring::cancel(IoUringOp *op)
+{
+    struct io_uring_sqe *sqe = get_sqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = (uintptr_t)op;
+    // The completion of the cancel request itself is ignored.
+    sqe->user_data = 0;
+    submit_soon();
+}
+
+void IoUring::submit()
+{
+    unsigned count = tail_ - submittedTail_;
+    if (!count)
+    {
+        return;
+    }
+    store_release(sqTail_, tail_);
+    ++stats_.syscalls;
+    int ret;
+    do
+    {
+        ret = sys_io_uring_enter(fd_, count);
+    } while (ret == -EINTR || ret == -EAGAIN || ret == -EBUSY);
+    HASSERT(ret == (int)count);
+    submittedTail_ = tail_;
+    stats_.submitted += count;
+}
+
+void IoUring::submit_soon()
+{
+    if (!submitPending_)
+    {
+        submitPending_ = true;
+        executor_->add(&submitter_);
+    }
+}
+
+void IoUring::Submitter::run()
+{
+    if (!parent_->executor_->empty() &&
+        parent_->submitDeferred_ < MAX_SUBMIT_DEFER)
+    {
+        // Goes to the back of the queue, so that the work queued meanwhile
+        // can add its operations to the same batch.
+        ++parent_->submitDeferred_;
+        parent_->executor_->add(this);
+        return;
+    }
+    parent_->submitDeferred_ = 0;
+    parent_->submitPending_ = false;
+    parent_->submit();
+}
+
+void IoUring::run()
+{
+    // The executor took selectHelper_ out of the select set.
+    armed_ = false;
+    reap();
+    arm();
+}
+
+void IoUring::reap()
+{
+    unsigned head = *cqHead_;
+    while (head != load_acquire(cqTail_))
+    {
+        struct io_uring_cqe *cqe = cqes_ + (head & *cqMask_);
+        IoUringOp *op = (IoUringOp *)(uintptr_t)cqe->user_data;
+        int res = cqe->res;
+        ++head;
+        // Frees the entry before the callback, which may queue more
+        // operations.
+        store_release(cqHead_, head);
+        if (op)
+        {
+            ++stats_.completed;
+            op->complete(res);
+        }
+    }
+}
+
+void IoUring::arm()
+{
+    if (!armed_)
+    {
+        selectHelper_.reset(Selectable::READ, fd_, 0);
+        executor_->select(&selectHelper_);
+        armed_ = true;
+    }
+}
+
+#endif // OPENMRN_HAVE_IO_URING
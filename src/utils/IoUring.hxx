@@ -0,0 +1,281 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file IoUring.hxx
+ *
+ * Asynchronous I/O with the Linux io_uring interface, completing on an
+ * Executor.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#ifndef _UTILS_IOURING_HXX_
+#define _UTILS_IOURING_HXX_
+
+#include "openmrn_features.h"
+
+#if OPENMRN_HAVE_IO_URING && defined(OPENMRN_FEATURE_EXECUTOR_SELECT)
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <vector>
+
+#include "executor/Executor.hxx"
+#include "utils/Atomic.hxx"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/// An operation submitted to an IoUring. The object must stay alive until
+/// complete() is called.
+class IoUringOp
+{
+public:
+    /// Called on the executor of the ring when the operation is finished.
+    /// @param result is the return value of the equivalent system call, or
+    /// -errno on failure (-ECANCELED if it was cancelled).
+    virtual void complete(int result) = 0;
+
+protected:
+    virtual ~IoUringOp()
+    {
+    }
+};
+
+/// Counters of an IoUring.
+struct IoUringStats
+{
+    /// Number of io_uring_enter system calls.
+    uint32_t syscalls {0};
+    /// Number of operations submitted.
+    uint32_t submitted {0};
+    /// Number of completions processed.
+    uint32_t completed {0};
+};
+
+/** An io_uring instance serving the operations of many file descriptors on
+ * one executor.
+ *
+ * Operations are queued with read(), write() and cancel() from the executor
+ * thread. They are handed to the kernel together with one system call when
+ * the executor runs out of other work (or after it has run MAX_SUBMIT_DEFER
+ * more executables), so everything the executor prepares in one round goes
+ * out in one batch. The ring's file
+ * descriptor is watched with ExecutorBase::select(); when it has completions,
+ * all of them are processed on the executor thread at once.
+ *
+ * The ring owns an area of memory divided into equal size buffers that are
+ * registered with the kernel, so that reads and writes into them do not need
+ * to map the user pages for every operation. */
+class IoUring : private Executable, private Atomic
+{
+public:
+    /// Constructor.
+    ///
+    /// @param executor where the completions are processed. Must support
+    /// select().
+    /// @param entries size of the submission queue. The completion queue is
+    /// twice this size.
+    /// @param num_buffers how many registered buffers to allocate.
+    /// @param buffer_size size of each registered buffer in bytes.
+    IoUring(ExecutorBase *executor, unsigned entries = 256,
+        unsigned num_buffers = 64, size_t buffer_size = 4096);
+
+    /// Destructor. All operations must have been completed.
+    ~IoUring();
+
+    /// @return false if the kernel does not support io_uring (or it is
+    /// disabled). No operations may be submitted to an invalid ring.
+    bool is_valid()
+    {
+        return fd_ >= 0;
+    }
+
+    /// @return the executor where the completions are processed.
+    ExecutorBase *executor()
+    {
+        return executor_;
+    }
+
+    /// Takes a registered buffer. May be called on any thread. @return the
+    /// buffer index, or -1 if all buffers are in use.
+    int alloc_buffer();
+
+    /// Returns a registered buffer. May be called on any thread. @param index
+    /// what alloc_buffer returned.
+    void free_buffer(int index);
+
+    /// @param index the buffer index. @return the memory of the buffer.
+    uint8_t *buffer(int index)
+    {
+        return arena_ + index * bufferSize_;
+    }
+
+    /// @return size of a registered buffer in bytes.
+    size_t buffer_size()
+    {
+        return bufferSize_;
+    }
+
+    /// Queues a read. Must be called on the executor.
+    ///
+    /// @param op is notified when the read is done.
+    /// @param fd where to read from.
+    /// @param buf where to read to.
+    /// @param len maximum number of bytes.
+    /// @param buf_index if buf is inside a registered buffer, its index,
+    /// otherwise -1.
+    void read(IoUringOp *op, int fd, void *buf, size_t len, int buf_index);
+
+    /// Queues a write. Must be called on the executor.
+    ///
+    /// @param op is notified when the write is done.
+    /// @param fd where to write to.
+    /// @param buf the data to write.
+    /// @param len number of bytes.
+    /// @param buf_index if buf is inside a registered buffer, its index,
+    /// otherwise -1.
+    void write(
+        IoUringOp *op, int fd, const void *buf, size_t len, int buf_index);
+
+    /// Requests an operation to be cancelled. The operation will still be
+    /// completed, usually with -ECANCELED. Must be called on the executor.
+    /// @param op is the operation to cancel.
+    void cancel(IoUringOp *op);
+
+    /// Hands the queued operations to the kernel now. Must be called on the
+    /// executor.
+    void submit();
+
+    /// @return the counters.
+    const IoUringStats &stats()
+    {
+        return stats_;
+    }
+
+private:
+    /// The submission of queued operations is postponed at most this many
+    /// times while the executor has other work.
+    static constexpr unsigned MAX_SUBMIT_DEFER = 16;
+
+    /// Helper to run the deferred submission on the executor.
+    class Submitter : public Executable
+    {
+    public:
+        /// @param parent the ring.
+        Submitter(IoUring *parent)
+            : parent_(parent)
+        {
+        }
+
+        void run() override;
+
+    private:
+        /// The ring.
+        IoUring *parent_;
+    };
+
+    /// Called when the ring's fd is readable. Processes the completions.
+    void run() override;
+
+    /// @return an empty submission queue entry, cleared to zero.
+    struct io_uring_sqe *get_sqe();
+
+    /// Processes all completions.
+    void reap();
+
+    /// Watches the ring's fd for more completions if it is not yet watched.
+    void arm();
+
+    /// Makes sure that the queued operations are submitted soon.
+    void submit_soon();
+
+    /// Executor for the completions.
+    ExecutorBase *executor_;
+    /// The io_uring file descriptor, or -1.
+    int fd_ {-1};
+    /// Mapped submission ring.
+    void *sqRing_ {nullptr};
+    /// Mapped completion ring (may be the same as sqRing_).
+    void *cqRing_ {nullptr};
+    /// Size of the sqRing_ mapping.
+    size_t sqRingSize_ {0};
+    /// Size of the cqRing_ mapping.
+    size_t cqRingSize_ {0};
+    /// Mapped submission queue entries.
+    struct io_uring_sqe *sqes_ {nullptr};
+    /// Number of entries in sqes_.
+    unsigned sqEntries_ {0};
+    /// Head of the submission ring, advanced by the kernel.
+    unsigned *sqHead_ {nullptr};
+    /// Tail of the submission ring, advanced by us.
+    unsigned *sqTail_ {nullptr};
+    /// Index mask of the submission ring.
+    unsigned *sqMask_ {nullptr};
+    /// Submission ring; each entry is an index into sqes_.
+    unsigned *sqArray_ {nullptr};
+    /// Head of the completion ring, advanced by us.
+    unsigned *cqHead_ {nullptr};
+    /// Tail of the completion ring, advanced by the kernel.
+    unsigned *cqTail_ {nullptr};
+    /// Index mask of the completion ring.
+    unsigned *cqMask_ {nullptr};
+    /// Completion ring entries.
+    struct io_uring_cqe *cqes_ {nullptr};
+    /// Our copy of the submission tail.
+    unsigned tail_ {0};
+    /// Value of tail_ at the last io_uring_enter call.
+    unsigned submittedTail_ {0};
+    /// Memory of the registered buffers.
+    uint8_t *arena_ {nullptr};
+    /// Number of registered buffers.
+    unsigned numBuffers_;
+    /// Size of one registered buffer.
+    size_t bufferSize_;
+    /// True if the kernel accepted the buffer registration.
+    bool fixedBuffers_ {false};
+    /// Indexes of the free registered buffers.
+    std::vector<int> freeBuffers_;
+    /// Watches the ring's fd.
+    Selectable selectHelper_ {this};
+    /// True while selectHelper_ is in the executor's select set. Tracked
+    /// here because the executor cannot be asked about a Selectable that was
+    /// never reset.
+    bool armed_ {false};
+    /// Runs the deferred submission.
+    Submitter submitter_ {this};
+    /// True if submitter_ is on the executor queue.
+    bool submitPending_ {false};
+    /// How many times the pending submission was postponed.
+    unsigned submitDeferred_ {0};
+    /// Counters.
+    IoUringStats stats_;
+};
+
+#endif // OPENMRN_HAVE_IO_URING
+
+#endif // _UTILS_IOURING_HXX_
@@ -72,6 +72,8 @@ protected:
     friend class ActiveTimers;
     /** ActiveTimers needs to iterate through the queue. */
     friend class ExecutorBase;
+    /** ExecutorPoolBase keeps deferred executables in a list. */
+    friend class ExecutorPoolBase;
     friend class TimerTest;
 };
 
@@ -509,6 +509,15 @@ public:
         return list[index].next_locked().item;
     }
 
+    /** Get an item from the front of the queue. Needs external locking.
+     * @param index in the list to operate on
+     * @return item retrieved from queue, NULL if no item available
+     */
+    QMember *next_locked(unsigned index)
+    {
+        return list[index].next_locked().item;
+    }
+
     /** Get an item from the front of the queue queue in priority order.
      * @return item retrieved from queue + index, NULL if no item available
      */
@@ -598,6 +607,83 @@ private:
  */
 template<unsigned items> using QListProtected = QList<items>;
 
+/** A list of queues that are served in priority order, except that a queue
+ * that was passed over too many times gets served next regardless of its
+ * priority. This bounds how long a low priority item waits under a
+ * continuous stream of high priority items.
+ *
+ * @param ITEMS is the number of priority levels.
+ * @param MAX_SKIP is how many items may be taken from higher priority queues
+ * while a queue is not empty, before it gets its turn.
+ */
+template <unsigned ITEMS, unsigned MAX_SKIP>
+class QListAging : public QList<ITEMS>
+{
+public:
+    typedef typename QList<ITEMS>::Result Result;
+
+    QListAging()
+    {
+        for (unsigned i = 0; i < ITEMS; ++i)
+        {
+            skipped_[i] = 0;
+        }
+    }
+
+    /** Get an item from the front of the queue in priority order, taking
+     * starvation into account.
+     * @return item retrieved from queue + index, NULL if no item available
+     */
+    Result next()
+    {
+        AtomicHolder h(this->lock());
+        return next_locked();
+    }
+
+    /// Same as next(), but needs external locking.
+    Result next_locked()
+    {
+        unsigned chosen = ITEMS;
+        for (unsigned i = 0; i < ITEMS; ++i)
+        {
+            if (this->empty(i))
+            {
+                continue;
+            }
+            if (chosen == ITEMS)
+            {
+                chosen = i;
+            }
+            else if (skipped_[i] >= MAX_SKIP)
+            {
+                chosen = i;
+                break;
+            }
+        }
+        if (chosen == ITEMS)
+        {
+            return Result();
+        }
+        for (unsigned i = 0; i < ITEMS; ++i)
+        {
+            if (i == chosen || this->empty(i))
+            {
+                skipped_[i] = 0;
+            }
+            else
+            {
+                ++skipped_[i];
+            }
+        }
+        return Result(this->QList<ITEMS>::next_locked(chosen), chosen);
+    }
+
+private:
+    /// For each queue: how many items were taken from other queues since it
+    /// was last served or empty.
+    unsigned skipped_[ITEMS];
+};
+
 
 #if 0
 /** A BufferQueue that adds the ability to wait on the next buffer.
@@ -0,0 +1,429 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file ShardedCanHub.cxx
+ *
+ * A CAN hub split into shards that run on separate executor threads.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "utils/ShardedCanHub.hxx"
+
+#include <string>
+
+#include "executor/Executor.hxx"
+#include "executor/Service.hxx"
+#include "executor/StateFlow.hxx"
+
+constexpr unsigned ShardedCanHub::RING_SIZE;
+
+static_assert((ShardedCanHub::RING_SIZE & (ShardedCanHub::RING_SIZE - 1)) == 0,
+    "RING_SIZE must be a power of two");
+
+/// Lock-free ring of CAN frames from one shard to another. Written only by
+/// the link of the source shard and read only by the drain of the
+/// destination shard.
+class ShardedCanHub::FrameRing
+{
+public:
+    FrameRing()
+    {
+    }
+
+    /// Appends a frame. Called on the source shard's executor. @param f the
+    /// frame. @return false if the ring is full.
+    bool push(const struct can_frame &f)
+    {
+        unsigned t = tail_.load(std::memory_order_relaxed);
+        if (t - head_.load(std::memory_order_acquire) >= RING_SIZE)
+        {
+            return false;
+        }
+        frames_[t & (RING_SIZE - 1)] = f;
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Takes the oldest frame. Called on the destination shard's executor.
+    /// @param f will be filled in. @return false if the ring is empty.
+    bool pop(struct can_frame *f)
+    {
+        unsigned h = head_.load(std::memory_order_relaxed);
+        if (h == tail_.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        *f = frames_[h & (RING_SIZE - 1)];
+        head_.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @return true if there are no frames in the ring.
+    bool empty()
+    {
+        return head_.load(std::memory_order_acquire) ==
+            tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    /// Index of the next frame to read. Written by the consumer.
+    std::atomic<unsigned> head_ {0};
+    /// Keeps head_ and tail_ on separate cache lines.
+    char pad0_[64 - sizeof(std::atomic<unsigned>)];
+    /// Index of the next frame to write. Written by the producer.
+    std::atomic<unsigned> tail_ {0};
+    /// Keeps tail_ and the frames on separate cache lines.
+    char pad1_[64 - sizeof(std::atomic<unsigned>)];
+    /// The frames.
+    struct can_frame frames_[RING_SIZE];
+
+    DISALLOW_COPY_AND_ASSIGN(FrameRing);
+};
+
+/// One shard of the hub. The members are destroyed in reverse order, the
+/// executor last.
+struct ShardedCanHub::Shard
+{
+    /// Name of the executor thread.
+    string name;
+    /// Executor of the shard; null for the first shard.
+    std::unique_ptr<Executor<1>> executor;
+    /// Service of the shard; null for the first shard.
+    std::unique_ptr<Service> service;
+    /// Hub of the shard; null for the first shard.
+    std::unique_ptr<CanHubFlow> ownHub;
+    /// Hub of the shard.
+    CanHubFlow *hub;
+    /// Rings from the other shards, indexed by the source shard. Null at our
+    /// own index.
+    std::vector<std::unique_ptr<FrameRing>> in;
+    /// Takes the frames from the rings.
+    std::unique_ptr<Drain> drain;
+    /// Puts the frames to the rings of the other shards.
+    std::unique_ptr<Link> link;
+};
+
+/// Injects the frames arriving from the other shards into the hub of one
+/// shard. Runs on the executor of the shard. A batch of frames is injected
+/// at a time, then the drain yields the executor, so the rings fill up (and
+/// push back on the other shards) if this shard's thread falls behind.
+///
+/// The drain does not wait for the hub to release the injected frames. The
+/// hub may be stopped by our own link, which waits for another shard's
+/// drain; waiting here would close that cycle.
+class ShardedCanHub::Drain : public Executable
+{
+public:
+    /// How many frames are injected at once.
+    static constexpr unsigned BATCH = 64;
+
+    /// Constructor. @param shard the shard whose hub we feed.
+    Drain(Shard *shard)
+        : shard_(shard)
+    {
+        // Held until flush(); the injected frames are children.
+        bn_.reset(this);
+    }
+
+    /// Notifies done once the rings are empty and the hub released every
+    /// injected frame. The links must not add frames anymore. Called on the
+    /// executor of the shard.
+    /// @param done notifiable to call.
+    void flush(Notifiable *done)
+    {
+        flushDone_ = done;
+        if (!active_.load())
+        {
+            bn_.notify();
+        }
+    }
+
+    /// Called by the link of a source shard after it added a frame to our
+    /// ring.
+    void wake()
+    {
+        if (!active_.exchange(true))
+        {
+            shard_->hub->service()->executor()->add(this);
+        }
+    }
+
+    /// Injects a batch of frames.
+    void run() override;
+
+    /// Called when the hub released every injected frame after flush().
+    void notify() override
+    {
+        flushDone_->notify();
+    }
+
+private:
+    /// The shard we feed.
+    Shard *shard_;
+    /// Tracks the injected frames that the hub did not release yet.
+    BarrierNotifiable bn_;
+    /// Set by flush().
+    Notifiable *flushDone_ {nullptr};
+    /// True while the drain is scheduled.
+    std::atomic<bool> active_ {false};
+    /// Which ring to look at first.
+    unsigned start_ {0};
+};
+
+constexpr unsigned ShardedCanHub::Drain::BATCH;
+
+/// Port on the hub of one shard that copies the frames originating in the
+/// shard to the rings towards the other shards. The link is registered with
+/// a blocking queue limit, so when a ring is full, the hub of the shard stops
+/// and the sources in the shard stall.
+class ShardedCanHub::Link : public CanHubPort
+{
+public:
+    /// How many frames the hub may hold for the link.
+    static constexpr unsigned QUEUE_SIZE = 32;
+
+    /// Constructor.
+    /// @param parent the sharded hub.
+    /// @param index index of our shard.
+    /// @param service the service of our shard.
+    Link(ShardedCanHub *parent, unsigned index, Service *service)
+        : CanHubPort(service)
+        , parent_(parent)
+        , index_(index)
+    {
+    }
+
+    /// Copies a frame to the other shards.
+    Action entry() override
+    {
+        if (message()->data()->skipMember_ == this)
+        {
+            // Flush marker from ~ShardedCanHub; the hub never sends us these.
+            return release_and_exit();
+        }
+        const auto &shards = parent_->shards_;
+        for (; next_ < shards.size(); ++next_)
+        {
+            if (next_ == index_)
+            {
+                continue;
+            }
+            Shard *dst = shards[next_].get();
+            if (!dst->in[index_]->push(message()->data()->frame()))
+            {
+                // The other shard is behind. Holding on to the message pushes
+                // back on the sources in this shard.
+                return sleep_and_call(&timer_, MSEC_TO_NSEC(1), STATE(entry));
+            }
+            forwarded_.fetch_add(1, std::memory_order_relaxed);
+            dst->drain->wake();
+        }
+        next_ = 0;
+        return release_and_exit();
+    }
+
+    /// @return the number of frames copied to other shards.
+    uint32_t forwarded()
+    {
+        return forwarded_.load(std::memory_order_relaxed);
+    }
+
+private:
+    /// The sharded hub.
+    ShardedCanHub *parent_;
+    /// Index of our shard.
+    unsigned index_;
+    /// Which shard the current message goes to next.
+    unsigned next_ {0};
+    /// Number of frames copied to other shards.
+    std::atomic<uint32_t> forwarded_ {0};
+    /// For waiting when a ring is full.
+    StateFlowTimer timer_ {this};
+};
+
+constexpr unsigned ShardedCanHub::Link::QUEUE_SIZE;
+
+void ShardedCanHub::Drain::run()
+{
+    unsigned n = 0;
+    unsigned count = shard_->in.size();
+    for (unsigned k = 0; k < count && n < BATCH; ++k)
+    {
+        // Starts at a different ring every time for fairness.
+        FrameRing *r = shard_->in[(start_ + k) % count].get();
+        if (!r)
+        {
+            continue;
+        }
+        struct can_frame f;
+        while (n < BATCH && r->pop(&f))
+        {
+            auto *b = shard_->hub->alloc();
+            *b->data()->mutable_frame() = f;
+            // Frames from other shards must not go back out.
+            b->data()->skipMember_ = shard_->link.get();
+            b->set_done(bn_.new_child());
+            shard_->hub->send(b);
+            ++n;
+        }
+    }
+    start_ = (start_ + 1) % count;
+    if (n)
+    {
+        // Lets the hub and the other flows of the shard run before the next
+        // batch.
+        shard_->hub->service()->executor()->add(this);
+        return;
+    }
+    active_.store(false);
+    // A link may have added a frame after we looked at its ring, and seen
+    // active_ still set.
+    for (const auto &r : shard_->in)
+    {
+        if (r && !r->empty())
+        {
+            wake();
+            return;
+        }
+    }
+    if (flushDone_ && !active_.load())
+    {
+        bn_.notify();
+    }
+}
+
+ShardedCanHub::ShardedCanHub(CanHubFlow *hub0, unsigned num_shards)
+{
+    HASSERT(num_shards >= 1);
+    for (unsigned i = 0; i < num_shards; ++i)
+    {
+        Shard *s = new Shard;
+        shards_.emplace_back(s);
+        if (i == 0)
+        {
+            s->hub = hub0;
+        }
+        else
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "hub_shard%u", i);
+            s->name = name;
+            s->executor.reset(new Executor<1>(s->name.c_str(), 0, 2048));
+            s->service.reset(new Service(s->executor.get()));
+            s->ownHub.reset(new CanHubFlow(s->service.get()));
+            s->hub = s->ownHub.get();
+        }
+        s->in.resize(num_shards);
+        for (unsigned j = 0; j < num_shards; ++j)
+        {
+            if (j != i)
+            {
+                s->in[j].reset(new FrameRing());
+            }
+        }
+        s->drain.reset(new Drain(s));
+        s->link.reset(new Link(this, i, s->hub->service()));
+    }
+    if (num_shards > 1)
+    {
+        HubPortLimits limits;
+        limits.maxFrames = Link::QUEUE_SIZE;
+        limits.maxBytes = 0;
+        limits.policy = HubQueuePolicy::BLOCK;
+        limits.onDisconnect = nullptr;
+        for (const auto &s : shards_)
+        {
+            s->hub->register_port(s->link.get(), limits);
+        }
+    }
+}
+
+ShardedCanHub::~ShardedCanHub()
+{
+    if (shards_.size() > 1)
+    {
+        for (const auto &s : shards_)
+        {
+            s->hub->unregister_port(s->link.get());
+        }
+    }
+    // Waits until every link has copied the frames it holds to the rings. A
+    // link processes its messages in order, so a marker sent after the last
+    // frame comes back when the link is done.
+    {
+        SyncNotifiable sn;
+        BarrierNotifiable bn(&sn);
+        for (const auto &s : shards_)
+        {
+            Shard *sh = s.get();
+            sh->hub->service()->executor()->sync_run([sh, &bn]() {
+                auto *b = sh->hub->alloc();
+                b->data()->skipMember_ = sh->link.get();
+                b->set_done(bn.new_child());
+                sh->link->send(b);
+            });
+        }
+        bn.notify();
+        sn.wait_for_notification();
+    }
+    // No more frames go into the rings. Waits until the drains have emptied
+    // them and the hubs have released the frames.
+    {
+        SyncNotifiable sn;
+        BarrierNotifiable bn(&sn);
+        for (const auto &s : shards_)
+        {
+            Shard *sh = s.get();
+            sh->hub->service()->executor()->sync_run(
+                [sh, &bn]() { sh->drain->flush(bn.new_child()); });
+        }
+        bn.notify();
+        sn.wait_for_notification();
+    }
+    // The hub flows may still be returning from the last frame.
+    for (const auto &s : shards_)
+    {
+        s->hub->service()->executor()->sync_run([]() {});
+    }
+}
+
+CanHubFlow *ShardedCanHub::shard(unsigned i)
+{
+    HASSERT(i < shards_.size());
+    return shards_[i]->hub;
+}
+
+uint32_t ShardedCanHub::forwarded()
+{
+    uint32_t ret = 0;
+    for (const auto &s : shards_)
+    {
+        ret += s->link->forwarded();
+    }
+    return ret;
+}
@@ -0,0 +1,106 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file ShardedCanHub.hxx
+ *
+ * A CAN hub split into shards that run on separate executor threads.
+ *
+ * Each shard is a CanHubFlow of its own with its own executor. The ports
+ * (typically client connections) are distributed among the shards. Every
+ * shard has one link port that copies the frames originating in the shard
+ * into a single-producer single-consumer ring towards every other shard; on
+ * the other side a drain flow injects them into that shard's hub. This way a
+ * frame crosses every thread once, and the per-port work of the hub (cloning,
+ * formatting, writing) is spread over the threads.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#ifndef _UTILS_SHARDEDCANHUB_HXX_
+#define _UTILS_SHARDEDCANHUB_HXX_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "utils/Hub.hxx"
+
+/// A CAN hub whose ports are spread over multiple executor threads.
+class ShardedCanHub
+{
+public:
+    /// Number of frames in the ring between two shards. Must be a power of
+    /// two.
+    static constexpr unsigned RING_SIZE = 256;
+
+    /// Constructor.
+    /// @param hub0 the first shard. Runs on its own service; ports that are
+    /// not distributed (upstream link, devices) should be added here.
+    /// @param num_shards total number of shards including hub0. The others
+    /// each get a new executor thread.
+    ShardedCanHub(CanHubFlow *hub0, unsigned num_shards);
+
+    /// Destructor. The ports that were added to the shards must be
+    /// unregistered already. Does not delete hub0.
+    ~ShardedCanHub();
+
+    /// @return the number of shards.
+    unsigned size()
+    {
+        return shards_.size();
+    }
+
+    /// @param i shard index, 0 <= i < size(). @return the hub of the shard.
+    CanHubFlow *shard(unsigned i);
+
+    /// @return the index of the shard that should take the next port. Assigns
+    /// round-robin.
+    unsigned next_shard()
+    {
+        return nextShard_.fetch_add(1, std::memory_order_relaxed) %
+            shards_.size();
+    }
+
+    /// @return the number of frames that were copied from one shard to
+    /// another (counting every destination separately).
+    uint32_t forwarded();
+
+private:
+    class FrameRing;
+    class Link;
+    class Drain;
+    struct Shard;
+
+    /// The shards.
+    std::vector<std::unique_ptr<Shard>> shards_;
+    /// Round-robin counter for next_shard().
+    std::atomic<unsigned> nextShard_ {0};
+
+    DISALLOW_COPY_AND_ASSIGN(ShardedCanHub);
+};
+
+#endif // _UTILS_SHARDEDCANHUB_HXX_
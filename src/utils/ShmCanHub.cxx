@@ -0,0 +1,668 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file ShmCanHub.cxx
+ *
+ * Connects CAN hubs of processes on the same host through shared memory.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#include "utils/ShmCanHub.hxx"
+
+#if OPENMRN_HAVE_FUTEX
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "utils/HubPortQueue.hxx"
+#include "utils/logging.h"
+
+/// One direction of a link. Written by exactly one producer and read by
+/// exactly one consumer; the indexes are free running.
+struct ShmCanRing
+{
+    /// Index of the next frame to write. Written by the producer.
+    alignas(64) std::atomic<uint32_t> tail;
+    /// Index of the next frame to read. Written by the consumer.
+    alignas(64) std::atomic<uint32_t> head;
+    /// The frames.
+    alignas(64) struct can_frame frames[SHM_CAN_RING_SIZE];
+};
+
+/// One client connection in the segment.
+struct ShmCanSlot
+{
+    /// Values of state.
+    enum State
+    {
+        /// Nobody uses the slot.
+        FREE = 0,
+        /// A client is initializing the slot.
+        ATTACHING,
+        /// The client is connected.
+        ACTIVE,
+        /// The client has disconnected; the hub frees the slot.
+        CLOSED,
+    };
+
+    /// One of the State values.
+    std::atomic<uint32_t> state;
+    /// Process ID of the client.
+    std::atomic<int32_t> pid;
+    /// Futex word: non-zero while the client's thread is asleep.
+    std::atomic<uint32_t> sleeping;
+    /// Frames from the client to the hub.
+    ShmCanRing toHub;
+    /// Frames from the hub to the client.
+    ShmCanRing toClient;
+};
+
+/// Header of the segment. The slots follow it.
+struct ShmCanSegment
+{
+    /// SEGMENT_MAGIC once the header is initialized.
+    std::atomic<uint32_t> magic;
+    /// SEGMENT_VERSION.
+    uint32_t version;
+    /// Number of slots after the header.
+    uint32_t numSlots;
+    /// SHM_CAN_RING_SIZE of the hub.
+    uint32_t ringSize;
+    /// Process ID of the hub.
+    int32_t hubPid;
+    /// Non-zero when the hub has shut down.
+    std::atomic<uint32_t> closed;
+    /// Futex word: non-zero while the hub's thread is asleep.
+    alignas(64) std::atomic<uint32_t> sleeping;
+
+    /// @param i slot number. @return the slot.
+    ShmCanSlot *slot(unsigned i)
+    {
+        return reinterpret_cast<ShmCanSlot *>(
+                   reinterpret_cast<uint8_t *>(this) + slot_offset()) +
+            i;
+    }
+
+    /// @return offset of the first slot from the start of the segment.
+    static size_t slot_offset()
+    {
+        return (sizeof(ShmCanSegment) + alignof(ShmCanSlot) - 1) &
+            ~(alignof(ShmCanSlot) - 1);
+    }
+
+    /// @param num_slots number of slots. @return size of the segment.
+    static size_t size(unsigned num_slots)
+    {
+        return slot_offset() + num_slots * sizeof(ShmCanSlot);
+    }
+};
+
+namespace
+{
+
+/// Identifies an initialized segment.
+constexpr uint32_t SEGMENT_MAGIC = 0x4f4d5348; // "OMSH"
+/// Version of the segment layout.
+constexpr uint32_t SEGMENT_VERSION = 1;
+/// Index mask of the rings.
+constexpr uint32_t RING_MASK = SHM_CAN_RING_SIZE - 1;
+static_assert((SHM_CAN_RING_SIZE & RING_MASK) == 0, "not a power of two");
+/// A reader forwards at most this many frames before publishing the new head
+/// of the ring.
+constexpr unsigned READ_BATCH = 64;
+/// How long the threads sleep before checking whether the other processes
+/// are still alive.
+constexpr long long IDLE_TIMEOUT_NSEC = MSEC_TO_NSEC(100);
+/// How many times a reader checks for more data before it goes to sleep.
+constexpr unsigned SPIN_COUNT = 200;
+/// How long a full ring waits before trying again.
+constexpr long long RETRY_NSEC = MSEC_TO_NSEC(1);
+
+/// Sleeps while *addr == 1. @param addr futex word in the shared memory.
+/// @param timeout_nsec maximum time to sleep.
+void futex_wait(std::atomic<uint32_t> *addr, long long timeout_nsec)
+{
+    struct timespec ts;
+    ts.tv_sec = timeout_nsec / 1000000000;
+    ts.tv_nsec = timeout_nsec % 1000000000;
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAIT, 1, &ts,
+        nullptr, 0);
+}
+
+/// Wakes up the threads sleeping on a futex word. @param addr futex word in
+/// the shared memory.
+void futex_wake(std::atomic<uint32_t> *addr)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAKE,
+        INT_MAX, nullptr, nullptr, 0);
+}
+
+/// Called after writing into a ring or changing a slot state. Wakes up the
+/// reader if it went to sleep.
+/// @param sleeping futex word of the reader.
+/// @param stats counts the wakeups; may be null.
+void wake_reader(std::atomic<uint32_t> *sleeping, ShmCanStats *stats)
+{
+    // Pairs with the store of the sleeping flag before the reader checks the
+    // rings the last time.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping->load(std::memory_order_relaxed) && sleeping->exchange(0))
+    {
+        futex_wake(sleeping);
+        if (stats)
+        {
+            ++stats->wakeups;
+        }
+    }
+}
+
+/// Puts the calling thread to sleep until a writer wakes it up. Before
+/// that, waits a little while for more data without a system call, and then
+/// gives up the CPU once, so that a writer running on the same CPU can
+/// continue without needing a wakeup.
+/// @param sleeping futex word of the reader.
+/// @param has_work checks the rings (again).
+template <class F>
+void reader_sleep(std::atomic<uint32_t> *sleeping, F has_work)
+{
+    for (unsigned i = 0; i < SPIN_COUNT; ++i)
+    {
+        if (has_work())
+        {
+            return;
+        }
+        asm volatile("" ::: "memory");
+    }
+    sched_yield();
+    if (has_work())
+    {
+        return;
+    }
+    sleeping->store(1);
+    if (!has_work())
+    {
+        futex_wait(sleeping, IDLE_TIMEOUT_NSEC);
+    }
+    sleeping->store(0, std::memory_order_relaxed);
+}
+
+/// @param r a ring. @return true if the ring has frames to read.
+bool ring_has_data(ShmCanRing *r)
+{
+    return r->head.load(std::memory_order_relaxed) !=
+        r->tail.load(std::memory_order_acquire);
+}
+
+/// Adds a frame to a ring. @param r the ring. @param f the frame. @return
+/// false if the ring is full.
+bool ring_write(ShmCanRing *r, const struct can_frame &f)
+{
+    uint32_t t = r->tail.load(std::memory_order_relaxed);
+    if (t - r->head.load(std::memory_order_acquire) >= SHM_CAN_RING_SIZE)
+    {
+        return false;
+    }
+    r->frames[t & RING_MASK] = f;
+    r->tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+/// Forwards the frames of a ring to a hub.
+/// @param r the ring.
+/// @param hub where to send the frames.
+/// @param skip the skipMember_ of the frames.
+/// @param stats counters.
+/// @return the number of frames forwarded.
+unsigned ring_read(ShmCanRing *r, CanHubFlow *hub,
+    CanHubPortInterface *skip, ShmCanStats *stats)
+{
+    unsigned count = 0;
+    uint32_t h = r->head.load(std::memory_order_relaxed);
+    while (true)
+    {
+        uint32_t t = r->tail.load(std::memory_order_acquire);
+        if (h == t)
+        {
+            break;
+        }
+        unsigned n = 0;
+        for (; h != t && n < READ_BATCH; ++h, ++n)
+        {
+            auto *b = hub->alloc();
+            *b->data()->mutable_frame() = r->frames[h & RING_MASK];
+            b->data()->skipMember_ = skip;
+            hub->send(b);
+        }
+        r->head.store(h, std::memory_order_release);
+        count += n;
+    }
+    stats->received += count;
+    return count;
+}
+
+/// @param pid a process ID. @return false if the process does not exist
+/// any more.
+bool process_alive(int32_t pid)
+{
+    return pid <= 0 || ::kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+} // namespace
+
+StateFlowBase::Action ShmCanWriteFlow::try_write()
+{
+    if (closed_)
+    {
+        return release_and_exit();
+    }
+    if (!ring_write(ring_, message()->data()->frame()))
+    {
+        ++stats_->ringFull;
+        return sleep_and_call(&timer_, RETRY_NSEC, STATE(try_write));
+    }
+    ++stats_->sent;
+    wake_reader(sleeping_, stats_);
+    return release_and_exit();
+}
+
+/// State of one client connected to the ShmCanHub.
+struct ShmCanHub::Link
+{
+    /// Called by the hub when the client falls too far behind.
+    class Disconnect : public Notifiable
+    {
+    public:
+        /// @param parent the link. @param segment for waking up the thread.
+        Disconnect(Link *parent, ShmCanSegment *segment)
+            : parent_(parent)
+            , segment_(segment)
+        {
+        }
+
+        void notify() override
+        {
+            parent_->kicked = true;
+            wake_reader(&segment_->sleeping, nullptr);
+        }
+
+    private:
+        /// The link.
+        Link *parent_;
+        /// The segment.
+        ShmCanSegment *segment_;
+    };
+
+    /// Constructor. @param hub the hub. @param segment the segment. @param
+    /// index slot number. @param stats counters.
+    Link(CanHubFlow *hub, ShmCanSegment *segment, unsigned index,
+        ShmCanStats *stats)
+        : slot(segment->slot(index))
+        , writeFlow(
+              hub->service(), &slot->toClient, &slot->sleeping, stats)
+        , disconnect(this, segment)
+    {
+    }
+
+    /// The slot.
+    ShmCanSlot *slot;
+    /// Writes the frames of the hub to the client.
+    ShmCanWriteFlow writeFlow;
+    /// Notifiable for the hub's slow consumer policy.
+    Disconnect disconnect;
+    /// Set when the hub wants the client disconnected.
+    std::atomic<bool> kicked {false};
+};
+
+ShmCanHub::ShmCanHub(CanHubFlow *hub, const string &name, unsigned num_slots)
+    : hub_(hub)
+    , name_(name)
+    , links_(num_slots)
+    , stats_(num_slots)
+{
+    ::shm_unlink(name.c_str());
+    int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+    if (fd < 0)
+    {
+        LOG_ERROR("shm_open %s: %s", name.c_str(), strerror(errno));
+        return;
+    }
+    // The mode given to shm_open is filtered by the umask.
+    ::fchmod(fd, 0666);
+    size_t size = ShmCanSegment::size(num_slots);
+    void *m = MAP_FAILED;
+    if (::ftruncate(fd, size) == 0)
+    {
+        m = ::mmap(
+            nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (m == MAP_FAILED)
+    {
+        LOG_ERROR("shm segment %s: %s", name.c_str(), strerror(errno));
+        ::shm_unlink(name.c_str());
+        return;
+    }
+    // The new segment is zero filled, so all slots are free and all rings
+    // are empty.
+    segment_ = static_cast<ShmCanSegment *>(m);
+    size_ = size;
+    segment_->version = SEGMENT_VERSION;
+    segment_->numSlots = num_slots;
+    segment_->ringSize = SHM_CAN_RING_SIZE;
+    segment_->hubPid = ::getpid();
+    segment_->magic.store(SEGMENT_MAGIC, std::memory_order_release);
+    start("shm_can_hub", 0, 2048);
+}
+
+ShmCanHub::~ShmCanHub()
+{
+    if (!segment_)
+    {
+        return;
+    }
+    segment_->closed = 1;
+    for (unsigned i = 0; i < links_.size(); ++i)
+    {
+        wake_reader(&segment_->slot(i)->sleeping, nullptr);
+    }
+    stop_ = true;
+    wake_reader(&segment_->sleeping, nullptr);
+    exited_.wait();
+    for (unsigned i = 0; i < links_.size(); ++i)
+    {
+        if (links_[i])
+        {
+            close_link(i);
+        }
+    }
+    ::munmap(segment_, size_);
+    ::shm_unlink(name_.c_str());
+}
+
+void *ShmCanHub::entry()
+{
+    while (!stop_)
+    {
+        if (poll_slots())
+        {
+            continue;
+        }
+        reader_sleep(&segment_->sleeping,
+            [this]() { return stop_ || poll_slots(); });
+        long long now = os_get_time_monotonic();
+        if (now - lastCheck_ >= IDLE_TIMEOUT_NSEC)
+        {
+            lastCheck_ = now;
+            check_clients();
+        }
+    }
+    exited_.post();
+    return nullptr;
+}
+
+bool ShmCanHub::poll_slots()
+{
+    bool ret = false;
+    for (unsigned i = 0; i < links_.size(); ++i)
+    {
+        ShmCanSlot *slot = segment_->slot(i);
+        uint32_t state = slot->state.load(std::memory_order_acquire);
+        if (!links_[i])
+        {
+            if (state == ShmCanSlot::ACTIVE)
+            {
+                open_link(i);
+                ret = true;
+            }
+            else if (state == ShmCanSlot::CLOSED)
+            {
+                // Closed before we have seen it.
+                slot->state.store(ShmCanSlot::FREE);
+                ret = true;
+            }
+            continue;
+        }
+        if (ring_read(&slot->toHub, hub_, &links_[i]->writeFlow,
+                &stats_[i]))
+        {
+            ret = true;
+        }
+        if (state == ShmCanSlot::CLOSED || links_[i]->kicked)
+        {
+            close_link(i);
+            ret = true;
+        }
+    }
+    return ret;
+}
+
+void ShmCanHub::check_clients()
+{
+    for (unsigned i = 0; i < links_.size(); ++i)
+    {
+        if (links_[i] && !process_alive(segment_->slot(i)->pid.load()))
+        {
+            LOG(INFO, "shm client %u (pid %d) is gone", i,
+                (int)segment_->slot(i)->pid.load());
+            close_link(i);
+        }
+    }
+}
+
+void ShmCanHub::open_link(unsigned index)
+{
+    stats_[index] = ShmCanStats();
+    links_[index].reset(new Link(hub_, segment_, index, &stats_[index]));
+    Link *l = links_[index].get();
+    HubPortLimits limits;
+    if (hub_port_limits_from_config(&limits, &l->disconnect))
+    {
+        hub_->register_port(&l->writeFlow, limits);
+    }
+    else
+    {
+        hub_->register_port(&l->writeFlow);
+    }
+    ++numClients_;
+    LOG(INFO, "shm client %u (pid %d) connected", index,
+        (int)segment_->slot(index)->pid.load());
+}
+
+void ShmCanHub::close_link(unsigned index)
+{
+    Link *l = links_[index].get();
+    hub_->unregister_port(&l->writeFlow);
+    ExecutorBase *e = hub_->service()->executor();
+    bool idle = false;
+    e->sync_run([l]() { l->writeFlow.close(); });
+    while (true)
+    {
+        e->sync_run([l, &idle]() { idle = l->writeFlow.is_waiting(); });
+        if (idle)
+        {
+            break;
+        }
+        // A full ring is retried after a timer.
+        usleep(1000);
+    }
+    links_[index].reset();
+    --numClients_;
+    segment_->slot(index)->state.store(ShmCanSlot::FREE);
+}
+
+ShmCanHubPort::ShmCanHubPort(
+    CanHubFlow *hub, const string &name, Notifiable *on_error)
+    : hub_(hub)
+    , onError_(on_error)
+{
+    int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+    {
+        LOG(INFO, "shm_open %s: %s", name.c_str(), strerror(errno));
+        return;
+    }
+    struct stat st;
+    void *m = MAP_FAILED;
+    if (::fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(ShmCanSegment))
+    {
+        m = ::mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+            fd, 0);
+    }
+    ::close(fd);
+    if (m == MAP_FAILED)
+    {
+        LOG_ERROR("shm segment %s is not usable", name.c_str());
+        return;
+    }
+    ShmCanSegment *seg = static_cast<ShmCanSegment *>(m);
+    if (seg->magic.load(std::memory_order_acquire) != SEGMENT_MAGIC ||
+        seg->version != SEGMENT_VERSION ||
+        seg->ringSize != SHM_CAN_RING_SIZE ||
+        ShmCanSegment::size(seg->numSlots) > (size_t)st.st_size ||
+        seg->closed.load())
+    {
+        LOG_ERROR("shm segment %s is incompatible", name.c_str());
+        ::munmap(m, st.st_size);
+        return;
+    }
+    for (unsigned i = 0; i < seg->numSlots; ++i)
+    {
+        ShmCanSlot *slot = seg->slot(i);
+        uint32_t expected = ShmCanSlot::FREE;
+        if (!slot->state.compare_exchange_strong(
+                expected, ShmCanSlot::ATTACHING))
+        {
+            continue;
+        }
+        slot->toHub.head = 0;
+        slot->toHub.tail = 0;
+        slot->toClient.head = 0;
+        slot->toClient.tail = 0;
+        slot->sleeping = 0;
+        slot->pid = ::getpid();
+        slot->state.store(ShmCanSlot::ACTIVE);
+        wake_reader(&seg->sleeping, nullptr);
+        segment_ = seg;
+        size_ = st.st_size;
+        index_ = i;
+        break;
+    }
+    if (!segment_)
+    {
+        LOG_ERROR("shm segment %s has no free slots", name.c_str());
+        ::munmap(m, st.st_size);
+        return;
+    }
+    ShmCanSlot *slot = segment_->slot(index_);
+    writeFlow_.reset(new ShmCanWriteFlow(
+        hub_->service(), &slot->toHub, &segment_->sleeping, &stats_));
+    hub_->register_port(writeFlow_.get());
+    start("shm_can_port", 0, 2048);
+}
+
+ShmCanHubPort::~ShmCanHubPort()
+{
+    if (!segment_)
+    {
+        return;
+    }
+    ShmCanSlot *slot = segment_->slot(index_);
+    hub_->unregister_port(writeFlow_.get());
+    ExecutorBase *e = hub_->service()->executor();
+    e->sync_run([this]() { writeFlow_->close(); });
+    bool idle = false;
+    while (true)
+    {
+        e->sync_run([this, &idle]() { idle = writeFlow_->is_waiting(); });
+        if (idle)
+        {
+            break;
+        }
+        usleep(1000);
+    }
+    stop_ = true;
+    wake_reader(&slot->sleeping, nullptr);
+    exited_.wait();
+    slot->state.store(ShmCanSlot::CLOSED);
+    wake_reader(&segment_->sleeping, nullptr);
+    ::munmap(segment_, size_);
+}
+
+void *ShmCanHubPort::entry()
+{
+    ShmCanSlot *slot = segment_->slot(index_);
+    long long last_check = 0;
+    while (!stop_)
+    {
+        if (ring_read(&slot->toClient, hub_, writeFlow_.get(), &stats_))
+        {
+            continue;
+        }
+        if (segment_->closed.load())
+        {
+            break;
+        }
+        reader_sleep(&slot->sleeping, [this, slot]() {
+            return stop_ || segment_->closed.load() ||
+                ring_has_data(&slot->toClient);
+        });
+        long long now = os_get_time_monotonic();
+        if (now - last_check >= IDLE_TIMEOUT_NSEC)
+        {
+            last_check = now;
+            if (!process_alive(segment_->hubPid))
+            {
+                break;
+            }
+        }
+    }
+    if (!stop_)
+    {
+        LOG(INFO, "shm hub is gone");
+        hub_->service()->executor()->sync_run(
+            [this]() { writeFlow_->close(); });
+        if (onError_)
+        {
+            onError_->notify();
+        }
+    }
+    exited_.post();
+    return nullptr;
+}
+
+#endif // OPENMRN_HAVE_FUTEX
@@ -0,0 +1,264 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file ShmCanHub.hxx
+ *
+ * Connects CAN hubs of processes on the same host through shared memory.
+ *
+ * The hub process creates a named POSIX shared memory segment with a fixed
+ * number of client slots. A client process claims a free slot. Each slot has
+ * two single-producer single-consumer rings of binary struct can_frame, one
+ * for each direction. While traffic is flowing, frames are exchanged without
+ * any system calls; a futex wakeup is only sent when the reader of a ring has
+ * run out of work and went to sleep.
+ *
+ * @author agent
+ * @date 18 Oct 2026
+ */
+
+#ifndef _UTILS_SHMCANHUB_HXX_
+#define _UTILS_SHMCANHUB_HXX_
+
+#include "openmrn_features.h"
+
+#if OPENMRN_HAVE_FUTEX
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "executor/StateFlow.hxx"
+#include "os/OS.hxx"
+#include "utils/Hub.hxx"
+
+struct ShmCanRing;
+struct ShmCanSegment;
+
+/// Number of frames in each ring of a shared memory CAN link. Both sides
+/// must use the same value.
+#define SHM_CAN_RING_SIZE 1024
+
+/// Counters of a shared memory CAN link.
+struct ShmCanStats
+{
+    /// Frames written to the ring.
+    uint32_t sent {0};
+    /// Frames read from the ring.
+    uint32_t received {0};
+    /// Number of times a frame had to wait because the ring was full.
+    uint32_t ringFull {0};
+    /// Number of wakeup system calls made.
+    uint32_t wakeups {0};
+};
+
+/// Hub port that writes the frames of a CAN hub into one ring of a shared
+/// memory segment. When the ring is full, the frame is retried after a
+/// millisecond; meanwhile the next frames wait in the queue of the flow.
+class ShmCanWriteFlow : public CanHubPort
+{
+public:
+    /// Constructor.
+    ///
+    /// @param service the executor to run on (usually the hub's).
+    /// @param ring where to write the frames.
+    /// @param sleeping futex word of the reader of the ring; it is woken up
+    /// when it is non-zero.
+    /// @param stats counters to update.
+    ShmCanWriteFlow(Service *service, ShmCanRing *ring,
+        std::atomic<uint32_t> *sleeping, ShmCanStats *stats)
+        : CanHubPort(service)
+        , ring_(ring)
+        , sleeping_(sleeping)
+        , stats_(stats)
+    {
+    }
+
+    /// Makes the flow drop all frames instead of writing them, because the
+    /// reader is gone. Must be called on the executor.
+    void close()
+    {
+        closed_ = true;
+    }
+
+    Action entry() override
+    {
+        return call_immediately(STATE(try_write));
+    }
+
+private:
+    /// Tries to add the frame to the ring. @return next state.
+    Action try_write();
+
+    /// Where to write.
+    ShmCanRing *ring_;
+    /// Futex word of the reader.
+    std::atomic<uint32_t> *sleeping_;
+    /// Counters.
+    ShmCanStats *stats_;
+    /// True if the frames should be dropped.
+    bool closed_ {false};
+    /// Helper for retrying when the ring is full.
+    StateFlowTimer timer_ {this};
+};
+
+/** Hub side of the shared memory transport. Creates the named segment and
+ * connects every client that attaches to it to a CAN hub. The frames coming
+ * from the clients are read by one thread for all clients and sent to the
+ * hub with the client as skipMember_, so there is no loopback. */
+class ShmCanHub : private OSThread
+{
+public:
+    /// Constructor. Replaces a stale segment with the same name.
+    ///
+    /// @param hub the CAN hub to connect the clients to.
+    /// @param name name of the shared memory segment, e.g. "/openmrn_hub".
+    /// @param num_slots how many clients can be connected at the same time.
+    ShmCanHub(CanHubFlow *hub, const string &name, unsigned num_slots = 16);
+
+    /// Disconnects the clients and removes the segment.
+    ~ShmCanHub();
+
+    /// @return false if the segment could not be created.
+    bool is_valid()
+    {
+        return segment_ != nullptr;
+    }
+
+    /// @return the number of connected clients.
+    unsigned num_clients()
+    {
+        return numClients_;
+    }
+
+    /// @param index slot number. @return counters of the client in that
+    /// slot. The values are not synchronized.
+    const ShmCanStats &stats(unsigned index)
+    {
+        return stats_[index];
+    }
+
+private:
+    /// State of one connected client.
+    struct Link;
+
+    /// Thread body: reads the frames of the clients and follows their
+    /// connections and disconnections.
+    void *entry() override;
+
+    /// Reads the rings of all clients once, and processes the slot state
+    /// changes. @return true if anything happened.
+    bool poll_slots();
+
+    /// Disconnects the clients whose process died.
+    void check_clients();
+
+    /// Sets up a newly attached client. @param index slot number.
+    void open_link(unsigned index);
+
+    /// Disconnects a client and frees its slot. @param index slot number.
+    void close_link(unsigned index);
+
+    /// The hub.
+    CanHubFlow *hub_;
+    /// Name of the segment.
+    string name_;
+    /// The mapped segment, or nullptr.
+    ShmCanSegment *segment_ {nullptr};
+    /// Size of the mapping.
+    size_t size_ {0};
+    /// Connected clients, indexed by slot.
+    std::vector<std::unique_ptr<Link>> links_;
+    /// Counters, indexed by slot.
+    std::vector<ShmCanStats> stats_;
+    /// Number of entries in links_.
+    std::atomic<unsigned> numClients_ {0};
+    /// Monotonic time of the last check_clients().
+    long long lastCheck_ {0};
+    /// Set to stop the thread.
+    std::atomic<bool> stop_ {false};
+    /// Posted when the thread exits.
+    OSSem exited_;
+};
+
+/** Client side of the shared memory transport. Attaches to the segment of a
+ * ShmCanHub in another (or the same) process and connects it to a local CAN
+ * hub, like a network connection to a hub would. */
+class ShmCanHubPort : private OSThread
+{
+public:
+    /// Constructor.
+    ///
+    /// @param hub the local CAN hub.
+    /// @param name name of the shared memory segment of the ShmCanHub.
+    /// @param on_error notified (from the port's thread) if the ShmCanHub
+    /// goes away.
+    ShmCanHubPort(
+        CanHubFlow *hub, const string &name, Notifiable *on_error = nullptr);
+
+    /// Disconnects and frees the slot.
+    ~ShmCanHubPort();
+
+    /// @return false if the segment does not exist, is incompatible or has
+    /// no free slots.
+    bool is_valid()
+    {
+        return segment_ != nullptr;
+    }
+
+    /// @return the counters of this connection. The values are not
+    /// synchronized.
+    const ShmCanStats &stats()
+    {
+        return stats_;
+    }
+
+private:
+    /// Thread body: reads the frames coming from the ShmCanHub.
+    void *entry() override;
+
+    /// The local hub.
+    CanHubFlow *hub_;
+    /// The mapped segment, or nullptr.
+    ShmCanSegment *segment_ {nullptr};
+    /// Size of the mapping.
+    size_t size_ {0};
+    /// Our slot number.
+    unsigned index_ {0};
+    /// Counters.
+    ShmCanStats stats_;
+    /// Writes the frames of the local hub to the ShmCanHub.
+    std::unique_ptr<ShmCanWriteFlow> writeFlow_;
+    /// Called when the ShmCanHub goes away.
+    Notifiable *onError_;
+    /// Set to stop the thread.
+    std::atomic<bool> stop_ {false};
+    /// Posted when the thread exits.
+    OSSem exited_;
+};
+
+#endif // OPENMRN_HAVE_FUTEX
+
+#endif // _UTILS_SHMCANHUB_HXX_
@@ -474,15 +474,21 @@ protected:
 
     void wait_for_event_thread()
     {
-        while (EventService::instance->event_processing_pending())
+        // The event service may start waiting for a timer (identify pacing)
+        // while the interface is processing, so we check again after the
+        // executor is empty.
+        do
         {
+            while (EventService::instance->event_processing_pending())
+            {
 #ifdef __EMSCRIPTEN__
-            os_emscripten_yield();
+                os_emscripten_yield();
 #else
-            usleep(100);
+                usleep(100);
 #endif
-        }
-        AsyncIfTest::wait();
+            }
+            AsyncIfTest::wait();
+        } while (EventService::instance->event_processing_pending());
     }
 
     EventService eventService_;
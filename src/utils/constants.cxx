@@ -85,6 +85,12 @@
  * vs the overhead used by the framework.
  */
 
+/** @var _sym_executor_use_epoll
+ *
+ * @brief Set to true to have executors wait for their FDs using epoll instead
+ * of ::pselect. Ignored on platforms without epoll. Off by default.
+ */
+
 /** @var _sym_can_tx_buffer_size
  * @brief default software buffer size for CAN transmission
  */
@@ -131,6 +137,7 @@ DEFAULT_CONST(main_thread_priority, 0xdefa01);
 DEFAULT_CONST(main_thread_stack_size, 2048);
 DEFAULT_CONST(executor_max_sleep_msec, 40);
 DEFAULT_CONST(executor_select_prescaler, 5);
+DEFAULT_CONST_FALSE(executor_use_epoll);
 
 DEFAULT_CONST(can_tx_buffer_size, 16);
 DEFAULT_CONST(can_rx_buffer_size, 16);
@@ -152,3 +159,9 @@ DEFAULT_CONST(gridconnect_bridge_max_incoming_packets, 1);
 DEFAULT_CONST(gridconnect_bridge_max_outgoing_packets, 1);
 
 DEFAULT_CONST_FALSE(gridconnect_tcp_use_select);
+
+/// 0 = no limit
+DEFAULT_CONST(hub_port_queue_max_frames, 0);
+DEFAULT_CONST(hub_port_queue_max_bytes, 0);
+/// HubQueuePolicy::DISCONNECT
+DEFAULT_CONST(hub_port_queue_policy, 3);
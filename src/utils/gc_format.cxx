@@ -34,10 +34,18 @@
 //#define LOGLEVEL VERBOSE
 
 #include <stdint.h>
+#include <string.h>
 #include "utils/logging.h"
 #include "utils/gc_format.h"
 #include "can_frame.h"
 
+// The hex conversion of the frame ID and payload is vectorized where the
+// compiler gives us SSE2; other targets use the scalar code.
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define GC_FORMAT_SSE2 1
+#endif
+
 extern "C" {
 
 /** Build an ASCII character representation of a nibble value (uppercase hex).
@@ -78,20 +86,132 @@ static int ascii_to_nibble(const char c)
     return -1;
 }
 
+/** Value of each character as a hex digit (upper or lowercase), 0x80 for
+ * characters that are not hex digits. */
+static const uint8_t HEX_NIBBLE[256] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
 
-int gc_format_parse(const char* buf, struct can_frame* can_frame)
+/** Converts 16 hex characters (upper or lowercase) to 8 bytes.
+ * @param src the characters to convert.
+ * @param dst the converted bytes, written only in case of success.
+ * @return false if any of the characters is not a hex digit.
+ */
+static bool hex_decode_16(const char *src, uint8_t *dst)
 {
-    CLR_CAN_FRAME_ERR(*can_frame);
-    if (*buf == ':')
+#if GC_FORMAT_SSE2
+    __m128i c = _mm_loadu_si128((const __m128i *)src);
+    // Digits: c - '0' in [0, 9]. Letters: (c | 0x20) - 'a' in [0, 5]. The
+    // comparisons are signed, which correctly excludes characters >= 0x80.
+    __m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(d, _mm_set1_epi8(-1)),
+        _mm_cmplt_epi8(d, _mm_set1_epi8(10)));
+    __m128i l = _mm_sub_epi8(
+        _mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(l, _mm_set1_epi8(-1)),
+        _mm_cmplt_epi8(l, _mm_set1_epi8(6)));
+    if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha)) != 0xffff)
     {
-        // skip leading :
-        ++buf;
+        return false;
+    }
+    __m128i v = _mm_or_si128(_mm_and_si128(is_digit, d),
+        _mm_and_si128(is_alpha, _mm_add_epi8(l, _mm_set1_epi8(10))));
+    // Each 16-bit lane has the high nibble in the low byte and the low nibble
+    // in the high byte.
+    v = _mm_or_si128(_mm_slli_epi16(v, 4), _mm_srli_epi16(v, 8));
+    v = _mm_and_si128(v, _mm_set1_epi16(0xff));
+    _mm_storel_epi64((__m128i *)dst, _mm_packus_epi16(v, v));
+    return true;
+#else
+    uint8_t out[8];
+    for (unsigned i = 0; i < 8; ++i)
+    {
+        int nh = ascii_to_nibble(src[2 * i]);
+        int nl = ascii_to_nibble(src[2 * i + 1]);
+        if (nh < 0 || nl < 0)
+        {
+            return false;
+        }
+        out[i] = (nh << 4) | nl;
+    }
+    memcpy(dst, out, 8);
+    return true;
+#endif
+}
+
+/** Converts 8 bytes to 16 uppercase hex characters.
+ * @param src the bytes to convert.
+ * @param dst where to write the characters. Exactly 16 characters are
+ * written, no terminating zero.
+ */
+static void hex_encode_8(const uint8_t *src, char *dst)
+{
+#if GC_FORMAT_SSE2
+    __m128i b = _mm_loadl_epi64((const __m128i *)src);
+    __m128i mask = _mm_set1_epi8(0xf);
+    __m128i n = _mm_unpacklo_epi8(
+        _mm_and_si128(_mm_srli_epi16(b, 4), mask), _mm_and_si128(b, mask));
+    __m128i a = _mm_add_epi8(n, _mm_set1_epi8('0'));
+    a = _mm_add_epi8(a, _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)),
+        _mm_set1_epi8('A' - '0' - 10)));
+    _mm_storeu_si128((__m128i *)dst, a);
+#else
+    static const char HEX[] = "0123456789ABCDEF";
+    for (unsigned i = 0; i < 8; ++i)
+    {
+        dst[2 * i] = HEX[src[i] >> 4];
+        dst[2 * i + 1] = HEX[src[i] & 0xf];
     }
-    if (*buf == 'X')
+#endif
+}
+
+/** Parses a GridConnect packet character by character. Accepts every packet
+    shape, e.g. a frame ID with fewer digits than usual.
+    @param buf is the packet, without the leading ':' and trailing ';'.
+    @param len is the number of characters in buf.
+    @param can_frame is the output frame.
+    @return 0 in case of success, -1 if there was a packet format error. */
+static int gc_format_parse_scalar(
+    const char *buf, size_t len, struct can_frame *can_frame)
+{
+    const char *end = buf + len;
+    CLR_CAN_FRAME_ERR(*can_frame);
+    if (buf < end && *buf == 'X')
     {
         SET_CAN_FRAME_EFF(*can_frame);
     }
-    else if (*buf == 'S') 
+    else if (buf < end && *buf == 'S')
     {
         CLR_CAN_FRAME_EFF(*can_frame);
     } else
@@ -104,21 +224,21 @@ int gc_format_parse(const char* buf, struct can_frame* can_frame)
     uint32_t id = 0;
     while (1)
     {
-        int nibble = ascii_to_nibble(*buf);
+        int nibble = buf < end ? ascii_to_nibble(*buf) : -1;
         if (nibble >= 0)
         {
             id <<= 4;
             id |= nibble;
             ++buf;
         }
-        else if (*buf == 'N')
+        else if (buf < end && *buf == 'N')
         {
             // end of ID, frame is coming.
             CLR_CAN_FRAME_RTR(*can_frame);
             ++buf;
             break;
         }
-        else if (*buf == 'R')
+        else if (buf < end && *buf == 'R')
         {
             // end of ID, remote frame is coming.
             SET_CAN_FRAME_RTR(*can_frame);
@@ -141,8 +261,14 @@ int gc_format_parse(const char* buf, struct can_frame* can_frame)
         SET_CAN_FRAME_ID(*can_frame, id);
     }
     int index = 0;
-    while ((*buf != 0) && (*buf != ';'))
+    while (buf < end)
     {
+        if (index >= 8 || end - buf < 2)
+        {
+            // Too much data or odd number of characters.
+            SET_CAN_FRAME_ERR(*can_frame);
+            return -1;
+        }
         int nh = ascii_to_nibble(*buf++);
         int nl = ascii_to_nibble(*buf++);
         if (nh < 0 || nl < 0)
@@ -157,14 +283,94 @@ int gc_format_parse(const char* buf, struct can_frame* can_frame)
     return 0;
 }
 
-/// Helper function for appending to a buffer ONCE.
-///
-/// @param dst buffer to append data to
-/// @param value one character to append to.
-///
-static void output_single(char*& dst, char value)
+int gc_format_parse_len(const char* buf, size_t len, struct can_frame* can_frame)
 {
-    *dst++ = value;
+    if (len && *buf == ':')
+    {
+        // skip leading :
+        ++buf;
+        --len;
+    }
+    // Fast path for the canonical packet shapes: X + 8 ID digits or S + 3 ID
+    // digits, then N or R, then at most 8 bytes of data. The digits are
+    // converted without branches and checked once at the end; a full 8-byte
+    // payload is converted straight from the input with hex_decode_16.
+    size_t header;
+    if (len >= 10 && buf[0] == 'X' && (buf[9] == 'N' || buf[9] == 'R'))
+    {
+        header = 10;
+    }
+    else if (len >= 5 && buf[0] == 'S' && (buf[4] == 'N' || buf[4] == 'R'))
+    {
+        header = 5;
+    }
+    else
+    {
+        return gc_format_parse_scalar(buf, len, can_frame);
+    }
+    size_t data_chars = len - header;
+    if (data_chars > 16 || (data_chars & 1))
+    {
+        return gc_format_parse_scalar(buf, len, can_frame);
+    }
+    const uint8_t *p = (const uint8_t *)buf + 1;
+    const uint8_t *id_end = (const uint8_t *)buf + header - 1;
+    uint8_t bad = 0;
+    uint32_t id = 0;
+    for (; p < id_end; ++p)
+    {
+        uint8_t n = HEX_NIBBLE[*p];
+        bad |= n;
+        id = (id << 4) | (n & 0xf);
+    }
+    ++p;
+    uint8_t data[8];
+    if (data_chars == 16)
+    {
+        bad |= hex_decode_16((const char *)p, data) ? 0 : 0x80;
+    }
+    else
+    {
+        for (unsigned i = 0; i < data_chars / 2; ++i, p += 2)
+        {
+            uint8_t nh = HEX_NIBBLE[p[0]];
+            uint8_t nl = HEX_NIBBLE[p[1]];
+            bad |= nh | nl;
+            data[i] = (nh << 4) | (nl & 0xf);
+        }
+    }
+    if (bad & 0x80)
+    {
+        // Invalid character; the scalar parser produces the error.
+        return gc_format_parse_scalar(buf, len, can_frame);
+    }
+    CLR_CAN_FRAME_ERR(*can_frame);
+    if (header == 10)
+    {
+        SET_CAN_FRAME_EFF(*can_frame);
+        SET_CAN_FRAME_ID_EFF(*can_frame, id);
+    }
+    else
+    {
+        CLR_CAN_FRAME_EFF(*can_frame);
+        SET_CAN_FRAME_ID(*can_frame, id);
+    }
+    if (buf[header - 1] == 'R')
+    {
+        SET_CAN_FRAME_RTR(*can_frame);
+    }
+    else
+    {
+        CLR_CAN_FRAME_RTR(*can_frame);
+    }
+    memcpy(can_frame->data, data, data_chars / 2);
+    can_frame->can_dlc = data_chars / 2;
+    return 0;
+}
+
+int gc_format_parse(const char* buf, struct can_frame* can_frame)
+{
+    return gc_format_parse_len(buf, strcspn(buf, ";"), can_frame);
 }
 
 /// Helper function for appending to a buffer TWICE. Used in the implementation
@@ -179,41 +385,14 @@ static void output_double(char*& dst, char value)
     *dst++ = value;
 }
 
-/** Formats a can frame in the GridConnect protocol.
-
-    If requested, it can create the double protocol with leading !!, trailing ;;
-    and all the characters doubled.
-
-    If the input frame is an error frame, then does not output anything and
-    returns the input pointer.
-
-    @param can_frame is the input frame.
-
-    @param buf is the output buffer. The caller must ensure this is big enough
-    to hold the resulting frame (28 or 56 bytes).
-
-    @param double_format if non-zero, the doubling format will be generated.
-
-    @return the pointer to the buffer character after the formatted can frame.
-*/
-char* gc_format_generate(const struct can_frame* can_frame, char* buf, int double_format)
+/** Formats a can frame in the double GridConnect protocol, character by
+    character. @param can_frame is the input frame. @param buf is the output
+    buffer. @return the pointer after the formatted frame. */
+static char *gc_format_generate_double(
+    const struct can_frame *can_frame, char *buf)
 {
-    if (IS_CAN_FRAME_ERR(*can_frame))
-    {
-        LOG(VERBOSE, "GC generate: incoming frame ERR.");
-        return buf;
-    }
-    void (*output)(char*& dst, char value);
-    if (double_format)
-    {
-        output = output_double;
-        output(buf, '!');
-    }
-    else
-    {
-        output = output_single;
-        output(buf, ':');
-    }
+    auto output = output_double;
+    output(buf, '!');
     uint32_t id;
     int offset;
     if (IS_CAN_FRAME_EFF(*can_frame))
@@ -253,4 +432,99 @@ char* gc_format_generate(const struct can_frame* can_frame, char* buf, int doubl
     return buf;
 }
 
+/** Formats a can frame in the single GridConnect protocol. The hex digits are
+    written in blocks of 16, which may overwrite characters after the end of
+    the frame (but not after buf + GC_FORMAT_MAX_FRAME_LENGTH).
+    @param can_frame is the input frame. @param buf is the output buffer.
+    @return the pointer after the formatted frame. */
+static char *gc_format_generate_single(
+    const struct can_frame *can_frame, char *buf)
+{
+    *buf++ = ':';
+    if (IS_CAN_FRAME_EFF(*can_frame))
+    {
+        uint32_t id = GET_CAN_FRAME_ID_EFF(*can_frame);
+        uint8_t id_bytes[8] = {(uint8_t)(id >> 24), (uint8_t)(id >> 16),
+            (uint8_t)(id >> 8), (uint8_t)id, 0, 0, 0, 0};
+        *buf++ = 'X';
+        hex_encode_8(id_bytes, buf);
+        buf += 8;
+    }
+    else
+    {
+        uint32_t id = GET_CAN_FRAME_ID(*can_frame);
+        *buf++ = 'S';
+        *buf++ = nibble_to_ascii(id >> 8);
+        *buf++ = nibble_to_ascii(id >> 4);
+        *buf++ = nibble_to_ascii(id);
+    }
+    *buf++ = IS_CAN_FRAME_RTR(*can_frame) ? 'R' : 'N';
+    unsigned dlc = can_frame->can_dlc;
+    if (dlc > 8)
+    {
+        dlc = 8;
+    }
+    uint8_t data[8];
+    memcpy(data, can_frame->data, 8);
+    hex_encode_8(data, buf);
+    buf += 2 * dlc;
+    *buf++ = ';';
+    if (config_gc_generate_newlines() == CONSTANT_TRUE) {
+        *buf++ = '\n';
+    }
+    return buf;
+}
+
+/** Formats a can frame in the GridConnect protocol.
+
+    If requested, it can create the double protocol with leading !!, trailing ;;
+    and all the characters doubled.
+
+    If the input frame is an error frame, then does not output anything and
+    returns the input pointer.
+
+    @param can_frame is the input frame.
+
+    @param buf is the output buffer. The caller must ensure this is big enough
+    to hold the resulting frame (GC_FORMAT_MAX_FRAME_LENGTH bytes, or twice
+    that for the double format).
+
+    @param double_format if non-zero, the doubling format will be generated.
+
+    @return the pointer to the buffer character after the formatted can frame.
+*/
+char* gc_format_generate(const struct can_frame* can_frame, char* buf, int double_format)
+{
+    if (IS_CAN_FRAME_ERR(*can_frame))
+    {
+        LOG(VERBOSE, "GC generate: incoming frame ERR.");
+        return buf;
+    }
+    if (double_format)
+    {
+        return gc_format_generate_double(can_frame, buf);
+    }
+    return gc_format_generate_single(can_frame, buf);
+}
+
+char* gc_format_generate_bulk(const struct can_frame* frames, size_t count, char* buf, int double_format)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (IS_CAN_FRAME_ERR(frames[i]))
+        {
+            continue;
+        }
+        if (double_format)
+        {
+            buf = gc_format_generate_double(frames + i, buf);
+        }
+        else
+        {
+            buf = gc_format_generate_single(frames + i, buf);
+        }
+    }
+    return buf;
+}
+
 }
@@ -34,6 +34,8 @@
 #ifndef _UTILS_GC_FORMAT_H_
 #define _UTILS_GC_FORMAT_H_
 
+#include <stddef.h>
+
 #include "utils/constants.hxx"
 
 #ifdef __cplusplus
@@ -46,6 +48,11 @@ struct can_frame;
 /// packets.
 DECLARE_CONST(gc_generate_newlines);
 
+/// Maximum number of characters gc_format_generate writes for one frame in
+/// the single format, including the optional newline. Double that for the
+/// double format.
+#define GC_FORMAT_MAX_FRAME_LENGTH 29
+
 /** Parses a GridConnect packet.
     
     @param buf points to a character buffer that contains the packet. The
@@ -60,6 +67,23 @@ DECLARE_CONST(gc_generate_newlines);
 */
 int gc_format_parse(const char* buf, struct can_frame* can_frame);
 
+/** Parses a GridConnect packet of known length. Same as gc_format_parse, but
+    the packet does not need to be terminated, so it can be parsed in place
+    from a receive buffer.
+
+    @param buf points to the packet. The leading ':' is optional.
+
+    @param len is the number of characters in the packet, excluding the
+    trailing ';'.
+
+    @param can_frame is the CAN frame that will be filled based on the source
+    packet.
+
+    @return 0 in case of success, -1 if there was a packet format error (in
+    this case the frame is set to an error frame).
+*/
+int gc_format_parse_len(const char* buf, size_t len, struct can_frame* can_frame);
+
 /** Formats a can frame in the GridConnect protocol.
 
     If requested, it can create the double protocol with leading !!, trailing ;;
@@ -71,7 +95,8 @@ int gc_format_parse(const char* buf, struct can_frame* can_frame);
     @param can_frame is the input frame.
 
     @param buf is the output buffer. The caller must ensure this is big enough
-    to hold the resulting frame (28 or 56 bytes).
+    to hold GC_FORMAT_MAX_FRAME_LENGTH bytes (twice that for the double
+    format).
 
     @param double_format if non-zero, the doubling format will be generated.
 
@@ -79,6 +104,24 @@ int gc_format_parse(const char* buf, struct can_frame* can_frame);
 */
 char* gc_format_generate(const struct can_frame* can_frame, char* buf, int double_format);
 
+/** Formats a sequence of CAN frames in the GridConnect protocol into one
+    contiguous buffer. Error frames are skipped.
+
+    @param frames is the array of input frames.
+
+    @param count is the number of entries in frames.
+
+    @param buf is the output buffer. The caller must ensure this is big enough
+    to hold count * GC_FORMAT_MAX_FRAME_LENGTH bytes (twice that for the double
+    format).
+
+    @param double_format if non-zero, the doubling format will be generated.
+
+    @return the pointer to the buffer character after the last formatted can
+    frame.
+*/
+char* gc_format_generate_bulk(const struct can_frame* frames, size_t count, char* buf, int double_format);
+
 #ifdef __cplusplus
 }
 #endif